@@ -5,9 +5,13 @@ in mat3 TBN;
 
 uniform sampler2D uTexture;       // Albedo / base color
 uniform sampler2D uNormalMap;     // Normal map
-uniform sampler2D uRoughnessMap;  // Roughness map
-uniform sampler2D uMetalnessMap;  // Metalness map
-uniform sampler2D uAOMap;         // Ambient Occlusion map
+uniform sampler2D uORMMap;        // Ambient occlusion, roughness, metalness in R, G, B
+// The same maps when they are layers of texture arrays
+uniform sampler2DArray uTextureArray;
+uniform sampler2DArray uNormalMapArray;
+uniform sampler2DArray uORMMapArray;
+uniform float uLayers[3];         // layer of each map, < 0 when it is a 2D texture
+uniform vec4 uLayerTransforms[3]; // scale and offset of each map's part of its layer
 
 uniform bool uCastsShadows;
 
@@ -57,21 +61,35 @@ vec3 FresnelSchlick(float cosTheta, vec3 F0)
     return F0 + (1.0 - F0) * pow(1.0 - cosTheta, 5.0);
 }
 
+// Coordinates wrap within the map's part of the layer; the gradients of the unwrapped
+// coordinates keep the mip level steady across the wrap.
+vec4 SampleMap(sampler2D map, sampler2DArray maps, int index, vec2 uv)
+{
+    if (uLayers[index] < 0.0) return texture(map, uv);
+    vec4 t = uLayerTransforms[index];
+    return textureGrad(maps, vec3(fract(uv) * t.xy + t.zw, uLayers[index]), dFdx(uv) * t.xy, dFdy(uv) * t.xy);
+}
+
 void main()
 {
     if(!uCastsShadows){
-        FragColor = texture(uTexture, fragTexCoord);
+        FragColor = SampleMap(uTexture, uTextureArray, 0, fragTexCoord);
         return;
     }
     // Sample textures
-    vec3 albedo     = pow(texture(uTexture, fragTexCoord).rgb, vec3(2.2)); // gamma correction
-    vec3 tangentNormal = texture(uNormalMap, fragTexCoord).rgb;
-    tangentNormal = normalize(tangentNormal * 2.0 - 1.0);
+    vec3 albedo     = pow(SampleMap(uTexture, uTextureArray, 0, fragTexCoord).rgb, vec3(2.2)); // gamma correction
+    vec3 tangentNormal = SampleMap(uNormalMap, uNormalMapArray, 1, fragTexCoord).rgb * 2.0 - 1.0;
+    // BC5 normal maps keep X and Y and read 0 for blue, which no tangent-space normal has
+    if (tangentNormal.z <= -1.0) {
+        tangentNormal.z = sqrt(max(1.0 - dot(tangentNormal.xy, tangentNormal.xy), 0.0));
+    }
+    tangentNormal = normalize(tangentNormal);
     vec3 N = normalize(TBN * tangentNormal);
 
-    float roughness = texture(uRoughnessMap, fragTexCoord).r;
-    float metallic  = texture(uMetalnessMap, fragTexCoord).r;
-    float ao        = texture(uAOMap, fragTexCoord).r;
+    vec3 orm = SampleMap(uORMMap, uORMMapArray, 2, fragTexCoord).rgb;
+    float ao        = orm.r;
+    float roughness = orm.g;
+    float metallic  = orm.b;
 
     // View vector
     vec3 V = normalize(vec3(0.0, 0.0, 1.0)); // camera pointing along +Z
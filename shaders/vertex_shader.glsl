@@ -1,5 +1,10 @@
 #version 330 core
 
+// Attribute meaning depends on uVertexEncoding (see vertex_format.h):
+//   0: float position, normal, uv and tangent
+//   1: octahedral normal in aNormal.xy, octahedral tangent in aTangent.xy
+//   2: octahedral normal in aNormal.xy, tangent angle / PI in aNormal.z
+// Positions and UVs are always mapped through their scale and offset.
 layout(location = 0) in vec3 aPos;
 layout(location = 1) in vec3 aNormal;
 layout(location = 2) in vec2 aTexCoord;
@@ -9,18 +14,57 @@ uniform mat4 uModel;
 uniform mat4 uView;
 uniform mat4 uProjection;
 
+uniform int uVertexEncoding;
+uniform vec3 uPositionScale;
+uniform vec3 uPositionOffset;
+uniform vec2 uTexCoordScale;
+uniform vec2 uTexCoordOffset;
+
 out vec2 fragTexCoord;
 out mat3 TBN;
 
+const float PI = 3.14159265359;
+
+vec3 OctDecode(vec2 e)
+{
+    vec3 v = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (v.z < 0.0) {
+        v.xy = (1.0 - abs(v.yx)) * vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+    }
+    return normalize(v);
+}
+
+// Same frame as tangentFrame() in vertex_format.c
+vec3 TangentFromAngle(vec3 n, float angle)
+{
+    float s = n.z >= 0.0 ? 1.0 : -1.0;
+    float a = -1.0 / (s + n.z);
+    float b = n.x * n.y * a;
+    vec3 b1 = vec3(1.0 + s * n.x * n.x * a, s * b, -s * n.x);
+    vec3 b2 = vec3(b, s + n.y * n.y * a, -n.y);
+    return cos(angle) * b1 + sin(angle) * b2;
+}
+
 void main()
 {
-    vec4 worldPos = uModel * vec4(aPos, 1.0);
-    fragTexCoord = aTexCoord;
+    vec3 position = aPos * uPositionScale + uPositionOffset;
+    vec3 normal = aNormal;
+    vec3 tangent = aTangent;
+    if (uVertexEncoding == 1) {
+        normal = OctDecode(aNormal.xy);
+        tangent = OctDecode(aTangent.xy);
+    } else if (uVertexEncoding == 2) {
+        normal = OctDecode(aNormal.xy);
+        tangent = TangentFromAngle(normal, aNormal.z * PI);
+    }
+
+    vec4 worldPos = uModel * vec4(position, 1.0);
+    fragTexCoord = aTexCoord * uTexCoordScale + uTexCoordOffset;
     gl_Position = uProjection * uView * worldPos;
 
     // Transform normals/tangents to world space
-    vec3 normalWorld = normalize(mat3(uModel) * aNormal);
-    vec3 tangentWorld = normalize(mat3(uModel) * aTangent);
+    vec3 normalWorld = normalize(mat3(uModel) * normal);
+    vec3 tangentWorld = normalize(mat3(uModel) * tangent);
     vec3 bitangentWorld = normalize(cross(normalWorld, tangentWorld));
 
     TBN = mat3(tangentWorld, bitangentWorld, normalWorld);
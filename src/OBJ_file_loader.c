@@ -1,27 +1,16 @@
-#include "obj_file_loader.h"
+#include "OBJ_file_loader.h"
+#include "file_map.h"
+#include "time_utils.h"
+#include "thread_utils.h"
+#include "geometry_kernels.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <limits.h>
 #include <string.h>
-#include <errno.h>
 #include <math.h>
 #include <sys/stat.h>
 
-#ifdef _WIN32
-#include <direct.h>
-#define getcwd _getcwd
-#else
-#include <unistd.h>
-#endif
-
-static void printWorkingDir(void) {
-    char cwd[512];
-    if (getcwd(cwd, sizeof(cwd))) {
-        fprintf(stderr, "Current working directory: %s\n", cwd);
-    } else {
-        fprintf(stderr, "Warning: unable to get working directory: %s\n", strerror(errno));
-    }
-}
-
 static void initMesh(ObjMesh* mesh) {
     mesh->vertices = NULL;
     mesh->vertex_count = 0;
@@ -33,6 +22,24 @@ static void initMesh(ObjMesh* mesh) {
     mesh->index_count = 0;
     mesh->triangle_vertices = NULL;
     mesh->triangle_vertex_count = 0;
+    mesh->unique_vertices = NULL;
+    mesh->unique_vertex_count = 0;
+    mesh->elements = NULL;
+    mesh->element_count = 0;
+    mesh->material_library[0] = '\0';
+    mesh->material_ranges = NULL;
+    mesh->material_range_count = 0;
+    mesh->submeshes = NULL;
+    mesh->submesh_count = 0;
+    for (int i = 0; i < OBJ_MAX_LODS; ++i) {
+        mesh->lods[i].error = 0.0f;
+        mesh->lods[i].submeshes = NULL;
+    }
+    mesh->lod_count = 0;
+    mesh->bounds_center[0] = mesh->bounds_center[1] = mesh->bounds_center[2] = 0.0f;
+    mesh->bounds_radius = 0.0f;
+    mesh->meshlets = NULL;
+    mesh->meshlet_count = 0;
 }
 
 void freeMesh(ObjMesh* mesh) {
@@ -42,175 +49,990 @@ void freeMesh(ObjMesh* mesh) {
     free(mesh->normals);
     free(mesh->indices);
     free(mesh->triangle_vertices);
+    free(mesh->unique_vertices);
+    free(mesh->elements);
+    free(mesh->material_ranges);
+    free(mesh->submeshes);
+    for (size_t i = 0; i < mesh->lod_count; ++i) {
+        free(mesh->lods[i].submeshes);
+    }
+    free(mesh->meshlets);
     initMesh(mesh);
 }
 
-// Helper to parse a single face vertex token of format "v", "v/vt", "v//vn" or "v/vt/vn"
-static void parseFaceVertex(const char* token, int* vi, int* vti, int* vni) {
-    *vi = -1; *vti = -1; *vni = -1;
+// Record counts for a range of the file, gathered by the counting pass.
+// Also used as the running write offsets while parsing a range.
+typedef struct {
+    size_t positions;
+    size_t texcoords;
+    size_t normals;
+    size_t triangles;
+    size_t lines;
+} ObjCounts;
+
+#define INTS_PER_CORNER 3
+
+static const double kPow10[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static inline int isDigit(char c) {
+    return (unsigned)(c - '0') < 10u;
+}
+
+static inline int isBlank(char c) {
+    return c == ' ' || c == '\t';
+}
 
-    // Copy token to modifiable string
-    char buf[64];
-    strncpy(buf, token, sizeof(buf)-1);
-    buf[sizeof(buf)-1] = 0;
+static inline const char* skipBlanks(const char* p, const char* end) {
+    while (p < end && isBlank(*p)) p++;
+    return p;
+}
 
-    char* ptr = buf;
-    char* slash1 = strchr(ptr, '/');
-    if (!slash1) {
-        // Format: v
-        *vi = atoi(ptr) - 1;
-        return;
+static inline const char* skipToken(const char* p, const char* end) {
+    while (p < end && !isBlank(*p) && *p != '\n' && *p != '\r') p++;
+    return p;
+}
+
+// Locale-independent decimal float parser ("-1.5", "2", ".5e-3").
+// Returns the position after the number, or p unchanged if there is none.
+static const char* parseFloat(const char* p, const char* end, float* out) {
+    const char* start = p;
+    int negative = 0;
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = (*p == '-');
+        p++;
     }
 
-    *slash1 = 0;
-    *vi = atoi(ptr) - 1;
+    uint64_t mantissa = 0;
+    int digits = 0;
+    int exponent = 0;
+    int any = 0;
+
+    while (p < end && isDigit(*p)) {
+        if (digits < 19) {
+            mantissa = mantissa * 10 + (uint64_t)(*p - '0');
+            if (mantissa) digits++;
+        } else {
+            exponent++;
+        }
+        p++;
+        any = 1;
+    }
+    if (p < end && *p == '.') {
+        p++;
+        while (p < end && isDigit(*p)) {
+            if (digits < 19) {
+                mantissa = mantissa * 10 + (uint64_t)(*p - '0');
+                if (mantissa) digits++;
+                exponent--;
+            }
+            p++;
+            any = 1;
+        }
+    }
+    if (!any) return start;
+
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        const char* q = p + 1;
+        int expNegative = 0;
+        if (q < end && (*q == '-' || *q == '+')) {
+            expNegative = (*q == '-');
+            q++;
+        }
+        if (q < end && isDigit(*q)) {
+            int e = 0;
+            while (q < end && isDigit(*q)) {
+                if (e < 10000) e = e * 10 + (*q - '0');
+                q++;
+            }
+            exponent += expNegative ? -e : e;
+            p = q;
+        }
+    }
 
-    char* slash2 = strchr(slash1 + 1, '/');
-    if (!slash2) {
-        // Format: v/vt
-        *vti = atoi(slash1 + 1) - 1;
-        return;
+    double value = (double)mantissa;
+    if (mantissa != 0) {
+        if (exponent < 0) {
+            value = (exponent >= -22) ? value / kPow10[-exponent] : value * pow(10.0, exponent);
+        } else if (exponent > 0) {
+            value = (exponent <= 22) ? value * kPow10[exponent] : value * pow(10.0, exponent);
+        }
+    }
+    *out = (float)(negative ? -value : value);
+    return p;
+}
+
+static const char* parseInt(const char* p, const char* end, int* out) {
+    const char* start = p;
+    int negative = 0;
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = (*p == '-');
+        p++;
+    }
+    if (p >= end || !isDigit(*p)) return start;
+
+    long long value = 0;
+    while (p < end && isDigit(*p)) {
+        if (value < INT_MAX) value = value * 10 + (*p - '0');
+        p++;
+    }
+    if (value > INT_MAX) value = INT_MAX;
+    *out = (int)(negative ? -value : value);
+    return p;
+}
+
+// Turns a 1-based (or negative, relative) OBJ index into a 0-based one.
+// `count` is the number of records of that kind defined so far. Returns -1 if invalid.
+static inline int resolveIndex(int index, size_t count) {
+    if (index > 0) return index - 1;
+    if (index < 0 && (size_t)(-(long long)index) <= count) return (int)((long long)count + index);
+    return -1;
+}
+
+// Parses one face corner token: "v", "v/vt", "v//vn" or "v/vt/vn".
+static const char* parseFaceCorner(const char* p, const char* end, const ObjCounts* seen, int* corner) {
+    int vi = 0, vti = 0, vni = 0;
+
+    p = parseInt(p, end, &vi);
+    if (p < end && *p == '/') {
+        p++;
+        if (p < end && *p != '/') p = parseInt(p, end, &vti);
+        if (p < end && *p == '/') {
+            p++;
+            p = parseInt(p, end, &vni);
+        }
+    }
+
+    corner[0] = resolveIndex(vi, seen->positions);
+    corner[1] = vti ? resolveIndex(vti, seen->texcoords) : -1;
+    corner[2] = vni ? resolveIndex(vni, seen->normals) : -1;
+
+    // Skip whatever is left of a malformed token
+    return skipToken(p, end);
+}
+
+typedef enum {
+    OBJ_RECORD_OTHER,
+    OBJ_RECORD_POSITION,
+    OBJ_RECORD_TEXCOORD,
+    OBJ_RECORD_NORMAL,
+    OBJ_RECORD_FACE,
+    OBJ_RECORD_USEMTL,
+    OBJ_RECORD_MTLLIB
+} ObjRecordType;
+
+// Classifies the line starting at p and advances p past the keyword.
+static inline ObjRecordType recordType(const char** pp, const char* end) {
+    const char* p = skipBlanks(*pp, end);
+    ObjRecordType type = OBJ_RECORD_OTHER;
+    if (p + 1 < end) {
+        if (p[0] == 'v') {
+            if (isBlank(p[1])) { type = OBJ_RECORD_POSITION; p += 2; }
+            else if (p + 2 < end && p[1] == 't' && isBlank(p[2])) { type = OBJ_RECORD_TEXCOORD; p += 3; }
+            else if (p + 2 < end && p[1] == 'n' && isBlank(p[2])) { type = OBJ_RECORD_NORMAL; p += 3; }
+        } else if (p[0] == 'f' && isBlank(p[1])) {
+            type = OBJ_RECORD_FACE;
+            p += 2;
+        } else if (p + 6 < end && isBlank(p[6])) {
+            if (memcmp(p, "usemtl", 6) == 0) { type = OBJ_RECORD_USEMTL; p += 7; }
+            else if (memcmp(p, "mtllib", 6) == 0) { type = OBJ_RECORD_MTLLIB; p += 7; }
+        }
+    }
+    *pp = p;
+    return type;
+}
+
+// First pass: counts records so every array can be allocated exactly once.
+static void countRecords(const char* p, const char* end, ObjCounts* counts) {
+    memset(counts, 0, sizeof(*counts));
+    while (p < end) {
+        const char* lineEnd = (const char*)memchr(p, '\n', (size_t)(end - p));
+        if (!lineEnd) lineEnd = end;
+
+        switch (recordType(&p, lineEnd)) {
+        case OBJ_RECORD_POSITION: counts->positions++; break;
+        case OBJ_RECORD_TEXCOORD: counts->texcoords++; break;
+        case OBJ_RECORD_NORMAL:   counts->normals++;   break;
+        case OBJ_RECORD_FACE: {
+            size_t corners = 0;
+            p = skipBlanks(p, lineEnd);
+            while (p < lineEnd && *p != '\r') {
+                corners++;
+                p = skipBlanks(skipToken(p, lineEnd), lineEnd);
+            }
+            if (corners >= 3) counts->triangles += corners - 2;
+            break;
+        }
+        default: break;
+        }
+
+        counts->lines++;
+        p = lineEnd < end ? lineEnd + 1 : end;
+    }
+}
+
+// Material switches seen while parsing one range of the file.
+typedef struct {
+    size_t triangle;              // first triangle after the usemtl line
+    char name[OBJ_MAX_NAME];
+} ObjMaterialEvent;
+
+typedef struct {
+    ObjMaterialEvent* events;
+    size_t count;
+    size_t capacity;
+    char library[OBJ_MAX_PATH];   // first mtllib in the range
+} ObjMaterialEvents;
+
+// Copies the rest of the line without surrounding blanks. Returns 0 if it was cut to fit.
+static int copyLineValue(const char* p, const char* lineEnd, char* out, size_t outSize) {
+    p = skipBlanks(p, lineEnd);
+    while (lineEnd > p && (isBlank(lineEnd[-1]) || lineEnd[-1] == '\r')) lineEnd--;
+    size_t length = (size_t)(lineEnd - p);
+    int fits = length < outSize;
+    if (!fits) length = outSize - 1;
+    memcpy(out, p, length);
+    out[length] = '\0';
+    return fits;
+}
+
+static void addMaterialEvent(ObjMaterialEvents* materials, size_t triangle, const char* p, const char* lineEnd) {
+    if (materials->count == materials->capacity) {
+        size_t capacity = materials->capacity ? materials->capacity * 2 : 16;
+        ObjMaterialEvent* grown = realloc(materials->events, capacity * sizeof(ObjMaterialEvent));
+        if (!grown) {
+            fprintf(stderr, "Warning: out of memory recording usemtl, material ignored\n");
+            return;
+        }
+        materials->events = grown;
+        materials->capacity = capacity;
+    }
+    ObjMaterialEvent* event = &materials->events[materials->count++];
+    event->triangle = triangle;
+    copyLineValue(p, lineEnd, event->name, sizeof(event->name));
+}
+
+// Second pass: parses the records of [p, end) into the mesh arrays, starting at the
+// offsets in `at`. The range must have been counted with countRecords.
+static void parseRecords(const char* p, const char* end, ObjMesh* mesh, ObjCounts at, ObjMaterialEvents* materials) {
+    while (p < end) {
+        const char* lineEnd = (const char*)memchr(p, '\n', (size_t)(end - p));
+        if (!lineEnd) lineEnd = end;
+        at.lines++;
+
+        ObjRecordType type = recordType(&p, lineEnd);
+        if (type == OBJ_RECORD_POSITION || type == OBJ_RECORD_NORMAL) {
+            float xyz[3] = {0.0f, 0.0f, 0.0f};
+            int parsed = 0;
+            for (; parsed < 3; ++parsed) {
+                const char* s = skipBlanks(p, lineEnd);
+                p = parseFloat(s, lineEnd, &xyz[parsed]);
+                if (p == s) break;
+            }
+            if (parsed < 3) {
+                fprintf(stderr, "Warning: malformed %s at line %zu\n",
+                        type == OBJ_RECORD_POSITION ? "vertex" : "normal", at.lines);
+            }
+            float* dst = (type == OBJ_RECORD_POSITION) ? &mesh->vertices[at.positions++ * 3]
+                                                       : &mesh->normals[at.normals++ * 3];
+            dst[0] = xyz[0];
+            dst[1] = xyz[1];
+            dst[2] = xyz[2];
+        } else if (type == OBJ_RECORD_TEXCOORD) {
+            float uv[2] = {0.0f, 0.0f};
+            const char* s = skipBlanks(p, lineEnd);
+            p = parseFloat(s, lineEnd, &uv[0]);
+            if (p == s) {
+                fprintf(stderr, "Warning: malformed texcoord at line %zu\n", at.lines);
+            } else {
+                parseFloat(skipBlanks(p, lineEnd), lineEnd, &uv[1]);
+            }
+            mesh->texcoords[at.texcoords * 2 + 0] = uv[0];
+            mesh->texcoords[at.texcoords * 2 + 1] = 1.0f - uv[1];
+            at.texcoords++;
+        } else if (type == OBJ_RECORD_FACE) {
+            // Fan triangulation: (first, previous, current) for every corner after the second
+            int first[INTS_PER_CORNER], prev[INTS_PER_CORNER], corner[INTS_PER_CORNER];
+            int cornerCount = 0;
+
+            p = skipBlanks(p, lineEnd);
+            while (p < lineEnd && *p != '\r') {
+                p = skipBlanks(parseFaceCorner(p, lineEnd, &at, corner), lineEnd);
+                if (cornerCount == 0) {
+                    memcpy(first, corner, sizeof(first));
+                } else if (cornerCount >= 2) {
+                    int* dst = &mesh->indices[at.triangles++ * 3 * INTS_PER_CORNER];
+                    memcpy(dst, first, sizeof(first));
+                    memcpy(dst + INTS_PER_CORNER, prev, sizeof(prev));
+                    memcpy(dst + 2 * INTS_PER_CORNER, corner, sizeof(corner));
+                }
+                memcpy(prev, corner, sizeof(prev));
+                cornerCount++;
+            }
+            if (cornerCount < 3) {
+                fprintf(stderr, "Warning: face with less than 3 vertices at line %zu\n", at.lines);
+            }
+        } else if (type == OBJ_RECORD_USEMTL) {
+            addMaterialEvent(materials, at.triangles, p, lineEnd);
+        } else if (type == OBJ_RECORD_MTLLIB && materials->library[0] == '\0') {
+            if (!copyLineValue(p, lineEnd, materials->library, sizeof(materials->library))) {
+                fprintf(stderr, "Warning: mtllib path too long at line %zu, ignored\n", at.lines);
+                materials->library[0] = '\0';
+            }
+        }
+
+        p = lineEnd < end ? lineEnd + 1 : end;
+    }
+}
+
+// Writes pos(3), normal(3), uv(2), tangent(3) for every corner of triangles [first, last).
+// Returns the number of corners that referenced a missing position.
+static size_t expandTriangles(ObjMesh* mesh, size_t first, size_t last) {
+    size_t invalid = 0;
+    size_t positionCount = mesh->vertex_count / 3;
+    size_t texcoordCount = mesh->texcoord_count / 2;
+    size_t normalCount = mesh->normal_count / 3;
+
+    for (size_t c = first * 3; c < last * 3; ++c) {
+        const int* corner = &mesh->indices[c * INTS_PER_CORNER];
+        float* out = &mesh->triangle_vertices[c * FLOATS_PER_VERTEX];
+        int vi = corner[0], vti = corner[1], vni = corner[2];
+
+        if (vi >= 0 && (size_t)vi < positionCount) {
+            out[0] = mesh->vertices[vi * 3 + 0];
+            out[1] = mesh->vertices[vi * 3 + 1];
+            out[2] = mesh->vertices[vi * 3 + 2];
+        } else {
+            out[0] = out[1] = out[2] = 0.0f;
+            invalid++;
+        }
+
+        if (vni >= 0 && (size_t)vni < normalCount) {
+            out[3] = mesh->normals[vni * 3 + 0];
+            out[4] = mesh->normals[vni * 3 + 1];
+            out[5] = mesh->normals[vni * 3 + 2];
+        } else {
+            out[3] = out[4] = out[5] = 0.0f;
+        }
+
+        if (vti >= 0 && (size_t)vti < texcoordCount) {
+            out[6] = mesh->texcoords[vti * 2 + 0];
+            out[7] = mesh->texcoords[vti * 2 + 1];
+        } else {
+            out[6] = out[7] = 1.0f;
+        }
+
+        out[8] = out[9] = out[10] = 0.0f; // tangent, filled by ComputeTangents
+    }
+    return invalid;
+}
+
+static int allocateMesh(ObjMesh* mesh, const ObjCounts* total) {
+    // +1 keeps every allocation non-empty so NULL always means out of memory
+    mesh->vertices = malloc((total->positions * 3 + 1) * sizeof(float));
+    mesh->texcoords = malloc((total->texcoords * 2 + 1) * sizeof(float));
+    mesh->normals = malloc((total->normals * 3 + 1) * sizeof(float));
+    mesh->indices = malloc((total->triangles * 3 * INTS_PER_CORNER + 1) * sizeof(int));
+    mesh->triangle_vertices = malloc((total->triangles * 3 * FLOATS_PER_VERTEX + 1) * sizeof(float));
+    if (!mesh->vertices || !mesh->texcoords || !mesh->normals || !mesh->indices || !mesh->triangle_vertices) {
+        freeMesh(mesh);
+        return 1;
+    }
+
+    mesh->vertex_count = total->positions * 3;
+    mesh->texcoord_count = total->texcoords * 2;
+    mesh->normal_count = total->normals * 3;
+    mesh->index_count = total->triangles * 3 * INTS_PER_CORNER;
+    mesh->triangle_vertex_count = total->triangles * 3 * FLOATS_PER_VERTEX;
+    return 0;
+}
+
+static void finishMesh(ObjMesh* mesh) {
+    for (int i = 0; i < 16; ++i) {
+        mesh->transform[i] = (i % 5 == 0) ? 1.0f : 0.0f; // Identity matrix
+    }
+
+    for (int i = 0; i < 3; ++i) {
+        mesh->color[i] = 1.0f;
+    }
+}
+
+#define OBJ_MIN_CHUNK_BYTES (256 * 1024)
+#define OBJ_CHUNKS_PER_THREAD 4
+#define OBJ_EXPAND_TRIANGLES_PER_TASK 65536
+
+typedef struct {
+    const char* begin;
+    const char* end;
+    ObjCounts counts;   // records in this chunk
+    ObjCounts base;     // records in all earlier chunks
+    ObjMaterialEvents materials;
+} ObjChunk;
+
+typedef struct {
+    ObjMesh* mesh;
+    ObjChunk* chunks;
+    size_t triangleCount;
+    size_t* invalidCorners; // one slot per expand task
+} ObjParseJob;
+
+static void countChunkTask(void* context, int index) {
+    ObjParseJob* job = (ObjParseJob*)context;
+    ObjChunk* chunk = &job->chunks[index];
+    countRecords(chunk->begin, chunk->end, &chunk->counts);
+}
+
+static void parseChunkTask(void* context, int index) {
+    ObjParseJob* job = (ObjParseJob*)context;
+    ObjChunk* chunk = &job->chunks[index];
+    parseRecords(chunk->begin, chunk->end, job->mesh, chunk->base, &chunk->materials);
+}
+
+static void expandTask(void* context, int index) {
+    ObjParseJob* job = (ObjParseJob*)context;
+    size_t first = (size_t)index * OBJ_EXPAND_TRIANGLES_PER_TASK;
+    size_t last = first + OBJ_EXPAND_TRIANGLES_PER_TASK;
+    if (last > job->triangleCount) last = job->triangleCount;
+    job->invalidCorners[index] = expandTriangles(job->mesh, first, last);
+}
+
+// Splits [begin, end) into at most maxChunks pieces that each end on a line break.
+static int splitChunks(const char* begin, const char* end, int maxChunks, ObjChunk* chunks) {
+    size_t size = (size_t)(end - begin);
+    int count = 0;
+    const char* p = begin;
+    for (int i = 1; i <= maxChunks && p < end; ++i) {
+        const char* cut = (i == maxChunks) ? end : begin + size / (size_t)maxChunks * (size_t)i;
+        if (cut < p) cut = p;
+        if (cut < end) {
+            const char* nl = (const char*)memchr(cut, '\n', (size_t)(end - cut));
+            cut = nl ? nl + 1 : end;
+        }
+        chunks[count].begin = p;
+        chunks[count].end = cut;
+        count++;
+        p = cut;
+    }
+    return count;
+}
+
+// Turns the per-chunk usemtl events into material ranges covering every triangle, and
+// resolves the mtllib name against the folder of the OBJ.
+static int buildMaterialRanges(ObjMesh* mesh, const char* filename, const ObjChunk* chunks, int chunkCount,
+                               size_t triangleCount) {
+    size_t eventCount = 0;
+    const char* library = NULL;
+    for (int i = 0; i < chunkCount; ++i) {
+        eventCount += chunks[i].materials.count;
+        if (!library && chunks[i].materials.library[0]) library = chunks[i].materials.library;
     }
 
-    *slash2 = 0;
-    if (slash1 + 1 != slash2) {
-        // Format: v/vt/vn
-        *vti = atoi(slash1 + 1) - 1;
+    if (library) {
+        const char* slash = strrchr(filename, '/');
+        const char* backslash = strrchr(filename, '\\');
+        if (backslash && (!slash || backslash > slash)) slash = backslash;
+        int dirLength = slash ? (int)(slash - filename + 1) : 0;
+        int length = snprintf(mesh->material_library, sizeof(mesh->material_library), "%.*s%s", dirLength, filename,
+                              library);
+        if (length < 0 || (size_t)length >= sizeof(mesh->material_library)) {
+            // A truncated path could name a different file
+            fprintf(stderr, "Warning: mtllib path too long, materials ignored: %.*s%s\n", dirLength, filename, library);
+            mesh->material_library[0] = '\0';
+        }
+    }
+    if (eventCount == 0 || triangleCount == 0) return 0;
+
+    // At most one range per event plus the faces before the first usemtl
+    ObjMaterialRange* ranges = malloc((eventCount + 1) * sizeof(ObjMaterialRange));
+    if (!ranges) return 2;
+
+    size_t rangeCount = 0;
+    const char* name = "";
+    size_t start = 0;
+    for (int i = 0; i <= chunkCount; ++i) {
+        size_t events = (i < chunkCount) ? chunks[i].materials.count : 1;
+        for (size_t e = 0; e < events; ++e) {
+            const ObjMaterialEvent* event = (i < chunkCount) ? &chunks[i].materials.events[e] : NULL;
+            size_t next = event ? event->triangle : triangleCount;
+            if (next > start) {
+                if (rangeCount > 0 && strcmp(ranges[rangeCount - 1].name, name) == 0) {
+                    ranges[rangeCount - 1].triangleCount += next - start;
+                } else {
+                    ObjMaterialRange* range = &ranges[rangeCount++];
+                    snprintf(range->name, sizeof(range->name), "%s", name);
+                    range->firstTriangle = start;
+                    range->triangleCount = next - start;
+                }
+                start = next;
+            }
+            if (event) name = event->name;
+        }
     }
-    *vni = atoi(slash2 + 1) - 1;
+
+    mesh->material_ranges = ranges;
+    mesh->material_range_count = rangeCount;
+    return 0;
 }
 
 int LoadOBJ(const char* filename, ObjMesh* mesh) {
+    return LoadOBJThreaded(filename, mesh, 1);
+}
+
+int LoadOBJThreaded(const char* filename, ObjMesh* mesh, int threadCount) {
     if (!filename || !mesh) {
         fprintf(stderr, "LoadOBJ error: null pointer provided\n");
         return 1;
     }
 
-    printWorkingDir();
+    initMesh(mesh);
 
-    FILE* file = fopen(filename, "r");
-    if (!file) {
-        fprintf(stderr, "Error: failed to open OBJ file '%s': %s\n", filename, strerror(errno));
+    FileMap map;
+    if (FileMap_Open(filename, &map)) {
+        fprintf(stderr, "Error: failed to open OBJ file '%s'\n", filename);
         return 1;
     }
+    size_t fileSize = map.size;
 
-    initMesh(mesh);
+    if (threadCount < 1) threadCount = 1;
+    int maxChunks = (threadCount == 1) ? 1 : threadCount * OBJ_CHUNKS_PER_THREAD;
+    if ((size_t)maxChunks > fileSize / OBJ_MIN_CHUNK_BYTES) {
+        maxChunks = (int)(fileSize / OBJ_MIN_CHUNK_BYTES);
+        if (maxChunks < 1) maxChunks = 1;
+    }
+
+    ObjChunk* chunks = calloc((size_t)maxChunks, sizeof(ObjChunk));
+    if (!chunks) {
+        FileMap_Close(&map);
+        return 2;
+    }
+    int chunkCount = splitChunks(map.data, map.data + fileSize, maxChunks, chunks);
+
+    ObjParseJob job;
+    job.mesh = mesh;
+    job.chunks = chunks;
+
+    ParallelFor(chunkCount, threadCount, countChunkTask, &job);
+
+    // Prefix sums give every chunk its global write offsets, so the merged result
+    // has the same indices and face order as a single pass over the file.
+    ObjCounts total = {0};
+    for (int i = 0; i < chunkCount; ++i) {
+        chunks[i].base = total;
+        total.positions += chunks[i].counts.positions;
+        total.texcoords += chunks[i].counts.texcoords;
+        total.normals += chunks[i].counts.normals;
+        total.triangles += chunks[i].counts.triangles;
+        total.lines += chunks[i].counts.lines;
+    }
+
+    if (allocateMesh(mesh, &total)) {
+        fprintf(stderr, "Error: out of memory allocating mesh for '%s'\n", filename);
+        free(chunks);
+        FileMap_Close(&map);
+        return 2;
+    }
+
+    ParallelFor(chunkCount, threadCount, parseChunkTask, &job);
+    int materialError = buildMaterialRanges(mesh, filename, chunks, chunkCount, total.triangles);
+    for (int i = 0; i < chunkCount; ++i) {
+        free(chunks[i].materials.events);
+    }
+    free(chunks);
+    FileMap_Close(&map);
+    if (materialError) {
+        freeMesh(mesh);
+        return 2;
+    }
+
+    int expandTasks = (int)((total.triangles + OBJ_EXPAND_TRIANGLES_PER_TASK - 1) / OBJ_EXPAND_TRIANGLES_PER_TASK);
+    size_t invalid = 0;
+    if (expandTasks > 0) {
+        job.triangleCount = total.triangles;
+        job.invalidCorners = calloc((size_t)expandTasks, sizeof(size_t));
+        if (!job.invalidCorners) {
+            freeMesh(mesh);
+            return 2;
+        }
+        ParallelFor(expandTasks, threadCount, expandTask, &job);
+        for (int i = 0; i < expandTasks; ++i) {
+            invalid += job.invalidCorners[i];
+        }
+        free(job.invalidCorners);
+    }
+    if (invalid) {
+        fprintf(stderr, "Warning: %zu face corners in '%s' reference missing vertices\n", invalid, filename);
+    }
+
+    finishMesh(mesh);
+    return 0;
+}
+
+// Attribute records seen so far. Faces may reference any earlier record, so these are
+// the only part of the import that grows with the file (12/8/12 bytes per v/vt/vn).
+typedef struct {
+    float* data;
+    size_t count;       // floats
+    size_t capacity;    // floats
+} ObjFloatPool;
+
+typedef struct {
+    ObjStreamSink sink;
+    void* user;
+    ObjStreamStats* stats;
+
+    ObjFloatPool positions;
+    ObjFloatPool texcoords;
+    ObjFloatPool normals;
+
+    size_t maxVertices;
+    size_t maxIndices;
+    float* vertices;
+    int* keys;              // (v, vt, vn) of every chunk vertex
+    size_t vertexCount;
+    uint32_t* indices;
+    size_t indexCount;
+    uint32_t* table;        // chunk vertex + 1, 0 = empty
+    size_t tableSize;
+
+    size_t firstTriangle;
+    size_t invalidCorners;
+    size_t fixedBytes;      // read buffer and chunk buffers
+    int stopped;
+} ObjStreamState;
+
+static void updatePeak(ObjStreamState* state) {
+    size_t attributes = (state->positions.capacity + state->texcoords.capacity + state->normals.capacity) * sizeof(float);
+    if (attributes + state->fixedBytes > state->stats->peak_bytes) {
+        state->stats->peak_bytes = attributes + state->fixedBytes;
+        state->stats->attribute_bytes = attributes;
+    }
+}
+
+static int pushFloats(ObjStreamState* state, ObjFloatPool* pool, const float* values, size_t count) {
+    if (pool->count + count > pool->capacity) {
+        size_t capacity = pool->capacity ? pool->capacity * 2 : 3 * 4096;
+        float* grown = realloc(pool->data, capacity * sizeof(float));
+        if (!grown) return 1;
+        pool->data = grown;
+        pool->capacity = capacity;
+        updatePeak(state);
+    }
+    memcpy(&pool->data[pool->count], values, count * sizeof(float));
+    pool->count += count;
+    return 0;
+}
+
+static inline uint32_t hashCornerKey(const int* key) {
+    uint32_t h = 2166136261u;
+    for (int i = 0; i < INTS_PER_CORNER; ++i) {
+        h = (h ^ (uint32_t)key[i]) * 16777619u;
+        h ^= h >> 15;
+    }
+    return h;
+}
+
+// Turns the per-face tangents summed into each vertex into a unit tangent orthogonal to
+// the vertex normal. Vertices without tangents keep a zero tangent.
+static void orthonormalizeTangents(float* vertices, size_t vertexCount) {
+    for (size_t i = 0; i < vertexCount; ++i) {
+        float* v = &vertices[i * FLOATS_PER_VERTEX];
+        float* t = v + 8;
+        if (t[0] == 0.0f && t[1] == 0.0f && t[2] == 0.0f) continue;
+        float normalLength = sqrtf(v[3] * v[3] + v[4] * v[4] + v[5] * v[5]);
+        if (normalLength > 0.0f) {
+            float n[3] = {v[3] / normalLength, v[4] / normalLength, v[5] / normalLength};
+            VertexFormat_OrthogonalTangent(n, t, t);
+        } else {
+            float length = sqrtf(t[0] * t[0] + t[1] * t[1] + t[2] * t[2]);
+            t[0] /= length;
+            t[1] /= length;
+            t[2] /= length;
+        }
+    }
+}
+
+// Normalises the accumulated face normals of corners that had no vn and the accumulated
+// tangents, emits the chunk and starts an empty one.
+static void flushStreamChunk(ObjStreamState* state) {
+    if (state->indexCount == 0 || state->stopped) return;
+
+    for (size_t i = 0; i < state->vertexCount; ++i) {
+        if (state->keys[i * INTS_PER_CORNER + 2] >= 0) continue;
+        float* n = &state->vertices[i * FLOATS_PER_VERTEX + 3];
+        float length = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        if (length > 0.0f) {
+            n[0] /= length;
+            n[1] /= length;
+            n[2] /= length;
+        }
+    }
+    orthonormalizeTangents(state->vertices, state->vertexCount);
+
+    ObjStreamChunk chunk;
+    chunk.vertices = state->vertices;
+    chunk.vertex_count = state->vertexCount;
+    chunk.indices = state->indices;
+    chunk.index_count = state->indexCount;
+    chunk.first_triangle = state->firstTriangle;
+    if (state->sink(&chunk, state->user)) state->stopped = 1;
+
+    state->stats->vertices += state->vertexCount;
+    state->stats->chunks++;
+    state->firstTriangle += state->indexCount / 3;
+    state->vertexCount = 0;
+    state->indexCount = 0;
+    memset(state->table, 0, state->tableSize * sizeof(uint32_t));
+}
+
+// Returns the chunk vertex for an OBJ corner, creating it on first use.
+static uint32_t streamVertex(ObjStreamState* state, const int* corner) {
+    size_t slot = hashCornerKey(corner) & (state->tableSize - 1);
+    while (state->table[slot] != 0) {
+        const int* key = &state->keys[(size_t)(state->table[slot] - 1) * INTS_PER_CORNER];
+        if (key[0] == corner[0] && key[1] == corner[1] && key[2] == corner[2]) {
+            return state->table[slot] - 1;
+        }
+        slot = (slot + 1) & (state->tableSize - 1);
+    }
 
-    char line[512];
-    int lineNumber = 0;
+    uint32_t index = (uint32_t)state->vertexCount++;
+    state->table[slot] = index + 1;
+    memcpy(&state->keys[index * INTS_PER_CORNER], corner, INTS_PER_CORNER * sizeof(int));
 
-    while (fgets(line, sizeof(line), file)) {
-        lineNumber++;
+    float* out = &state->vertices[index * FLOATS_PER_VERTEX];
+    int vi = corner[0], vti = corner[1], vni = corner[2];
+    if (vi >= 0 && (size_t)vi < state->positions.count / 3) {
+        memcpy(out, &state->positions.data[vi * 3], 3 * sizeof(float));
+    } else {
+        out[0] = out[1] = out[2] = 0.0f;
+        state->invalidCorners++;
+    }
+    if (vni >= 0 && (size_t)vni < state->normals.count / 3) {
+        memcpy(out + 3, &state->normals.data[vni * 3], 3 * sizeof(float));
+    } else {
+        out[3] = out[4] = out[5] = 0.0f;
+    }
+    if (vti >= 0 && (size_t)vti < state->texcoords.count / 2) {
+        memcpy(out + 6, &state->texcoords.data[vti * 2], 2 * sizeof(float));
+    } else {
+        out[6] = out[7] = 1.0f;
+    }
+    out[8] = out[9] = out[10] = 0.0f;
+    return index;
+}
+
+static void streamTriangle(ObjStreamState* state, const int* c0, const int* c1, const int* c2) {
+    if (state->vertexCount + 3 > state->maxVertices || state->indexCount + 3 > state->maxIndices) {
+        flushStreamChunk(state);
+    }
+
+    uint32_t i0 = streamVertex(state, c0);
+    uint32_t i1 = streamVertex(state, c1);
+    uint32_t i2 = streamVertex(state, c2);
+    state->indices[state->indexCount++] = i0;
+    state->indices[state->indexCount++] = i1;
+    state->indices[state->indexCount++] = i2;
+
+    float* v0 = &state->vertices[i0 * FLOATS_PER_VERTEX];
+    float* v1 = &state->vertices[i1 * FLOATS_PER_VERTEX];
+    float* v2 = &state->vertices[i2 * FLOATS_PER_VERTEX];
+    float e1[3] = {v1[0] - v0[0], v1[1] - v0[1], v1[2] - v0[2]};
+    float e2[3] = {v2[0] - v0[0], v2[1] - v0[1], v2[2] - v0[2]};
+
+    // Same per-face tangent as ComputeTangents, summed per vertex like BuildIndexedMesh and
+    // orthonormalised when the chunk is flushed
+    float s1 = v1[6] - v0[6], t1 = v1[7] - v0[7];
+    float s2 = v2[6] - v0[6], t2 = v2[7] - v0[7];
+    float r = s1 * t2 - s2 * t1;
+    r = (fabsf(r) < 1e-8f) ? 1.0f : 1.0f / r;
+    float tangent[3] = {(t2 * e1[0] - t1 * e2[0]) * r, (t2 * e1[1] - t1 * e2[1]) * r, (t2 * e1[2] - t1 * e2[2]) * r};
+
+    // Unnormalised cross product: larger faces weigh more
+    float normal[3] = {e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0]};
+
+    const int* corners[3] = {c0, c1, c2};
+    float* vertices[3] = {v0, v1, v2};
+    for (int j = 0; j < 3; ++j) {
+        vertices[j][8] += tangent[0];
+        vertices[j][9] += tangent[1];
+        vertices[j][10] += tangent[2];
+        if (corners[j][2] < 0) {
+            vertices[j][3] += normal[0];
+            vertices[j][4] += normal[1];
+            vertices[j][5] += normal[2];
+        }
+    }
+}
 
-        if (line[0] == 'v' && line[1] == ' ') {
-            float x, y, z;
-            if (sscanf(line + 2, "%f %f %f", &x, &y, &z) == 3) {
-                float* tmp = realloc(mesh->vertices, (mesh->vertex_count + 3) * sizeof(float));
-                if (!tmp) {
-                    fprintf(stderr, "Error: out of memory expanding vertices at line %d\n", lineNumber);
-                    fclose(file);
-                    return 2;
+static int streamLines(ObjStreamState* state, const char* p, const char* end, ObjCounts* seen) {
+    while (p < end && !state->stopped) {
+        const char* lineEnd = (const char*)memchr(p, '\n', (size_t)(end - p));
+        if (!lineEnd) lineEnd = end;
+        seen->lines++;
+
+        ObjRecordType type = recordType(&p, lineEnd);
+        if (type == OBJ_RECORD_POSITION || type == OBJ_RECORD_NORMAL) {
+            float xyz[3] = {0.0f, 0.0f, 0.0f};
+            for (int i = 0; i < 3; ++i) {
+                const char* s = skipBlanks(p, lineEnd);
+                p = parseFloat(s, lineEnd, &xyz[i]);
+                if (p == s) {
+                    fprintf(stderr, "Warning: malformed %s at line %zu\n",
+                            type == OBJ_RECORD_POSITION ? "vertex" : "normal", seen->lines);
+                    break;
                 }
-                mesh->vertices = tmp;
-                mesh->vertices[mesh->vertex_count++] = x;
-                mesh->vertices[mesh->vertex_count++] = y;
-                mesh->vertices[mesh->vertex_count++] = z;
-            } else {
-                fprintf(stderr, "Warning: malformed vertex at line %d: %s", lineNumber, line);
             }
-        } else if (strncmp(line, "vt ", 3) == 0) {
-            float u = 0.0f, v = 0.0f;
-            if (sscanf(line + 3, "%f %f", &u, &v) >= 1) {
-                float* tmp = realloc(mesh->texcoords, (mesh->texcoord_count + 2) * sizeof(float));
-                if (!tmp) {
-                    fprintf(stderr, "Error: out of memory expanding texcoords at line %d\n", lineNumber);
-                    fclose(file);
-                    return 2;
-                }
-                mesh->texcoords = tmp;
-                mesh->texcoords[mesh->texcoord_count++] = u;
-                v = 1.0f - v;
-
-                mesh->texcoords[mesh->texcoord_count++] = v;
+            ObjFloatPool* pool = (type == OBJ_RECORD_POSITION) ? &state->positions : &state->normals;
+            if (pushFloats(state, pool, xyz, 3)) return 2;
+            if (type == OBJ_RECORD_POSITION) seen->positions++;
+            else seen->normals++;
+        } else if (type == OBJ_RECORD_TEXCOORD) {
+            float uv[2] = {0.0f, 0.0f};
+            const char* s = skipBlanks(p, lineEnd);
+            p = parseFloat(s, lineEnd, &uv[0]);
+            if (p == s) {
+                fprintf(stderr, "Warning: malformed texcoord at line %zu\n", seen->lines);
             } else {
-                fprintf(stderr, "Warning: malformed texcoord at line %d: %s", lineNumber, line);
+                parseFloat(skipBlanks(p, lineEnd), lineEnd, &uv[1]);
             }
-        } else if (strncmp(line, "vn ", 3) == 0) {
-            float nx, ny, nz;
-            if (sscanf(line + 3, "%f %f %f", &nx, &ny, &nz) == 3) {
-                float* tmp = realloc(mesh->normals, (mesh->normal_count + 3) * sizeof(float));
-                if (!tmp) {
-                    fprintf(stderr, "Error: out of memory expanding normals at line %d\n", lineNumber);
-                    fclose(file);
-                    return 2;
+            uv[1] = 1.0f - uv[1];
+            if (pushFloats(state, &state->texcoords, uv, 2)) return 2;
+            seen->texcoords++;
+        } else if (type == OBJ_RECORD_FACE) {
+            int first[INTS_PER_CORNER], prev[INTS_PER_CORNER], corner[INTS_PER_CORNER];
+            int cornerCount = 0;
+            p = skipBlanks(p, lineEnd);
+            while (p < lineEnd && *p != '\r') {
+                p = skipBlanks(parseFaceCorner(p, lineEnd, seen, corner), lineEnd);
+                if (cornerCount == 0) {
+                    memcpy(first, corner, sizeof(first));
+                } else if (cornerCount >= 2) {
+                    streamTriangle(state, first, prev, corner);
+                    seen->triangles++;
                 }
-                mesh->normals = tmp;
-                mesh->normals[mesh->normal_count++] = nx;
-                mesh->normals[mesh->normal_count++] = ny;
-                mesh->normals[mesh->normal_count++] = nz;
-            } else {
-                fprintf(stderr, "Warning: malformed normal at line %d: %s", lineNumber, line);
+                memcpy(prev, corner, sizeof(prev));
+                cornerCount++;
+            }
+            if (cornerCount < 3) {
+                fprintf(stderr, "Warning: face with less than 3 vertices at line %zu\n", seen->lines);
             }
-        } else if (line[0] == 'f' && line[1] == ' ') {
-    int maxFaceVerts = 64;
-    int* vis  = malloc(maxFaceVerts * sizeof(int));
-    int* vnis = malloc(maxFaceVerts * sizeof(int));
-    int* vtis = malloc(maxFaceVerts * sizeof(int));
-    int faceVertexCount = 0;
-
-    char* token = strtok(line + 2, " \t\r\n");
-    while (token && faceVertexCount < maxFaceVerts) {
-        int vi, vti, vni;
-        parseFaceVertex(token, &vi, &vti, &vni);
-
-        vis[faceVertexCount]  = vi;
-        vtis[faceVertexCount] = vti;
-        vnis[faceVertexCount] = vni;
-
-        faceVertexCount++;
-        token = strtok(NULL, " \t\r\n");
-    }
-
-    if (faceVertexCount < 3) {
-        fprintf(stderr, "Warning: face with less than 3 vertices at line %d\n", lineNumber);
-    } else if (faceVertexCount == 3) {
-        AddFaceAsTriangles(mesh, vis, vnis, vtis, 3, lineNumber);
-    } else {
-        // Fan triangulation for n-gon
-        for (int i = 1; i < faceVertexCount - 1; i++) {
-            int tri[3]   = { vis[0], vis[i], vis[i+1] };
-            int tri_n[3] = { vnis[0], vnis[i], vnis[i+1] };
-            int tri_t[3] = { vtis[0], vtis[i], vtis[i+1] };
-            AddFaceAsTriangles(mesh, tri, tri_n, tri_t, 3, lineNumber);
-        }
-        if (lineNumber % 1000 == 0) {
-            printf("Triangulated an n-gon with %d vertices at line %d\n", faceVertexCount, lineNumber);
-            
         }
-    }
 
-    free(vis);
-    free(vnis);
-    free(vtis);
+        p = lineEnd < end ? lineEnd + 1 : end;
+    }
+    return 0;
 }
+
+int LoadOBJStreaming(const char* filename, size_t chunkVertices, ObjStreamSink sink, void* user,
+                     ObjStreamStats* stats) {
+    if (!filename || !sink) {
+        fprintf(stderr, "LoadOBJStreaming error: null pointer provided\n");
+        return 1;
+    }
+    if (chunkVertices < 3) chunkVertices = 3;
+    if (chunkVertices > UINT32_MAX) chunkVertices = UINT32_MAX;
+
+    ObjStreamStats localStats;
+    if (!stats) stats = &localStats;
+    memset(stats, 0, sizeof(*stats));
+
+    double startTime = GetTimeSeconds();
+
+    FILE* f = fopen(filename, "rb");
+    if (!f) {
+        fprintf(stderr, "Error: failed to open OBJ file '%s'\n", filename);
+        return 1;
     }
 
-    if (ferror(file)) {
-        fprintf(stderr, "Error reading file '%s' at line %d: %s\n", filename, lineNumber, strerror(errno));
-        fclose(file);
-        return 3;
+    ObjStreamState state;
+    memset(&state, 0, sizeof(state));
+    state.sink = sink;
+    state.user = user;
+    state.stats = stats;
+    state.maxVertices = chunkVertices;
+    state.maxIndices = chunkVertices * OBJ_STREAM_INDICES_PER_VERTEX;
+    state.tableSize = 1;
+    while (state.tableSize < chunkVertices * 2) state.tableSize <<= 1;
+
+    char* buffer = malloc(OBJ_STREAM_BUFFER_BYTES);
+    state.vertices = malloc(state.maxVertices * FLOATS_PER_VERTEX * sizeof(float));
+    state.keys = malloc(state.maxVertices * INTS_PER_CORNER * sizeof(int));
+    state.indices = malloc(state.maxIndices * sizeof(uint32_t));
+    state.table = calloc(state.tableSize, sizeof(uint32_t));
+    state.fixedBytes = OBJ_STREAM_BUFFER_BYTES + state.maxVertices * (FLOATS_PER_VERTEX * sizeof(float) + INTS_PER_CORNER * sizeof(int)) +
+                       state.maxIndices * sizeof(uint32_t) + state.tableSize * sizeof(uint32_t);
+    updatePeak(&state);
+
+    int result = 0;
+    if (!buffer || !state.vertices || !state.keys || !state.indices || !state.table) {
+        fprintf(stderr, "Error: out of memory streaming '%s'\n", filename);
+        result = 2;
     }
 
-    fclose(file);
+    // Only whole lines are parsed; the partial last line moves to the front of the buffer
+    ObjCounts seen = {0};
+    size_t filled = 0;
+    size_t fileSize = 0;
+    while (result == 0 && !state.stopped) {
+        size_t wanted = OBJ_STREAM_BUFFER_BYTES - filled;
+        size_t got = fread(buffer + filled, 1, wanted, f);
+        int last = got < wanted;
+        filled += got;
+        fileSize += got;
+
+        const char* end = buffer + filled;
+        const char* stop = end;
+        if (!last) {
+            while (stop > buffer && stop[-1] != '\n') stop--;
+            if (stop == buffer) {
+                fprintf(stderr, "Warning: line longer than %d bytes split at line %zu\n",
+                        OBJ_STREAM_BUFFER_BYTES, seen.lines + 1);
+                stop = end;
+            }
+        }
 
-    for (int i = 0; i < 16; ++i) {
-        mesh->transform[i] = (i % 5 == 0) ? 1.0f : 0.0f; // Identity matrix
+        result = streamLines(&state, buffer, stop, &seen);
+        filled = (size_t)(end - stop);
+        memmove(buffer, stop, filled);
+        if (last) break;
+    }
+    if (ferror(f)) {
+        fprintf(stderr, "Error: failed reading '%s'\n", filename);
+        result = 1;
     }
+    fclose(f);
 
-    for (int i = 0; i < 3; ++i) {
-        mesh->color[i] = 1.0f;
+    if (result == 0) flushStreamChunk(&state);
+    if (state.invalidCorners) {
+        fprintf(stderr, "Warning: %zu face corners in '%s' reference missing vertices\n", state.invalidCorners, filename);
     }
-    return 0;
+
+    stats->positions = seen.positions;
+    stats->texcoords = seen.texcoords;
+    stats->normals = seen.normals;
+    stats->triangles = seen.triangles;
+
+    free(buffer);
+    free(state.vertices);
+    free(state.keys);
+    free(state.indices);
+    free(state.table);
+    free(state.positions.data);
+    free(state.texcoords.data);
+    free(state.normals.data);
+    if (result) return result;
+
+    // What LoadOBJ would have held at its peak: mapping, attributes, corners and the soup
+    size_t wholeMeshBytes = fileSize + (seen.positions * 3 + seen.texcoords * 2 + seen.normals * 3) * sizeof(float) +
+                            seen.triangles * 3 * (INTS_PER_CORNER * sizeof(int) + FLOATS_PER_VERTEX * sizeof(float));
+    double seconds = GetTimeSeconds() - startTime;
+    printf("[LoadOBJStreaming] %s: %.2f MB in %.1f ms, %zu triangles in %zu chunks (<= %zu vertices), "
+           "peak scratch %zu KB (%zu KB attribute pools) vs %zu KB for LoadOBJ\n",
+           filename, (double)fileSize / (1024.0 * 1024.0), seconds * 1000.0, seen.triangles, stats->chunks,
+           chunkVertices, stats->peak_bytes / 1024, stats->attribute_bytes / 1024, wholeMeshBytes / 1024);
+    return state.stopped ? 3 : 0;
 }
 
 void printVertices(const ObjMesh* mesh) {
@@ -249,39 +1071,17 @@ static inline int sameVertex(const float* v1, const float* v2, float eps) {
            nearlyEqual(v1[2], v2[2], eps);
 }
 
-static int FileExists(const char* filename) {
-    struct stat buffer;
-    return (stat(filename, &buffer) == 0);
-}
-
 
 typedef struct {
     float x, y, z;
 } Vec3;
 
 
-#define EPSILON 1e-4f
-#define ANGLE_THRESHOLD cosf(45.0f * 3.14159f / 180.0f)
-#define FLOATS_PER_VERTEX 11
-
-// Simple hash table entry for vertex groups
-typedef struct VertexGroup {
-    Vec3 pos;
-    size_t* indices;   // indices of vertices with this position
-    size_t count;
-    size_t capacity;
-    struct VertexGroup* next;
-} VertexGroup;
-
-#define HASH_SIZE 4096
-
-// Hash function for Vec3
-static unsigned int Vec3Hash(const Vec3* v) {
-    int ix = (int)(v->x / EPSILON);
-    int iy = (int)(v->y / EPSILON);
-    int iz = (int)(v->z / EPSILON);
-    return (unsigned int)((ix*73856093) ^ (iy*19349663) ^ (iz*83492791)) % HASH_SIZE;
-}
+#define EPSILON SMOOTH_NORMALS_EPSILON
+#define ANGLE_THRESHOLD cosf(SMOOTH_NORMALS_ANGLE_DEGREES * 3.14159f / 180.0f)
+// Positions are bucketed into cells this many EPSILONs wide. A corner only probes the next
+// cell on an axis when it lies within EPSILON of that side, so most corners probe one cell.
+#define SMOOTH_CELL_EPSILONS 16.0f
 
 // Compare two vertices within EPSILON
 static int Vec3Equal(const Vec3* a, const Vec3* b) {
@@ -290,288 +1090,997 @@ static int Vec3Equal(const Vec3* a, const Vec3* b) {
            fabsf(a->z - b->z) < EPSILON;
 }
 
-// Insert vertex index into hash table
-static void AddVertexGroup(VertexGroup** table, const Vec3* pos, size_t index) {
-    unsigned int h = Vec3Hash(pos);
-    VertexGroup* node = table[h];
-    while (node) {
-        if (Vec3Equal(&node->pos, pos)) {
-            if (node->count >= node->capacity) {
-                node->capacity = node->capacity ? node->capacity*2 : 4;
-                node->indices = realloc(node->indices, node->capacity * sizeof(size_t));
-            }
-            node->indices[node->count++] = index;
-            return;
-        }
-        node = node->next;
-    }
-
-    // New group
-    node = (VertexGroup*)malloc(sizeof(VertexGroup));
-    node->pos = *pos;
-    node->capacity = 4;
-    node->indices = (size_t*)malloc(node->capacity * sizeof(size_t));
-    node->indices[0] = index;
-    node->count = 1;
-    node->next = table[h];
-    table[h] = node;
-}
-
-// Free hash table
-static void FreeVertexGroups(VertexGroup** table) {
-    for (int i = 0; i < HASH_SIZE; ++i) {
-        VertexGroup* node = table[i];
-        while (node) {
-            VertexGroup* next = node->next;
-            free(node->indices);
-            free(node);
-            node = next;
-        }
-    }
-}
-
-// Compute smooth normals in pure C with hash map
-void ComputeSmoothNormals(const char* filename, ObjMesh* mesh) {
-    if(FileExists(filename)){
-        FILE * f = fopen(filename, "rb");
-        if(f){
-            size_t count =0;
-            fread(&count, sizeof(size_t),1,f);
-            if(count == mesh->triangle_vertex_count){
-                fread(mesh->triangle_vertices, sizeof(float), count, f);
-                fclose(f);
-                printf("[ComputeSmoothNormals] Loaded smooth normals from file.\n");
-                return;
-            }
-            else{
-                printf("[ComputeSmoothNormals] File mismatch, recalculating normals...\n");
-            }
-            fclose(f);
+static inline int32_t cellCoordinate(float value) {
+    float cell = floorf(value * (1.0f / (EPSILON * SMOOTH_CELL_EPSILONS)));
+    if (cell < -2147483520.0f) return INT32_MIN;
+    if (cell > 2147483520.0f) return INT32_MAX;
+    return (int32_t)cell;
+}
+
+// Cells are hashed onto a directory of 2^bits slots, about one per corner. A slot may hold
+// corners of several cells; they are all checked by position, so sharing only costs time.
+static inline size_t cellSlot(const int32_t* cell, int bits) {
+    uint64_t h = (uint64_t)(uint32_t)cell[0] * 0x9E3779B97F4A7C15ull;
+    h ^= (uint64_t)(uint32_t)cell[1] * 0xC2B2AE3D27D4EB4Full;
+    h ^= (uint64_t)(uint32_t)cell[2] * 0x165667B19E3779F9ull;
+    h ^= h >> 29;
+    h *= 0xBF58476D1CE4E5B9ull;
+    h ^= h >> 32;
+    return (size_t)(h >> (64 - bits));
+}
+
+#define SMOOTH_TRIANGLES_PER_TASK 16384
+#define SMOOTH_CORNERS_PER_TASK (SMOOTH_TRIANGLES_PER_TASK * 3)
+#define SMOOTH_MAX_SORT_CHUNKS 64
+#define SMOOTH_MIN_SORT_CHUNK 16384
+// Groups up to this size compare every pair of corners; larger ones build a tree of normals
+#define SMOOTH_PAIRWISE_GROUP 32
+// Normals per leaf of that tree
+#define SMOOTH_CONE_LEAF 8
+// Angular slack when deciding a whole cone of normals at once, well above the error of the
+// angles themselves, so the outcome matches comparing each pair of corners
+#define SMOOTH_CONE_MARGIN 1e-3f
+
+typedef struct {
+    uint32_t key;       // directory slot, later group
+    uint32_t index;     // corner
+} SortItem;
+
+// Sort of (key, index) pairs: chunks are sorted on their own, then merged pairwise in rounds.
+// Pairs are unique, so the result does not depend on the chunk count.
+typedef struct {
+    SortItem* source;
+    SortItem* target;
+    size_t count;
+    int chunkCount;
+    int width;          // chunks per merged run in the current round
+} SortJob;
+
+static size_t sortChunkBound(const SortJob* job, int chunk) {
+    if (chunk >= job->chunkCount) return job->count;
+    return job->count * (size_t)chunk / (size_t)job->chunkCount;
+}
+
+#define SORT_RADIX_BITS 11
+#define SORT_RADIX_PASSES ((32 + SORT_RADIX_BITS - 1) / SORT_RADIX_BITS)
+#define SORT_RADIX_BUCKETS (1 << SORT_RADIX_BITS)
+
+// Stable LSD radix sort by key, skipping passes where every key has the same digit. Items
+// arrive in index order, so equal keys stay sorted by index.
+static void sortChunkTask(void* context, int index) {
+    SortJob* job = (SortJob*)context;
+    size_t first = sortChunkBound(job, index);
+    size_t count = sortChunkBound(job, index + 1) - first;
+    if (count == 0) return;
+    SortItem* from = job->source + first;
+    SortItem* to = job->target + first;
+    uint32_t histogram[SORT_RADIX_PASSES][SORT_RADIX_BUCKETS];
+    memset(histogram, 0, sizeof(histogram));
+    for (size_t i = 0; i < count; ++i) {
+        uint32_t key = from[i].key;
+        for (int d = 0; d < SORT_RADIX_PASSES; ++d) histogram[d][(key >> (d * SORT_RADIX_BITS)) & (SORT_RADIX_BUCKETS - 1)]++;
+    }
+    for (int d = 0; d < SORT_RADIX_PASSES; ++d) {
+        uint32_t* offsets = histogram[d];
+        int bit = d * SORT_RADIX_BITS;
+        if (offsets[(from[0].key >> bit) & (SORT_RADIX_BUCKETS - 1)] == count) continue;
+        uint32_t sum = 0;
+        for (int b = 0; b < SORT_RADIX_BUCKETS; ++b) {
+            uint32_t n = offsets[b];
+            offsets[b] = sum;
+            sum += n;
         }
+        for (size_t i = 0; i < count; ++i) to[offsets[(from[i].key >> bit) & (SORT_RADIX_BUCKETS - 1)]++] = from[i];
+        SortItem* swap = from;
+        from = to;
+        to = swap;
     }
-    else{
-        printf("[ComputeSmoothNormals] No precomputed normals file found, calculating...\n");
+    if (from != job->source + first) memcpy(job->source + first, from, count * sizeof(SortItem));
+}
+
+static void mergeChunksTask(void* context, int index) {
+    SortJob* job = (SortJob*)context;
+    int chunk = index * 2 * job->width;
+    size_t a = sortChunkBound(job, chunk);
+    size_t middle = sortChunkBound(job, chunk + job->width);
+    size_t b = middle;
+    size_t last = sortChunkBound(job, chunk + 2 * job->width);
+    size_t out = a;
+    while (a < middle && b < last) {
+        const SortItem* x = &job->source[a];
+        const SortItem* y = &job->source[b];
+        if (y->key < x->key || (y->key == x->key && y->index < x->index)) job->target[out++] = job->source[b++];
+        else job->target[out++] = job->source[a++];
     }
-    if (!mesh || !mesh->triangle_vertices || mesh->triangle_vertex_count == 0)
-        return;
+    memcpy(job->target + out, job->source + a, (middle - a) * sizeof(SortItem));
+    out += middle - a;
+    memcpy(job->target + out, job->source + b, (last - b) * sizeof(SortItem));
+}
 
-    if (FileExists(filename)) {
-        FILE* f = fopen(filename, "rb");
-        if (f) {
-            size_t count = 0;
-            fread(&count, sizeof(size_t), 1, f);
-            if (count == mesh->triangle_vertex_count) {
-                fread(mesh->triangle_vertices, sizeof(float), count, f);
-                fclose(f);
-                fprintf(stderr, "[ComputeSmoothNormals] Loaded smooth normals from file.\n");
-                return;
-            }
-            fclose(f);
-        }
-        fprintf(stderr, "[ComputeSmoothNormals] File mismatch, recalculating normals...\n");
+// Sorts items using scratch as the second buffer; returns whichever holds the result.
+static SortItem* sortItems(SortItem* items, SortItem* scratch, size_t count, int threadCount) {
+    SortJob job;
+    job.source = items;
+    job.target = scratch;
+    job.count = count;
+    job.chunkCount = threadCount < 1 ? 1 : threadCount;
+    if (job.chunkCount > SMOOTH_MAX_SORT_CHUNKS) job.chunkCount = SMOOTH_MAX_SORT_CHUNKS;
+    if ((size_t)job.chunkCount > count / SMOOTH_MIN_SORT_CHUNK + 1) job.chunkCount = (int)(count / SMOOTH_MIN_SORT_CHUNK + 1);
+
+    ParallelFor(job.chunkCount, threadCount, sortChunkTask, &job);
+    for (job.width = 1; job.width < job.chunkCount; job.width *= 2) {
+        int merges = (job.chunkCount + 2 * job.width - 1) / (2 * job.width);
+        ParallelFor(merges, threadCount, mergeChunksTask, &job);
+        SortItem* swap = job.source;
+        job.source = job.target;
+        job.target = swap;
     }
+    return job.source;
+}
 
-    size_t vertexCount = mesh->triangle_vertex_count / FLOATS_PER_VERTEX;
-    Vec3* positions = (Vec3*)malloc(sizeof(Vec3) * vertexCount);
-    Vec3* faceNormals = (Vec3*)malloc(sizeof(Vec3) * vertexCount);
+static inline Vec3 cornerPosition(const float* vertices, size_t corner) {
+    const float* p = &vertices[corner * FLOATS_PER_VERTEX];
+    Vec3 v = {p[0], p[1], p[2]};
+    return v;
+}
 
-    if (!positions || !faceNormals) {
-        fprintf(stderr, "[ComputeSmoothNormals] Out of memory\n");
-        free(positions);
-        free(faceNormals);
-        return;
+// Every step works on its own range of triangles, corners or groups and writes only there,
+// so the result is the same for any thread count.
+typedef struct {
+    const GeometryKernels* kernels;
+    float* vertices;
+    size_t cornerCount;
+    int taskCount;
+    Vec3* faceNormals;          // per triangle, plus one zero normal for trailing corners
+    SortItem* items;            // corners by slot, then by group
+    uint32_t* directory;        // per slot, its first item while sorted by slot; one extra entry ends the last
+    int directoryBits;
+    Vec3* sortedPositions;      // position of each item while sorted by slot
+    uint32_t* nearest;          // per corner: the first corner within EPSILON of it, itself when none is
+    uint32_t* groupOf;          // per corner: the first corner of its group, or GROUP_UNDECIDED
+    size_t* probes;             // per task, corners looked at while grouping
+    size_t* undecided;          // per task, corners left undecided by the current round
+    size_t* groupCount;         // per task
+    size_t* largest;            // per task
+    int* failed;                // per task
+} SmoothJob;
+
+static void faceNormalTask(void* context, int index) {
+    SmoothJob* job = (SmoothJob*)context;
+    size_t first = (size_t)index * SMOOTH_CORNERS_PER_TASK;
+    size_t last = first + SMOOTH_CORNERS_PER_TASK;
+    if (last > job->cornerCount) last = job->cornerCount;
+
+    // Ranges start on a triangle; corners after the last whole triangle get a zero normal
+    size_t triangles = (last - first) / 3;
+    job->kernels->faceNormals(&job->vertices[first * FLOATS_PER_VERTEX], triangles, &job->faceNormals[first / 3].x);
+    if (first + triangles * 3 < last) job->faceNormals[first / 3 + triangles] = (Vec3){0.0f, 0.0f, 0.0f};
+
+    for (size_t i = first; i < last; ++i) {
+        const float* p = &job->vertices[i * FLOATS_PER_VERTEX];
+        int32_t cell[3] = {cellCoordinate(p[0]), cellCoordinate(p[1]), cellCoordinate(p[2])};
+        job->items[i].key = (uint32_t)cellSlot(cell, job->directoryBits);
+        job->items[i].index = (uint32_t)i;
     }
+}
 
-    // Copy positions
-    for (size_t i = 0; i < vertexCount; ++i) {
-        positions[i].x = mesh->triangle_vertices[i*FLOATS_PER_VERTEX + 0];
-        positions[i].y = mesh->triangle_vertices[i*FLOATS_PER_VERTEX + 1];
-        positions[i].z = mesh->triangle_vertices[i*FLOATS_PER_VERTEX + 2];
-    }
-
-    // Compute face normals per triangle
-    for (size_t i = 0; i + 3 <= vertexCount; i += 3) {
-        Vec3 v0 = positions[i];
-        Vec3 v1 = positions[i+1];
-        Vec3 v2 = positions[i+2];
-
-        Vec3 e1 = {v1.x - v0.x, v1.y - v0.y, v1.z - v0.z};
-        Vec3 e2 = {v2.x - v0.x, v2.y - v0.y, v2.z - v0.z};
-
-        Vec3 fn = {
-            e1.y * e2.z - e1.z * e2.y,
-            e1.z * e2.x - e1.x * e2.z,
-            e1.x * e2.y - e1.y * e2.x
-        };
-
-        float len = sqrtf(fn.x*fn.x + fn.y*fn.y + fn.z*fn.z);
-        if (len > 1e-6f) {
-            fn.x /= len; fn.y /= len; fn.z /= len;
-        }
-
-        for (int j = 0; j < 3; ++j)
-            faceNormals[i+j] = fn;
-    }
-
-    // Build hash table for vertices
-    VertexGroup* table[HASH_SIZE] = {0};
-    for (size_t i = 0; i < vertexCount; ++i)
-        AddVertexGroup(table, &positions[i], i);
-
-    // Smooth normals per vertex group
-    for (int h = 0; h < HASH_SIZE; ++h) {
-        VertexGroup* node = table[h];
-        while (node) {
-            for (size_t idx = 0; idx < node->count; ++idx) {
-                Vec3 sum = {0,0,0};
-                for (size_t jdx = 0; jdx < node->count; ++jdx) {
-                    float dot = faceNormals[node->indices[idx]].x*faceNormals[node->indices[jdx]].x +
-                                faceNormals[node->indices[idx]].y*faceNormals[node->indices[jdx]].y +
-                                faceNormals[node->indices[idx]].z*faceNormals[node->indices[jdx]].z;
-                    if (dot >= ANGLE_THRESHOLD) {
-                        sum.x += faceNormals[node->indices[jdx]].x;
-                        sum.y += faceNormals[node->indices[jdx]].y;
-                        sum.z += faceNormals[node->indices[jdx]].z;
+static void directoryTask(void* context, int index) {
+    SmoothJob* job = (SmoothJob*)context;
+    size_t first = (size_t)index * SMOOTH_CORNERS_PER_TASK;
+    size_t last = first + SMOOTH_CORNERS_PER_TASK;
+    if (last > job->cornerCount) last = job->cornerCount;
+
+    // Each slot is written by the item that first reaches it, so tasks never overlap
+    for (size_t i = first; i < last; ++i) {
+        job->sortedPositions[i] = cornerPosition(job->vertices, job->items[i].index);
+        size_t slot = job->items[i].key;
+        size_t from = i > 0 ? (size_t)job->items[i - 1].key + 1 : 0;
+        for (size_t s = from; s <= slot; ++s) job->directory[s] = (uint32_t)i;
+    }
+    if (last == job->cornerCount) {
+        size_t slotCount = (size_t)1 << job->directoryBits;
+        for (size_t s = (size_t)job->items[last - 1].key + 1; s <= slotCount; ++s)
+            job->directory[s] = (uint32_t)last;
+    }
+}
+
+#define GROUP_UNDECIDED UINT32_MAX
+
+// The first earlier corner within EPSILON of corner i, or i when there is none. With groupOf,
+// corners that joined another group are skipped, so only roots (the first corner of a group)
+// and undecided corners count. Every cell that the EPSILON box around the corner touches is
+// searched. The corners of a slot are in corner order, so each scan stops at the first match
+// or at the best corner found so far.
+static uint32_t firstWithin(const SmoothJob* job, const uint32_t* groupOf, uint32_t i, const Vec3* pos,
+                            size_t* probes) {
+    int32_t lo[3] = {cellCoordinate(pos->x - EPSILON), cellCoordinate(pos->y - EPSILON), cellCoordinate(pos->z - EPSILON)};
+    int32_t hi[3] = {cellCoordinate(pos->x + EPSILON), cellCoordinate(pos->y + EPSILON), cellCoordinate(pos->z + EPSILON)};
+    uint32_t best = i;
+    int32_t cell[3];
+    for (cell[0] = lo[0]; cell[0] <= hi[0]; ++cell[0]) {
+        for (cell[1] = lo[1]; cell[1] <= hi[1]; ++cell[1]) {
+            for (cell[2] = lo[2]; cell[2] <= hi[2]; ++cell[2]) {
+                size_t slot = cellSlot(cell, job->directoryBits);
+                for (size_t k = job->directory[slot]; k < job->directory[slot + 1]; ++k) {
+                    (*probes)++;
+                    uint32_t other = job->items[k].index;
+                    if (other >= best) break;
+                    if (groupOf && groupOf[other] != GROUP_UNDECIDED && groupOf[other] != other) continue;
+                    if (Vec3Equal(&job->sortedPositions[k], pos)) {
+                        best = other;
+                        break;
                     }
                 }
-                float len = sqrtf(sum.x*sum.x + sum.y*sum.y + sum.z*sum.z);
-                if (len > 1e-6f) {
-                    sum.x /= len; sum.y /= len; sum.z /= len;
-                }
-                size_t vi = node->indices[idx];
-                mesh->triangle_vertices[vi*FLOATS_PER_VERTEX + 3] = sum.x;
-                mesh->triangle_vertices[vi*FLOATS_PER_VERTEX + 4] = sum.y;
-                mesh->triangle_vertices[vi*FLOATS_PER_VERTEX + 5] = sum.z;
+                if (cell[2] == INT32_MAX) break;
             }
-            node = node->next;
+            if (cell[1] == INT32_MAX) break;
         }
+        if (cell[0] == INT32_MAX) break;
     }
+    return best;
+}
 
-    SaveMeshVertices(filename, mesh);
-    free(positions);
-    free(faceNormals);
-    FreeVertexGroups(table);
+// Corners are visited in slot order, which keeps the scan of their own cell next to them.
+static void nearestCornerTask(void* context, int index) {
+    SmoothJob* job = (SmoothJob*)context;
+    size_t first = (size_t)index * SMOOTH_CORNERS_PER_TASK;
+    size_t last = first + SMOOTH_CORNERS_PER_TASK;
+    if (last > job->cornerCount) last = job->cornerCount;
+    size_t probes = 0;
+    for (size_t item = first; item < last; ++item) {
+        uint32_t i = job->items[item].index;
+        job->nearest[i] = firstWithin(job, NULL, i, &job->sortedPositions[item], &probes);
+    }
+    job->probes[index] = probes;
+}
+
+// The serial rule: a corner joins the first root within EPSILON of it and is a root when there
+// is none. A corner with no earlier one within EPSILON is a root, and a corner whose nearest
+// earlier one is such a root joins it, which settles coincident corners. The rest are chained
+// to others through gaps under EPSILON and wait for settleChainedCorners.
+static void groupCornersTask(void* context, int index) {
+    SmoothJob* job = (SmoothJob*)context;
+    size_t first = (size_t)index * SMOOTH_CORNERS_PER_TASK;
+    size_t last = first + SMOOTH_CORNERS_PER_TASK;
+    if (last > job->cornerCount) last = job->cornerCount;
+    size_t undecided = 0;
+    for (size_t i = first; i < last; ++i) {
+        uint32_t nearest = job->nearest[i];
+        if (nearest == i || job->nearest[nearest] == nearest) {
+            job->groupOf[i] = nearest;
+        } else {
+            job->groupOf[i] = GROUP_UNDECIDED;
+            undecided++;
+        }
+    }
+    job->undecided[index] = undecided;
+}
 
-    fprintf(stderr, "[ComputeSmoothNormals] Smoothing done (%zu verts)\n", vertexCount);
+// In corner order every corner before an undecided one is settled by the time it is reached,
+// so one pass decides them all whatever the thread count.
+static size_t settleChainedCorners(SmoothJob* job, size_t* probes) {
+    size_t settled = 0;
+    for (size_t i = 0; i < job->cornerCount; ++i) {
+        if (job->groupOf[i] != GROUP_UNDECIDED) continue;
+        Vec3 pos = cornerPosition(job->vertices, i);
+        job->groupOf[i] = firstWithin(job, job->groupOf, (uint32_t)i, &pos, probes);
+        settled++;
+    }
+    return settled;
+}
+
+static void groupItemsTask(void* context, int index) {
+    SmoothJob* job = (SmoothJob*)context;
+    size_t first = (size_t)index * SMOOTH_CORNERS_PER_TASK;
+    size_t last = first + SMOOTH_CORNERS_PER_TASK;
+    if (last > job->cornerCount) last = job->cornerCount;
+    for (size_t i = first; i < last; ++i) {
+        job->items[i].key = job->groupOf[i];
+        job->items[i].index = (uint32_t)i;
+    }
+}
+
+// First group that starts at or after the task's share of the sorted corners
+static size_t groupRangeStart(const SmoothJob* job, int task) {
+    if (task >= job->taskCount) return job->cornerCount;
+    size_t start = job->cornerCount * (size_t)task / (size_t)job->taskCount;
+    while (start > 0 && start < job->cornerCount && job->items[start].key == job->items[start - 1].key) start++;
+    return start;
+}
+
+// Node of a tree over the normals of one group. Every normal in it lies within some radius
+// of axis, so a normal n takes the whole cone when n.axis >= cosInside and none of it when
+// n.axis <= cosOutside. Children are stored next to each other.
+typedef struct {
+    Vec3 axis;
+    Vec3 sum;
+    float cosInside;
+    float cosOutside;
+    uint32_t first;     // into the ordered members
+    uint32_t count;
+    uint32_t children;  // index of the first child, 0 for a leaf
+} NormalCone;
+
+// Per-task buffers for smoothing one group, grown to the largest group seen
+typedef struct {
+    Vec3* normals;
+    Vec3* sums;
+    uint32_t* members;
+    NormalCone* cones;  // at most 2 per member
+    uint32_t* stack;    // at most 2 per member
+    size_t capacity;
+} GroupScratch;
+
+static void freeGroupScratch(GroupScratch* scratch) {
+    free(scratch->normals);
+    free(scratch->sums);
+    free(scratch->members);
+    free(scratch->cones);
+    free(scratch->stack);
+    memset(scratch, 0, sizeof(*scratch));
+}
+
+static int reserveGroupScratch(GroupScratch* scratch, size_t count) {
+    if (count <= scratch->capacity) return 1;
+    freeGroupScratch(scratch);
+    size_t capacity = count < SMOOTH_PAIRWISE_GROUP * 2 ? SMOOTH_PAIRWISE_GROUP * 2 : count;
+    scratch->normals = malloc(capacity * sizeof(Vec3));
+    scratch->sums = malloc(capacity * sizeof(Vec3));
+    scratch->members = malloc(capacity * sizeof(uint32_t));
+    scratch->cones = malloc(capacity * 2 * sizeof(NormalCone));
+    scratch->stack = malloc(capacity * 2 * sizeof(uint32_t));
+    scratch->capacity = capacity;
+    if (scratch->normals && scratch->sums && scratch->members && scratch->cones && scratch->stack) return 1;
+    freeGroupScratch(scratch);
+    return 0;
+}
+
+static inline void addVec3(Vec3* sum, const Vec3* v) {
+    sum->x += v->x;
+    sum->y += v->y;
+    sum->z += v->z;
+}
+
+static inline float vec3Component(const Vec3* v, int axis) {
+    return axis == 0 ? v->x : (axis == 1 ? v->y : v->z);
+}
+
+// Angle between two unit vectors, accurate near 0 unlike acos
+static inline float angleBetween(const Vec3* a, const Vec3* b) {
+    Vec3 c = {a->y * b->z - a->z * b->y, a->z * b->x - a->x * b->z, a->x * b->y - a->y * b->x};
+    return atan2f(sqrtf(c.x * c.x + c.y * c.y + c.z * c.z), a->x * b->x + a->y * b->y + a->z * b->z);
+}
+
+// Fills cone `node` with members [first, first + count) and splits it at the middle of the
+// widest axis of their bounding box until leaves hold SMOOTH_CONE_LEAF normals. threshold is
+// the smoothing angle in radians.
+static void buildNormalCones(GroupScratch* scratch, uint32_t node, uint32_t first, uint32_t count, float threshold,
+                             uint32_t* coneCount) {
+    const Vec3* normals = scratch->normals;
+    uint32_t* members = scratch->members;
+    NormalCone* cone = &scratch->cones[node];
+    Vec3 lo = normals[members[first]], hi = lo;
+    cone->sum = (Vec3){0, 0, 0};
+    for (uint32_t i = first; i < first + count; ++i) {
+        const Vec3* n = &normals[members[i]];
+        addVec3(&cone->sum, n);
+        lo = (Vec3){fminf(lo.x, n->x), fminf(lo.y, n->y), fminf(lo.z, n->z)};
+        hi = (Vec3){fmaxf(hi.x, n->x), fmaxf(hi.y, n->y), fmaxf(hi.z, n->z)};
+    }
+    float length = sqrtf(cone->sum.x * cone->sum.x + cone->sum.y * cone->sum.y + cone->sum.z * cone->sum.z);
+    // Normals that cancel out have no useful axis; any unit axis keeps the radius honest
+    cone->axis = (length > 1e-6f) ? (Vec3){cone->sum.x / length, cone->sum.y / length, cone->sum.z / length}
+                                  : normals[members[first]];
+    float radius = 0.0f;
+    for (uint32_t i = first; i < first + count; ++i) {
+        float angle = angleBetween(&cone->axis, &normals[members[i]]);
+        if (angle > radius) radius = angle;
+    }
+    float inside = threshold - SMOOTH_CONE_MARGIN - radius;
+    float outside = threshold + SMOOTH_CONE_MARGIN + radius;
+    cone->cosInside = inside >= 0.0f ? cosf(inside) : 2.0f;
+    cone->cosOutside = outside <= 3.14159265f ? cosf(outside) : -2.0f;
+    cone->first = first;
+    cone->count = count;
+    cone->children = 0;
+    if (count <= SMOOTH_CONE_LEAF) return;
+
+    Vec3 extent = {hi.x - lo.x, hi.y - lo.y, hi.z - lo.z};
+    int axis = (extent.x >= extent.y && extent.x >= extent.z) ? 0 : (extent.y >= extent.z ? 1 : 2);
+    float middle = 0.5f * (vec3Component(&lo, axis) + vec3Component(&hi, axis));
+    uint32_t split = first;
+    for (uint32_t i = first; i < first + count; ++i) {
+        if (vec3Component(&normals[members[i]], axis) < middle) {
+            uint32_t swap = members[i];
+            members[i] = members[split];
+            members[split++] = swap;
+        }
+    }
+    // Identical normals cannot be told apart by position; halve the range instead
+    if (split == first || split == first + count) split = first + count / 2;
+
+    uint32_t children = *coneCount;
+    *coneCount += 2;
+    scratch->cones[node].children = children;
+    buildNormalCones(scratch, children, first, split - first, threshold, coneCount);
+    buildNormalCones(scratch, children + 1, split, first + count - split, threshold, coneCount);
 }
 
+// Sum of the normals within the smoothing angle of n, from the cones that lie wholly inside
+// it plus single normals of the leaves that straddle it. The margin in the cone bounds
+// covers the rounding of the dot products, so this matches comparing every normal.
+static Vec3 sumNormalsNear(const GroupScratch* scratch, const Vec3* n) {
+    Vec3 sum = {0, 0, 0};
+    uint32_t* stack = scratch->stack;
+    size_t depth = 0;
+    stack[depth++] = 0;
+    while (depth > 0) {
+        const NormalCone* cone = &scratch->cones[stack[--depth]];
+        float d = n->x * cone->axis.x + n->y * cone->axis.y + n->z * cone->axis.z;
+        if (d <= cone->cosOutside) continue;
+        if (d >= cone->cosInside) {
+            addVec3(&sum, &cone->sum);
+        } else if (cone->children) {
+            stack[depth++] = cone->children + 1;
+            stack[depth++] = cone->children;
+        } else {
+            for (uint32_t i = cone->first; i < cone->first + cone->count; ++i) {
+                const Vec3* m = &scratch->normals[scratch->members[i]];
+                if (n->x * m->x + n->y * m->y + n->z * m->z >= ANGLE_THRESHOLD) addVec3(&sum, m);
+            }
+        }
+    }
+    return sum;
+}
 
-void AddFaceAsTriangles(ObjMesh* mesh, int* vis, int* vnis, int* vtis, int vcount, int lineNumber) {
-    if (vcount != 3) {
-        fprintf(stderr, "AddFaceAsTriangles expects exactly 3 vertices, got %d at line %d\n", vcount, lineNumber);
+// For each of count face normals in scratch->normals, sums the normals within
+// SMOOTH_NORMALS_ANGLE_DEGREES of it into scratch->sums. Small groups compare every pair.
+// Larger ones build a tree of normal cones and take whole cones that lie inside or outside
+// the angle, so a fan of thousands of faces around one position costs about n log n
+// instead of n^2.
+static void smoothGroupNormals(GroupScratch* scratch, size_t count) {
+    const Vec3* normals = scratch->normals;
+    Vec3* sums = scratch->sums;
+    if (count <= SMOOTH_PAIRWISE_GROUP) {
+        for (size_t i = 0; i < count; ++i) sums[i] = (Vec3){0, 0, 0};
+        for (size_t i = 0; i < count; ++i) {
+            const Vec3* a = &normals[i];
+            for (size_t j = i; j < count; ++j) {
+                const Vec3* b = &normals[j];
+                if (a->x * b->x + a->y * b->y + a->z * b->z >= ANGLE_THRESHOLD) {
+                    addVec3(&sums[i], b);
+                    if (j != i) addVec3(&sums[j], a);
+                }
+            }
+        }
         return;
     }
 
-    for (int i = 0; i < 3; ++i) {
-        int vi = vis[i];
-        int vni = vnis[i];  
-        int vti = vtis[i];
-        if (vi < 0 || vi * 3 + 2 >= mesh->vertex_count) {
-            fprintf(stderr, "Invalid vertex index %d at line %d\n", vi, lineNumber);
+    // Degenerate faces have near-zero normals that match nothing, not even themselves
+    uint32_t used = 0;
+    for (size_t i = 0; i < count; ++i) {
+        const Vec3* n = &normals[i];
+        if (n->x * n->x + n->y * n->y + n->z * n->z >= 0.25f) scratch->members[used++] = (uint32_t)i;
+    }
+    for (size_t i = 0; i < count; ++i) sums[i] = (Vec3){0, 0, 0};
+    if (used == 0) return;
+
+    uint32_t coneCount = 1;
+    buildNormalCones(scratch, 0, 0, used, SMOOTH_NORMALS_ANGLE_DEGREES * (3.14159265f / 180.0f), &coneCount);
+    for (uint32_t i = 0; i < used; ++i) {
+        uint32_t member = scratch->members[i];
+        sums[member] = sumNormalsNear(scratch, &normals[member]);
+    }
+}
+
+static void smoothGroupsTask(void* context, int index) {
+    SmoothJob* job = (SmoothJob*)context;
+    size_t start = groupRangeStart(job, index);
+    size_t end = groupRangeStart(job, index + 1);
+    GroupScratch scratch;
+    memset(&scratch, 0, sizeof(scratch));
+    size_t groupCount = 0;
+    size_t largest = 0;
+
+    while (start < end) {
+        size_t count = 1;
+        while (start + count < end && job->items[start + count].key == job->items[start].key) count++;
+        const SortItem* group = &job->items[start];
+        start += count;
+        groupCount++;
+        if (count > largest) largest = count;
+
+        if (!reserveGroupScratch(&scratch, count)) {
+            job->failed[index] = 1;
             continue;
         }
+        for (size_t idx = 0; idx < count; ++idx) scratch.normals[idx] = job->faceNormals[group[idx].index / 3];
+        smoothGroupNormals(&scratch, count);
+        for (size_t idx = 0; idx < count; ++idx) {
+            // Normalized afterwards by normalizeTask
+            float* normal = &job->vertices[(size_t)group[idx].index * FLOATS_PER_VERTEX + 3];
+            normal[0] = scratch.sums[idx].x;
+            normal[1] = scratch.sums[idx].y;
+            normal[2] = scratch.sums[idx].z;
+        }
+    }
+
+    freeGroupScratch(&scratch);
+    job->groupCount[index] = groupCount;
+    job->largest[index] = largest;
+}
 
-        float vx = mesh->vertices[vi * 3 + 0];
-        float vy = mesh->vertices[vi * 3 + 1];
-        float vz = mesh->vertices[vi * 3 + 2];
+static void normalizeTask(void* context, int index) {
+    SmoothJob* job = (SmoothJob*)context;
+    size_t first = (size_t)index * SMOOTH_CORNERS_PER_TASK;
+    size_t last = first + SMOOTH_CORNERS_PER_TASK;
+    if (last > job->cornerCount) last = job->cornerCount;
+    job->kernels->normalize(&job->vertices[first * FLOATS_PER_VERTEX + 3], last - first, FLOATS_PER_VERTEX);
+}
 
-        float nx = 0.0f, ny = 0.0f, nz = 0.0f;
-        if (vni >= 0 && vni * 3 + 2 < mesh->normal_count) {
-            nx = mesh->normals[vni * 3 + 0];
-            ny = mesh->normals[vni * 3 + 1];
-            nz = mesh->normals[vni * 3 + 2];
+// One thread groups positions in a single pass: a corner joins the oldest group whose first
+// position is within EPSILON, searching every cell that the EPSILON box around it touches.
+// That is the rule groupCornersTask applies, without the sorts that split the work.
+typedef struct {
+    uint32_t* table;       // open addressing by cell, group + 1, 0 = empty
+    int tableBits;         // at least twice the corner count
+    Vec3* position;        // first position seen, per group
+    int32_t (*cell)[3];    // cell of that position, per group
+    uint32_t* groupOf;     // per corner
+    size_t groupCount;
+    size_t probes;         // table slots visited, for the log
+} PositionGroups;
+
+static uint32_t findGroup(PositionGroups* groups, const int32_t* cell, const Vec3* pos) {
+    uint32_t best = UINT32_MAX;
+    size_t mask = ((size_t)1 << groups->tableBits) - 1;
+    size_t slot = cellSlot(cell, groups->tableBits);
+    while (groups->table[slot] != 0) {
+        uint32_t group = groups->table[slot] - 1;
+        const int32_t* other = groups->cell[group];
+        groups->probes++;
+        if (other[0] == cell[0] && other[1] == cell[1] && other[2] == cell[2] && group < best &&
+            Vec3Equal(&groups->position[group], pos)) {
+            best = group;
         }
-        float u = 1.0f, v = 1.0f;
-        if (vti >= 0 && vti * 2 + 1 < mesh->texcoord_count) {
-            u = mesh->texcoords[vti * 2 + 0];
-            v = mesh->texcoords[vti * 2 + 1];
+        slot = (slot + 1) & mask;
+    }
+    return best;
+}
+
+static int groupPositions(PositionGroups* groups, const float* vertices, size_t vertexCount) {
+    memset(groups, 0, sizeof(*groups));
+    groups->tableBits = 1;
+    while (((size_t)1 << groups->tableBits) < vertexCount * 2) groups->tableBits++;
+    size_t mask = ((size_t)1 << groups->tableBits) - 1;
+    groups->table = calloc(mask + 1, sizeof(uint32_t));
+    groups->position = malloc(vertexCount * sizeof(Vec3) + 1);
+    groups->cell = malloc(vertexCount * sizeof(*groups->cell) + 1);
+    groups->groupOf = malloc(vertexCount * sizeof(uint32_t) + 1);
+    if (!groups->table || !groups->position || !groups->cell || !groups->groupOf) return 2;
+
+    for (size_t i = 0; i < vertexCount; ++i) {
+        Vec3 pos = cornerPosition(vertices, i);
+        int32_t lo[3] = {cellCoordinate(pos.x - EPSILON), cellCoordinate(pos.y - EPSILON), cellCoordinate(pos.z - EPSILON)};
+        int32_t hi[3] = {cellCoordinate(pos.x + EPSILON), cellCoordinate(pos.y + EPSILON), cellCoordinate(pos.z + EPSILON)};
+        uint32_t best = UINT32_MAX;
+        int32_t cell[3];
+        for (cell[0] = lo[0]; cell[0] <= hi[0]; ++cell[0]) {
+            for (cell[1] = lo[1]; cell[1] <= hi[1]; ++cell[1]) {
+                for (cell[2] = lo[2]; cell[2] <= hi[2]; ++cell[2]) {
+                    uint32_t group = findGroup(groups, cell, &pos);
+                    if (group < best) best = group;
+                    if (cell[2] == INT32_MAX) break;
+                }
+                if (cell[1] == INT32_MAX) break;
+            }
+            if (cell[0] == INT32_MAX) break;
         }
-        // Default white color
-        float r = 1.0f, g = 1.0f, b = 1.0f;
 
-        float* tmp = realloc(mesh->triangle_vertices, (mesh->triangle_vertex_count + 11) * sizeof(float));
-        if (!tmp) {
-            fprintf(stderr, "Out of memory expanding triangle buffer at line %d\n", lineNumber);
-            return;
+        if (best == UINT32_MAX) {
+            best = (uint32_t)groups->groupCount++;
+            groups->position[best] = pos;
+            groups->cell[best][0] = cellCoordinate(pos.x);
+            groups->cell[best][1] = cellCoordinate(pos.y);
+            groups->cell[best][2] = cellCoordinate(pos.z);
+            size_t slot = cellSlot(groups->cell[best], groups->tableBits);
+            while (groups->table[slot] != 0) slot = (slot + 1) & mask;
+            groups->table[slot] = best + 1;
         }
+        groups->groupOf[i] = best;
+    }
+    return 0;
+}
+
+static void freePositionGroups(PositionGroups* groups) {
+    free(groups->table);
+    free(groups->position);
+    free(groups->cell);
+    free(groups->groupOf);
+}
 
-        mesh->triangle_vertices = tmp;
+static void smoothNormalsSerial(ObjMesh* mesh, size_t vertexCount, double startTime) {
+    const GeometryKernels* kernels = GeometryKernels_Get();
+    float* vertices = mesh->triangle_vertices;
+    size_t triangleCount = vertexCount / 3;
+    Vec3* faceNormals = malloc((triangleCount + 1) * sizeof(Vec3));
+    PositionGroups groups;
+    memset(&groups, 0, sizeof(groups));
+    GroupScratch scratch;
+    memset(&scratch, 0, sizeof(scratch));
+    // Members of every group stored back to back in one arena
+    uint32_t* groupStart = NULL;
+    uint32_t* members = NULL;
+
+    int failed = !faceNormals || groupPositions(&groups, vertices, vertexCount);
+    if (!failed) {
+        groupStart = calloc(groups.groupCount + 1, sizeof(uint32_t));
+        members = malloc(vertexCount * sizeof(uint32_t));
+        failed = !groupStart || !members;
+    }
+    size_t largest = 0;
+    if (!failed) {
+        // Counting sort of the corners by group, keeping corner order within a group
+        for (size_t i = 0; i < vertexCount; ++i) groupStart[groups.groupOf[i] + 1]++;
+        for (size_t g = 0; g < groups.groupCount; ++g) {
+            if (groupStart[g + 1] > largest) largest = groupStart[g + 1];
+            groupStart[g + 1] += groupStart[g];
+        }
+        // The hash table is done with and has room for one fill count per group
+        uint32_t* filled = groups.table;
+        memset(filled, 0, groups.groupCount * sizeof(uint32_t));
+        for (size_t i = 0; i < vertexCount; ++i) {
+            uint32_t g = groups.groupOf[i];
+            members[groupStart[g] + filled[g]++] = (uint32_t)i;
+        }
+        failed = !reserveGroupScratch(&scratch, largest);
+    }
+    if (failed) {
+        fprintf(stderr, "[ComputeSmoothNormals] Out of memory\n");
+        free(faceNormals);
+        freePositionGroups(&groups);
+        free(groupStart);
+        free(members);
+        return;
+    }
 
-        mesh->triangle_vertices[mesh->triangle_vertex_count++] = vx;
-        mesh->triangle_vertices[mesh->triangle_vertex_count++] = vy;
-        mesh->triangle_vertices[mesh->triangle_vertex_count++] = vz;
+    // Corners after the last whole triangle get a zero normal, as in faceNormalTask
+    kernels->faceNormals(vertices, triangleCount, &faceNormals[0].x);
+    faceNormals[triangleCount] = (Vec3){0.0f, 0.0f, 0.0f};
+    for (size_t g = 0; g < groups.groupCount; ++g) {
+        const uint32_t* group = &members[groupStart[g]];
+        size_t count = groupStart[g + 1] - groupStart[g];
+        for (size_t idx = 0; idx < count; ++idx) scratch.normals[idx] = faceNormals[group[idx] / 3];
+        smoothGroupNormals(&scratch, count);
+        for (size_t idx = 0; idx < count; ++idx) {
+            float* normal = &vertices[(size_t)group[idx] * FLOATS_PER_VERTEX + 3];
+            normal[0] = scratch.sums[idx].x;
+            normal[1] = scratch.sums[idx].y;
+            normal[2] = scratch.sums[idx].z;
+        }
+    }
+    kernels->normalize(&vertices[3], vertexCount, FLOATS_PER_VERTEX);
 
-        mesh->triangle_vertices[mesh->triangle_vertex_count++] = nx;
-        mesh->triangle_vertices[mesh->triangle_vertex_count++] = ny;
-        mesh->triangle_vertices[mesh->triangle_vertex_count++] = nz;
+    fprintf(stderr, "[ComputeSmoothNormals] %zu corners -> %zu positions (largest %zu), %.2f probes per corner, "
+            "serial, %.1f ms\n", vertexCount, groups.groupCount, largest, (double)groups.probes / (double)vertexCount,
+            (GetTimeSeconds() - startTime) * 1000.0);
 
-        mesh->triangle_vertices[mesh->triangle_vertex_count++] = u;
-        mesh->triangle_vertices[mesh->triangle_vertex_count++] = v;
+    free(faceNormals);
+    freePositionGroups(&groups);
+    free(groupStart);
+    free(members);
+    freeGroupScratch(&scratch);
+}
 
-        mesh->triangle_vertices[mesh->triangle_vertex_count++] = 0.0f; // tangent x
-        mesh->triangle_vertices[mesh->triangle_vertex_count++] = 0.0f; // tangent y
-        mesh->triangle_vertices[mesh->triangle_vertex_count++] = 0.0f; // tangent z
-    }
+void ComputeSmoothNormals(ObjMesh* mesh) {
+    ComputeSmoothNormalsThreaded(mesh, 1);
 }
-void SaveMeshVertices(const char* filename, const ObjMesh* mesh) {
-    if (!mesh || !mesh->triangle_vertices || mesh->triangle_vertex_count == 0) {
-        fprintf(stderr, "[SaveMeshVertices] Invalid mesh\n");
+
+// Compute smooth normals: corners at the same position average the face normals within
+// SMOOTH_NORMALS_ANGLE_DEGREES of their own.
+void ComputeSmoothNormalsThreaded(ObjMesh* mesh, int threadCount) {
+    if (!mesh || !mesh->triangle_vertices || mesh->triangle_vertex_count == 0)
         return;
-    }
 
-    FILE* f = fopen(filename, "wb");
-    if (!f) {
-        perror("[SaveMeshVertices] Failed to open file");
+    double startTime = GetTimeSeconds();
+    size_t vertexCount = mesh->triangle_vertex_count / FLOATS_PER_VERTEX;
+    if (vertexCount >= UINT32_MAX) {
+        fprintf(stderr, "[ComputeSmoothNormals] Too many vertices (%zu)\n", vertexCount);
+        return;
+    }
+    if (threadCount <= 1) {
+        smoothNormalsSerial(mesh, vertexCount, startTime);
         return;
     }
 
-    // Write vertex count first (for easier loading)
-    fwrite(&mesh->triangle_vertex_count, sizeof(size_t), 1, f);
+    SmoothJob job;
+    job.kernels = GeometryKernels_Get();
+    job.vertices = mesh->triangle_vertices;
+    job.cornerCount = vertexCount;
+    job.taskCount = (int)((vertexCount + SMOOTH_CORNERS_PER_TASK - 1) / SMOOTH_CORNERS_PER_TASK);
+    job.faceNormals = malloc((vertexCount / 3 + 1) * sizeof(Vec3));
+    job.items = malloc(vertexCount * sizeof(SortItem));
+    job.nearest = malloc(vertexCount * sizeof(uint32_t));
+    job.groupOf = malloc(vertexCount * sizeof(uint32_t));
+    job.probes = calloc((size_t)job.taskCount, sizeof(size_t));
+    job.undecided = calloc((size_t)job.taskCount, sizeof(size_t));
+    job.groupCount = calloc((size_t)job.taskCount, sizeof(size_t));
+    job.largest = calloc((size_t)job.taskCount, sizeof(size_t));
+    job.failed = calloc((size_t)job.taskCount, sizeof(int));
+    job.directoryBits = 1;
+    while (((size_t)1 << job.directoryBits) < vertexCount) job.directoryBits++;
+    job.directory = malloc((((size_t)1 << job.directoryBits) + 1) * sizeof(uint32_t));
+    job.sortedPositions = malloc(vertexCount * sizeof(Vec3));
+    SortItem* scratch = malloc(vertexCount * sizeof(SortItem));
+
+    if (!job.faceNormals || !job.items || !job.nearest || !job.groupOf || !job.probes || !job.undecided ||
+        !job.groupCount || !job.largest || !job.failed || !job.directory || !job.sortedPositions || !scratch) {
+        fprintf(stderr, "[ComputeSmoothNormals] Out of memory\n");
+        free(job.faceNormals);
+        free(job.items);
+        free(job.nearest);
+        free(job.groupOf);
+        free(job.probes);
+        free(job.undecided);
+        free(job.groupCount);
+        free(job.largest);
+        free(job.failed);
+        free(job.directory);
+        free(job.sortedPositions);
+        free(scratch);
+        return;
+    }
+    SortItem* buffers[2] = {job.items, scratch};
+
+    // Face normals, and corners sorted by the directory slot of their cell
+    ParallelFor(job.taskCount, threadCount, faceNormalTask, &job);
+    job.items = sortItems(buffers[0], buffers[1], vertexCount, threadCount);
+    ParallelFor(job.taskCount, threadCount, directoryTask, &job);
+    ParallelFor(job.taskCount, threadCount, nearestCornerTask, &job);
+    ParallelFor(job.taskCount, threadCount, groupCornersTask, &job);
+    size_t undecided = 0, chainProbes = 0, chained = 0;
+    for (int t = 0; t < job.taskCount; ++t) undecided += job.undecided[t];
+    if (undecided > 0) chained = settleChainedCorners(&job, &chainProbes);
+
+    // Corners sorted by group, in corner order within a group, then smoothed group by group
+    SortItem* spare = (job.items == buffers[0]) ? buffers[1] : buffers[0];
+    job.items = spare;
+    ParallelFor(job.taskCount, threadCount, groupItemsTask, &job);
+    job.items = sortItems(spare, (spare == buffers[0]) ? buffers[1] : buffers[0], vertexCount, threadCount);
+    ParallelFor(job.taskCount, threadCount, smoothGroupsTask, &job);
+    ParallelFor(job.taskCount, threadCount, normalizeTask, &job);
+
+    size_t probes = chainProbes, groupCount = 0, largest = 0;
+    int failed = 0;
+    for (int t = 0; t < job.taskCount; ++t) {
+        probes += job.probes[t];
+        groupCount += job.groupCount[t];
+        if (job.largest[t] > largest) largest = job.largest[t];
+        failed |= job.failed[t];
+    }
+    if (failed) {
+        fprintf(stderr, "[ComputeSmoothNormals] Out of memory, some groups keep their normals\n");
+    }
 
-    // Write the actual vertex data
-    fwrite(mesh->triangle_vertices, sizeof(float), mesh->triangle_vertex_count, f);
+    fprintf(stderr, "[ComputeSmoothNormals] %zu corners -> %zu positions (largest %zu), %.2f probes per corner, "
+            "%zu chained, %d threads, %.1f ms\n", vertexCount, groupCount, largest,
+            (double)probes / (double)vertexCount, chained, threadCount, (GetTimeSeconds() - startTime) * 1000.0);
+
+    free(job.faceNormals);
+    free(buffers[0]);
+    free(buffers[1]);
+    free(job.nearest);
+    free(job.groupOf);
+    free(job.probes);
+    free(job.undecided);
+    free(job.groupCount);
+    free(job.largest);
+    free(job.failed);
+    free(job.directory);
+    free(job.sortedPositions);
+}
 
-    fclose(f);
-    fprintf(stderr, "[SaveMeshVertices] Saved %zu floats to %s\n", mesh->triangle_vertex_count, filename);
+typedef struct {
+    const GeometryKernels* kernels;
+    float* vertices;
+    size_t triangleCount;
+} TangentJob;
+
+static void tangentTask(void* context, int index) {
+    TangentJob* job = (TangentJob*)context;
+    size_t first = (size_t)index * SMOOTH_TRIANGLES_PER_TASK;
+    size_t last = first + SMOOTH_TRIANGLES_PER_TASK;
+    if (last > job->triangleCount) last = job->triangleCount;
+    job->kernels->tangents(&job->vertices[first * 3 * FLOATS_PER_VERTEX], last - first);
 }
+
 void ComputeTangents(ObjMesh* mesh) {
+    ComputeTangentsThreaded(mesh, 1);
+}
+
+void ComputeTangentsThreaded(ObjMesh* mesh, int threadCount) {
     if (!mesh || !mesh->triangle_vertices) return;
 
-    size_t vertexCount = mesh->triangle_vertex_count / FLOATS_PER_VERTEX;
+    TangentJob job;
+    job.kernels = GeometryKernels_Get();
+    job.vertices = mesh->triangle_vertices;
+    job.triangleCount = mesh->triangle_vertex_count / FLOATS_PER_VERTEX / 3;
+    int taskCount = (int)((job.triangleCount + SMOOTH_TRIANGLES_PER_TASK - 1) / SMOOTH_TRIANGLES_PER_TASK);
+    ParallelFor(taskCount, threadCount, tangentTask, &job);
+}
+
+// Hash of the attributes that make a vertex unique: position, normal and UV.
+#define WELD_FLOATS 8
+
+static inline uint32_t hashVertexKey(const float* v) {
+    uint32_t h = 2166136261u;
+    for (int i = 0; i < WELD_FLOATS; ++i) {
+        uint32_t bits;
+        memcpy(&bits, &v[i], sizeof(bits));
+        h = (h ^ bits) * 16777619u;
+        h ^= h >> 15;
+    }
+    return h;
+}
+
+// Sphere around the centre of the bounding box; loose but cheap and stable.
+static void computeBounds(ObjMesh* mesh) {
+    float lo[3] = {INFINITY, INFINITY, INFINITY};
+    float hi[3] = {-INFINITY, -INFINITY, -INFINITY};
+    for (size_t i = 0; i < mesh->unique_vertex_count; ++i) {
+        const float* p = &mesh->unique_vertices[i * FLOATS_PER_VERTEX];
+        for (int c = 0; c < 3; ++c) {
+            if (p[c] < lo[c]) lo[c] = p[c];
+            if (p[c] > hi[c]) hi[c] = p[c];
+        }
+    }
+    float radiusSq = 0.0f;
+    for (int c = 0; c < 3; ++c) mesh->bounds_center[c] = 0.5f * (lo[c] + hi[c]);
+    for (size_t i = 0; i < mesh->unique_vertex_count; ++i) {
+        const float* p = &mesh->unique_vertices[i * FLOATS_PER_VERTEX];
+        float dx = p[0] - mesh->bounds_center[0];
+        float dy = p[1] - mesh->bounds_center[1];
+        float dz = p[2] - mesh->bounds_center[2];
+        float d = dx * dx + dy * dy + dz * dz;
+        if (d > radiusSq) radiusSq = d;
+    }
+    mesh->bounds_radius = sqrtf(radiusSq);
+}
+
+// Reorders the triangles of `elements` so each material's ranges become one contiguous
+// submesh, in order of first use. Without usemtl the whole mesh is one submesh.
+static int groupByMaterial(ObjMesh* mesh) {
+    size_t rangeCount = mesh->material_range_count;
+    size_t groupCount = 0;
+    int* group = malloc((rangeCount + 1) * sizeof(int));
+    ObjSubmesh* submeshes = calloc(rangeCount + 1, sizeof(ObjSubmesh));
+    if (!group || !submeshes) {
+        free(group);
+        free(submeshes);
+        return 2;
+    }
+
+    if (rangeCount == 0) {
+        submeshes[0].indexCount = (uint32_t)mesh->element_count;
+        groupCount = 1;
+    }
+    for (size_t r = 0; r < rangeCount; ++r) {
+        const ObjMaterialRange* range = &mesh->material_ranges[r];
+        size_t g = 0;
+        while (g < groupCount && strcmp(submeshes[g].material, range->name) != 0) g++;
+        if (g == groupCount) {
+            snprintf(submeshes[g].material, sizeof(submeshes[g].material), "%s", range->name);
+            groupCount++;
+        }
+        group[r] = (int)g;
+        submeshes[g].indexCount += (uint32_t)(range->triangleCount * 3);
+    }
+
+    uint32_t offset = 0;
+    for (size_t g = 0; g < groupCount; ++g) {
+        submeshes[g].firstIndex = offset;
+        offset += submeshes[g].indexCount;
+    }
+
+    // When every material is used by a single range the face order is already grouped
+    if (groupCount < rangeCount) {
+        uint32_t* grouped = malloc(mesh->element_count * sizeof(uint32_t));
+        uint32_t* cursor = malloc(groupCount * sizeof(uint32_t));
+        if (!grouped || !cursor) {
+            free(grouped);
+            free(cursor);
+            free(group);
+            free(submeshes);
+            return 2;
+        }
+        for (size_t g = 0; g < groupCount; ++g) cursor[g] = submeshes[g].firstIndex;
+        for (size_t r = 0; r < rangeCount; ++r) {
+            const ObjMaterialRange* range = &mesh->material_ranges[r];
+            size_t count = range->triangleCount * 3;
+            memcpy(&grouped[cursor[group[r]]], &mesh->elements[range->firstTriangle * 3], count * sizeof(uint32_t));
+            cursor[group[r]] += (uint32_t)count;
+        }
+        free(cursor);
+        free(mesh->elements);
+        mesh->elements = grouped;
+    }
+    free(group);
 
-    for (size_t i = 0; i + 3 <= vertexCount; i += 3) {
-        float* v0 = &mesh->triangle_vertices[i*FLOATS_PER_VERTEX + 0];
-        float* v1 = &mesh->triangle_vertices[(i+1)*FLOATS_PER_VERTEX + 0];
-        float* v2 = &mesh->triangle_vertices[(i+2)*FLOATS_PER_VERTEX + 0];
+    free(mesh->submeshes);
+    mesh->submeshes = submeshes;
+    mesh->submesh_count = groupCount;
+    return 0;
+}
 
-        // Positions
-        float x1 = v1[0] - v0[0];
-        float y1 = v1[1] - v0[1];
-        float z1 = v1[2] - v0[2];
+int BuildIndexedMesh(ObjMesh* mesh) {
+    if (!mesh || !mesh->triangle_vertices || mesh->triangle_vertex_count == 0) return 1;
 
-        float x2 = v2[0] - v0[0];
-        float y2 = v2[1] - v0[1];
-        float z2 = v2[2] - v0[2];
+    size_t cornerCount = mesh->triangle_vertex_count / FLOATS_PER_VERTEX;
+    if (cornerCount > UINT32_MAX) {
+        fprintf(stderr, "[BuildIndexedMesh] Too many vertices (%zu)\n", cornerCount);
+        return 1;
+    }
 
-        // UVs
-        float s1 = v1[6] - v0[6];
-        float t1 = v1[7] - v0[7];
-        float s2 = v2[6] - v0[6];
-        float t2 = v2[7] - v0[7];
+    size_t tableSize = 1;
+    while (tableSize < cornerCount * 2) tableSize <<= 1;
+
+    uint32_t* table = calloc(tableSize, sizeof(uint32_t)); // unique index + 1, 0 = empty
+    float* vertices = malloc(cornerCount * FLOATS_PER_VERTEX * sizeof(float));
+    uint32_t* elements = malloc(cornerCount * sizeof(uint32_t));
+    if (!table || !vertices || !elements) {
+        fprintf(stderr, "[BuildIndexedMesh] Out of memory\n");
+        free(table);
+        free(vertices);
+        free(elements);
+        return 2;
+    }
 
-        float r = (s1 * t2 - s2 * t1);
-        if (fabsf(r) < 1e-8f) r = 1.0f; // avoid division by zero
-        else r = 1.0f / r;
+    size_t uniqueCount = 0;
+    for (size_t c = 0; c < cornerCount; ++c) {
+        const float* corner = &mesh->triangle_vertices[c * FLOATS_PER_VERTEX];
+        size_t slot = hashVertexKey(corner) & (tableSize - 1);
 
-        float tx = (t2 * x1 - t1 * x2) * r;
-        float ty = (t2 * y1 - t1 * y2) * r;
-        float tz = (t2 * z1 - t1 * z2) * r;
+        while (table[slot] != 0) {
+            const float* candidate = &vertices[(size_t)(table[slot] - 1) * FLOATS_PER_VERTEX];
+            if (memcmp(candidate, corner, WELD_FLOATS * sizeof(float)) == 0) break;
+            slot = (slot + 1) & (tableSize - 1);
+        }
 
-        // Store tangent per vertex
-        for (int j = 0; j < 3; ++j) {
-            mesh->triangle_vertices[(i+j)*FLOATS_PER_VERTEX + 8] = tx;
-            mesh->triangle_vertices[(i+j)*FLOATS_PER_VERTEX + 9] = ty;
-            mesh->triangle_vertices[(i+j)*FLOATS_PER_VERTEX + 10] = tz;
+        if (table[slot] == 0) {
+            memcpy(&vertices[uniqueCount * FLOATS_PER_VERTEX], corner, FLOATS_PER_VERTEX * sizeof(float));
+            table[slot] = (uint32_t)(++uniqueCount);
+        } else {
+            // Same position/normal/UV: accumulate the per-face tangents into a vertex tangent
+            float* shared = &vertices[(size_t)(table[slot] - 1) * FLOATS_PER_VERTEX];
+            shared[8] += corner[8];
+            shared[9] += corner[9];
+            shared[10] += corner[10];
         }
+        elements[c] = table[slot] - 1;
     }
+    free(table);
+    orthonormalizeTangents(vertices, uniqueCount);
+
+    float* shrunk = realloc(vertices, uniqueCount * FLOATS_PER_VERTEX * sizeof(float));
+    if (shrunk) vertices = shrunk;
+
+    free(mesh->unique_vertices);
+    free(mesh->elements);
+    mesh->unique_vertices = vertices;
+    mesh->unique_vertex_count = uniqueCount;
+    mesh->elements = elements;
+    mesh->element_count = cornerCount;
+
+    if (groupByMaterial(mesh)) {
+        fprintf(stderr, "[BuildIndexedMesh] Out of memory grouping materials\n");
+        return 2;
+    }
+    computeBounds(mesh);
+
+    fprintf(stderr, "[BuildIndexedMesh] %zu corners -> %zu unique vertices (%.1fx), %zu KB -> %zu KB, %zu submeshes\n",
+            cornerCount, uniqueCount, (double)cornerCount / (double)uniqueCount,
+            cornerCount * FLOATS_PER_VERTEX * sizeof(float) / 1024,
+            (uniqueCount * FLOATS_PER_VERTEX * sizeof(float) + cornerCount * sizeof(uint32_t)) / 1024,
+            mesh->submesh_count);
+    return 0;
 }
@@ -2,7 +2,51 @@
 #define OBJ_FILE_LOADER_H
 
 #include <stddef.h>
-#include <GL/gl.h>
+#include <stdint.h>
+#include "vertex_format.h"
+
+// Smoothing parameters; they are part of the mesh cache key
+#define SMOOTH_NORMALS_ANGLE_DEGREES 45.0f
+#define SMOOTH_NORMALS_EPSILON 1e-4f
+
+#define OBJ_MAX_NAME 64
+#define OBJ_MAX_PATH 260
+// Simplified levels kept after the base mesh
+#define OBJ_MAX_LODS 4
+
+// Triangles [firstTriangle, firstTriangle + triangleCount) of the file use material `name`.
+typedef struct {
+    char name[OBJ_MAX_NAME];
+    size_t firstTriangle;
+    size_t triangleCount;
+} ObjMaterialRange;
+
+// Slice of `elements` drawn with one material; "" when the faces had no usemtl.
+typedef struct {
+    char material[OBJ_MAX_NAME];
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    uint32_t firstMeshlet;   // clusters covering this range, see MeshletBuilder_BuildMeshlets
+    uint32_t meshletCount;
+} ObjSubmesh;
+
+// Contiguous run of elements small enough to be culled as a unit. The normal cone holds
+// every triangle normal within asin(coneCutoff) of coneAxis; coneCutoff >= 1 never culls.
+typedef struct {
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    float center[3];     // bounding sphere, object space
+    float radius;
+    float coneAxis[3];
+    float coneCutoff;
+} ObjMeshlet;
+
+// One simplified level of an indexed mesh. It reuses unique_vertices; its submeshes
+// parallel the base ones and point at extra ranges appended to `elements`.
+typedef struct {
+    float error;             // object-space deviation from the base mesh, an upper bound
+    ObjSubmesh* submeshes;   // submesh_count entries
+} ObjLod;
 
 typedef struct {
     float* vertices;     
@@ -14,34 +58,93 @@ typedef struct {
     float* normals;       
     size_t normal_count;  
 
-    int* indices;         
+    int* indices;         // (v, vt, vn) per triangle corner, 0-based, -1 if absent
     size_t index_count;   
 
     float* triangle_vertices; 
     size_t triangle_vertex_count;
 
-    float transform[16];
+    float* unique_vertices;       // welded vertices, FLOATS_PER_VERTEX each
+    size_t unique_vertex_count;   // number of vertices, not floats
+    uint32_t* elements;           // triangle list into unique_vertices
+    size_t element_count;
+
+    char material_library[OBJ_MAX_PATH];   // first mtllib, relative to the working dir; "" if none
+    ObjMaterialRange* material_ranges;     // usemtl runs in face order, empty without usemtl
+    size_t material_range_count;
+    ObjSubmesh* submeshes;                 // per-material element ranges, set by BuildIndexedMesh
+    size_t submesh_count;
+    ObjLod lods[OBJ_MAX_LODS];             // coarser levels, see MeshSimplifier_BuildLods
+    size_t lod_count;
+    float bounds_center[3];                // bounding sphere of unique_vertices
+    float bounds_radius;
+    ObjMeshlet* meshlets;                  // clusters of every level's ranges
+    size_t meshlet_count;
 
-    GLuint textureID;
-    GLuint normalID;
-    GLuint roughnessID;
-    GLuint metalnessID;
-    GLuint aoID;
+    float transform[16];
     float color[3]; 
 } ObjMesh;
 
+// A streamed chunk holds at most chunkVertices * OBJ_STREAM_INDICES_PER_VERTEX indices
+#define OBJ_STREAM_INDICES_PER_VERTEX 6
+// LoadOBJStreaming reads the file through a buffer of this size
+#define OBJ_STREAM_BUFFER_BYTES (1024 * 1024)
+
+// One chunk emitted by LoadOBJStreaming. Vertices are welded within the chunk and
+// indices are local to it; the arrays are only valid during the sink call.
+typedef struct {
+    const float* vertices;     // FLOATS_PER_VERTEX each
+    size_t vertex_count;
+    const uint32_t* indices;   // triangle list into this chunk's vertices
+    size_t index_count;
+    size_t first_triangle;     // index of the chunk's first triangle in the file
+} ObjStreamChunk;
+
+// Returns 0 to continue, nonzero to stop the import.
+typedef int (*ObjStreamSink)(const ObjStreamChunk* chunk, void* user);
+
+typedef struct {
+    size_t positions;
+    size_t texcoords;
+    size_t normals;
+    size_t triangles;
+    size_t vertices;           // emitted, summed over chunks
+    size_t chunks;
+    size_t peak_bytes;         // largest CPU scratch held at once
+    size_t attribute_bytes;    // part of peak_bytes spent on the v/vt/vn pools
+} ObjStreamStats;
+
 typedef struct VertexNode {
     size_t index;
     struct VertexNode* next;
 } VertexNode;
 
 int LoadOBJ(const char* filename, ObjMesh* mesh);
+// Same result as LoadOBJ, with the file split at line breaks and parsed on threadCount threads.
+int LoadOBJThreaded(const char* filename, ObjMesh* mesh, int threadCount);
 void freeMesh(ObjMesh* mesh);
+// Parses the file through a fixed read buffer and hands chunks of at most chunkVertices
+// vertices to sink as it goes; no whole-file mesh is ever built. Corners without a normal
+// get the area-weighted face normals of their chunk. stats may be NULL.
+// Scratch memory is OBJ_STREAM_BUFFER_BYTES plus at most 96 bytes per chunk vertex, plus
+// pools of every v/vt/vn record, since a face may reference any earlier one: 12/8/12 bytes
+// per record, up to twice that while the pools grow, 48 KB each at least. The number of
+// faces does not change it.
+// Returns 0 on success, 3 if the sink stopped the import.
+int LoadOBJStreaming(const char* filename, size_t chunkVertices, ObjStreamSink sink, void* user,
+                     ObjStreamStats* stats);
 
 void printVertices(const ObjMesh* mesh);
-void ComputeSmoothNormals(const char * filename ,ObjMesh* mesh);
-void AddFaceAsTriangles(ObjMesh* mesh, int* vis, int* vnis, int* vtis, int vcount, int lineNumber);
-void SaveMeshVertices(const char* filename, const ObjMesh* mesh);
+void ComputeSmoothNormals(ObjMesh* mesh);
+// threadCount 1 is ComputeSmoothNormals, a serial pass that is the fastest on one core.
+// More threads split the work into sorted steps. Every thread count groups corners the same
+// way: each joins the first earlier group start within SMOOTH_NORMALS_EPSILON.
+void ComputeSmoothNormalsThreaded(ObjMesh* mesh, int threadCount);
 void ComputeTangents(ObjMesh* mesh);
+void ComputeTangentsThreaded(ObjMesh* mesh, int threadCount);
+// Welds triangle_vertices into unique_vertices + elements. Run after normals and tangents;
+// the tangents summed per vertex come out unit length and orthogonal to the normal.
+// Elements are grouped by material so every submesh is one contiguous range.
+int BuildIndexedMesh(ObjMesh* mesh);
 
 #endif
@@ -0,0 +1,250 @@
+#include "asset_cache.h"
+#include "hash_utils.h"
+#include "atomic_file.h"
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include <inttypes.h>
+#include <stdatomic.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <direct.h>
+#include <sys/utime.h>
+#define utime _utime
+#else
+#include <dirent.h>
+#include <utime.h>
+#endif
+
+#define KEY_DIGITS 16
+#define ENTRY_NAME_SIZE 96
+// Temporary files this old belong to a writer that crashed or was killed
+#define STALE_TEMP_SECONDS (60 * 60)
+#define UNKNOWN_BYTES UINT64_MAX
+
+static char cacheDirectory[ASSET_CACHE_PATH_SIZE] = ASSET_CACHE_DEFAULT_DIRECTORY;
+static uint64_t cacheMaxBytes = ASSET_CACHE_DEFAULT_MAX_BYTES;
+static int cacheCompression = 1;
+// Size of the directory at the last trim plus everything stored since
+static atomic_ullong knownBytes = UNKNOWN_BYTES;
+
+typedef struct {
+    char name[ENTRY_NAME_SIZE];
+    uint64_t size;
+    int64_t lastUse;   // seconds since the epoch
+} CacheEntry;
+
+typedef struct {
+    CacheEntry* entries;
+    size_t count;
+    size_t capacity;
+} EntryList;
+
+void AssetCache_Configure(const char* directory, uint64_t maxBytes) {
+    if (directory && directory[0]) {
+        snprintf(cacheDirectory, sizeof(cacheDirectory), "%s", directory);
+        size_t length = strlen(cacheDirectory);
+        while (length > 1 && (cacheDirectory[length - 1] == '/' || cacheDirectory[length - 1] == '\\')) {
+            cacheDirectory[--length] = '\0';
+        }
+    }
+    cacheMaxBytes = maxBytes;
+    atomic_store(&knownBytes, UNKNOWN_BYTES);
+}
+
+void AssetCache_SetCompression(int enabled) {
+    cacheCompression = enabled != 0;
+}
+
+int AssetCache_GetCompression(void) {
+    return cacheCompression;
+}
+
+uint64_t AssetCache_MakeKey(uint64_t sourceHash, uint32_t processingVersion, const void* params, size_t paramsSize) {
+    uint64_t prefix[2] = {sourceHash, processingVersion};
+    return Hash64(params, paramsSize, Hash64(prefix, sizeof(prefix), 0));
+}
+
+void AssetCache_GetPath(uint64_t key, const char* extension, char* out, size_t outSize) {
+    snprintf(out, outSize, "%s/%016" PRIx64 "%s", cacheDirectory, key, extension ? extension : "");
+}
+
+void AssetCache_Touch(const char* path) {
+    utime(path, NULL);
+}
+
+// Only files named like entries are counted or deleted, whatever else is in the directory
+static int isEntryName(const char* name) {
+    for (int i = 0; i < KEY_DIGITS; ++i) {
+        if (!isxdigit((unsigned char)name[i])) return 0;
+    }
+    return name[KEY_DIGITS] == '.' || name[KEY_DIGITS] == '\0';
+}
+
+static int isTempName(const char* name) {
+    size_t length = strlen(name);
+    size_t suffix = strlen(ATOMIC_FILE_TEMP_SUFFIX);
+    return length > suffix && strcmp(name + length - suffix, ATOMIC_FILE_TEMP_SUFFIX) == 0;
+}
+
+static int makeDirectories(const char* directory) {
+    char path[ASSET_CACHE_PATH_SIZE];
+    snprintf(path, sizeof(path), "%s", directory);
+    for (char* p = path + 1; ; ++p) {
+        if (*p != '/' && *p != '\\' && *p != '\0') continue;
+        char separator = *p;
+        *p = '\0';
+#ifdef _WIN32
+        _mkdir(path);
+#else
+        mkdir(path, 0755);
+#endif
+        if (separator == '\0') break;
+        *p = separator;
+    }
+    struct stat st;
+    return stat(directory, &st) != 0 || !(st.st_mode & S_IFDIR);
+}
+
+// Returns 0 when "<directory>/<name>" fits in out.
+static int entryPath(char* out, size_t outSize, const char* name) {
+    int length = snprintf(out, outSize, "%s/%s", cacheDirectory, name);
+    return length < 0 || (size_t)length >= outSize;
+}
+
+static int addEntry(EntryList* list, const char* name, uint64_t size, int64_t lastUse) {
+    size_t length = strlen(name);
+    if (length >= ENTRY_NAME_SIZE || !isEntryName(name)) return 0;
+    if (list->count == list->capacity) {
+        size_t capacity = list->capacity ? list->capacity * 2 : 256;
+        CacheEntry* grown = realloc(list->entries, capacity * sizeof(CacheEntry));
+        if (!grown) return 1;
+        list->entries = grown;
+        list->capacity = capacity;
+    }
+    CacheEntry* entry = &list->entries[list->count++];
+    memcpy(entry->name, name, length + 1);
+    entry->size = size;
+    entry->lastUse = lastUse;
+    return 0;
+}
+
+#ifdef _WIN32
+
+static int listEntries(EntryList* list) {
+    char pattern[ASSET_CACHE_PATH_SIZE];
+    snprintf(pattern, sizeof(pattern), "%s/*", cacheDirectory);
+    WIN32_FIND_DATAA data;
+    HANDLE find = FindFirstFileA(pattern, &data);
+    if (find == INVALID_HANDLE_VALUE) return 1;
+
+    int failed = 0;
+    do {
+        if (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) continue;
+        uint64_t size = ((uint64_t)data.nFileSizeHigh << 32) | data.nFileSizeLow;
+        // FILETIME counts 100 ns intervals since 1601
+        uint64_t ticks = ((uint64_t)data.ftLastWriteTime.dwHighDateTime << 32) | data.ftLastWriteTime.dwLowDateTime;
+        int64_t lastUse = (int64_t)(ticks / 10000000ull) - 11644473600ll;
+        failed |= addEntry(list, data.cFileName, size, lastUse);
+    } while (!failed && FindNextFileA(find, &data));
+    FindClose(find);
+    return failed;
+}
+
+#else
+
+static int listEntries(EntryList* list) {
+    DIR* dir = opendir(cacheDirectory);
+    if (!dir) return 1;
+
+    int failed = 0;
+    struct dirent* item;
+    while (!failed && (item = readdir(dir)) != NULL) {
+        char path[ASSET_CACHE_PATH_SIZE];
+        struct stat st;
+        if (entryPath(path, sizeof(path), item->d_name) || stat(path, &st) != 0 || !S_ISREG(st.st_mode)) continue;
+        failed |= addEntry(list, item->d_name, (uint64_t)st.st_size, (int64_t)st.st_mtime);
+    }
+    closedir(dir);
+    return failed;
+}
+
+#endif
+
+static int compareLastUse(const void* a, const void* b) {
+    const CacheEntry* ea = (const CacheEntry*)a;
+    const CacheEntry* eb = (const CacheEntry*)b;
+    if (ea->lastUse != eb->lastUse) return (ea->lastUse < eb->lastUse) ? -1 : 1;
+    return strcmp(ea->name, eb->name);
+}
+
+uint64_t AssetCache_Trim(uint64_t maxBytes) {
+    EntryList list = {0};
+    if (listEntries(&list)) {
+        free(list.entries);
+        atomic_store(&knownBytes, 0);
+        return 0;
+    }
+
+    int64_t now = (int64_t)time(NULL);
+    uint64_t total = 0;
+    size_t kept = 0;
+    for (size_t i = 0; i < list.count; ++i) {
+        CacheEntry* entry = &list.entries[i];
+        if (isTempName(entry->name)) {
+            if (now - entry->lastUse > STALE_TEMP_SECONDS) {
+                char path[ASSET_CACHE_PATH_SIZE];
+                if (entryPath(path, sizeof(path), entry->name) == 0) remove(path);
+            }
+            continue;
+        }
+        total += entry->size;
+        list.entries[kept++] = *entry;
+    }
+
+    qsort(list.entries, kept, sizeof(CacheEntry), compareLastUse);
+    size_t evicted = 0;
+    uint64_t evictedBytes = 0;
+    for (size_t i = 0; i < kept && total > maxBytes; ++i) {
+        char path[ASSET_CACHE_PATH_SIZE];
+        if (entryPath(path, sizeof(path), list.entries[i].name) == 0 && remove(path) == 0) {
+            total -= list.entries[i].size;
+            evictedBytes += list.entries[i].size;
+            evicted++;
+        }
+    }
+    if (evicted > 0) {
+        printf("[AssetCache] Evicted %zu least recently used entries (%" PRIu64 " KB), %" PRIu64 " of %" PRIu64
+               " KB in use\n", evicted, evictedBytes / 1024, total / 1024, maxBytes / 1024);
+    }
+
+    free(list.entries);
+    atomic_store(&knownBytes, total);
+    return total;
+}
+
+FILE* AssetCache_BeginWrite(const char* path, char* tempPath, size_t tempPathSize) {
+    if (makeDirectories(cacheDirectory)) {
+        fprintf(stderr, "[AssetCache] Cannot create cache directory %s\n", cacheDirectory);
+        return NULL;
+    }
+    return AtomicFile_Begin(path, tempPath, tempPathSize);
+}
+
+int AssetCache_EndWrite(FILE* file, const char* tempPath, const char* path, int failed) {
+    if (AtomicFile_End(file, tempPath, path, failed)) {
+        return 1;
+    }
+
+    struct stat st;
+    uint64_t size = (stat(path, &st) == 0) ? (uint64_t)st.st_size : 0;
+    unsigned long long known = atomic_load(&knownBytes);
+    if (known == UNKNOWN_BYTES || atomic_fetch_add(&knownBytes, size) + size > cacheMaxBytes) {
+        AssetCache_Trim(cacheMaxBytes);
+    }
+    return 0;
+}
@@ -0,0 +1,55 @@
+#ifndef ASSET_CACHE_H
+#define ASSET_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Content-addressed store for derived artifacts (cooked meshes, decoded textures). Each
+// entry is one file named by a hash of the source bytes, the processing version and the
+// processing parameters, so changing any of them looks up a different file and a stale
+// result is never found. Entries are written to a temporary file and renamed into place,
+// and the least recently used ones are deleted when the directory grows past its limit.
+
+#define ASSET_CACHE_DEFAULT_DIRECTORY "cache"
+#define ASSET_CACHE_DEFAULT_MAX_BYTES (2048ull * 1024 * 1024)
+#define ASSET_CACHE_PATH_SIZE 512
+
+// How an entry stores its payload, the blocks after its header: a set of bits, so an entry
+// type can add its own encodings underneath the general ones.
+enum {
+    ASSET_CACHE_STORED = 0,             // as is, ready to use from the mapping
+    ASSET_CACHE_BLOCK_CODEC = 1 << 0    // one BlockCodec stream, decoded on open
+};
+
+// Sets where entries live and how many bytes they may take. Optional; the defaults above
+// apply otherwise. The directory is created on the first write.
+void AssetCache_Configure(const char* directory, uint64_t maxBytes);
+
+// Whether writers compress entry payloads with the block codec. On by default; entries
+// that do not shrink are stored either way, and readers accept both.
+void AssetCache_SetCompression(int enabled);
+int AssetCache_GetCompression(void);
+
+uint64_t AssetCache_MakeKey(uint64_t sourceHash, uint32_t processingVersion, const void* params, size_t paramsSize);
+
+// "<directory>/<16 hex digits of key><extension>"
+void AssetCache_GetPath(uint64_t key, const char* extension, char* out, size_t outSize);
+
+// Marks an entry as used now; call on every cache hit.
+void AssetCache_Touch(const char* path);
+
+// Opens a temporary file to write the entry for path into. tempPath receives its name
+// and is passed on to AssetCache_EndWrite. Returns NULL on failure.
+FILE* AssetCache_BeginWrite(const char* path, char* tempPath, size_t tempPathSize);
+
+// Closes the file and, unless failed is set or the data did not reach the disk, renames it
+// over path; otherwise the temporary file is removed. Then evicts least recently used entries
+// if the directory is over its limit. Returns 0 when the entry was stored.
+int AssetCache_EndWrite(FILE* file, const char* tempPath, const char* path, int failed);
+
+// Deletes least recently used entries until the directory holds at most maxBytes, plus
+// temporary files left behind by writers that did not finish. Returns the bytes left.
+uint64_t AssetCache_Trim(uint64_t maxBytes);
+
+#endif
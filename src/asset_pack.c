@@ -0,0 +1,189 @@
+#include "asset_pack.h"
+#include "atomic_file.h"
+#include "hash_utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <sys/stat.h>
+
+#define PACK_PATH_SIZE 1024
+
+static AssetPack mountedPack;
+static int packMounted;
+
+static uint64_t alignUp(uint64_t value, uint64_t alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+uint64_t AssetPack_MakeKey(AssetPackType type, const char* path, const void* params, size_t paramsSize) {
+    char normalized[PACK_PATH_SIZE];
+    size_t length = 0;
+    for (; path[length] && length < sizeof(normalized); ++length) {
+        char c = path[length];
+        normalized[length] = (c == '\\') ? '/' : (char)tolower((unsigned char)c);
+    }
+    return Hash64(params, paramsSize, Hash64(normalized, length, (uint64_t)type));
+}
+
+static int validatePack(const AssetPack* pack, const char* path) {
+    const AssetPackHeader* h = (const AssetPackHeader*)pack->map.data;
+    size_t size = pack->map.size;
+    if (size < sizeof(AssetPackHeader) || h->magic != ASSET_PACK_MAGIC) {
+        printf("[AssetPack] %s is not an asset pack\n", path);
+        return 1;
+    }
+    if (h->version != ASSET_PACK_VERSION) {
+        printf("[AssetPack] %s has version %u, expected %d\n", path, h->version, ASSET_PACK_VERSION);
+        return 1;
+    }
+    if (h->fileSize != size || h->tocOffset < sizeof(AssetPackHeader) || h->tocOffset % sizeof(uint64_t) ||
+        h->tocOffset > size || (size - h->tocOffset) / sizeof(AssetPackEntry) < h->entryCount) {
+        printf("[AssetPack] %s is truncated or has a bad table of contents\n", path);
+        return 1;
+    }
+    const AssetPackEntry* entries = (const AssetPackEntry*)(pack->map.data + h->tocOffset);
+    for (uint64_t i = 0; i < h->entryCount; ++i) {
+        const AssetPackEntry* entry = &entries[i];
+        if ((i > 0 && entry->key <= entries[i - 1].key) || entry->offset % ASSET_PACK_ALIGNMENT ||
+            entry->offset > size || entry->size > size - entry->offset) {
+            printf("[AssetPack] %s has a bad entry %llu\n", path, (unsigned long long)i);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int AssetPack_Open(const char* path, AssetPack* pack) {
+    memset(pack, 0, sizeof(*pack));
+    if (FileMap_Open(path, &pack->map)) {
+        return 1;
+    }
+    if (validatePack(pack, path)) {
+        AssetPack_Close(pack);
+        return 1;
+    }
+    const AssetPackHeader* h = (const AssetPackHeader*)pack->map.data;
+    pack->entries = (const AssetPackEntry*)(pack->map.data + h->tocOffset);
+    pack->entryCount = (size_t)h->entryCount;
+    return 0;
+}
+
+void AssetPack_Close(AssetPack* pack) {
+    if (!pack) return;
+    FileMap_Close(&pack->map);
+    pack->entries = NULL;
+    pack->entryCount = 0;
+}
+
+const void* AssetPack_Find(const AssetPack* pack, uint64_t key, AssetPackType type, size_t* size) {
+    size_t low = 0, high = pack->entryCount;
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        if (pack->entries[mid].key < key) low = mid + 1;
+        else high = mid;
+    }
+    if (low == pack->entryCount || pack->entries[low].key != key ||
+        (pack->entries[low].flags & ASSET_PACK_TYPE_MASK) != (uint32_t)type) {
+        return NULL;
+    }
+    if (size) *size = (size_t)pack->entries[low].size;
+    return pack->map.data + pack->entries[low].offset;
+}
+
+static int compareKey(const void* a, const void* b) {
+    uint64_t ka = ((const AssetPackSource*)a)->key;
+    uint64_t kb = ((const AssetPackSource*)b)->key;
+    return (ka > kb) - (ka < kb);
+}
+
+static int writePadding(FILE* f, uint64_t from, uint64_t to) {
+    static const char zeros[ASSET_PACK_ALIGNMENT] = {0};
+    return (to > from) ? fwrite(zeros, 1, (size_t)(to - from), f) != (size_t)(to - from) : 0;
+}
+
+int AssetPack_Write(const char* path, AssetPackSource* sources, size_t count) {
+    qsort(sources, count, sizeof(AssetPackSource), compareKey);
+    for (size_t i = 1; i < count; ++i) {
+        if (sources[i].key == sources[i - 1].key) {
+            fprintf(stderr, "[AssetPack] Two assets share the key %016llx\n", (unsigned long long)sources[i].key);
+            return 1;
+        }
+    }
+
+    AssetPackEntry* entries = malloc(count * sizeof(AssetPackEntry) + 1);
+    if (!entries) return 2;
+    AssetPackHeader h;
+    memset(&h, 0, sizeof(h));
+    h.magic = ASSET_PACK_MAGIC;
+    h.version = ASSET_PACK_VERSION;
+    h.entryCount = count;
+    h.tocOffset = sizeof(AssetPackHeader);
+    // Sources passing the same bytes, e.g. one cooked texture under two paths, share a payload
+    uint64_t offset = alignUp(h.tocOffset + count * sizeof(AssetPackEntry), ASSET_PACK_ALIGNMENT);
+    h.fileSize = h.tocOffset + count * sizeof(AssetPackEntry);
+    for (size_t i = 0; i < count; ++i) {
+        memset(&entries[i], 0, sizeof(entries[i]));
+        entries[i].key = sources[i].key;
+        entries[i].size = sources[i].size;
+        entries[i].flags = sources[i].flags;
+        entries[i].offset = offset;
+        for (size_t j = 0; j < i; ++j) {
+            if (sources[j].data == sources[i].data && sources[j].size == sources[i].size) {
+                entries[i].offset = entries[j].offset;
+                break;
+            }
+        }
+        if (entries[i].offset == offset) {
+            // The last payload is not padded
+            h.fileSize = offset + sources[i].size;
+            offset = alignUp(h.fileSize, ASSET_PACK_ALIGNMENT);
+        }
+    }
+
+    char tempPath[PACK_PATH_SIZE];
+    FILE* f = AtomicFile_Begin(path, tempPath, sizeof(tempPath));
+    if (!f) {
+        free(entries);
+        return 1;
+    }
+    int failed = fwrite(&h, sizeof(h), 1, f) != 1;
+    failed |= fwrite(entries, sizeof(AssetPackEntry), count, f) != count;
+    uint64_t written = h.tocOffset + count * sizeof(AssetPackEntry);
+    for (size_t i = 0; i < count && !failed; ++i) {
+        if (entries[i].offset < written) continue;
+        failed |= writePadding(f, written, entries[i].offset);
+        failed |= fwrite(sources[i].data, 1, sources[i].size, f) != sources[i].size;
+        written = entries[i].offset + entries[i].size;
+    }
+    free(entries);
+    if (AtomicFile_End(f, tempPath, path, failed)) {
+        return 1;
+    }
+    printf("[AssetPack] Wrote %s (%zu entries, %llu KB)\n", path, count, (unsigned long long)(h.fileSize / 1024));
+    return 0;
+}
+
+int AssetPack_Mount(const char* path) {
+    AssetPack_Unmount();
+    struct stat st;
+    if (stat(path, &st) != 0) {
+        return 1;
+    }
+    if (AssetPack_Open(path, &mountedPack)) {
+        return 1;
+    }
+    packMounted = 1;
+    printf("[AssetPack] Mounted %s: %zu entries, %zu KB\n", path, mountedPack.entryCount, mountedPack.map.size / 1024);
+    return 0;
+}
+
+void AssetPack_Unmount(void) {
+    if (!packMounted) return;
+    AssetPack_Close(&mountedPack);
+    packMounted = 0;
+}
+
+const void* AssetPack_FindMounted(uint64_t key, AssetPackType type, size_t* size) {
+    return packMounted ? AssetPack_Find(&mountedPack, key, type, size) : NULL;
+}
@@ -0,0 +1,78 @@
+#ifndef ASSET_PACK_H
+#define ASSET_PACK_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "file_map.h"
+
+// One file holding every cooked asset a build ships: header, a table of contents sorted by
+// key, then the payloads at 4 KiB aligned offsets. The whole pack is mapped once and lookups
+// return pointers into the mapping, so loading an asset costs a binary search instead of an
+// open, stat and read per file. Payloads are the asset cache files as the cook tool wrote
+// them, and open with MeshCache_OpenMemory, TextureCache_OpenMemory and friends.
+
+#define ASSET_PACK_MAGIC   0x50443342u   // "B3DP"
+#define ASSET_PACK_VERSION 1
+#define ASSET_PACK_ALIGNMENT 4096
+#define ASSET_PACK_DEFAULT_PATH "assets.pack"
+
+typedef enum {
+    ASSET_PACK_MESH = 1,           // MeshCache file, keyed by OBJ path and MeshProcessParams
+    ASSET_PACK_TEXTURE,            // TextureCache file, keyed by image path
+    ASSET_PACK_SCENE,              // SceneManifest file, keyed by scene.json path
+    ASSET_PACK_MATERIALS           // ObjMaterial array with resolved map paths, keyed by .mtl path
+} AssetPackType;
+
+#define ASSET_PACK_TYPE_MASK 0xffu
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t entryCount;
+    uint64_t tocOffset;
+    uint64_t fileSize;
+} AssetPackHeader;
+
+typedef struct {
+    uint64_t key;                  // AssetPack_MakeKey
+    uint64_t offset;               // multiple of ASSET_PACK_ALIGNMENT
+    uint64_t size;
+    uint32_t flags;                // AssetPackType in the low bits
+    uint32_t reserved;
+} AssetPackEntry;
+
+typedef struct {
+    FileMap map;
+    const AssetPackEntry* entries;
+    size_t entryCount;
+} AssetPack;
+
+// One payload for AssetPack_Write.
+typedef struct {
+    uint64_t key;
+    uint32_t flags;
+    const void* data;
+    size_t size;
+} AssetPackSource;
+
+// Key of an asset by type, path and processing parameters. Paths compare the way Windows
+// does: case-insensitive, with '\' and '/' alike.
+uint64_t AssetPack_MakeKey(AssetPackType type, const char* path, const void* params, size_t paramsSize);
+
+// Maps and validates a pack. Returns 0 on success.
+int AssetPack_Open(const char* path, AssetPack* pack);
+void AssetPack_Close(AssetPack* pack);
+// Returns the payload with the key and type, or NULL.
+const void* AssetPack_Find(const AssetPack* pack, uint64_t key, AssetPackType type, size_t* size);
+
+// Writes a pack through a temporary file; sources are sorted in place. Returns 0 on success.
+int AssetPack_Write(const char* path, AssetPackSource* sources, size_t count);
+
+// The pack the loaders look in before the asset cache. Mounting is optional and fails
+// quietly when there is no pack. Returns 0 when mounted.
+int AssetPack_Mount(const char* path);
+void AssetPack_Unmount(void);
+// AssetPack_Find on the mounted pack; NULL when none is mounted.
+const void* AssetPack_FindMounted(uint64_t key, AssetPackType type, size_t* size);
+
+#endif
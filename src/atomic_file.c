@@ -0,0 +1,73 @@
+#include "atomic_file.h"
+#include <stdatomic.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <io.h>
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
+static atomic_uint tempCounter;
+
+#ifdef _WIN32
+
+static int syncFile(FILE* file) {
+    return _commit(_fileno(file)) != 0;
+}
+
+static int replaceFile(const char* from, const char* to) {
+    if (!MoveFileExA(from, to, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)) {
+        fprintf(stderr, "[AtomicFile] Failed to rename %s to %s (error %lu)\n", from, to, GetLastError());
+        return 1;
+    }
+    return 0;
+}
+
+#else
+
+static int syncFile(FILE* file) {
+    return fsync(fileno(file)) != 0;
+}
+
+static int replaceFile(const char* from, const char* to) {
+    if (rename(from, to) != 0) {
+        perror("[AtomicFile] Failed to rename file into place");
+        return 1;
+    }
+    return 0;
+}
+
+#endif
+
+FILE* AtomicFile_Begin(const char* path, char* tempPath, size_t tempPathSize) {
+    unsigned serial = atomic_fetch_add(&tempCounter, 1);
+    int length = snprintf(tempPath, tempPathSize, "%s.%lu.%u" ATOMIC_FILE_TEMP_SUFFIX, path,
+                          (unsigned long)getpid(), serial);
+    if (length < 0 || (size_t)length >= tempPathSize) {
+        fprintf(stderr, "[AtomicFile] Path too long: %s\n", path);
+        return NULL;
+    }
+    FILE* file = fopen(tempPath, "wb");
+    if (!file) {
+        perror("[AtomicFile] Failed to open temporary file");
+    }
+    return file;
+}
+
+int AtomicFile_End(FILE* file, const char* tempPath, const char* path, int failed) {
+    // The data reaches the disk before the rename, so a crash leaves the old file or the new one
+    failed |= fflush(file) != 0;
+    if (!failed) failed |= syncFile(file);
+    failed |= fclose(file) != 0;
+    if (!failed) failed |= replaceFile(tempPath, path);
+    if (failed) {
+        fprintf(stderr, "[AtomicFile] Failed to store %s\n", path);
+        remove(tempPath);
+        return 1;
+    }
+    return 0;
+}
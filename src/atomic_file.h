@@ -0,0 +1,21 @@
+#ifndef ATOMIC_FILE_H
+#define ATOMIC_FILE_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+// Whole-file replacement that readers never see half done: the data goes to a temporary
+// file next to the target, reaches the disk, and is then renamed over it. A crash leaves
+// the old file or the new one, plus at worst a stray "<path>.<pid>.<n>.tmp".
+
+#define ATOMIC_FILE_TEMP_SUFFIX ".tmp"
+
+// Opens a temporary file to write path's new contents into. tempPath receives its name
+// and is passed on to AtomicFile_End. Returns NULL on failure.
+FILE* AtomicFile_Begin(const char* path, char* tempPath, size_t tempPathSize);
+
+// Closes the file and, unless failed is set or the data did not reach the disk, renames it
+// over path; otherwise the temporary file is removed. Returns 0 when path was replaced.
+int AtomicFile_End(FILE* file, const char* tempPath, const char* path, int failed);
+
+#endif
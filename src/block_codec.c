@@ -0,0 +1,357 @@
+#include "block_codec.h"
+#include "thread_utils.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+
+#define MIN_MATCH 4
+#define LAST_LITERALS 5      // the format ends every block with at least this many literals
+#define MF_LIMIT 12          // and starts no match closer than this to the end
+#define MAX_OFFSET 65535
+#define HASH_LOG 14
+#define SKIP_TRIGGER 6       // without matches the search steps further and further ahead
+
+static uint32_t read32(const uint8_t* p) {
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static uint32_t hashSequence(uint32_t sequence) {
+    return (sequence * 2654435761u) >> (32 - HASH_LOG);
+}
+
+// 15 in the token, then bytes of 255 and a final byte below 255
+static uint8_t* writeLength(uint8_t* out, size_t length) {
+    for (length -= 15; length >= 255; length -= 255) *out++ = 255;
+    *out++ = (uint8_t)length;
+    return out;
+}
+
+size_t BlockCodec_Bound(size_t size) {
+    return size + size / 255 + 16;
+}
+
+static uint8_t* writeSequence(uint8_t* out, const uint8_t* outEnd, const uint8_t* literals, size_t literalLength,
+                              size_t offset, size_t matchLength) {
+    // Token, literal length bytes, literals, offset and match length bytes
+    if ((size_t)(outEnd - out) < 1 + literalLength / 255 + 1 + literalLength + 2 + matchLength / 255 + 1) return NULL;
+    uint8_t* token = out++;
+    *token = (uint8_t)((literalLength >= 15 ? 15 : literalLength) << 4);
+    if (literalLength >= 15) out = writeLength(out, literalLength);
+    memcpy(out, literals, literalLength);
+    out += literalLength;
+    if (offset == 0) return out;   // the last sequence has literals only
+
+    *out++ = (uint8_t)(offset & 0xff);
+    *out++ = (uint8_t)(offset >> 8);
+    *token |= (uint8_t)(matchLength >= 15 ? 15 : matchLength);
+    if (matchLength >= 15) out = writeLength(out, matchLength);
+    return out;
+}
+
+size_t BlockCodec_Compress(const void* src, size_t size, void* dst, size_t dstCapacity) {
+    const uint8_t* in = (const uint8_t*)src;
+    const uint8_t* end = in + size;
+    const uint8_t* anchor = in;
+    uint8_t* out = (uint8_t*)dst;
+    const uint8_t* outEnd = out + dstCapacity;
+
+    if (size > MF_LIMIT) {
+        uint32_t table[1 << HASH_LOG];
+        memset(table, 0, sizeof(table));
+        const uint8_t* matchLimit = end - LAST_LITERALS;
+        const uint8_t* mfLimit = end - MF_LIMIT;
+        const uint8_t* ip = in + 1;
+        unsigned misses = 1u << SKIP_TRIGGER;
+
+        while (ip < mfLimit) {
+            uint32_t sequence = read32(ip);
+            uint32_t hash = hashSequence(sequence);
+            const uint8_t* ref = in + table[hash];
+            table[hash] = (uint32_t)(ip - in);
+            if (ref >= ip || ip - ref > MAX_OFFSET || read32(ref) != sequence) {
+                ip += misses++ >> SKIP_TRIGGER;
+                continue;
+            }
+            misses = 1u << SKIP_TRIGGER;
+
+            while (ip > anchor && ref > in && ip[-1] == ref[-1]) {
+                ip--;
+                ref--;
+            }
+            const uint8_t* matchEnd = ip + MIN_MATCH;
+            const uint8_t* refEnd = ref + MIN_MATCH;
+            while (matchEnd < matchLimit && *matchEnd == *refEnd) {
+                matchEnd++;
+                refEnd++;
+            }
+
+            out = writeSequence(out, outEnd, anchor, (size_t)(ip - anchor), (size_t)(ip - ref),
+                                (size_t)(matchEnd - ip) - MIN_MATCH);
+            if (!out) return 0;
+            ip = matchEnd;
+            anchor = ip;
+            if (ip - 2 > in && ip < mfLimit) {
+                table[hashSequence(read32(ip - 2))] = (uint32_t)(ip - 2 - in);
+            }
+        }
+    }
+
+    out = writeSequence(out, outEnd, anchor, (size_t)(end - anchor), 0, 0);
+    return out ? (size_t)(out - (uint8_t*)dst) : 0;
+}
+
+static int readLength(const uint8_t** ip, const uint8_t* ipEnd, size_t* length) {
+    unsigned byte;
+    do {
+        if (*ip >= ipEnd) return 1;
+        byte = *(*ip)++;
+        *length += byte;
+    } while (byte == 255);
+    return 0;
+}
+
+int BlockCodec_Decompress(const void* src, size_t srcSize, void* dst, size_t dstSize) {
+    const uint8_t* ip = (const uint8_t*)src;
+    const uint8_t* ipEnd = ip + srcSize;
+    uint8_t* const start = (uint8_t*)dst;
+    uint8_t* op = start;
+    uint8_t* const opEnd = op + dstSize;
+
+    for (;;) {
+        if (ip >= ipEnd) return 1;
+        unsigned token = *ip++;
+
+        size_t literalLength = token >> 4;
+        // Most sequences have no length bytes: fixed-size copies only
+        if (literalLength < 15 && (token & 15) < 15 && ipEnd - ip >= 18 && opEnd - op >= 40) {
+            size_t offset = (size_t)ip[literalLength] | ((size_t)ip[literalLength + 1] << 8);
+            if (offset != 0 && offset <= (size_t)(op - start) + literalLength) {
+                memcpy(op, ip, 16);
+                op += literalLength;
+                ip += literalLength + 2;
+                // Up to 18 bytes in 8-byte chunks, which need the source 8 or more bytes back.
+                // A closer one is copied 4 bytes at a time once, then read from a whole number
+                // of periods back.
+                const uint8_t* ref = op - offset;
+                if (offset < 8) {
+                    static const int forward[8] = {0, 1, 2, 1, 0, 4, 4, 4};
+                    static const int back[8] = {0, 0, 0, -1, -4, 1, 2, 3};
+                    op[0] = ref[0];
+                    op[1] = ref[1];
+                    op[2] = ref[2];
+                    op[3] = ref[3];
+                    ref += forward[offset];
+                    memcpy(op + 4, ref, 4);
+                    ref -= back[offset];
+                } else {
+                    memcpy(op, ref, 8);
+                    ref += 8;
+                }
+                memcpy(op + 8, ref, 8);
+                memcpy(op + 16, ref + 8, 8);
+                op += (token & 15) + MIN_MATCH;
+                continue;
+            }
+        }
+        if (literalLength == 15 && readLength(&ip, ipEnd, &literalLength)) return 1;
+        if ((size_t)(ipEnd - ip) < literalLength || (size_t)(opEnd - op) < literalLength) return 1;
+        // Short runs copy a fixed 16 bytes when both sides have room; the excess is overwritten
+        if (literalLength <= 16 && ipEnd - ip >= 16 && opEnd - op >= 16) {
+            memcpy(op, ip, 16);
+        } else {
+            memcpy(op, ip, literalLength);
+        }
+        op += literalLength;
+        ip += literalLength;
+        if (ip == ipEnd) return op == opEnd ? 0 : 1;
+
+        if (ipEnd - ip < 2) return 1;
+        size_t offset = (size_t)ip[0] | ((size_t)ip[1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > (size_t)(op - start)) return 1;
+
+        size_t matchLength = token & 15;
+        if (matchLength == 15 && readLength(&ip, ipEnd, &matchLength)) return 1;
+        matchLength += MIN_MATCH;
+        if ((size_t)(opEnd - op) < matchLength) return 1;
+
+        const uint8_t* ref = op - offset;
+        size_t room = (size_t)(opEnd - op);
+        if (offset >= 16 && matchLength <= 16 && room >= 16) {
+            memcpy(op, ref, 16);
+        } else if (offset >= matchLength) {
+            memcpy(op, ref, matchLength);
+        } else if (matchLength > 64) {
+            // A long match overlapping its own output, e.g. a flat region: every copy doubles
+            // the run, which stays a whole number of periods
+            size_t done = offset;
+            memcpy(op, ref, offset);
+            while (done < matchLength) {
+                size_t count = (matchLength - done < done) ? matchLength - done : done;
+                memcpy(op + done, op, count);
+                done += count;
+            }
+        } else if (room >= matchLength + 8) {
+            // A run with a period under 8 bytes repeats with any multiple of it too, so after
+            // the first period bytes every 8-byte chunk reads bytes that are already final
+            size_t period = offset;
+            while (period < 8) period += offset;
+            size_t i = 0;
+            if (period != offset) {
+                for (; i < period; ++i) op[i] = ref[i];
+            }
+            for (; i < matchLength; i += 8) memcpy(op + i, op + i - period, 8);
+        } else {
+            for (size_t i = 0; i < matchLength; ++i) op[i] = ref[i];
+        }
+        op += matchLength;
+    }
+}
+
+typedef struct {
+    const uint8_t* data;
+    size_t size;
+    uint8_t** blocks;        // compressed blocks, NULL where the block is stored raw
+    uint32_t* storedSizes;
+} CompressJob;
+
+static void compressTask(void* context, int blockIndex) {
+    CompressJob* job = (CompressJob*)context;
+    size_t offset = (size_t)blockIndex * BLOCK_CODEC_BLOCK_SIZE;
+    size_t rawSize = (job->size - offset < BLOCK_CODEC_BLOCK_SIZE) ? job->size - offset : BLOCK_CODEC_BLOCK_SIZE;
+
+    // Without memory for the output the block is simply stored
+    uint8_t* block = malloc(BlockCodec_Bound(rawSize));
+    size_t compressed = block ? BlockCodec_Compress(job->data + offset, rawSize, block, rawSize - 1) : 0;
+    if (compressed == 0) {
+        free(block);
+        job->blocks[blockIndex] = NULL;
+        job->storedSizes[blockIndex] = (uint32_t)rawSize | BLOCK_CODEC_STORED_RAW;
+        return;
+    }
+    job->blocks[blockIndex] = block;
+    job->storedSizes[blockIndex] = (uint32_t)compressed;
+}
+
+int BlockCodec_CompressStream(const void* data, size_t size, int threadCount, void** stream, size_t* streamSize) {
+    *stream = NULL;
+    *streamSize = 0;
+    size_t blockCount = (size + BLOCK_CODEC_BLOCK_SIZE - 1) / BLOCK_CODEC_BLOCK_SIZE;
+
+    CompressJob job;
+    job.data = (const uint8_t*)data;
+    job.size = size;
+    job.blocks = calloc(blockCount + 1, sizeof(uint8_t*));
+    job.storedSizes = calloc(blockCount + 1, sizeof(uint32_t));
+    if (!job.blocks || !job.storedSizes) {
+        free(job.blocks);
+        free(job.storedSizes);
+        return 2;
+    }
+    ParallelFor((int)blockCount, threadCount, compressTask, &job);
+
+    size_t total = sizeof(BlockStreamHeader) + blockCount * sizeof(uint32_t);
+    for (size_t i = 0; i < blockCount; ++i) total += job.storedSizes[i] & ~BLOCK_CODEC_STORED_RAW;
+    uint8_t* out = malloc(total);
+    if (out) {
+        BlockStreamHeader header;
+        memset(&header, 0, sizeof(header));
+        header.magic = BLOCK_CODEC_STREAM_MAGIC;
+        header.blockSize = BLOCK_CODEC_BLOCK_SIZE;
+        header.rawSize = size;
+        header.blockCount = (uint32_t)blockCount;
+        memcpy(out, &header, sizeof(header));
+        memcpy(out + sizeof(header), job.storedSizes, blockCount * sizeof(uint32_t));
+        uint8_t* p = out + sizeof(header) + blockCount * sizeof(uint32_t);
+        for (size_t i = 0; i < blockCount; ++i) {
+            size_t stored = job.storedSizes[i] & ~BLOCK_CODEC_STORED_RAW;
+            const uint8_t* from = job.blocks[i] ? job.blocks[i] : job.data + i * BLOCK_CODEC_BLOCK_SIZE;
+            memcpy(p, from, stored);
+            p += stored;
+        }
+        *stream = out;
+        *streamSize = total;
+    }
+
+    for (size_t i = 0; i < blockCount; ++i) free(job.blocks[i]);
+    free(job.blocks);
+    free(job.storedSizes);
+    return out ? 0 : 2;
+}
+
+typedef struct {
+    const uint8_t* blocks;
+    const uint32_t* storedSizes;
+    const size_t* offsets;
+    uint8_t* dst;
+    size_t dstSize;
+    size_t blockSize;
+    atomic_int failed;
+} DecompressJob;
+
+static void decompressTask(void* context, int blockIndex) {
+    DecompressJob* job = (DecompressJob*)context;
+    size_t offset = (size_t)blockIndex * job->blockSize;
+    size_t rawSize = (job->dstSize - offset < job->blockSize) ? job->dstSize - offset : job->blockSize;
+    uint32_t stored = job->storedSizes[blockIndex];
+    const uint8_t* src = job->blocks + job->offsets[blockIndex];
+
+    if (stored & BLOCK_CODEC_STORED_RAW) {
+        if ((stored & ~BLOCK_CODEC_STORED_RAW) != rawSize) {
+            atomic_store(&job->failed, 1);
+            return;
+        }
+        memcpy(job->dst + offset, src, rawSize);
+    } else if (BlockCodec_Decompress(src, stored, job->dst + offset, rawSize)) {
+        atomic_store(&job->failed, 1);
+    }
+}
+
+int BlockCodec_GetRawSize(const void* stream, size_t streamSize, size_t* rawSize) {
+    BlockStreamHeader header;
+    if (streamSize < sizeof(header)) return 1;
+    memcpy(&header, stream, sizeof(header));
+    if (header.magic != BLOCK_CODEC_STREAM_MAGIC || header.rawSize > SIZE_MAX) return 1;
+    *rawSize = (size_t)header.rawSize;
+    return 0;
+}
+
+int BlockCodec_DecompressStream(const void* stream, size_t streamSize, void* dst, size_t dstSize, int threadCount) {
+    BlockStreamHeader header;
+    if (streamSize < sizeof(header)) return 1;
+    memcpy(&header, stream, sizeof(header));
+    if (header.magic != BLOCK_CODEC_STREAM_MAGIC || header.blockSize == 0 || header.rawSize != dstSize ||
+        header.blockCount != (dstSize + header.blockSize - 1) / header.blockSize ||
+        (streamSize - sizeof(header)) / sizeof(uint32_t) < header.blockCount) {
+        return 1;
+    }
+
+    const uint8_t* bytes = (const uint8_t*)stream;
+    const uint32_t* storedSizes = (const uint32_t*)(bytes + sizeof(header));
+    size_t dataOffset = sizeof(header) + (size_t)header.blockCount * sizeof(uint32_t);
+    size_t* offsets = malloc((size_t)header.blockCount * sizeof(size_t) + 1);
+    if (!offsets) return 2;
+    size_t total = 0;
+    for (uint32_t i = 0; i < header.blockCount; ++i) {
+        offsets[i] = total;
+        total += storedSizes[i] & ~BLOCK_CODEC_STORED_RAW;
+    }
+    if (total > streamSize - dataOffset) {
+        free(offsets);
+        return 1;
+    }
+
+    DecompressJob job;
+    job.blocks = bytes + dataOffset;
+    job.storedSizes = storedSizes;
+    job.offsets = offsets;
+    job.dst = (uint8_t*)dst;
+    job.dstSize = dstSize;
+    job.blockSize = header.blockSize;
+    atomic_init(&job.failed, 0);
+    ParallelFor((int)header.blockCount, threadCount, decompressTask, &job);
+    free(offsets);
+    return atomic_load(&job.failed) ? 1 : 0;
+}
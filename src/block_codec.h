@@ -0,0 +1,42 @@
+#ifndef BLOCK_CODEC_H
+#define BLOCK_CODEC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Fast byte compression for cooked asset payloads. Blocks use the LZ4 block format (token,
+// literals, 16-bit offset, match length), so decoding is a tight copy loop. A stream cuts
+// the data into independent BLOCK_CODEC_BLOCK_SIZE blocks that compress and decode in
+// parallel; blocks that do not shrink are stored as they are.
+
+#define BLOCK_CODEC_STREAM_MAGIC 0x5A443342u   // "B3DZ"
+#define BLOCK_CODEC_BLOCK_SIZE (256 * 1024)
+
+typedef struct {
+    uint32_t magic;
+    uint32_t blockSize;
+    uint64_t rawSize;
+    uint32_t blockCount;
+    uint32_t reserved;
+    // then blockCount uint32_t stored sizes, BLOCK_CODEC_STORED_RAW set for uncompressed
+    // blocks, then the blocks back to back
+} BlockStreamHeader;
+
+#define BLOCK_CODEC_STORED_RAW 0x80000000u
+
+// Worst-case compressed size of one block of size bytes.
+size_t BlockCodec_Bound(size_t size);
+// Compresses one block. Returns the compressed size, or 0 if it does not fit in dstCapacity.
+size_t BlockCodec_Compress(const void* src, size_t size, void* dst, size_t dstCapacity);
+// Decompresses one block that must expand to exactly dstSize bytes. Returns 0 on success;
+// malformed input fails without reading or writing out of bounds.
+int BlockCodec_Decompress(const void* src, size_t srcSize, void* dst, size_t dstSize);
+
+// Compresses data into a malloc'd stream. Returns 0 on success, 2 when out of memory.
+int BlockCodec_CompressStream(const void* data, size_t size, int threadCount, void** stream, size_t* streamSize);
+// Reads the raw size of a stream from its header. Returns 0 on success.
+int BlockCodec_GetRawSize(const void* stream, size_t streamSize, size_t* rawSize);
+// Expands a stream into dst, which must hold exactly the raw size. Returns 0 on success.
+int BlockCodec_DecompressStream(const void* stream, size_t streamSize, void* dst, size_t dstSize, int threadCount);
+
+#endif
@@ -3,6 +3,7 @@
 #include "user_input.h"
 #include <stdio.h>
 #include <math.h>
+#include <string.h>
 #ifndef M_PI_2
 #define M_PI_2 1.5707963267948966
 #endif
@@ -14,6 +15,33 @@ static float rotation[16] = {0.0f};
 static float translation[16] = {0.0f};
 static float speed = 20.0f;
 static int mouseX = 0, mouseY = 0;
+
+static float pathKeys[CAMERA_PATH_MAX_KEYS * CAMERA_PATH_KEY_FLOATS];
+static int pathKeyCount = 0;
+static float pathSecondsPerKey = 1.0f;
+static float pathTime = 0.0f;
+static int pathPlaying = 0;
+
+// Moves the camera along the path; stops on the last key.
+static void UpdatePath(float deltaTime) {
+    pathTime += deltaTime;
+    float position = pathTime / pathSecondsPerKey;
+    int key = (int)position;
+    if (key >= pathKeyCount - 1) {
+        key = pathKeyCount - 1;
+        position = (float)key;
+        pathPlaying = 0;
+    }
+    const float* a = &pathKeys[key * CAMERA_PATH_KEY_FLOATS];
+    const float* b = pathPlaying ? a + CAMERA_PATH_KEY_FLOATS : a;
+    float t = position - (float)key;
+    for (int i = 0; i < 3; ++i) {
+        cameraPosition[i] = a[i] + (b[i] - a[i]) * t;
+    }
+    cameraRotation[0] = a[3] + (b[3] - a[3]) * t;
+    cameraRotation[1] = a[4] + (b[4] - a[4]) * t;
+    cameraRotation[2] = 0.0f;
+}
 void CameraControl_Init() {
     UserInput_Init(&g_input);
     cameraPosition[0] = 0.0f;
@@ -126,6 +154,10 @@ void CameraControl_Update(float deltaTime, float* viewMatrix) {
 
 
 
+    if (pathPlaying) {
+        UpdatePath(deltaTime);
+    }
+
     if (!viewMatrix) return;
 
    
@@ -161,4 +193,25 @@ void CameraControl_GetRotation(float* pitch, float* yaw, float* roll) {
     if (pitch) *pitch = cameraRotation[0];
     if (yaw)   *yaw   = cameraRotation[1];
     if (roll)  *roll  = cameraRotation[2];
-}
\ No newline at end of file
+}
+
+void CameraControl_SetPath(const float* keys, int keyCount, float secondsPerKey) {
+    if (keyCount > CAMERA_PATH_MAX_KEYS) keyCount = CAMERA_PATH_MAX_KEYS;
+    if (keyCount < 0) keyCount = 0;
+    memcpy(pathKeys, keys, sizeof(float) * CAMERA_PATH_KEY_FLOATS * (size_t)keyCount);
+    pathKeyCount = keyCount;
+    pathSecondsPerKey = (secondsPerKey > 0.0f) ? secondsPerKey : 1.0f;
+    pathPlaying = 0;
+}
+
+int CameraControl_StartPath(void) {
+    if (pathKeyCount == 0) return 0;
+    pathTime = 0.0f;
+    pathPlaying = 1;
+    UpdatePath(0.0f);
+    return 1;
+}
+
+int CameraControl_PathActive(void) {
+    return pathPlaying;
+}
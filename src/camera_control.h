@@ -1,6 +1,10 @@
 #ifndef CAMERA_CONTROL_H
 #define CAMERA_CONTROL_H
 
+// A scripted path is a list of keys: x, y, z, pitch, yaw
+#define CAMERA_PATH_MAX_KEYS 64
+#define CAMERA_PATH_KEY_FLOATS 5
+
 void CameraControl_Init();
 void CameraControl_Update(float deltaTime, float* viewMatrix);
 void CameraControl_Cleanup();
@@ -8,6 +12,12 @@ void CameraControl_SetPosition(float x, float y, float z);
 void CameraControl_SetRotation(float pitch, float yaw, float roll);
 void CameraControl_GetPosition(float* x, float* y, float* z);
 void CameraControl_GetRotation(float* pitch, float* yaw, float* roll);
+// Copies up to CAMERA_PATH_MAX_KEYS keys; the camera moves linearly between them.
+void CameraControl_SetPath(const float* keys, int keyCount, float secondsPerKey);
+// Starts the path from its first key; returns 0 if no path is set.
+int CameraControl_StartPath(void);
+// Nonzero while a started path is playing; it overrides keyboard and mouse.
+int CameraControl_PathActive(void);
 
 
 
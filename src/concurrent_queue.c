@@ -0,0 +1,69 @@
+#include "concurrent_queue.h"
+#include <stdlib.h>
+#include <string.h>
+
+int ConcurrentQueue_Init(ConcurrentQueue* queue, size_t capacity) {
+    memset(queue, 0, sizeof(*queue));
+    size_t size = 2;
+    while (size < capacity) size *= 2;
+    queue->cells = malloc(size * sizeof(ConcurrentQueueCell));
+    if (!queue->cells) return 2;
+    queue->mask = size - 1;
+    for (size_t i = 0; i < size; ++i) {
+        atomic_init(&queue->cells[i].sequence, i);
+        queue->cells[i].item = NULL;
+    }
+    atomic_init(&queue->head, 0);
+    atomic_init(&queue->tail, 0);
+    return 0;
+}
+
+void ConcurrentQueue_Free(ConcurrentQueue* queue) {
+    free(queue->cells);
+    queue->cells = NULL;
+    queue->mask = 0;
+}
+
+// A cell at position p takes a push when its sequence is p and a pop when it is p + 1; after a
+// pop it is p + capacity, ready for the push one lap later.
+int ConcurrentQueue_Push(ConcurrentQueue* queue, void* item) {
+    size_t position = atomic_load_explicit(&queue->head, memory_order_relaxed);
+    for (;;) {
+        ConcurrentQueueCell* cell = &queue->cells[position & queue->mask];
+        size_t sequence = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+        ptrdiff_t diff = (ptrdiff_t)sequence - (ptrdiff_t)position;
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&queue->head, &position, position + 1, memory_order_relaxed,
+                                                      memory_order_relaxed)) {
+                cell->item = item;
+                atomic_store_explicit(&cell->sequence, position + 1, memory_order_release);
+                return 0;
+            }
+        } else if (diff < 0) {
+            return 1;
+        } else {
+            position = atomic_load_explicit(&queue->head, memory_order_relaxed);
+        }
+    }
+}
+
+void* ConcurrentQueue_Pop(ConcurrentQueue* queue) {
+    size_t position = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+    for (;;) {
+        ConcurrentQueueCell* cell = &queue->cells[position & queue->mask];
+        size_t sequence = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+        ptrdiff_t diff = (ptrdiff_t)sequence - (ptrdiff_t)(position + 1);
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&queue->tail, &position, position + 1, memory_order_relaxed,
+                                                      memory_order_relaxed)) {
+                void* item = cell->item;
+                atomic_store_explicit(&cell->sequence, position + queue->mask + 1, memory_order_release);
+                return item;
+            }
+        } else if (diff < 0) {
+            return NULL;
+        } else {
+            position = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+        }
+    }
+}
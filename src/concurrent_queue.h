@@ -0,0 +1,36 @@
+#ifndef CONCURRENT_QUEUE_H
+#define CONCURRENT_QUEUE_H
+
+#include <stddef.h>
+#include <stdatomic.h>
+
+// Bounded queue of pointers that any number of threads push to and pop from without locks.
+// Each cell has a sequence number telling whether it is ready for the next push or pop, so a
+// thread only has to win one compare-and-swap on the head or tail (Vyukov's bounded queue).
+// Used to hand finished work from loader threads to the GL thread.
+
+typedef struct {
+    atomic_size_t sequence;
+    void* item;
+} ConcurrentQueueCell;
+
+typedef struct {
+    ConcurrentQueueCell* cells;
+    size_t mask;                           // capacity - 1, capacity is a power of two
+    char pad0[64];
+    atomic_size_t head;                    // next push
+    char pad1[64];
+    atomic_size_t tail;                    // next pop
+    char pad2[64];
+} ConcurrentQueue;
+
+// capacity is rounded up to a power of two. Returns 0 on success, 2 when out of memory.
+int ConcurrentQueue_Init(ConcurrentQueue* queue, size_t capacity);
+void ConcurrentQueue_Free(ConcurrentQueue* queue);
+
+// Returns 0 on success, 1 when the queue is full.
+int ConcurrentQueue_Push(ConcurrentQueue* queue, void* item);
+// Returns the oldest item, or NULL when the queue is empty.
+void* ConcurrentQueue_Pop(ConcurrentQueue* queue);
+
+#endif
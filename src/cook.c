@@ -0,0 +1,437 @@
+// Headless asset cooker: processes every mesh and texture a scene references into the asset
+// cache and writes the scene manifest, so the runtime starts without parsing OBJ or JSON or
+// decoding images. Needs no GL context.
+//
+//   cook [-f] [-u] [-b] [-j threads] [-p pack] [scene.json]
+//
+// -f cooks again even when a valid entry exists; -u stores payloads uncompressed, which only
+// affects entries cooked in this run, so combine it with -f to rewrite existing ones; -b cooks
+// textures without block compression, for a runtime whose GL lacks S3TC; -p also
+// writes everything the scene needs into one asset pack (see asset_pack.h). The default scene
+// is assets/scene.json.
+
+#include "scene_manifest.h"
+#include "mesh_cooker.h"
+#include "texture_cooker.h"
+#include "texture_packer.h"
+#include "asset_cache.h"
+#include "asset_pack.h"
+#include "hash_utils.h"
+#include "mtl_loader.h"
+#include "thread_utils.h"
+#include "time_utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#define DEFAULT_SCENE_FILE "assets/scene.json"
+
+typedef enum {
+    COOK_MESH,
+    COOK_TEXTURE
+} CookAssetType;
+
+typedef enum {
+    COOK_PENDING,
+    COOK_COOKED,
+    COOK_UP_TO_DATE,
+    COOK_FAILED
+} CookStatus;
+
+typedef struct {
+    CookAssetType type;
+    char path[TEXTURE_PACKER_NAME_SIZE];      // or the name of a packed texture
+    MeshProcessParams params;                 // meshes only
+    TextureKind kind;                         // textures only
+    uint64_t sourceSize;
+    CookStatus status;
+    double seconds;
+    uint64_t cookedBytes;
+    char cachePath[ASSET_CACHE_PATH_SIZE];
+    char materialLibrary[MESH_CACHE_PATH_SIZE];
+} CookAsset;
+
+typedef struct {
+    CookAsset* assets;
+    int count;
+    int capacity;
+} AssetList;
+
+typedef struct {
+    AssetList* list;
+    int* order;                  // largest source first, so a big asset does not start last
+    int innerThreads;
+    int force;
+} CookJob;
+
+static uint64_t fileSize(const char* path) {
+    struct stat st;
+    return (stat(path, &st) == 0) ? (uint64_t)st.st_size : 0;
+}
+
+// Of the file, or of every map of a packed texture.
+static uint64_t sourceSize(const char* path) {
+    char sources[3][TEXTURE_PACKER_SOURCE_SIZE];
+    if (TexturePacker_GetSources(path, sources)) return fileSize(path);
+    uint64_t total = 0;
+    for (int i = 0; i < 3; ++i) {
+        if (sources[i][0] != '\0') total += fileSize(sources[i]);
+    }
+    return total;
+}
+
+// Returns 2 when out of memory. Assets already in the list are not added again.
+static int addAsset(AssetList* list, CookAssetType type, const char* path, const MeshProcessParams* params,
+                    TextureKind kind) {
+    if (path[0] == '\0') return 0;
+    for (int i = 0; i < list->count; ++i) {
+        const CookAsset* asset = &list->assets[i];
+        if (asset->type == type && strcmp(asset->path, path) == 0 &&
+            (type == COOK_MESH ? memcmp(&asset->params, params, sizeof(*params)) == 0 : asset->kind == kind)) {
+            return 0;
+        }
+    }
+    if (list->count == list->capacity) {
+        int capacity = list->capacity ? list->capacity * 2 : 64;
+        CookAsset* grown = realloc(list->assets, (size_t)capacity * sizeof(CookAsset));
+        if (!grown) return 2;
+        list->assets = grown;
+        list->capacity = capacity;
+    }
+    CookAsset* asset = &list->assets[list->count++];
+    memset(asset, 0, sizeof(*asset));
+    asset->type = type;
+    snprintf(asset->path, sizeof(asset->path), "%s", path);
+    if (params) asset->params = *params;
+    asset->kind = kind;
+    asset->sourceSize = sourceSize(path);
+    return 0;
+}
+
+static void cookMesh(CookAsset* asset, int threadCount, int force) {
+    uint64_t sourceHash;
+    if (HashFile64(asset->path, 0, &sourceHash)) {
+        asset->status = COOK_FAILED;
+        return;
+    }
+    char* cachePath = asset->cachePath;
+    MeshCache_GetPath(sourceHash, &asset->params, cachePath, sizeof(asset->cachePath));
+
+    MeshCache cache;
+    if (!force && MeshCache_Open(cachePath, sourceHash, &asset->params, &cache) == 0) {
+        MeshCacheData data;
+        MeshCache_GetData(&cache, &data);
+        snprintf(asset->materialLibrary, sizeof(asset->materialLibrary), "%s",
+                 data.materialLibrary ? data.materialLibrary : "");
+        MeshCache_Close(&cache);
+        AssetCache_Touch(cachePath);
+        asset->cookedBytes = fileSize(cachePath);
+        asset->status = COOK_UP_TO_DATE;
+        return;
+    }
+
+    CookedMesh cooked;
+    if (MeshCooker_Cook(asset->path, &asset->params, threadCount, &cooked)) {
+        asset->status = COOK_FAILED;
+        return;
+    }
+    snprintf(asset->materialLibrary, sizeof(asset->materialLibrary), "%s", cooked.materialLibrary);
+    int failed = MeshCache_Write(cachePath, sourceHash, &asset->params, &cooked.data);
+    MeshCooker_Free(&cooked);
+    asset->cookedBytes = fileSize(cachePath);
+    asset->status = failed ? COOK_FAILED : COOK_COOKED;
+}
+
+static void cookTexture(CookAsset* asset, int threadCount, int force) {
+    uint64_t sourceHash;
+    if (TextureCooker_HashSource(asset->path, &sourceHash)) {
+        asset->status = COOK_FAILED;
+        return;
+    }
+    char* cachePath = asset->cachePath;
+    TextureCache_GetPath(sourceHash, asset->kind, cachePath, sizeof(asset->cachePath));
+
+    TextureCache cache;
+    if (!force && TextureCache_Open(cachePath, sourceHash, asset->kind, &cache) == 0) {
+        TextureCache_Close(&cache);
+        AssetCache_Touch(cachePath);
+        asset->cookedBytes = fileSize(cachePath);
+        asset->status = COOK_UP_TO_DATE;
+        return;
+    }
+
+    CookedTexture cooked;
+    if (TextureCooker_Cook(asset->path, asset->kind, threadCount, &cooked)) {
+        asset->status = COOK_FAILED;
+        return;
+    }
+    int failed = TextureCache_Write(cachePath, sourceHash, &cooked.data);
+    TextureCooker_Free(&cooked);
+    asset->cookedBytes = fileSize(cachePath);
+    asset->status = failed ? COOK_FAILED : COOK_COOKED;
+}
+
+static void cookTask(void* context, int taskIndex) {
+    CookJob* job = (CookJob*)context;
+    CookAsset* asset = &job->list->assets[job->order[taskIndex]];
+    double startTime = GetTimeSeconds();
+    if (asset->type == COOK_MESH) {
+        cookMesh(asset, job->innerThreads, job->force);
+    } else {
+        cookTexture(asset, job->innerThreads, job->force);
+    }
+    asset->seconds = GetTimeSeconds() - startTime;
+
+    static const char* statusNames[] = {"pending", "cooked", "up to date", "FAILED"};
+    printf("[Cook] %-7s %s: %s in %.1f ms (%llu KB source, %llu KB cooked)\n",
+           asset->type == COOK_MESH ? "mesh" : "texture", asset->path, statusNames[asset->status],
+           asset->seconds * 1000.0, (unsigned long long)(asset->sourceSize / 1024),
+           (unsigned long long)(asset->cookedBytes / 1024));
+}
+
+static const AssetList* sortList;
+
+static int compareSourceSize(const void* a, const void* b) {
+    uint64_t sa = sortList->assets[*(const int*)a].sourceSize;
+    uint64_t sb = sortList->assets[*(const int*)b].sourceSize;
+    if (sa != sb) return (sa > sb) ? -1 : 1;
+    return *(const int*)a - *(const int*)b;
+}
+
+// Cooks the pending assets of one type; with fewer assets than threads, each asset gets the rest.
+static int cookPending(AssetList* list, CookAssetType type, int threadCount, int force) {
+    int* order = malloc((size_t)list->count * sizeof(int) + 1);
+    if (!order) return 2;
+    int pending = 0;
+    for (int i = 0; i < list->count; ++i) {
+        if (list->assets[i].type == type && list->assets[i].status == COOK_PENDING) order[pending++] = i;
+    }
+    sortList = list;
+    qsort(order, (size_t)pending, sizeof(int), compareSourceSize);
+
+    CookJob job;
+    job.list = list;
+    job.order = order;
+    job.innerThreads = (pending > 0 && pending < threadCount) ? threadCount / pending : 1;
+    job.force = force;
+    ParallelFor(pending, threadCount, cookTask, &job);
+    free(order);
+    return 0;
+}
+
+// Maps named in the MTL files of the cooked meshes; the runtime loads them per submesh. A
+// material's packed maps take the ones it lacks from the object, so they are per object.
+static int addMaterialTextures(AssetList* list, const SceneManifest* manifest) {
+    for (int i = 0; i < manifest->objectCount; ++i) {
+        const SceneObjectDesc* desc = &manifest->objects[i];
+        if (desc->flags & SCENE_OBJECT_STREAM) continue;
+        MeshProcessParams params;
+        MeshCooker_GetParams(desc->flags & SCENE_OBJECT_SMOOTH, (VertexLayoutId)desc->vertexLayout, &params);
+        const CookAsset* mesh = NULL;
+        for (int a = 0; a < list->count && !mesh; ++a) {
+            const CookAsset* asset = &list->assets[a];
+            if (asset->type == COOK_MESH && strcmp(asset->path, desc->mesh) == 0 &&
+                memcmp(&asset->params, &params, sizeof(params)) == 0) {
+                mesh = asset;
+            }
+        }
+        if (!mesh || mesh->materialLibrary[0] == '\0') continue;
+        MaterialLibrary library = {0};
+        if (LoadMTL(mesh->materialLibrary, &library)) continue;
+        int result = 0;
+        for (int m = 0; m < library.count && result == 0; ++m) {
+            const ObjMaterial* material = &library.materials[m];
+            char orm[TEXTURE_PACKER_NAME_SIZE];
+            SceneManifest_GetOrmName(desc, material->roughnessMap, material->metalnessMap, orm, sizeof(orm));
+            result |= addAsset(list, COOK_TEXTURE, material->diffuseMap, NULL, TEXTURE_KIND_COLOR);
+            result |= addAsset(list, COOK_TEXTURE, material->normalMap, NULL, TEXTURE_KIND_NORMAL);
+            result |= addAsset(list, COOK_TEXTURE, orm, NULL, TEXTURE_KIND_DATA);
+        }
+        FreeMaterialLibrary(&library);
+        if (result) return result;
+    }
+    return 0;
+}
+
+typedef struct {
+    AssetPackSource* sources;
+    size_t count;
+    FileMap* maps;                 // one per source, closed state for material tables
+    char (*cachePaths)[ASSET_CACHE_PATH_SIZE];   // one per source, "" for material tables
+    MaterialLibrary* libraries;
+    size_t libraryCount;
+} PackContents;
+
+// Paths that differ only in case or slashes share a key and are packed once
+static int hasKey(const PackContents* contents, uint64_t key) {
+    for (size_t i = 0; i < contents->count; ++i) {
+        if (contents->sources[i].key == key) return 1;
+    }
+    return 0;
+}
+
+static void addPackSource(PackContents* contents, AssetPackType type, uint64_t key, const void* data, size_t size) {
+    if (hasKey(contents, key)) return;
+    AssetPackSource* source = &contents->sources[contents->count++];
+    source->key = key;
+    source->flags = (uint32_t)type;
+    source->data = data;
+    source->size = size;
+}
+
+static int addPackFile(PackContents* contents, AssetPackType type, uint64_t key, const char* cachePath) {
+    if (hasKey(contents, key)) return 0;
+    // Equal sources cook to the same cache file, which the pack stores once
+    for (size_t i = 0; i < contents->count; ++i) {
+        if (strcmp(contents->cachePaths[i], cachePath) == 0) {
+            snprintf(contents->cachePaths[contents->count], ASSET_CACHE_PATH_SIZE, "%s", cachePath);
+            addPackSource(contents, type, key, contents->sources[i].data, contents->sources[i].size);
+            return 0;
+        }
+    }
+    FileMap* map = &contents->maps[contents->count];
+    if (FileMap_Open(cachePath, map)) return 1;
+    snprintf(contents->cachePaths[contents->count], ASSET_CACHE_PATH_SIZE, "%s", cachePath);
+    addPackSource(contents, type, key, map->data, map->size);
+    return 0;
+}
+
+// Packs the cooked entries of the scene, the material tables of its meshes and the manifest.
+static int writePack(const char* packPath, const char* sceneFile, const AssetList* list) {
+    size_t capacity = 2 * (size_t)list->count + 1;
+    PackContents contents = {0};
+    contents.sources = calloc(capacity, sizeof(AssetPackSource));
+    contents.maps = calloc(capacity, sizeof(FileMap));
+    contents.cachePaths = calloc(capacity, sizeof(*contents.cachePaths));
+    contents.libraries = calloc((size_t)list->count + 1, sizeof(MaterialLibrary));
+    int result = (contents.sources && contents.maps && contents.cachePaths && contents.libraries) ? 0 : 2;
+    for (size_t i = 0; i < capacity && contents.maps; ++i) FileMap_Init(&contents.maps[i]);
+
+    for (int i = 0; i < list->count && result == 0; ++i) {
+        const CookAsset* asset = &list->assets[i];
+        if (asset->status == COOK_FAILED) continue;
+        if (asset->type == COOK_MESH) {
+            uint64_t key = AssetPack_MakeKey(ASSET_PACK_MESH, asset->path, &asset->params, sizeof(asset->params));
+            result = addPackFile(&contents, ASSET_PACK_MESH, key, asset->cachePath);
+            MaterialLibrary* library = &contents.libraries[contents.libraryCount];
+            if (result == 0 && asset->materialLibrary[0] != '\0' && LoadMTL(asset->materialLibrary, library) == 0) {
+                contents.libraryCount++;
+                addPackSource(&contents, ASSET_PACK_MATERIALS,
+                              AssetPack_MakeKey(ASSET_PACK_MATERIALS, asset->materialLibrary, NULL, 0),
+                              library->materials, (size_t)library->count * sizeof(ObjMaterial));
+            }
+        } else {
+            uint32_t params[2] = { (uint32_t)asset->kind, (uint32_t)TextureCache_GetBlockCompression() };
+            uint64_t key = AssetPack_MakeKey(ASSET_PACK_TEXTURE, asset->path, params, sizeof(params));
+            result = addPackFile(&contents, ASSET_PACK_TEXTURE, key, asset->cachePath);
+        }
+    }
+    if (result == 0) {
+        char manifestPath[ASSET_CACHE_PATH_SIZE];
+        SceneManifest_GetPath(sceneFile, manifestPath, sizeof(manifestPath));
+        result = addPackFile(&contents, ASSET_PACK_SCENE, AssetPack_MakeKey(ASSET_PACK_SCENE, sceneFile, NULL, 0),
+                             manifestPath);
+    }
+    if (result == 0) {
+        result = AssetPack_Write(packPath, contents.sources, contents.count);
+    }
+
+    for (size_t i = 0; i < capacity && contents.maps; ++i) FileMap_Close(&contents.maps[i]);
+    for (size_t i = 0; i < contents.libraryCount; ++i) FreeMaterialLibrary(&contents.libraries[i]);
+    free(contents.sources);
+    free(contents.maps);
+    free(contents.cachePaths);
+    free(contents.libraries);
+    return result;
+}
+
+static void printUsage(void) {
+    fprintf(stderr, "Usage: cook [-f] [-u] [-b] [-j threads] [-p pack] [scene.json]\n");
+}
+
+int main(int argc, char** argv) {
+    const char* sceneFile = DEFAULT_SCENE_FILE;
+    int threadCount = GetHardwareThreadCount();
+    const char* packPath = NULL;
+    int force = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "-f") == 0) {
+            force = 1;
+        } else if (strcmp(argv[i], "-u") == 0) {
+            AssetCache_SetCompression(0);
+        } else if (strcmp(argv[i], "-b") == 0) {
+            TextureCache_SetBlockCompression(0);
+        } else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) {
+            packPath = argv[++i];
+        } else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            threadCount = atoi(argv[++i]);
+            if (threadCount < 1) threadCount = 1;
+        } else if (argv[i][0] == '-') {
+            printUsage();
+            return 2;
+        } else {
+            sceneFile = argv[i];
+        }
+    }
+
+    double startTime = GetTimeSeconds();
+    SceneManifest manifest;
+    if (SceneManifest_Parse(sceneFile, &manifest)) {
+        return 1;
+    }
+
+    AssetList list = {0};
+    int result = 0;
+    for (int i = 0; i < manifest.objectCount && result == 0; ++i) {
+        const SceneObjectDesc* desc = &manifest.objects[i];
+        // Streamed meshes go to the GPU as they are parsed and have nothing to cook
+        if (!(desc->flags & SCENE_OBJECT_STREAM)) {
+            MeshProcessParams params;
+            MeshCooker_GetParams(desc->flags & SCENE_OBJECT_SMOOTH, (VertexLayoutId)desc->vertexLayout, &params);
+            result |= addAsset(&list, COOK_MESH, desc->mesh, &params, TEXTURE_KIND_COLOR);
+        }
+        char orm[TEXTURE_PACKER_NAME_SIZE];
+        SceneManifest_GetOrmName(desc, NULL, NULL, orm, sizeof(orm));
+        result |= addAsset(&list, COOK_TEXTURE, desc->textures[SCENE_TEXTURE_ALBEDO], NULL, TEXTURE_KIND_COLOR);
+        result |= addAsset(&list, COOK_TEXTURE, desc->textures[SCENE_TEXTURE_NORMAL], NULL, TEXTURE_KIND_NORMAL);
+        result |= addAsset(&list, COOK_TEXTURE, orm, NULL, TEXTURE_KIND_DATA);
+    }
+    printf("[Cook] %s: %d objects, cooking on %d threads\n", sceneFile, manifest.objectCount, threadCount);
+
+    // Meshes first: their MTL files name more textures
+    if (result == 0) result = cookPending(&list, COOK_MESH, threadCount, force);
+    if (result == 0) result = addMaterialTextures(&list, &manifest);
+    if (result == 0) result = cookPending(&list, COOK_TEXTURE, threadCount, force);
+    if (result) {
+        fprintf(stderr, "[Cook] Out of memory\n");
+        free(list.assets);
+        SceneManifest_Free(&manifest);
+        return 1;
+    }
+
+    int counts[4] = {0};
+    uint64_t sourceBytes = 0, cookedBytes = 0;
+    double cpuSeconds = 0.0;
+    for (int i = 0; i < list.count; ++i) {
+        counts[list.assets[i].status]++;
+        sourceBytes += list.assets[i].sourceSize;
+        cookedBytes += list.assets[i].cookedBytes;
+        cpuSeconds += list.assets[i].seconds;
+    }
+    int writeFailed = SceneManifest_Write(sceneFile, &manifest);
+    if (packPath && !writeFailed) {
+        double packStart = GetTimeSeconds();
+        writeFailed = writePack(packPath, sceneFile, &list);
+        printf("[Cook] Pack written in %.1f ms\n", (GetTimeSeconds() - packStart) * 1000.0);
+    }
+
+    printf("[Cook] %d assets: %d cooked, %d up to date, %d failed; %llu KB source, %llu KB cooked; "
+           "%.1f s of work in %.1f s\n", list.count, counts[COOK_COOKED], counts[COOK_UP_TO_DATE],
+           counts[COOK_FAILED], (unsigned long long)(sourceBytes / 1024), (unsigned long long)(cookedBytes / 1024),
+           cpuSeconds, GetTimeSeconds() - startTime);
+
+    free(list.assets);
+    SceneManifest_Free(&manifest);
+    return (counts[COOK_FAILED] > 0 || writeFailed) ? 1 : 0;
+}
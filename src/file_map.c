@@ -0,0 +1,119 @@
+#include "file_map.h"
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+void FileMap_Init(FileMap* map) {
+    map->data = NULL;
+    map->size = 0;
+#ifdef _WIN32
+    map->fileHandle = NULL;
+    map->mappingHandle = NULL;
+#else
+    map->fd = -1;
+#endif
+}
+
+#ifdef _WIN32
+
+int FileMap_Open(const char* filename, FileMap* map) {
+    FileMap_Init(map);
+
+    HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        fprintf(stderr, "[FileMap] Failed to open '%s' (error %lu)\n", filename, GetLastError());
+        return 1;
+    }
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size)) {
+        fprintf(stderr, "[FileMap] Failed to query size of '%s' (error %lu)\n", filename, GetLastError());
+        CloseHandle(file);
+        return 1;
+    }
+
+    map->fileHandle = file;
+    map->size = (size_t)size.QuadPart;
+    if (map->size == 0) {
+        return 0;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!mapping) {
+        fprintf(stderr, "[FileMap] Failed to map '%s' (error %lu)\n", filename, GetLastError());
+        FileMap_Close(map);
+        return 1;
+    }
+    map->mappingHandle = mapping;
+
+    map->data = (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!map->data) {
+        fprintf(stderr, "[FileMap] Failed to view '%s' (error %lu)\n", filename, GetLastError());
+        FileMap_Close(map);
+        return 1;
+    }
+    return 0;
+}
+
+void FileMap_Close(FileMap* map) {
+    if (!map) return;
+    if (map->data) UnmapViewOfFile(map->data);
+    if (map->mappingHandle) CloseHandle((HANDLE)map->mappingHandle);
+    if (map->fileHandle) CloseHandle((HANDLE)map->fileHandle);
+    FileMap_Init(map);
+}
+
+#else
+
+int FileMap_Open(const char* filename, FileMap* map) {
+    FileMap_Init(map);
+
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "[FileMap] Failed to open '%s': %s\n", filename, strerror(errno));
+        return 1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        fprintf(stderr, "[FileMap] Failed to stat '%s': %s\n", filename, strerror(errno));
+        close(fd);
+        return 1;
+    }
+
+    map->fd = fd;
+    map->size = (size_t)st.st_size;
+    if (map->size == 0) {
+        return 0;
+    }
+
+    void* data = mmap(NULL, map->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+        fprintf(stderr, "[FileMap] Failed to map '%s': %s\n", filename, strerror(errno));
+        FileMap_Close(map);
+        return 1;
+    }
+    madvise(data, map->size, MADV_SEQUENTIAL);
+    map->data = (const char*)data;
+    return 0;
+}
+
+void FileMap_Close(FileMap* map) {
+    if (!map) return;
+    if (map->data) munmap((void*)map->data, map->size);
+    if (map->fd >= 0) close(map->fd);
+    FileMap_Init(map);
+}
+
+#endif
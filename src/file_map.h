@@ -0,0 +1,24 @@
+#ifndef FILE_MAP_H
+#define FILE_MAP_H
+
+#include <stddef.h>
+
+// Read-only memory mapping of a whole file.
+typedef struct {
+    const char* data;
+    size_t size;
+#ifdef _WIN32
+    void* fileHandle;
+    void* mappingHandle;
+#else
+    int fd;
+#endif
+} FileMap;
+
+// Puts map in the closed state, so FileMap_Close on it does nothing.
+void FileMap_Init(FileMap* map);
+// Returns 0 on success. Empty files succeed with data == NULL and size == 0.
+int FileMap_Open(const char* filename, FileMap* map);
+void FileMap_Close(FileMap* map);
+
+#endif
@@ -0,0 +1,431 @@
+#include "geometry_kernels.h"
+#include "vertex_format.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <math.h>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define GEOMETRY_KERNELS_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+// GCC and clang compile each SIMD variant for its own instruction set, so the rest of
+// the program keeps the default target. Helpers are always inlined, also in -O0 builds.
+#if defined(__GNUC__)
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#define KERNEL_INLINE static inline __attribute__((always_inline))
+#elif defined(_MSC_VER)
+#define TARGET_SSE2
+#define TARGET_AVX2
+#define KERNEL_INLINE static __forceinline
+#else
+#define TARGET_SSE2
+#define TARGET_AVX2
+#define KERNEL_INLINE static inline
+#endif
+
+#define TRIANGLE_STRIDE (3 * FLOATS_PER_VERTEX)
+#define DEGENERATE_LENGTH 1e-6f
+#define DEGENERATE_UV_AREA 1e-8f
+
+static void faceNormalsScalar(const float* vertices, size_t triangleCount, float* normals) {
+    for (size_t t = 0; t < triangleCount; ++t) {
+        const float* v0 = &vertices[t * TRIANGLE_STRIDE];
+        const float* v1 = v0 + FLOATS_PER_VERTEX;
+        const float* v2 = v1 + FLOATS_PER_VERTEX;
+
+        float e1x = v1[0] - v0[0], e1y = v1[1] - v0[1], e1z = v1[2] - v0[2];
+        float e2x = v2[0] - v0[0], e2y = v2[1] - v0[1], e2z = v2[2] - v0[2];
+
+        float nx = e1y * e2z - e1z * e2y;
+        float ny = e1z * e2x - e1x * e2z;
+        float nz = e1x * e2y - e1y * e2x;
+
+        float len = sqrtf(nx * nx + ny * ny + nz * nz);
+        if (len > DEGENERATE_LENGTH) {
+            nx /= len; ny /= len; nz /= len;
+        }
+        normals[t * 3 + 0] = nx;
+        normals[t * 3 + 1] = ny;
+        normals[t * 3 + 2] = nz;
+    }
+}
+
+static void tangentsScalar(float* vertices, size_t triangleCount) {
+    for (size_t t = 0; t < triangleCount; ++t) {
+        float* v0 = &vertices[t * TRIANGLE_STRIDE];
+        float* v1 = v0 + FLOATS_PER_VERTEX;
+        float* v2 = v1 + FLOATS_PER_VERTEX;
+
+        // Positions
+        float x1 = v1[0] - v0[0];
+        float y1 = v1[1] - v0[1];
+        float z1 = v1[2] - v0[2];
+
+        float x2 = v2[0] - v0[0];
+        float y2 = v2[1] - v0[1];
+        float z2 = v2[2] - v0[2];
+
+        // UVs
+        float s1 = v1[6] - v0[6];
+        float t1 = v1[7] - v0[7];
+        float s2 = v2[6] - v0[6];
+        float t2 = v2[7] - v0[7];
+
+        float r = (s1 * t2 - s2 * t1);
+        if (fabsf(r) < DEGENERATE_UV_AREA) r = 1.0f; // avoid division by zero
+        else r = 1.0f / r;
+
+        float tx = (t2 * x1 - t1 * x2) * r;
+        float ty = (t2 * y1 - t1 * y2) * r;
+        float tz = (t2 * z1 - t1 * z2) * r;
+
+        // Store tangent per vertex
+        for (int j = 0; j < 3; ++j) {
+            v0[j * FLOATS_PER_VERTEX + 8] = tx;
+            v0[j * FLOATS_PER_VERTEX + 9] = ty;
+            v0[j * FLOATS_PER_VERTEX + 10] = tz;
+        }
+    }
+}
+
+static void normalizeScalar(float* vectors, size_t count, size_t stride) {
+    for (size_t i = 0; i < count; ++i) {
+        float* v = &vectors[i * stride];
+        float len = sqrtf(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+        if (len > DEGENERATE_LENGTH) {
+            v[0] /= len; v[1] /= len; v[2] /= len;
+        }
+    }
+}
+
+#ifdef GEOMETRY_KERNELS_X86
+
+// Vectors are moved between the interleaved buffer and SoA registers with one 4-float load
+// per vector and a transpose; on the way back they are transposed into rows and each row is
+// stored as 2 + 1 floats, so the floats around a vector are never written.
+
+// Reads a fourth float after each vector; every attribute of a vertex is followed by one.
+KERNEL_INLINE TARGET_SSE2 void loadXyz4(const float* p, size_t stride, __m128* x, __m128* y, __m128* z) {
+    __m128 r0 = _mm_loadu_ps(p);
+    __m128 r1 = _mm_loadu_ps(p + stride);
+    __m128 r2 = _mm_loadu_ps(p + 2 * stride);
+    __m128 r3 = _mm_loadu_ps(p + 3 * stride);
+    __m128 xy01 = _mm_unpacklo_ps(r0, r1);
+    __m128 xy23 = _mm_unpacklo_ps(r2, r3);
+    *x = _mm_movelh_ps(xy01, xy23);
+    *y = _mm_movehl_ps(xy23, xy01);
+    *z = _mm_shuffle_ps(_mm_unpackhi_ps(r0, r1), _mm_unpackhi_ps(r2, r3), _MM_SHUFFLE(1, 0, 1, 0));
+}
+
+KERNEL_INLINE TARGET_SSE2 void loadXy4(const float* p, size_t stride, __m128* x, __m128* y) {
+    __m128 xy01 = _mm_unpacklo_ps(_mm_loadu_ps(p), _mm_loadu_ps(p + stride));
+    __m128 xy23 = _mm_unpacklo_ps(_mm_loadu_ps(p + 2 * stride), _mm_loadu_ps(p + 3 * stride));
+    *x = _mm_movelh_ps(xy01, xy23);
+    *y = _mm_movehl_ps(xy23, xy01);
+}
+
+// rows[i] = (x[i], y[i], z[i], 0)
+KERNEL_INLINE TARGET_SSE2 void rowsXyz4(__m128 x, __m128 y, __m128 z, __m128* rows) {
+    __m128 zero = _mm_setzero_ps();
+    __m128 xy01 = _mm_unpacklo_ps(x, y);
+    __m128 xy23 = _mm_unpackhi_ps(x, y);
+    __m128 z01 = _mm_unpacklo_ps(z, zero);
+    __m128 z23 = _mm_unpackhi_ps(z, zero);
+    rows[0] = _mm_movelh_ps(xy01, z01);
+    rows[1] = _mm_movehl_ps(z01, xy01);
+    rows[2] = _mm_movelh_ps(xy23, z23);
+    rows[3] = _mm_movehl_ps(z23, xy23);
+}
+
+// high is movehl(row, row), so rows written to several places are shuffled once
+KERNEL_INLINE TARGET_SSE2 void storeRow(float* p, __m128 row, __m128 high) {
+    _mm_storel_pi((__m64*)p, row);
+    _mm_store_ss(p + 2, high);
+}
+
+KERNEL_INLINE TARGET_SSE2 void storeXyz4(float* p, size_t stride, __m128 x, __m128 y, __m128 z) {
+    __m128 rows[4];
+    rowsXyz4(x, y, z, rows);
+    for (int l = 0; l < 4; ++l) storeRow(p + l * stride, rows[l], _mm_movehl_ps(rows[l], rows[l]));
+}
+
+KERNEL_INLINE TARGET_SSE2 __m128 select4(__m128 mask, __m128 a, __m128 b) {
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+// SSE2: 4 triangles per step
+
+TARGET_SSE2 static void faceNormalsSse2(const float* vertices, size_t triangleCount, float* normals) {
+    const __m128 threshold = _mm_set1_ps(DEGENERATE_LENGTH);
+    size_t t = 0;
+    for (; t + 4 <= triangleCount; t += 4) {
+        const float* v0 = &vertices[t * TRIANGLE_STRIDE];
+        __m128 x0, y0, z0, x1, y1, z1, x2, y2, z2;
+        loadXyz4(v0, TRIANGLE_STRIDE, &x0, &y0, &z0);
+        loadXyz4(v0 + FLOATS_PER_VERTEX, TRIANGLE_STRIDE, &x1, &y1, &z1);
+        loadXyz4(v0 + 2 * FLOATS_PER_VERTEX, TRIANGLE_STRIDE, &x2, &y2, &z2);
+
+        __m128 e1x = _mm_sub_ps(x1, x0), e1y = _mm_sub_ps(y1, y0), e1z = _mm_sub_ps(z1, z0);
+        __m128 e2x = _mm_sub_ps(x2, x0), e2y = _mm_sub_ps(y2, y0), e2z = _mm_sub_ps(z2, z0);
+
+        __m128 nx = _mm_sub_ps(_mm_mul_ps(e1y, e2z), _mm_mul_ps(e1z, e2y));
+        __m128 ny = _mm_sub_ps(_mm_mul_ps(e1z, e2x), _mm_mul_ps(e1x, e2z));
+        __m128 nz = _mm_sub_ps(_mm_mul_ps(e1x, e2y), _mm_mul_ps(e1y, e2x));
+
+        __m128 len = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, nx), _mm_mul_ps(ny, ny)), _mm_mul_ps(nz, nz)));
+        __m128 valid = _mm_cmpgt_ps(len, threshold);
+        nx = select4(valid, _mm_div_ps(nx, len), nx);
+        ny = select4(valid, _mm_div_ps(ny, len), ny);
+        nz = select4(valid, _mm_div_ps(nz, len), nz);
+        storeXyz4(&normals[t * 3], 3, nx, ny, nz);
+    }
+    faceNormalsScalar(&vertices[t * TRIANGLE_STRIDE], triangleCount - t, &normals[t * 3]);
+}
+
+TARGET_SSE2 static void tangentsSse2(float* vertices, size_t triangleCount) {
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 sign = _mm_set1_ps(-0.0f);
+    const __m128 threshold = _mm_set1_ps(DEGENERATE_UV_AREA);
+    size_t t = 0;
+    for (; t + 4 <= triangleCount; t += 4) {
+        float* v0 = &vertices[t * TRIANGLE_STRIDE];
+        const float* v1 = v0 + FLOATS_PER_VERTEX;
+        const float* v2 = v1 + FLOATS_PER_VERTEX;
+        __m128 x0, y0, z0, x1, y1, z1, x2, y2, z2;
+        __m128 s0, t0, s1, t1, s2, t2;
+        loadXyz4(v0, TRIANGLE_STRIDE, &x0, &y0, &z0);
+        loadXyz4(v1, TRIANGLE_STRIDE, &x1, &y1, &z1);
+        loadXyz4(v2, TRIANGLE_STRIDE, &x2, &y2, &z2);
+        loadXy4(v0 + 6, TRIANGLE_STRIDE, &s0, &t0);
+        loadXy4(v1 + 6, TRIANGLE_STRIDE, &s1, &t1);
+        loadXy4(v2 + 6, TRIANGLE_STRIDE, &s2, &t2);
+
+        x1 = _mm_sub_ps(x1, x0); y1 = _mm_sub_ps(y1, y0); z1 = _mm_sub_ps(z1, z0);
+        x2 = _mm_sub_ps(x2, x0); y2 = _mm_sub_ps(y2, y0); z2 = _mm_sub_ps(z2, z0);
+        s1 = _mm_sub_ps(s1, s0); t1 = _mm_sub_ps(t1, t0);
+        s2 = _mm_sub_ps(s2, s0); t2 = _mm_sub_ps(t2, t0);
+
+        __m128 r = _mm_sub_ps(_mm_mul_ps(s1, t2), _mm_mul_ps(s2, t1));
+        __m128 degenerate = _mm_cmplt_ps(_mm_andnot_ps(sign, r), threshold);
+        r = select4(degenerate, one, _mm_div_ps(one, r));
+
+        __m128 tx = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(t2, x1), _mm_mul_ps(t1, x2)), r);
+        __m128 ty = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(t2, y1), _mm_mul_ps(t1, y2)), r);
+        __m128 tz = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(t2, z1), _mm_mul_ps(t1, z2)), r);
+
+        // One tangent per triangle, stored to its three corners
+        __m128 rows[4];
+        rowsXyz4(tx, ty, tz, rows);
+        for (int l = 0; l < 4; ++l) {
+            __m128 high = _mm_movehl_ps(rows[l], rows[l]);
+            float* corner = v0 + l * TRIANGLE_STRIDE + 8;
+            storeRow(corner, rows[l], high);
+            storeRow(corner + FLOATS_PER_VERTEX, rows[l], high);
+            storeRow(corner + 2 * FLOATS_PER_VERTEX, rows[l], high);
+        }
+    }
+    tangentsScalar(&vertices[t * TRIANGLE_STRIDE], triangleCount - t);
+}
+
+TARGET_SSE2 static void normalizeSse2(float* vectors, size_t count, size_t stride) {
+    const __m128 threshold = _mm_set1_ps(DEGENERATE_LENGTH);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        float* v = &vectors[i * stride];
+        __m128 x, y, z;
+        loadXyz4(v, stride, &x, &y, &z);
+        __m128 len = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z)));
+        __m128 valid = _mm_cmpgt_ps(len, threshold);
+        x = select4(valid, _mm_div_ps(x, len), x);
+        y = select4(valid, _mm_div_ps(y, len), y);
+        z = select4(valid, _mm_div_ps(z, len), z);
+        storeXyz4(v, stride, x, y, z);
+    }
+    normalizeScalar(&vectors[i * stride], count - i, stride);
+}
+
+// AVX2: 8 triangles per step. Lane i and lane i + 4 share a 128-bit half of each load, so
+// the transposes stay within halves.
+
+KERNEL_INLINE TARGET_AVX2 __m256 loadPair(const float* p, size_t offset) {
+    return _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(p)), _mm_loadu_ps(p + offset), 1);
+}
+
+KERNEL_INLINE TARGET_AVX2 void loadXyz8(const float* p, size_t stride, __m256* x, __m256* y, __m256* z) {
+    __m256 r0 = loadPair(p, 4 * stride);
+    __m256 r1 = loadPair(p + stride, 4 * stride);
+    __m256 r2 = loadPair(p + 2 * stride, 4 * stride);
+    __m256 r3 = loadPair(p + 3 * stride, 4 * stride);
+    __m256 xy01 = _mm256_unpacklo_ps(r0, r1);
+    __m256 xy23 = _mm256_unpacklo_ps(r2, r3);
+    *x = _mm256_shuffle_ps(xy01, xy23, _MM_SHUFFLE(1, 0, 1, 0));
+    *y = _mm256_shuffle_ps(xy01, xy23, _MM_SHUFFLE(3, 2, 3, 2));
+    *z = _mm256_shuffle_ps(_mm256_unpackhi_ps(r0, r1), _mm256_unpackhi_ps(r2, r3), _MM_SHUFFLE(1, 0, 1, 0));
+}
+
+// rows[i] = (x[i], y[i], z[i], 0) for lanes 0..7
+KERNEL_INLINE TARGET_AVX2 void rowsXyz8(__m256 x, __m256 y, __m256 z, __m128* rows) {
+    __m256 zero = _mm256_setzero_ps();
+    __m256 xy01 = _mm256_unpacklo_ps(x, y);
+    __m256 xy23 = _mm256_unpackhi_ps(x, y);
+    __m256 z01 = _mm256_unpacklo_ps(z, zero);
+    __m256 z23 = _mm256_unpackhi_ps(z, zero);
+    __m256 pairs[4] = {
+        _mm256_shuffle_ps(xy01, z01, _MM_SHUFFLE(1, 0, 1, 0)),
+        _mm256_shuffle_ps(xy01, z01, _MM_SHUFFLE(3, 2, 3, 2)),
+        _mm256_shuffle_ps(xy23, z23, _MM_SHUFFLE(1, 0, 1, 0)),
+        _mm256_shuffle_ps(xy23, z23, _MM_SHUFFLE(3, 2, 3, 2))
+    };
+    for (int l = 0; l < 4; ++l) {
+        rows[l] = _mm256_castps256_ps128(pairs[l]);
+        rows[l + 4] = _mm256_extractf128_ps(pairs[l], 1);
+    }
+}
+
+KERNEL_INLINE TARGET_AVX2 void storeXyz8(float* p, size_t stride, __m256 x, __m256 y, __m256 z) {
+    __m128 rows[8];
+    rowsXyz8(x, y, z, rows);
+    for (int l = 0; l < 8; ++l) storeRow(p + l * stride, rows[l], _mm_movehl_ps(rows[l], rows[l]));
+}
+
+TARGET_AVX2 static void faceNormalsAvx2(const float* vertices, size_t triangleCount, float* normals) {
+    const __m256 threshold = _mm256_set1_ps(DEGENERATE_LENGTH);
+    size_t t = 0;
+    for (; t + 8 <= triangleCount; t += 8) {
+        const float* v0 = &vertices[t * TRIANGLE_STRIDE];
+        __m256 x0, y0, z0, x1, y1, z1, x2, y2, z2;
+        loadXyz8(v0, TRIANGLE_STRIDE, &x0, &y0, &z0);
+        loadXyz8(v0 + FLOATS_PER_VERTEX, TRIANGLE_STRIDE, &x1, &y1, &z1);
+        loadXyz8(v0 + 2 * FLOATS_PER_VERTEX, TRIANGLE_STRIDE, &x2, &y2, &z2);
+
+        __m256 e1x = _mm256_sub_ps(x1, x0), e1y = _mm256_sub_ps(y1, y0), e1z = _mm256_sub_ps(z1, z0);
+        __m256 e2x = _mm256_sub_ps(x2, x0), e2y = _mm256_sub_ps(y2, y0), e2z = _mm256_sub_ps(z2, z0);
+
+        __m256 nx = _mm256_sub_ps(_mm256_mul_ps(e1y, e2z), _mm256_mul_ps(e1z, e2y));
+        __m256 ny = _mm256_sub_ps(_mm256_mul_ps(e1z, e2x), _mm256_mul_ps(e1x, e2z));
+        __m256 nz = _mm256_sub_ps(_mm256_mul_ps(e1x, e2y), _mm256_mul_ps(e1y, e2x));
+
+        __m256 len = _mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(nx, nx), _mm256_mul_ps(ny, ny)),
+                                                  _mm256_mul_ps(nz, nz)));
+        __m256 valid = _mm256_cmp_ps(len, threshold, _CMP_GT_OQ);
+        nx = _mm256_blendv_ps(nx, _mm256_div_ps(nx, len), valid);
+        ny = _mm256_blendv_ps(ny, _mm256_div_ps(ny, len), valid);
+        nz = _mm256_blendv_ps(nz, _mm256_div_ps(nz, len), valid);
+        storeXyz8(&normals[t * 3], 3, nx, ny, nz);
+    }
+    faceNormalsScalar(&vertices[t * TRIANGLE_STRIDE], triangleCount - t, &normals[t * 3]);
+}
+
+TARGET_AVX2 static void normalizeAvx2(float* vectors, size_t count, size_t stride) {
+    const __m256 threshold = _mm256_set1_ps(DEGENERATE_LENGTH);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        float* v = &vectors[i * stride];
+        __m256 x, y, z;
+        loadXyz8(v, stride, &x, &y, &z);
+        __m256 len = _mm256_sqrt_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, x), _mm256_mul_ps(y, y)),
+                                                  _mm256_mul_ps(z, z)));
+        __m256 valid = _mm256_cmp_ps(len, threshold, _CMP_GT_OQ);
+        x = _mm256_blendv_ps(x, _mm256_div_ps(x, len), valid);
+        y = _mm256_blendv_ps(y, _mm256_div_ps(y, len), valid);
+        z = _mm256_blendv_ps(z, _mm256_div_ps(z, len), valid);
+        storeXyz8(v, stride, x, y, z);
+    }
+    normalizeScalar(&vectors[i * stride], count - i, stride);
+}
+
+static void cpuid(unsigned leaf, unsigned subleaf, unsigned regs[4]) {
+#if defined(_MSC_VER)
+    int r[4];
+    __cpuidex(r, (int)leaf, (int)subleaf);
+    for (int i = 0; i < 4; ++i) regs[i] = (unsigned)r[i];
+#else
+    if (!__get_cpuid_count(leaf, subleaf, &regs[0], &regs[1], &regs[2], &regs[3])) {
+        memset(regs, 0, 4 * sizeof(unsigned));
+    }
+#endif
+}
+
+static uint64_t readXcr0(void) {
+#if defined(_MSC_VER)
+    return _xgetbv(0);
+#else
+    uint32_t lo, hi;
+    __asm__ volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+    return ((uint64_t)hi << 32) | lo;
+#endif
+}
+
+static GeometryKernelLevel detectLevel(void) {
+    unsigned regs[4];
+    cpuid(0, 0, regs);
+    unsigned maxLeaf = regs[0];
+    cpuid(1, 0, regs);
+    if (!(regs[3] & (1u << 26))) return GEOMETRY_KERNELS_SCALAR;
+
+    // AVX2 also needs the OS to save the YMM registers: OSXSAVE and AVX, then XCR0 bits 1 and 2
+    int osSavesYmm = (regs[2] & (1u << 27)) && (regs[2] & (1u << 28)) && (readXcr0() & 6) == 6;
+    if (maxLeaf >= 7 && osSavesYmm) {
+        cpuid(7, 0, regs);
+        if (regs[1] & (1u << 5)) return GEOMETRY_KERNELS_AVX2;
+    }
+    return GEOMETRY_KERNELS_SSE2;
+}
+
+#else
+
+static GeometryKernelLevel detectLevel(void) {
+    return GEOMETRY_KERNELS_SCALAR;
+}
+
+#endif
+
+static const GeometryKernels kernelLevels[] = {
+    {GEOMETRY_KERNELS_SCALAR, "scalar", faceNormalsScalar, tangentsScalar, normalizeScalar},
+#ifdef GEOMETRY_KERNELS_X86
+    {GEOMETRY_KERNELS_SSE2, "SSE2", faceNormalsSse2, tangentsSse2, normalizeSse2},
+    // The tangent solve is bound by moving 6 attributes in and 3 out per triangle; 8-wide
+    // transposes measured slower than the 4-wide ones, so AVX2 keeps the SSE2 tangents.
+    {GEOMETRY_KERNELS_AVX2, "AVX2", faceNormalsAvx2, tangentsSse2, normalizeAvx2},
+#endif
+};
+
+// Both are filled in on first use. Threads that race there detect the same level, and only
+// the one whose compare-exchange stores the selection prints it.
+static atomic_int supportedLevel = -1;
+static _Atomic(const GeometryKernels*) selectedKernels = NULL;
+
+static int getSupportedLevel(void) {
+    int level = atomic_load(&supportedLevel);
+    if (level < 0) {
+        level = (int)detectLevel();
+        atomic_store(&supportedLevel, level);
+    }
+    return level;
+}
+
+const GeometryKernels* GeometryKernels_GetLevel(GeometryKernelLevel level) {
+    if ((int)level < 0 || (int)level > getSupportedLevel()) return NULL;
+    return &kernelLevels[level];
+}
+
+const GeometryKernels* GeometryKernels_Get(void) {
+    const GeometryKernels* selected = atomic_load(&selectedKernels);
+    if (!selected) {
+        const GeometryKernels* expected = NULL;
+        selected = &kernelLevels[getSupportedLevel()];
+        if (atomic_compare_exchange_strong(&selectedKernels, &expected, selected)) {
+            printf("[GeometryKernels] Using %s kernels\n", selected->name);
+        }
+    }
+    return selected;
+}
@@ -0,0 +1,35 @@
+#ifndef GEOMETRY_KERNELS_H
+#define GEOMETRY_KERNELS_H
+
+#include <stddef.h>
+
+// Per-triangle kernels over the interleaved FLOATS_PER_VERTEX triangle soup that
+// ComputeSmoothNormals and ComputeTangents work on. The SIMD variants load 4 or 8
+// triangles into SoA registers and do the same float operations in the same order as the
+// scalar one (no FMA), so every variant gives the same results.
+
+typedef enum {
+    GEOMETRY_KERNELS_SCALAR = 0,
+    GEOMETRY_KERNELS_SSE2 = 1,
+    GEOMETRY_KERNELS_AVX2 = 2
+} GeometryKernelLevel;
+
+typedef struct {
+    GeometryKernelLevel level;
+    const char* name;
+    // Unit face normal of each triangle, 3 floats per triangle into normals. Degenerate
+    // triangles (cross product of length 1e-6 or less) keep the unnormalized cross product.
+    void (*faceNormals)(const float* vertices, size_t triangleCount, float* normals);
+    // UV-derivative tangent of each triangle, written to floats 8..10 of its three corners.
+    void (*tangents)(float* vertices, size_t triangleCount);
+    // Normalizes count vectors that start stride floats apart; vectors of length 1e-6 or
+    // less are left as they are.
+    void (*normalize)(float* vectors, size_t count, size_t stride);
+} GeometryKernels;
+
+// The widest level this CPU and OS support, picked with CPUID on the first call.
+const GeometryKernels* GeometryKernels_Get(void);
+// The given level, or NULL when this CPU cannot run it.
+const GeometryKernels* GeometryKernels_GetLevel(GeometryKernelLevel level);
+
+#endif
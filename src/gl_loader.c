@@ -32,6 +32,18 @@ PFNGLDELETESHADERPROC           glDeleteShader = NULL;
 PFNGLUNIFORM1IPROC              glUniform1i = NULL;
 PFNGLACTIVETEXTUREPROC           glActiveTexture = NULL;
 PFNGLUNIFORM3FVPROC           glUniform3fv = NULL;
+PFNGLBUFFERSUBDATAPROC          glBufferSubData = NULL;
+PFNGLCOPYBUFFERSUBDATAPROC      glCopyBufferSubData = NULL;
+PFNGLDELETEBUFFERSPROC          glDeleteBuffers = NULL;
+PFNGLDISABLEVERTEXATTRIBARRAYPROC glDisableVertexAttribArray = NULL;
+PFNGLUNIFORM2FVPROC             glUniform2fv = NULL;
+PFNGLMULTIDRAWELEMENTSPROC      glMultiDrawElements = NULL;
+PFNGLCOMPRESSEDTEXIMAGE2DPROC   glCompressedTexImage2D = NULL;
+PFNGLGETSTRINGIPROC             glGetStringi = NULL;
+PFNGLTEXIMAGE3DPROC             glTexImage3D = NULL;
+PFNGLCOMPRESSEDTEXIMAGE3DPROC   glCompressedTexImage3D = NULL;
+PFNGLUNIFORM1FVPROC             glUniform1fv = NULL;
+PFNGLUNIFORM4FVPROC             glUniform4fv = NULL;
 
 //LOAD set active texture
 
@@ -72,6 +84,18 @@ void LoadGLFunctions(void) {
     LOAD_GL_FUNC(PFNGLUNIFORM1IPROC, glUniform1i);
     LOAD_GL_FUNC(PFNGLACTIVETEXTUREPROC, glActiveTexture);
     LOAD_GL_FUNC(PFNGLUNIFORM3FVPROC, glUniform3fv);
+    LOAD_GL_FUNC(PFNGLBUFFERSUBDATAPROC, glBufferSubData);
+    LOAD_GL_FUNC(PFNGLCOPYBUFFERSUBDATAPROC, glCopyBufferSubData);
+    LOAD_GL_FUNC(PFNGLDELETEBUFFERSPROC, glDeleteBuffers);
+    LOAD_GL_FUNC(PFNGLDISABLEVERTEXATTRIBARRAYPROC, glDisableVertexAttribArray);
+    LOAD_GL_FUNC(PFNGLUNIFORM2FVPROC, glUniform2fv);
+    LOAD_GL_FUNC(PFNGLMULTIDRAWELEMENTSPROC, glMultiDrawElements);
+    LOAD_GL_FUNC(PFNGLCOMPRESSEDTEXIMAGE2DPROC, glCompressedTexImage2D);
+    LOAD_GL_FUNC(PFNGLGETSTRINGIPROC, glGetStringi);
+    LOAD_GL_FUNC(PFNGLTEXIMAGE3DPROC, glTexImage3D);
+    LOAD_GL_FUNC(PFNGLCOMPRESSEDTEXIMAGE3DPROC, glCompressedTexImage3D);
+    LOAD_GL_FUNC(PFNGLUNIFORM1FVPROC, glUniform1fv);
+    LOAD_GL_FUNC(PFNGLUNIFORM4FVPROC, glUniform4fv);
 
 
     printf("All OpenGL functions loaded successfully.\n");
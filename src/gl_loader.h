@@ -31,6 +31,18 @@ extern PFNGLDELETESHADERPROC           glDeleteShader;
 extern PFNGLUNIFORM1IPROC              glUniform1i;
 extern PFNGLACTIVETEXTUREPROC          glActiveTexture;
 extern PFNGLUNIFORM3FVPROC           glUniform3fv;
+extern PFNGLBUFFERSUBDATAPROC          glBufferSubData;
+extern PFNGLCOPYBUFFERSUBDATAPROC      glCopyBufferSubData;
+extern PFNGLDELETEBUFFERSPROC          glDeleteBuffers;
+extern PFNGLDISABLEVERTEXATTRIBARRAYPROC glDisableVertexAttribArray;
+extern PFNGLUNIFORM2FVPROC             glUniform2fv;
+extern PFNGLMULTIDRAWELEMENTSPROC      glMultiDrawElements;
+extern PFNGLCOMPRESSEDTEXIMAGE2DPROC   glCompressedTexImage2D;
+extern PFNGLGETSTRINGIPROC             glGetStringi;
+extern PFNGLTEXIMAGE3DPROC             glTexImage3D;
+extern PFNGLCOMPRESSEDTEXIMAGE3DPROC   glCompressedTexImage3D;
+extern PFNGLUNIFORM1FVPROC             glUniform1fv;
+extern PFNGLUNIFORM4FVPROC             glUniform4fv;
 // Loader function
 void LoadGLFunctions(void);
 
@@ -1,6 +1,7 @@
 #include "gl_setup.h"
 #include <stdlib.h>
 #include <stdio.h>
+#include <stdint.h>
 #include <GL/gl.h>
 
 // Helper function for error checking
@@ -10,13 +11,36 @@ static void CheckGLError(const char* msg) {
         printf("OpenGL Error [%s]: 0x%X\n", msg, err);
     }
 }
-GLuint GLSetup_CreateVAO(const float* data, int vertexCount, int componentsPerVertex) {
-    // NOTE: componentsPerVertex here means floats per vertex total (e.g. 9)
-    // We assume the format is: pos(3 floats), normal(3 floats), color(3 floats)
-    if (componentsPerVertex != 11) {
-        printf("Warning: Expected componentsPerVertex = 11 for pos+normal+color, got %d\n", componentsPerVertex);
+// Attribute pointers for one of the layouts in vertex_format.c. Locations match
+// VertexAttribute. Expects the VAO and its GL_ARRAY_BUFFER to be bound.
+static void SetupVertexAttributes(const VertexLayout* layout) {
+    for (int location = 0; location < VERTEX_ATTRIBUTE_COUNT; ++location) {
+        const VertexAttributeFormat* attribute = &layout->attributes[location];
+        if (attribute->components == 0) {
+            // Absent attributes read the current generic value (0, 0, 0, 1)
+            glDisableVertexAttribArray(location);
+            continue;
+        }
+
+        GLenum type = GL_FLOAT;
+        GLboolean normalized = GL_FALSE;
+        switch (attribute->type) {
+            case VERTEX_COMPONENT_FLOAT32:          type = GL_FLOAT; break;
+            case VERTEX_COMPONENT_HALF:             type = GL_HALF_FLOAT; break;
+            case VERTEX_COMPONENT_UNORM16:          type = GL_UNSIGNED_SHORT; normalized = GL_TRUE; break;
+            case VERTEX_COMPONENT_SNORM16:          type = GL_SHORT; normalized = GL_TRUE; break;
+            case VERTEX_COMPONENT_SNORM_10_10_10_2: type = GL_INT_2_10_10_10_REV; normalized = GL_TRUE; break;
+        }
+
+        glEnableVertexAttribArray(location);
+        CheckGLError("glEnableVertexAttribArray");
+        glVertexAttribPointer(location, attribute->components, type, normalized, (GLsizei)layout->stride,
+                              (void*)(uintptr_t)attribute->offset);
+        CheckGLError("glVertexAttribPointer");
     }
+}
 
+GLuint GLSetup_CreateVAO(const void* vertices, size_t vertexCount, const VertexLayout* layout) {
     GLuint vao = 0, vbo = 0;
 
     glGenVertexArrays(1, &vao);
@@ -29,43 +53,58 @@ GLuint GLSetup_CreateVAO(const float* data, int vertexCount, int componentsPerVe
     glBindBuffer(GL_ARRAY_BUFFER, vbo);
     CheckGLError("glBindBuffer");
 
-    glBufferData(GL_ARRAY_BUFFER, vertexCount * sizeof(float), data, GL_STATIC_DRAW);
+    glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)(vertexCount * layout->stride), vertices, GL_STATIC_DRAW);
     CheckGLError("glBufferData");
 
-    // Setup attribute pointers:
+    SetupVertexAttributes(layout);
+    
+    glBindVertexArray(0);
+    CheckGLError("glBindVertexArray (unbind)");
+
+    if (vao == 0) {
+        printf("Failed to create VAO.\n");
+    }
 
-    // position (location = 0)
-    glEnableVertexAttribArray(0);
-    CheckGLError("glEnableVertexAttribArray(0)");
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, componentsPerVertex * sizeof(float), (void*)(0));
-    CheckGLError("glVertexAttribPointer(0)");
+    return vao;
+}
 
-    // normal (location = 1)
-    glEnableVertexAttribArray(1);
-    CheckGLError("glEnableVertexAttribArray(1)");
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, componentsPerVertex * sizeof(float), (void*)(3 * sizeof(float)));
-    CheckGLError("glVertexAttribPointer(1)");
+GLuint GLSetup_CreateIndexedVAO(const void* vertices, size_t vertexCount, const VertexLayout* layout,
+                                const void* indices, size_t indexCount, GLenum indexType,
+                                GLuint* outVBO, GLuint* outEBO) {
+    size_t indexSize = (indexType == GL_UNSIGNED_SHORT) ? sizeof(unsigned short) : sizeof(unsigned int);
+    GLuint vao = 0, vbo = 0, ebo = 0;
+
+    glGenVertexArrays(1, &vao);
+    CheckGLError("glGenVertexArrays");
+    glBindVertexArray(vao);
+    CheckGLError("glBindVertexArray");
+
+    glGenBuffers(1, &vbo);
+    CheckGLError("glGenBuffers");
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    CheckGLError("glBindBuffer");
+    glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)(vertexCount * layout->stride), vertices, GL_STATIC_DRAW);
+    CheckGLError("glBufferData (vertices)");
+
+    // The element buffer binding is part of the VAO state
+    glGenBuffers(1, &ebo);
+    CheckGLError("glGenBuffers (elements)");
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+    CheckGLError("glBindBuffer (elements)");
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount * indexSize, indices, GL_STATIC_DRAW);
+    CheckGLError("glBufferData (elements)");
+
+    SetupVertexAttributes(layout);
 
-    
-    // texture (location = 2)
-    glEnableVertexAttribArray(2);
-    CheckGLError("glEnableVertexAttribArray(2)");
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, componentsPerVertex * sizeof(float), (void*)(6 * sizeof(float)));
-    CheckGLError("glVertexAttribPointer(2)");
-
-    // tangent (location = 3)
-    glEnableVertexAttribArray(3);
-    CheckGLError("glEnableVertexAttribArray(3)");
-    glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, componentsPerVertex * sizeof(float), (void*)(8 * sizeof(float)));
-    CheckGLError("glVertexAttribPointer(3)");
-    
     glBindVertexArray(0);
     CheckGLError("glBindVertexArray (unbind)");
 
     if (vao == 0) {
-        printf("Failed to create VAO.\n");
+        printf("Failed to create indexed VAO.\n");
     }
 
+    *outVBO = vbo;
+    *outEBO = ebo;
     return vao;
 }
 
@@ -109,3 +148,67 @@ GLuint GLSetup_CreateDynamicVAO(GLuint* outVBO) {
 
     return vao;
 }
+
+// Makes room for `needed` bytes, doubling the capacity. The copy targets keep the
+// current VAO's element binding untouched.
+static int GrowStreamBuffer(GLuint* buffer, size_t used, size_t* capacity, size_t needed) {
+    if (needed <= *capacity) return 0;
+
+    size_t newCapacity = *capacity ? *capacity * 2 : 1024 * 1024;
+    while (newCapacity < needed) newCapacity *= 2;
+
+    GLuint grown = 0;
+    glGenBuffers(1, &grown);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, grown);
+    glBufferData(GL_COPY_WRITE_BUFFER, (GLsizeiptr)newCapacity, NULL, GL_STATIC_DRAW);
+    CheckGLError("glBufferData (stream grow)");
+    if (*buffer) {
+        glBindBuffer(GL_COPY_READ_BUFFER, *buffer);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, (GLsizeiptr)used);
+        CheckGLError("glCopyBufferSubData (stream grow)");
+        glDeleteBuffers(1, buffer);
+    }
+    *buffer = grown;
+    *capacity = newCapacity;
+    return grown == 0;
+}
+
+int GLSetup_AppendStreamBuffers(GLStreamBuffers* buffers, const void* vertices, size_t vertexBytes,
+                                const void* indices, size_t indexBytes) {
+    if (GrowStreamBuffer(&buffers->vbo, buffers->vertexBytes, &buffers->vertexCapacity, buffers->vertexBytes + vertexBytes) ||
+        GrowStreamBuffer(&buffers->ebo, buffers->indexBytes, &buffers->indexCapacity, buffers->indexBytes + indexBytes)) {
+        printf("Failed to grow stream buffers.\n");
+        return 1;
+    }
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffers->vbo);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, (GLintptr)buffers->vertexBytes, (GLsizeiptr)vertexBytes, vertices);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffers->ebo);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, (GLintptr)buffers->indexBytes, (GLsizeiptr)indexBytes, indices);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    CheckGLError("glBufferSubData (stream)");
+
+    buffers->vertexBytes += vertexBytes;
+    buffers->indexBytes += indexBytes;
+    return 0;
+}
+
+GLuint GLSetup_FinishStreamedVAO(GLStreamBuffers* buffers, const VertexLayout* layout) {
+    GLuint vao = 0;
+    glGenVertexArrays(1, &vao);
+    CheckGLError("glGenVertexArrays");
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, buffers->vbo);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers->ebo);
+    CheckGLError("glBindBuffer (stream)");
+
+    SetupVertexAttributes(layout);
+
+    glBindVertexArray(0);
+    CheckGLError("glBindVertexArray (unbind)");
+
+    if (vao == 0) {
+        printf("Failed to create streamed VAO.\n");
+    }
+    return vao;
+}
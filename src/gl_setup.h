@@ -3,8 +3,31 @@
 #include <GL/gl.h>
 #include <stddef.h>
 #include "gl_loader.h"
+#include "vertex_format.h"
 
-GLuint GLSetup_CreateVAO(const float* data, int vertexCount, int componentsPerVertex);
+// vertices holds vertexCount vertices of layout->stride bytes each.
+GLuint GLSetup_CreateVAO(const void* vertices, size_t vertexCount, const VertexLayout* layout);
+// indexType is GL_UNSIGNED_SHORT or GL_UNSIGNED_INT. The buffers are returned so the owner
+// can delete them with the VAO.
+GLuint GLSetup_CreateIndexedVAO(const void* vertices, size_t vertexCount, const VertexLayout* layout,
+                                const void* indices, size_t indexCount, GLenum indexType,
+                                GLuint* outVBO, GLuint* outEBO);
 GLuint GLSetup_CreateDynamicVAO(GLuint* outVBO);
 
+// Vertex and element buffers that grow on the GPU while a mesh is appended chunk by chunk.
+typedef struct {
+    GLuint vbo;
+    GLuint ebo;
+    size_t vertexBytes;
+    size_t vertexCapacity;
+    size_t indexBytes;
+    size_t indexCapacity;
+} GLStreamBuffers;
+
+// Returns 0 on success. Growing copies the old contents on the GPU, not through the CPU.
+int GLSetup_AppendStreamBuffers(GLStreamBuffers* buffers, const void* vertices, size_t vertexBytes,
+                                const void* indices, size_t indexBytes);
+// Wraps the appended buffers in a VAO with the given vertex layout.
+GLuint GLSetup_FinishStreamedVAO(GLStreamBuffers* buffers, const VertexLayout* layout);
+
 #endif // GL_SETUP_H
\ No newline at end of file
@@ -0,0 +1,13 @@
+#ifndef HASH_UTILS_H
+#define HASH_UTILS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// 64-bit non-cryptographic hash (XXH64 algorithm) for cache keys and content checks.
+uint64_t Hash64(const void* data, size_t size, uint64_t seed);
+
+// Hashes a whole file. Returns 0 on success.
+int HashFile64(const char* filename, uint64_t seed, uint64_t* outHash);
+
+#endif
@@ -0,0 +1,432 @@
+#include "mesh_cache.h"
+#include "asset_cache.h"
+#include "block_codec.h"
+#include "mesh_codec.h"
+#include "thread_utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+static size_t alignUp(size_t value, size_t alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+static int sameParams(const MeshProcessParams* a, const MeshProcessParams* b) {
+    return a->flags == b->flags && a->smoothAngle == b->smoothAngle && a->weldEpsilon == b->weldEpsilon &&
+           a->vertexLayout == b->vertexLayout;
+}
+
+static int validateVersion(const MeshCache* cache, const char* cachePath) {
+    const MeshCacheHeader* h = cache->header;
+    if (h->magic != MESH_CACHE_MAGIC) {
+        printf("[MeshCache] %s is not a mesh cache\n", cachePath);
+        return 1;
+    }
+    if (h->version != MESH_CACHE_VERSION || h->processingVersion != MESH_PROCESSING_VERSION) {
+        printf("[MeshCache] %s has version %u/%u, expected %u/%u\n", cachePath,
+               h->version, h->processingVersion, MESH_CACHE_VERSION, MESH_PROCESSING_VERSION);
+        return 1;
+    }
+    return 0;
+}
+
+// Undoes MESH_CACHE_MESH_CODEC: payload holds the coded blocks, image receives the stored layout
+static int decodeBlocks(const MeshCacheHeader* h, const char* payload, size_t payloadSize, char* image) {
+    MeshCacheCodedSizes sizes;
+    size_t restBytes = (size_t)(h->rawSize - h->submeshOffset);
+    if (payloadSize < sizeof(sizes)) return 1;
+    memcpy(&sizes, payload, sizeof(sizes));
+    payload += sizeof(sizes);
+    payloadSize -= sizeof(sizes);
+    if (sizes.vertexBytes > payloadSize || sizes.indexBytes > payloadSize - sizes.vertexBytes ||
+        payloadSize - sizes.vertexBytes - sizes.indexBytes != restBytes) {
+        return 1;
+    }
+
+    size_t vertexBytes = (size_t)(h->vertexCount * h->vertexStride);
+    size_t indexBytes = (size_t)(h->indexCount * h->indexSize);
+    if (MeshCodec_DecodeVertices(payload, (size_t)sizes.vertexBytes, image + h->vertexOffset, (size_t)h->vertexCount,
+                                 h->vertexStride) ||
+        MeshCodec_DecodeIndices(payload + sizes.vertexBytes, (size_t)sizes.indexBytes, image + h->indexOffset,
+                                (size_t)h->indexCount, h->indexSize)) {
+        return 1;
+    }
+    memset(image + h->vertexOffset + vertexBytes, 0, (size_t)(h->indexOffset - h->vertexOffset) - vertexBytes);
+    memset(image + h->indexOffset + indexBytes, 0, (size_t)(h->submeshOffset - h->indexOffset) - indexBytes);
+    memcpy(image + h->submeshOffset, payload + sizes.vertexBytes + sizes.indexBytes, restBytes);
+    return 0;
+}
+
+// An encoded payload is decoded next to a copy of the header, so the rest of the code sees
+// the stored layout. The mapping is not needed after that. The header has been validated
+// against rawSize.
+static int expandPayload(MeshCache* cache, const char* cachePath) {
+    const MeshCacheHeader* h = cache->header;
+    uint32_t encoding = h->payloadEncoding;
+    if (encoding == ASSET_CACHE_STORED) {
+        return 0;
+    }
+    size_t headerBytes = (size_t)h->vertexOffset;
+    if ((encoding & ~(ASSET_CACHE_BLOCK_CODEC | MESH_CACHE_MESH_CODEC)) ||
+        headerBytes > cache->size || h->storedSize > cache->size - headerBytes) {
+        printf("[MeshCache] %s has a bad compressed payload\n", cachePath);
+        return 1;
+    }
+    char* image = malloc((size_t)h->rawSize);
+    if (!image) {
+        printf("[MeshCache] Out of memory decoding %s\n", cachePath);
+        return 1;
+    }
+    memcpy(image, cache->data, headerBytes);
+
+    const char* payload = cache->data + headerBytes;
+    size_t payloadSize = (size_t)h->storedSize;
+    char* unpacked = NULL;
+    int failed = 0;
+    if ((encoding & ASSET_CACHE_BLOCK_CODEC) && !(encoding & MESH_CACHE_MESH_CODEC)) {
+        failed = BlockCodec_DecompressStream(payload, payloadSize, image + headerBytes,
+                                             (size_t)h->rawSize - headerBytes, GetHardwareThreadCount()) != 0;
+    } else if (encoding & ASSET_CACHE_BLOCK_CODEC) {
+        // The mesh codec is only kept when it shrinks the payload
+        size_t unpackedSize = 0;
+        failed = BlockCodec_GetRawSize(payload, payloadSize, &unpackedSize) ||
+                 unpackedSize >= (size_t)h->rawSize - headerBytes || !(unpacked = malloc(unpackedSize + 1)) ||
+                 BlockCodec_DecompressStream(payload, payloadSize, unpacked, unpackedSize, GetHardwareThreadCount());
+        payload = unpacked;
+        payloadSize = unpackedSize;
+    }
+    if (!failed && (encoding & MESH_CACHE_MESH_CODEC)) {
+        failed = decodeBlocks(h, payload, payloadSize, image);
+    }
+    free(unpacked);
+    if (failed) {
+        printf("[MeshCache] %s has a corrupt compressed payload\n", cachePath);
+        free(image);
+        return 1;
+    }
+
+    cache->decoded = image;
+    cache->data = image;
+    cache->size = (size_t)h->rawSize;
+    cache->header = (const MeshCacheHeader*)image;
+    FileMap_Close(&cache->map);
+    return 0;
+}
+
+// sourceHash is NULL when the source is not checked
+static int validateHeader(const MeshCache* cache, const char* cachePath, const uint64_t* sourceHash,
+                          const MeshProcessParams* params) {
+    const MeshCacheHeader* h = cache->header;
+    // An encoded payload is checked against the size it decodes to
+    uint64_t fileSize = (h->payloadEncoding == ASSET_CACHE_STORED) ? cache->size : h->rawSize;
+
+    const VertexLayout* layout = VertexFormat_GetLayout(h->vertexLayout);
+    if (!layout || h->vertexStride != layout->stride) {
+        printf("[MeshCache] %s has an unsupported vertex layout %u\n", cachePath, h->vertexLayout);
+        return 1;
+    }
+    if (!sameParams(&h->params, params)) {
+        printf("[MeshCache] %s was built with different processing parameters\n", cachePath);
+        return 1;
+    }
+    if (sourceHash && h->sourceHash != *sourceHash) {
+        printf("[MeshCache] %s was built from a different source\n", cachePath);
+        return 1;
+    }
+    if (h->indexSize != 2 && h->indexSize != 4) {
+        printf("[MeshCache] %s has invalid index size %u\n", cachePath, h->indexSize);
+        return 1;
+    }
+    if (h->lodCount > MESH_CACHE_MAX_LODS) {
+        printf("[MeshCache] %s has %u LOD levels, at most %d are supported\n", cachePath, h->lodCount, MESH_CACHE_MAX_LODS);
+        return 1;
+    }
+
+    uint64_t vertexBytes = h->vertexCount * h->vertexStride;
+    uint64_t indexBytes = h->indexCount * h->indexSize;
+    uint64_t submeshBytes = (h->lodCount + 1) * h->submeshCount * sizeof(MeshCacheSubmesh);
+    uint64_t meshletBytes = h->meshletCount * sizeof(MeshCacheMeshlet);
+    if (h->vertexOffset % MESH_CACHE_ALIGNMENT || h->indexOffset % MESH_CACHE_ALIGNMENT ||
+        h->submeshOffset % MESH_CACHE_ALIGNMENT ||
+        h->vertexOffset < sizeof(MeshCacheHeader) || h->vertexOffset + vertexBytes > fileSize ||
+        h->indexOffset < h->vertexOffset + vertexBytes || h->indexOffset + indexBytes > fileSize ||
+        h->meshletOffset % MESH_CACHE_ALIGNMENT ||
+        h->submeshOffset < h->indexOffset + indexBytes || h->submeshOffset + submeshBytes > fileSize ||
+        h->meshletOffset < h->submeshOffset + submeshBytes || h->meshletOffset + meshletBytes > fileSize) {
+        printf("[MeshCache] %s is truncated or has bad block offsets\n", cachePath);
+        return 1;
+    }
+    if (memchr(h->materialLibrary, '\0', sizeof(h->materialLibrary)) == NULL) {
+        printf("[MeshCache] %s has a bad material library name\n", cachePath);
+        return 1;
+    }
+    return 0;
+}
+
+static int indicesInRange(const MeshCache* cache) {
+    const MeshCacheHeader* h = cache->header;
+    if (h->indexSize == 2) {
+        const uint16_t* indices = (const uint16_t*)cache->indices;
+        for (uint64_t i = 0; i < h->indexCount; ++i) {
+            if (indices[i] >= h->vertexCount) return 0;
+        }
+    } else {
+        const uint32_t* indices = (const uint32_t*)cache->indices;
+        for (uint64_t i = 0; i < h->indexCount; ++i) {
+            if (indices[i] >= h->vertexCount) return 0;
+        }
+    }
+    return 1;
+}
+
+static int submeshesInRange(const MeshCache* cache) {
+    const MeshCacheHeader* h = cache->header;
+    for (uint64_t i = 0; i < (h->lodCount + 1) * h->submeshCount; ++i) {
+        const MeshCacheSubmesh* submesh = &cache->submeshes[i];
+        if ((uint64_t)submesh->firstIndex + submesh->indexCount > h->indexCount ||
+            (uint64_t)submesh->firstMeshlet + submesh->meshletCount > h->meshletCount ||
+            memchr(submesh->material, '\0', sizeof(submesh->material)) == NULL) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static int meshletsInRange(const MeshCache* cache) {
+    const MeshCacheHeader* h = cache->header;
+    for (uint64_t i = 0; i < h->meshletCount; ++i) {
+        const MeshCacheMeshlet* meshlet = &cache->meshlets[i];
+        if ((uint64_t)meshlet->firstIndex + meshlet->indexCount > h->indexCount) return 0;
+    }
+    return 1;
+}
+
+static int openData(MeshCache* cache, const char* name, const uint64_t* sourceHash, const MeshProcessParams* params) {
+    if (cache->size < sizeof(MeshCacheHeader)) {
+        printf("[MeshCache] %s is too small\n", name);
+        return 1;
+    }
+    cache->header = (const MeshCacheHeader*)cache->data;
+    if (validateVersion(cache, name) || validateHeader(cache, name, sourceHash, params) ||
+        expandPayload(cache, name)) {
+        return 1;
+    }
+
+    cache->vertices = cache->data + cache->header->vertexOffset;
+    cache->indices = cache->data + cache->header->indexOffset;
+    cache->submeshes = (const MeshCacheSubmesh*)(cache->data + cache->header->submeshOffset);
+    cache->meshlets = (const MeshCacheMeshlet*)(cache->data + cache->header->meshletOffset);
+    if (!indicesInRange(cache) || !submeshesInRange(cache) || !meshletsInRange(cache)) {
+        printf("[MeshCache] %s has out-of-range indices\n", name);
+        return 1;
+    }
+    return 0;
+}
+
+int MeshCache_Open(const char* cachePath, uint64_t sourceHash, const MeshProcessParams* params, MeshCache* cache) {
+    memset(cache, 0, sizeof(*cache));
+    FileMap_Init(&cache->map);
+
+    struct stat st;
+    if (stat(cachePath, &st) != 0) {
+        printf("[MeshCache] No cache at %s\n", cachePath);
+        return 1;
+    }
+    if (FileMap_Open(cachePath, &cache->map)) {
+        return 1;
+    }
+    cache->data = cache->map.data;
+    cache->size = cache->map.size;
+    if (openData(cache, cachePath, &sourceHash, params)) {
+        MeshCache_Close(cache);
+        return 1;
+    }
+    return 0;
+}
+
+int MeshCache_OpenMemory(const void* data, size_t size, const char* name, const MeshProcessParams* params,
+                         MeshCache* cache) {
+    memset(cache, 0, sizeof(*cache));
+    FileMap_Init(&cache->map);
+    cache->data = (const char*)data;
+    cache->size = size;
+    if (openData(cache, name, NULL, params)) {
+        MeshCache_Close(cache);
+        return 1;
+    }
+    return 0;
+}
+
+void MeshCache_Close(MeshCache* cache) {
+    if (!cache) return;
+    FileMap_Close(&cache->map);
+    free(cache->decoded);
+    cache->decoded = NULL;
+    cache->data = NULL;
+    cache->size = 0;
+    cache->header = NULL;
+    cache->vertices = NULL;
+    cache->indices = NULL;
+    cache->submeshes = NULL;
+    cache->meshlets = NULL;
+}
+
+void MeshCache_GetData(const MeshCache* cache, MeshCacheData* data) {
+    const MeshCacheHeader* h = cache->header;
+    data->vertices = cache->vertices;
+    data->vertexCount = (size_t)h->vertexCount;
+    data->indices = cache->indices;
+    data->indexCount = (size_t)h->indexCount;
+    data->indexSize = h->indexSize;
+    data->submeshes = cache->submeshes;
+    data->submeshCount = (size_t)h->submeshCount;
+    data->meshlets = cache->meshlets;
+    data->meshletCount = (size_t)h->meshletCount;
+    data->lodCount = h->lodCount;
+    data->lodErrors = h->lodErrors;
+    data->boundsCenter = h->boundsCenter;
+    data->boundsRadius = h->boundsRadius;
+    data->materialLibrary = h->materialLibrary;
+    data->quantization = &h->quantization;
+}
+
+void MeshCache_GetPath(uint64_t sourceHash, const MeshProcessParams* params, char* out, size_t outSize) {
+    uint64_t key = AssetCache_MakeKey(sourceHash, MESH_PROCESSING_VERSION, params, sizeof(*params));
+    AssetCache_GetPath(key, MESH_CACHE_EXTENSION, out, outSize);
+}
+
+// Applies MESH_CACHE_MESH_CODEC to a laid-out payload: [sizes][vertices][indices][payload from
+// the submesh table on]. Returns a malloc'd buffer only when it comes out smaller.
+static char* encodeBlocks(const MeshCacheHeader* h, const char* payload, size_t payloadSize, size_t* codedSize) {
+    if (h->indexCount % 3 != 0 || (h->vertexStride & 1) || h->vertexStride > MESH_CODEC_MAX_STRIDE) {
+        return NULL;
+    }
+    size_t restOffset = (size_t)(h->submeshOffset - h->vertexOffset);
+    size_t restBytes = payloadSize - restOffset;
+    size_t vertexBound = MeshCodec_VertexBound((size_t)h->vertexCount, h->vertexStride);
+    size_t indexBound = MeshCodec_IndexBound((size_t)h->indexCount);
+    char* coded = malloc(sizeof(MeshCacheCodedSizes) + vertexBound + indexBound + restBytes);
+    if (!coded) return NULL;
+
+    MeshCacheCodedSizes sizes;
+    char* out = coded + sizeof(sizes);
+    sizes.vertexBytes = MeshCodec_EncodeVertices(payload, (size_t)h->vertexCount, h->vertexStride, out, vertexBound);
+    out += sizes.vertexBytes;
+    sizes.indexBytes = MeshCodec_EncodeIndices(payload + (h->indexOffset - h->vertexOffset), (size_t)h->indexCount,
+                                               h->indexSize, out, indexBound);
+    out += sizes.indexBytes;
+    memcpy(out, payload + restOffset, restBytes);
+    out += restBytes;
+    memcpy(coded, &sizes, sizeof(sizes));
+
+    *codedSize = (size_t)(out - coded);
+    if ((h->vertexCount > 0 && sizes.vertexBytes == 0) || (h->indexCount > 0 && sizes.indexBytes == 0) ||
+        *codedSize >= payloadSize) {
+        free(coded);
+        return NULL;
+    }
+    return coded;
+}
+
+int MeshCache_Write(const char* cachePath, uint64_t sourceHash, const MeshProcessParams* params,
+                    const MeshCacheData* data) {
+    MeshCacheHeader h;
+    memset(&h, 0, sizeof(h));
+    h.magic = MESH_CACHE_MAGIC;
+    h.version = MESH_CACHE_VERSION;
+    const VertexLayout* layout = VertexFormat_GetLayout(params->vertexLayout);
+    if (!layout) {
+        fprintf(stderr, "[MeshCache] Unknown vertex layout %u\n", params->vertexLayout);
+        return 1;
+    }
+    h.vertexLayout = layout->id;
+    h.vertexStride = layout->stride;
+    h.processingVersion = MESH_PROCESSING_VERSION;
+    h.indexSize = data->indexSize;
+    h.params = *params;
+    if (data->quantization) h.quantization = *data->quantization;
+    else VertexFormat_IdentityQuantization(&h.quantization);
+    if (data->materialLibrary) {
+        snprintf(h.materialLibrary, sizeof(h.materialLibrary), "%s", data->materialLibrary);
+    }
+
+    h.sourceHash = sourceHash;
+
+    size_t vertexBytes = data->vertexCount * h.vertexStride;
+    size_t indexBytes = data->indexCount * data->indexSize;
+    size_t submeshBytes = (data->lodCount + 1) * data->submeshCount * sizeof(MeshCacheSubmesh);
+    size_t meshletBytes = data->meshlets ? data->meshletCount * sizeof(MeshCacheMeshlet) : 0;
+    h.vertexCount = data->vertexCount;
+    h.indexCount = data->indexCount;
+    h.submeshCount = data->submeshCount;
+    h.meshletCount = meshletBytes / sizeof(MeshCacheMeshlet);
+    h.lodCount = (uint32_t)data->lodCount;
+    for (size_t i = 0; i < data->lodCount && i < MESH_CACHE_MAX_LODS; ++i) h.lodErrors[i] = data->lodErrors[i];
+    if (data->boundsCenter) memcpy(h.boundsCenter, data->boundsCenter, sizeof(h.boundsCenter));
+    h.boundsRadius = data->boundsRadius;
+    h.vertexOffset = alignUp(sizeof(MeshCacheHeader), MESH_CACHE_ALIGNMENT);
+    h.indexOffset = alignUp(h.vertexOffset + vertexBytes, MESH_CACHE_ALIGNMENT);
+    h.submeshOffset = alignUp(h.indexOffset + indexBytes, MESH_CACHE_ALIGNMENT);
+    h.meshletOffset = alignUp(h.submeshOffset + submeshBytes, MESH_CACHE_ALIGNMENT);
+
+    h.rawSize = h.meshletOffset + meshletBytes;
+
+    // The blocks are laid out in memory first, padding zeroed, so they can go through the codec
+    size_t payloadSize = (size_t)(h.rawSize - h.vertexOffset);
+    char* payload = calloc(payloadSize + 1, 1);
+    if (!payload) {
+        fprintf(stderr, "[MeshCache] Out of memory writing %s\n", cachePath);
+        return 1;
+    }
+    memcpy(payload, data->vertices, vertexBytes);
+    memcpy(payload + (h.indexOffset - h.vertexOffset), data->indices, indexBytes);
+    if (submeshBytes > 0) memcpy(payload + (h.submeshOffset - h.vertexOffset), data->submeshes, submeshBytes);
+    if (meshletBytes > 0) memcpy(payload + (h.meshletOffset - h.vertexOffset), data->meshlets, meshletBytes);
+
+    // The mesh codec goes first and the block codec runs over its output; each is kept only
+    // when it makes the payload smaller
+    void* stream = NULL;
+    size_t streamSize = 0;
+    char* coded = NULL;
+    size_t codedSize = 0;
+    const void* stored = payload;
+    h.payloadEncoding = ASSET_CACHE_STORED;
+    h.storedSize = payloadSize;
+    if (AssetCache_GetCompression()) {
+        coded = encodeBlocks(&h, payload, payloadSize, &codedSize);
+        if (coded) {
+            stored = coded;
+            h.payloadEncoding = MESH_CACHE_MESH_CODEC;
+            h.storedSize = codedSize;
+        }
+        if (BlockCodec_CompressStream(stored, (size_t)h.storedSize, GetHardwareThreadCount(), &stream, &streamSize) == 0 &&
+            streamSize < h.storedSize) {
+            stored = stream;
+            h.payloadEncoding |= ASSET_CACHE_BLOCK_CODEC;
+            h.storedSize = streamSize;
+        }
+    }
+
+    static const char zeros[MESH_CACHE_ALIGNMENT] = {0};
+    size_t padding = (size_t)h.vertexOffset - sizeof(h);
+    char tempPath[ASSET_CACHE_PATH_SIZE];
+    FILE* f = AssetCache_BeginWrite(cachePath, tempPath, sizeof(tempPath));
+    int failed = !f;
+    if (f) {
+        failed |= fwrite(&h, sizeof(h), 1, f) != 1;
+        failed |= fwrite(zeros, 1, padding, f) != padding;
+        failed |= fwrite(stored, 1, (size_t)h.storedSize, f) != (size_t)h.storedSize;
+    }
+    free(payload);
+    free(coded);
+    free(stream);
+    if (!f || AssetCache_EndWrite(f, tempPath, cachePath, failed)) {
+        return 1;
+    }
+
+    printf("[MeshCache] Wrote %s (%zu vertices, %zu indices, %zu submeshes, %zu LODs, %zu meshlets, %zu KB, %zu KB stored)\n",
+           cachePath, data->vertexCount, data->indexCount, data->submeshCount, data->lodCount,
+           (size_t)h.meshletCount, (size_t)h.rawSize / 1024, (size_t)(h.vertexOffset + h.storedSize) / 1024);
+    return 0;
+}
@@ -0,0 +1,154 @@
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "file_map.h"
+#include "vertex_format.h"
+
+// Cooked mesh file: header, then 64-byte aligned vertex, index, submesh and meshlet blocks. The
+// vertex and index blocks can be handed to glBufferData straight from the mapping. Files live in
+// the asset cache under a key of the source hash, MESH_PROCESSING_VERSION and MeshProcessParams.
+// With compression on, the vertex and index blocks go through MeshCodec and everything after
+// the header through BlockCodec, each kept only where it makes the file smaller; opening
+// decodes them into memory laid out as above.
+
+#define MESH_CACHE_MAGIC   0x4D443342u   // "B3DM"
+#define MESH_CACHE_VERSION 8
+#define MESH_CACHE_EXTENSION ".mesh"
+#define MESH_CACHE_NAME_SIZE 64
+#define MESH_CACHE_PATH_SIZE 260
+#define MESH_CACHE_ALIGNMENT 64
+#define MESH_CACHE_MAX_LODS 4
+
+// payloadEncoding bit: the payload starts with MeshCacheCodedSizes, then the MeshCodec vertex
+// and index streams, then the submesh and meshlet blocks as stored. With both bits set,
+// the BlockCodec stream holds this coded payload.
+#define MESH_CACHE_MESH_CODEC (1u << 1)
+
+typedef struct {
+    uint64_t vertexBytes;
+    uint64_t indexBytes;
+} MeshCacheCodedSizes;
+
+// Bump when the processing code changes its output for the same parameters.
+#define MESH_PROCESSING_VERSION 5
+
+enum {
+    MESH_PROCESS_SMOOTH_NORMALS = 1 << 0,
+    MESH_PROCESS_TANGENTS       = 1 << 1,
+    MESH_PROCESS_INDEXED        = 1 << 2,
+    MESH_PROCESS_OPTIMIZE_VERTEX_CACHE = 1 << 3,
+    MESH_PROCESS_OPTIMIZE_OVERDRAW     = 1 << 4,
+    MESH_PROCESS_OPTIMIZE_VERTEX_FETCH = 1 << 5,
+    MESH_PROCESS_LODS                  = 1 << 6,
+    MESH_PROCESS_MESHLETS              = 1 << 7
+};
+
+typedef struct {
+    uint32_t flags;          // MESH_PROCESS_*
+    float smoothAngle;       // degrees
+    float weldEpsilon;
+    uint32_t vertexLayout;   // VertexLayoutId the vertices are stored in
+} MeshProcessParams;
+
+// Per-material index range; matches ObjSubmesh.
+typedef struct {
+    char material[MESH_CACHE_NAME_SIZE];
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    uint32_t firstMeshlet;
+    uint32_t meshletCount;
+} MeshCacheSubmesh;
+
+// Culling cluster; matches ObjMeshlet.
+typedef struct {
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    float center[3];
+    float radius;
+    float coneAxis[3];
+    float coneCutoff;
+} MeshCacheMeshlet;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t vertexLayout;      // VertexLayoutId
+    uint32_t vertexStride;      // bytes
+    uint32_t processingVersion;
+    uint32_t indexSize;         // 2 or 4 bytes
+    MeshProcessParams params;
+
+    uint64_t sourceHash;        // Hash64 of the source file
+    uint32_t payloadEncoding;   // ASSET_CACHE_BLOCK_CODEC and MESH_CACHE_MESH_CODEC bits
+    uint32_t reserved;
+    uint64_t rawSize;           // file size with the payload stored; the offsets below are into it
+    uint64_t storedSize;        // payload bytes in the file after vertexOffset
+
+    uint64_t vertexCount;
+    uint64_t indexCount;
+    uint64_t vertexOffset;
+    uint64_t indexOffset;
+    uint64_t submeshCount;      // per level; the block holds (lodCount + 1) * submeshCount, level by level
+    uint64_t submeshOffset;
+    uint64_t meshletCount;      // over all levels
+    uint64_t meshletOffset;
+    uint32_t lodCount;          // simplified levels after the base mesh
+    float lodErrors[MESH_CACHE_MAX_LODS];
+    float boundsCenter[3];
+    float boundsRadius;
+
+    VertexQuantization quantization;              // ranges of packed positions and UVs
+    char materialLibrary[MESH_CACHE_PATH_SIZE];   // mtllib path, "" if none
+} MeshCacheHeader;
+
+typedef struct {
+    FileMap map;                // unused when opened from memory
+    const char* data;
+    size_t size;
+    void* decoded;              // heap copy of a compressed cache, NULL otherwise
+    const MeshCacheHeader* header;
+    const void* vertices;       // header->vertexLayout
+    const void* indices;
+    const MeshCacheSubmesh* submeshes;
+    const MeshCacheMeshlet* meshlets;
+} MeshCache;
+
+// Everything MeshCache_Write stores besides the source hash and parameters.
+typedef struct {
+    const void* vertices;               // in params->vertexLayout
+    size_t vertexCount;
+    const void* indices;
+    size_t indexCount;
+    uint32_t indexSize;                 // 2 or 4 bytes
+    const MeshCacheSubmesh* submeshes;  // (lodCount + 1) * submeshCount, level by level
+    size_t submeshCount;
+    const MeshCacheMeshlet* meshlets;   // may be NULL when meshletCount is 0
+    size_t meshletCount;
+    size_t lodCount;
+    const float* lodErrors;             // lodCount entries
+    const float* boundsCenter;          // may be NULL
+    float boundsRadius;
+    const char* materialLibrary;        // may be NULL
+    const VertexQuantization* quantization;   // NULL for the float layout
+} MeshCacheData;
+
+// Maps and validates a cache built from a source with the given hash. Returns 0 if it can be used as is.
+int MeshCache_Open(const char* cachePath, uint64_t sourceHash, const MeshProcessParams* params, MeshCache* cache);
+// Validates a cache already in memory, e.g. an asset pack entry, which must stay valid while
+// the cache is open. The source is not checked; a pack is built from the sources it ships with.
+int MeshCache_OpenMemory(const void* data, size_t size, const char* name, const MeshProcessParams* params,
+                         MeshCache* cache);
+void MeshCache_Close(MeshCache* cache);
+// Describes an open cache the way MeshCache_Write takes it; the pointers are into the cache data.
+void MeshCache_GetData(const MeshCache* cache, MeshCacheData* data);
+
+// Writes the cache through a temporary file, so readers never see a partial one. Returns 0 on success.
+int MeshCache_Write(const char* cachePath, uint64_t sourceHash, const MeshProcessParams* params,
+                    const MeshCacheData* data);
+
+// Asset cache path of the mesh cache for a source hash and parameters.
+void MeshCache_GetPath(uint64_t sourceHash, const MeshProcessParams* params, char* out, size_t outSize);
+
+#endif
@@ -0,0 +1,476 @@
+#include "mesh_codec.h"
+#include <string.h>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define MESH_CODEC_X86 1
+#include <emmintrin.h>
+#endif
+
+#if defined(__GNUC__)
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#define CODEC_INLINE static inline __attribute__((always_inline))
+#elif defined(_MSC_VER)
+#define TARGET_SSE2
+#define CODEC_INLINE static __forceinline
+#else
+#define TARGET_SSE2
+#define CODEC_INLINE static inline
+#endif
+
+#define GROUP_SIZE 16                 // vertices per group; one byte plane is 16 bytes
+#define MAX_CHANNELS (MESH_CODEC_MAX_STRIDE / 2)
+
+// Each byte plane of a group is stored with one of these modes, 2 bits per plane
+enum { PLANE_ZERO, PLANE_2BIT, PLANE_4BIT, PLANE_RAW };
+static const size_t planeBytes[4] = {0, 4, 8, 16};
+
+#define FIFO_SIZE 16
+#define NO_EDGE 15            // edge nibble of a triangle that shares no recent edge
+#define VERTEX_NEXT 0         // vertex nibble: the next vertex not seen yet,
+#define VERTEX_EXPLICIT 15    // an explicit index, or 1 + the position in the vertex FIFO
+#define VERTEX_FIFO_USED (VERTEX_EXPLICIT - 1)
+#define MAX_VARINT_BYTES 5
+
+static int useSimd = 1;
+
+void MeshCodec_SetSimd(int enabled) {
+    useSimd = enabled != 0;
+}
+
+static size_t modeBytes(size_t channels) {
+    return (2 * channels * 2 + 7) / 8;
+}
+
+static int planeMode(const uint8_t* modes, size_t plane) {
+    return (modes[plane / 4] >> (2 * (plane % 4))) & 3;
+}
+
+static uint16_t zigzag16(uint16_t delta) {
+    return (uint16_t)((delta << 1) ^ ((delta & 0x8000) ? 0xffff : 0));
+}
+
+static uint16_t unzigzag16(uint16_t value) {
+    return (uint16_t)((value >> 1) ^ (0u - (value & 1)));
+}
+
+size_t MeshCodec_VertexBound(size_t vertexCount, size_t stride) {
+    size_t channels = stride / 2;
+    size_t groups = (vertexCount + GROUP_SIZE - 1) / GROUP_SIZE;
+    return groups * (modeBytes(channels) + 2 * channels * GROUP_SIZE);
+}
+
+// 2-bit planes put value k + 4 * s in bits 2s of byte k and 4-bit planes value k + 8 in the
+// high nibble of byte k, so the decoder unpacks them with whole-register shifts
+static uint8_t* encodePlane(uint8_t* out, const uint8_t values[GROUP_SIZE], int* mode) {
+    uint8_t bits = 0;
+    for (int i = 0; i < GROUP_SIZE; ++i) bits |= values[i];
+
+    if (bits == 0) {
+        *mode = PLANE_ZERO;
+    } else if (bits < 4) {
+        *mode = PLANE_2BIT;
+        for (int k = 0; k < 4; ++k) {
+            out[k] = (uint8_t)(values[k] | values[k + 4] << 2 | values[k + 8] << 4 | values[k + 12] << 6);
+        }
+    } else if (bits < 16) {
+        *mode = PLANE_4BIT;
+        for (int k = 0; k < 8; ++k) out[k] = (uint8_t)(values[k] | values[k + 8] << 4);
+    } else {
+        *mode = PLANE_RAW;
+        memcpy(out, values, GROUP_SIZE);
+    }
+    return out + planeBytes[*mode];
+}
+
+size_t MeshCodec_EncodeVertices(const void* vertices, size_t vertexCount, size_t stride, void* dst, size_t dstCapacity) {
+    if (stride == 0 || stride % 2 || stride > MESH_CODEC_MAX_STRIDE ||
+        dstCapacity < MeshCodec_VertexBound(vertexCount, stride)) {
+        return 0;
+    }
+    size_t channels = stride / 2;
+    const uint8_t* in = (const uint8_t*)vertices;
+    uint8_t* out = (uint8_t*)dst;
+    uint16_t previous[MAX_CHANNELS] = {0};
+
+    for (size_t base = 0; base < vertexCount; base += GROUP_SIZE) {
+        size_t count = (vertexCount - base < GROUP_SIZE) ? vertexCount - base : GROUP_SIZE;
+        uint8_t* modes = out;
+        memset(modes, 0, modeBytes(channels));
+        out += modeBytes(channels);
+
+        for (size_t c = 0; c < channels; ++c) {
+            uint8_t low[GROUP_SIZE] = {0}, high[GROUP_SIZE] = {0};
+            for (size_t i = 0; i < count; ++i) {
+                uint16_t value;
+                memcpy(&value, in + (base + i) * stride + 2 * c, sizeof(value));
+                uint16_t code = zigzag16((uint16_t)(value - previous[c]));
+                previous[c] = value;
+                low[i] = (uint8_t)(code & 0xff);
+                high[i] = (uint8_t)(code >> 8);
+            }
+            int mode;
+            out = encodePlane(out, low, &mode);
+            modes[(2 * c) / 4] |= (uint8_t)(mode << (2 * ((2 * c) % 4)));
+            out = encodePlane(out, high, &mode);
+            modes[(2 * c + 1) / 4] |= (uint8_t)(mode << (2 * ((2 * c + 1) % 4)));
+        }
+    }
+    return (size_t)(out - (uint8_t*)dst);
+}
+
+static const uint8_t* decodePlane(const uint8_t* in, int mode, uint8_t values[GROUP_SIZE]) {
+    switch (mode) {
+    case PLANE_ZERO:
+        memset(values, 0, GROUP_SIZE);
+        break;
+    case PLANE_2BIT:
+        for (int k = 0; k < 4; ++k) {
+            for (int s = 0; s < 4; ++s) values[k + 4 * s] = (uint8_t)((in[k] >> (2 * s)) & 3);
+        }
+        break;
+    case PLANE_4BIT:
+        for (int k = 0; k < 8; ++k) {
+            values[k] = in[k] & 15;
+            values[k + 8] = in[k] >> 4;
+        }
+        break;
+    default:
+        memcpy(values, in, GROUP_SIZE);
+        break;
+    }
+    return in + planeBytes[mode];
+}
+
+// Decodes the planes of one group into columns[channel][vertex]
+static void decodeGroupScalar(const uint8_t* modes, const uint8_t* data, size_t channels, uint16_t* previous,
+                              uint16_t (*columns)[GROUP_SIZE]) {
+    for (size_t c = 0; c < channels; ++c) {
+        uint8_t low[GROUP_SIZE], high[GROUP_SIZE];
+        data = decodePlane(data, planeMode(modes, 2 * c), low);
+        data = decodePlane(data, planeMode(modes, 2 * c + 1), high);
+        uint16_t value = previous[c];
+        for (int i = 0; i < GROUP_SIZE; ++i) {
+            value = (uint16_t)(value + unzigzag16((uint16_t)(low[i] | high[i] << 8)));
+            columns[c][i] = value;
+        }
+        previous[c] = value;
+    }
+}
+
+#ifdef MESH_CODEC_X86
+TARGET_SSE2 CODEC_INLINE __m128i decodePlaneSse2(const uint8_t** data, int mode) {
+    const uint8_t* in = *data;
+    *data = in + planeBytes[mode];
+    switch (mode) {
+    case PLANE_ZERO:
+        return _mm_setzero_si128();
+    case PLANE_2BIT: {
+        uint32_t bits;
+        memcpy(&bits, in, sizeof(bits));
+        __m128i x = _mm_cvtsi32_si128((int)bits);
+        __m128i mask = _mm_set1_epi8(3);
+        __m128i v0 = _mm_and_si128(x, mask);
+        __m128i v1 = _mm_and_si128(_mm_srli_epi32(x, 2), mask);
+        __m128i v2 = _mm_and_si128(_mm_srli_epi32(x, 4), mask);
+        __m128i v3 = _mm_and_si128(_mm_srli_epi32(x, 6), mask);
+        return _mm_unpacklo_epi64(_mm_unpacklo_epi32(v0, v1), _mm_unpacklo_epi32(v2, v3));
+    }
+    case PLANE_4BIT: {
+        __m128i x = _mm_loadl_epi64((const __m128i*)in);
+        __m128i mask = _mm_set1_epi8(15);
+        return _mm_unpacklo_epi64(_mm_and_si128(x, mask), _mm_and_si128(_mm_srli_epi16(x, 4), mask));
+    }
+    default:
+        return _mm_loadu_si128((const __m128i*)in);
+    }
+}
+
+TARGET_SSE2 CODEC_INLINE __m128i unzigzagSse2(__m128i value) {
+    __m128i sign = _mm_sub_epi16(_mm_setzero_si128(), _mm_and_si128(value, _mm_set1_epi16(1)));
+    return _mm_xor_si128(_mm_srli_epi16(value, 1), sign);
+}
+
+// Running sum over the 8 lanes
+TARGET_SSE2 CODEC_INLINE __m128i prefixSumSse2(__m128i x) {
+    x = _mm_add_epi16(x, _mm_slli_si128(x, 2));
+    x = _mm_add_epi16(x, _mm_slli_si128(x, 4));
+    return _mm_add_epi16(x, _mm_slli_si128(x, 8));
+}
+
+TARGET_SSE2 CODEC_INLINE __m128i broadcastLastSse2(__m128i x) {
+    __m128i high = _mm_shufflehi_epi16(x, _MM_SHUFFLE(3, 3, 3, 3));
+    return _mm_unpackhi_epi64(high, high);
+}
+
+TARGET_SSE2 static void decodeGroupSse2(const uint8_t* modes, const uint8_t* data, size_t channels, uint16_t* previous,
+                                        uint16_t (*columns)[GROUP_SIZE]) {
+    for (size_t c = 0; c < channels; ++c) {
+        __m128i low = decodePlaneSse2(&data, planeMode(modes, 2 * c));
+        __m128i high = decodePlaneSse2(&data, planeMode(modes, 2 * c + 1));
+        __m128i first = prefixSumSse2(unzigzagSse2(_mm_unpacklo_epi8(low, high)));
+        __m128i second = prefixSumSse2(unzigzagSse2(_mm_unpackhi_epi8(low, high)));
+        first = _mm_add_epi16(first, _mm_set1_epi16((short)previous[c]));
+        second = _mm_add_epi16(second, broadcastLastSse2(first));
+        _mm_storeu_si128((__m128i*)columns[c], first);
+        _mm_storeu_si128((__m128i*)(columns[c] + 8), second);
+        previous[c] = (uint16_t)_mm_extract_epi16(second, 7);
+    }
+}
+
+// Writes a full group: 8 channels at a time go from columns to vertices with an 8x8 transpose
+TARGET_SSE2 static void storeGroupSse2(uint8_t* out, size_t stride, size_t channels,
+                                       const uint16_t (*columns)[GROUP_SIZE]) {
+    size_t c = 0;
+    for (; c + 8 <= channels; c += 8) {
+        for (int half = 0; half < GROUP_SIZE; half += 8) {
+            __m128i r[8];
+            for (int k = 0; k < 8; ++k) r[k] = _mm_loadu_si128((const __m128i*)(columns[c + k] + half));
+            __m128i a0 = _mm_unpacklo_epi16(r[0], r[1]), a1 = _mm_unpackhi_epi16(r[0], r[1]);
+            __m128i a2 = _mm_unpacklo_epi16(r[2], r[3]), a3 = _mm_unpackhi_epi16(r[2], r[3]);
+            __m128i a4 = _mm_unpacklo_epi16(r[4], r[5]), a5 = _mm_unpackhi_epi16(r[4], r[5]);
+            __m128i a6 = _mm_unpacklo_epi16(r[6], r[7]), a7 = _mm_unpackhi_epi16(r[6], r[7]);
+            __m128i b0 = _mm_unpacklo_epi32(a0, a2), b1 = _mm_unpackhi_epi32(a0, a2);
+            __m128i b2 = _mm_unpacklo_epi32(a1, a3), b3 = _mm_unpackhi_epi32(a1, a3);
+            __m128i b4 = _mm_unpacklo_epi32(a4, a6), b5 = _mm_unpackhi_epi32(a4, a6);
+            __m128i b6 = _mm_unpacklo_epi32(a5, a7), b7 = _mm_unpackhi_epi32(a5, a7);
+            __m128i rows[8] = {
+                _mm_unpacklo_epi64(b0, b4), _mm_unpackhi_epi64(b0, b4), _mm_unpacklo_epi64(b1, b5), _mm_unpackhi_epi64(b1, b5),
+                _mm_unpacklo_epi64(b2, b6), _mm_unpackhi_epi64(b2, b6), _mm_unpacklo_epi64(b3, b7), _mm_unpackhi_epi64(b3, b7)
+            };
+            for (int k = 0; k < 8; ++k) _mm_storeu_si128((__m128i*)(out + (half + k) * stride + 2 * c), rows[k]);
+        }
+    }
+    for (int i = 0; i < GROUP_SIZE; ++i) {
+        for (size_t k = c; k < channels; ++k) memcpy(out + i * stride + 2 * k, &columns[k][i], sizeof(uint16_t));
+    }
+}
+#endif
+
+int MeshCodec_DecodeVertices(const void* src, size_t srcSize, void* vertices, size_t vertexCount, size_t stride) {
+    if (stride == 0 || stride % 2 || stride > MESH_CODEC_MAX_STRIDE) return 1;
+    size_t channels = stride / 2;
+    size_t headerBytes = modeBytes(channels);
+    const uint8_t* in = (const uint8_t*)src;
+    const uint8_t* end = in + srcSize;
+    uint8_t* out = (uint8_t*)vertices;
+    uint16_t previous[MAX_CHANNELS] = {0};
+    uint16_t columns[MAX_CHANNELS][GROUP_SIZE];
+#ifdef MESH_CODEC_X86
+    int simd = useSimd;
+#endif
+
+    for (size_t base = 0; base < vertexCount; base += GROUP_SIZE) {
+        if ((size_t)(end - in) < headerBytes) return 1;
+        size_t groupBytes = headerBytes;
+        for (size_t plane = 0; plane < 2 * channels; ++plane) groupBytes += planeBytes[planeMode(in, plane)];
+        if ((size_t)(end - in) < groupBytes) return 1;
+
+#ifdef MESH_CODEC_X86
+        if (simd) decodeGroupSse2(in, in + headerBytes, channels, previous, columns);
+        else decodeGroupScalar(in, in + headerBytes, channels, previous, columns);
+#else
+        decodeGroupScalar(in, in + headerBytes, channels, previous, columns);
+#endif
+        in += groupBytes;
+
+        size_t count = (vertexCount - base < GROUP_SIZE) ? vertexCount - base : GROUP_SIZE;
+#ifdef MESH_CODEC_X86
+        if (simd && count == GROUP_SIZE) {
+            storeGroupSse2(out + base * stride, stride, channels, (const uint16_t (*)[GROUP_SIZE])columns);
+            continue;
+        }
+#endif
+        for (size_t i = 0; i < count; ++i) {
+            uint8_t* vertex = out + (base + i) * stride;
+            for (size_t c = 0; c < channels; ++c) memcpy(vertex + 2 * c, &columns[c][i], sizeof(uint16_t));
+        }
+    }
+    return in == end ? 0 : 1;
+}
+
+typedef struct {
+    uint32_t edges[FIFO_SIZE][2];
+    uint32_t vertices[FIFO_SIZE];
+    uint32_t edgeCount;       // pushed so far; the newest is at (count - 1) % FIFO_SIZE
+    uint32_t vertexCount;
+    uint32_t next;            // the vertex a new vertex is expected to be, in fetch order
+    uint32_t last;            // the last explicit index
+} IndexCoder;
+
+static void initCoder(IndexCoder* coder) {
+    memset(coder, 0xff, sizeof(*coder));
+    coder->edgeCount = 0;
+    coder->vertexCount = 0;
+    coder->next = 0;
+    coder->last = 0;
+}
+
+static void pushEdge(IndexCoder* coder, uint32_t a, uint32_t b) {
+    uint32_t slot = coder->edgeCount++ % FIFO_SIZE;
+    coder->edges[slot][0] = a;
+    coder->edges[slot][1] = b;
+}
+
+static void pushVertex(IndexCoder* coder, uint32_t v) {
+    coder->vertices[coder->vertexCount++ % FIFO_SIZE] = v;
+}
+
+static int findEdge(const IndexCoder* coder, uint32_t a, uint32_t b) {
+    for (uint32_t i = 0; i < NO_EDGE; ++i) {
+        uint32_t slot = (coder->edgeCount - 1 - i) % FIFO_SIZE;
+        if (coder->edges[slot][0] == a && coder->edges[slot][1] == b) return (int)i;
+    }
+    return -1;
+}
+
+static int findVertex(const IndexCoder* coder, uint32_t v) {
+    for (uint32_t i = 0; i < VERTEX_FIFO_USED; ++i) {
+        if (coder->vertices[(coder->vertexCount - 1 - i) % FIFO_SIZE] == v) return (int)i;
+    }
+    return -1;
+}
+
+static uint32_t readIndex(const uint8_t* indices, uint32_t indexSize, size_t i) {
+    if (indexSize == 2) {
+        uint16_t value;
+        memcpy(&value, indices + i * 2, sizeof(value));
+        return value;
+    }
+    uint32_t value;
+    memcpy(&value, indices + i * 4, sizeof(value));
+    return value;
+}
+
+static void writeIndex(uint8_t* indices, uint32_t indexSize, size_t i, uint32_t value) {
+    if (indexSize == 2) {
+        uint16_t narrow = (uint16_t)value;
+        memcpy(indices + i * 2, &narrow, sizeof(narrow));
+    } else {
+        memcpy(indices + i * 4, &value, sizeof(value));
+    }
+}
+
+// Returns the nibble for v and appends the explicit index to out when there is one
+static int encodeVertex(IndexCoder* coder, uint32_t v, uint8_t** out) {
+    if (v == coder->next) {
+        coder->next++;
+        pushVertex(coder, v);
+        return VERTEX_NEXT;
+    }
+    int position = findVertex(coder, v);
+    if (position >= 0) {
+        return position + 1;
+    }
+    uint32_t delta = v - coder->last;
+    uint32_t code = (delta << 1) ^ (0u - (delta >> 31));
+    while (code >= 0x80) {
+        *(*out)++ = (uint8_t)(code | 0x80);
+        code >>= 7;
+    }
+    *(*out)++ = (uint8_t)code;
+    coder->last = v;
+    pushVertex(coder, v);
+    return VERTEX_EXPLICIT;
+}
+
+static int decodeVertex(IndexCoder* coder, int nibble, const uint8_t** in, const uint8_t* end, uint32_t* v) {
+    if (nibble == VERTEX_NEXT) {
+        *v = coder->next++;
+        pushVertex(coder, *v);
+        return 0;
+    }
+    if (nibble != VERTEX_EXPLICIT) {
+        *v = coder->vertices[(coder->vertexCount - (uint32_t)nibble) % FIFO_SIZE];
+        return 0;
+    }
+    uint32_t code = 0;
+    for (int shift = 0;; shift += 7) {
+        if (*in >= end || shift >= 7 * MAX_VARINT_BYTES) return 1;
+        uint8_t byte = *(*in)++;
+        code |= (uint32_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) break;
+    }
+    *v = coder->last + ((code >> 1) ^ (0u - (code & 1)));
+    coder->last = *v;
+    pushVertex(coder, *v);
+    return 0;
+}
+
+size_t MeshCodec_IndexBound(size_t indexCount) {
+    return indexCount / 3 * (2 + 3 * MAX_VARINT_BYTES) + 1;
+}
+
+size_t MeshCodec_EncodeIndices(const void* indices, size_t indexCount, uint32_t indexSize, void* dst, size_t dstCapacity) {
+    if (indexCount % 3 || (indexSize != 2 && indexSize != 4) || dstCapacity < MeshCodec_IndexBound(indexCount)) {
+        return 0;
+    }
+    const uint8_t* in = (const uint8_t*)indices;
+    uint8_t* out = (uint8_t*)dst;
+    IndexCoder coder;
+    initCoder(&coder);
+
+    for (size_t i = 0; i < indexCount; i += 3) {
+        uint32_t t[3] = {readIndex(in, indexSize, i), readIndex(in, indexSize, i + 1), readIndex(in, indexSize, i + 2)};
+
+        // A neighbour of a recent triangle has one of its edges reversed; rotate it to come first
+        int edge = -1, rotation = 0;
+        for (; rotation < 3 && edge < 0; ++rotation) edge = findEdge(&coder, t[rotation], t[(rotation + 1) % 3]);
+        if (edge >= 0) {
+            rotation--;
+            uint32_t a = t[rotation], b = t[(rotation + 1) % 3], c = t[(rotation + 2) % 3];
+            uint8_t* code = out++;
+            *code = (uint8_t)(edge << 4 | encodeVertex(&coder, c, &out));
+            pushEdge(&coder, c, b);
+            pushEdge(&coder, a, c);
+        } else {
+            uint8_t* code = out;
+            out += 2;
+            int na = encodeVertex(&coder, t[0], &out);
+            int nb = encodeVertex(&coder, t[1], &out);
+            int nc = encodeVertex(&coder, t[2], &out);
+            code[0] = (uint8_t)(NO_EDGE << 4 | na);
+            code[1] = (uint8_t)(nb << 4 | nc);
+            pushEdge(&coder, t[1], t[0]);
+            pushEdge(&coder, t[2], t[1]);
+            pushEdge(&coder, t[0], t[2]);
+        }
+    }
+    return (size_t)(out - (uint8_t*)dst);
+}
+
+int MeshCodec_DecodeIndices(const void* src, size_t srcSize, void* indices, size_t indexCount, uint32_t indexSize) {
+    if (indexCount % 3 || (indexSize != 2 && indexSize != 4)) return 1;
+    const uint8_t* in = (const uint8_t*)src;
+    const uint8_t* end = in + srcSize;
+    uint8_t* out = (uint8_t*)indices;
+    IndexCoder coder;
+    initCoder(&coder);
+
+    for (size_t i = 0; i < indexCount; i += 3) {
+        if (in >= end) return 1;
+        uint8_t code = *in++;
+        uint32_t a, b, c;
+        if ((code >> 4) != NO_EDGE) {
+            uint32_t slot = (coder.edgeCount - 1 - (code >> 4)) % FIFO_SIZE;
+            a = coder.edges[slot][0];
+            b = coder.edges[slot][1];
+            if (decodeVertex(&coder, code & 15, &in, end, &c)) return 1;
+            pushEdge(&coder, c, b);
+            pushEdge(&coder, a, c);
+        } else {
+            if (in >= end) return 1;
+            uint8_t more = *in++;
+            if (decodeVertex(&coder, code & 15, &in, end, &a) || decodeVertex(&coder, more >> 4, &in, end, &b) ||
+                decodeVertex(&coder, more & 15, &in, end, &c)) {
+                return 1;
+            }
+            pushEdge(&coder, b, a);
+            pushEdge(&coder, c, b);
+            pushEdge(&coder, a, c);
+        }
+        writeIndex(out, indexSize, i, a);
+        writeIndex(out, indexSize, i + 1, b);
+        writeIndex(out, indexSize, i + 2, c);
+    }
+    return in == end ? 0 : 1;
+}
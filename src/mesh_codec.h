@@ -0,0 +1,43 @@
+#ifndef MESH_CODEC_H
+#define MESH_CODEC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Lossless codec for the vertex and index blocks of a mesh cache. It does better than a
+// general-purpose compressor because it knows the data layout.
+//
+// Vertices are read as 16-bit channels (the quantized attributes of the packed layouts). Each
+// channel is delta coded against the previous vertex and zigzag mapped, so that vertices in
+// fetch order give small values. Then the low and high bytes of 16 vertices are each stored
+// as 0, 2, 4 or 8 bits per value.
+//
+// Triangles are coded against a FIFO of recent edges and a FIFO of recent vertices. A
+// triangle that shares an edge with a recent one costs one byte when its third vertex is
+// the next new one or a recently used one. Triangles may come back rotated, with the same
+// winding.
+//
+// Decoding checks every read and write against the buffer sizes, and on x86 the vertex
+// decoder uses SSE2.
+
+// Worst-case encoded sizes.
+size_t MeshCodec_VertexBound(size_t vertexCount, size_t stride);
+size_t MeshCodec_IndexBound(size_t indexCount);
+
+// stride must be even and at most MESH_CODEC_MAX_STRIDE. Returns the encoded size, or 0 if it
+// does not fit.
+#define MESH_CODEC_MAX_STRIDE 256
+size_t MeshCodec_EncodeVertices(const void* vertices, size_t vertexCount, size_t stride, void* dst, size_t dstCapacity);
+// Returns 0 on success.
+int MeshCodec_DecodeVertices(const void* src, size_t srcSize, void* vertices, size_t vertexCount, size_t stride);
+
+// indexCount must be a multiple of 3; indexSize is 2 or 4 bytes. Returns the encoded size, or
+// 0 if it does not fit.
+size_t MeshCodec_EncodeIndices(const void* indices, size_t indexCount, uint32_t indexSize, void* dst, size_t dstCapacity);
+// Returns 0 on success.
+int MeshCodec_DecodeIndices(const void* src, size_t srcSize, void* indices, size_t indexCount, uint32_t indexSize);
+
+// Set to 0 to use the scalar vertex decoder on every CPU, e.g. to compare the two.
+void MeshCodec_SetSimd(int enabled);
+
+#endif
@@ -0,0 +1,168 @@
+#include "mesh_cooker.h"
+#include "OBJ_file_loader.h"
+#include "mesh_optimizer.h"
+#include "mesh_simplifier.h"
+#include "meshlet_builder.h"
+#include "time_utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+void MeshCooker_GetParams(int smooth, VertexLayoutId vertexLayout, MeshProcessParams* params) {
+    memset(params, 0, sizeof(*params));
+    params->vertexLayout = vertexLayout;
+    params->flags = MESH_PROCESS_INDEXED | MESH_PROCESS_OPTIMIZE_VERTEX_CACHE |
+                    MESH_PROCESS_OPTIMIZE_OVERDRAW | MESH_PROCESS_OPTIMIZE_VERTEX_FETCH | MESH_PROCESS_LODS |
+                    MESH_PROCESS_MESHLETS;
+    if (smooth) {
+        params->flags |= MESH_PROCESS_SMOOTH_NORMALS | MESH_PROCESS_TANGENTS;
+        params->smoothAngle = SMOOTH_NORMALS_ANGLE_DEGREES;
+        params->weldEpsilon = SMOOTH_NORMALS_EPSILON;
+    }
+}
+
+// Level by level, the per-material ranges of the base mesh and its LODs
+static int copySubmeshes(const ObjMesh* mesh, int withMeshlets, CookedMesh* cooked) {
+    size_t levels = mesh->lod_count + 1;
+    cooked->submeshes = calloc(levels * mesh->submesh_count + 1, sizeof(MeshCacheSubmesh));
+    if (!cooked->submeshes) return 2;
+
+    for (size_t level = 0; level < levels; ++level) {
+        const ObjSubmesh* source = (level == 0) ? mesh->submeshes : mesh->lods[level - 1].submeshes;
+        for (size_t i = 0; i < mesh->submesh_count; ++i) {
+            MeshCacheSubmesh* submesh = &cooked->submeshes[level * mesh->submesh_count + i];
+            snprintf(submesh->material, sizeof(submesh->material), "%s", source[i].material);
+            submesh->firstIndex = source[i].firstIndex;
+            submesh->indexCount = source[i].indexCount;
+            if (withMeshlets) {
+                submesh->firstMeshlet = source[i].firstMeshlet;
+                submesh->meshletCount = source[i].meshletCount;
+            }
+        }
+        if (level > 0) cooked->lodErrors[level - 1] = mesh->lods[level - 1].error;
+    }
+    cooked->data.submeshes = cooked->submeshes;
+    cooked->data.submeshCount = mesh->submesh_count;
+    cooked->data.lodCount = mesh->lod_count;
+    cooked->data.lodErrors = cooked->lodErrors;
+    return 0;
+}
+
+static int copyMeshlets(const ObjMesh* mesh, CookedMesh* cooked) {
+    cooked->meshlets = malloc(mesh->meshlet_count * sizeof(MeshCacheMeshlet) + 1);
+    if (!cooked->meshlets) return 2;
+    for (size_t i = 0; i < mesh->meshlet_count; ++i) {
+        const ObjMeshlet* source = &mesh->meshlets[i];
+        MeshCacheMeshlet* meshlet = &cooked->meshlets[i];
+        meshlet->firstIndex = source->firstIndex;
+        meshlet->indexCount = source->indexCount;
+        memcpy(meshlet->center, source->center, sizeof(meshlet->center));
+        meshlet->radius = source->radius;
+        memcpy(meshlet->coneAxis, source->coneAxis, sizeof(meshlet->coneAxis));
+        meshlet->coneCutoff = source->coneCutoff;
+    }
+    cooked->data.meshlets = cooked->meshlets;
+    cooked->data.meshletCount = mesh->meshlet_count;
+    return 0;
+}
+
+// Vertices in params->vertexLayout and 16-bit indices when every vertex fits
+static int packBuffers(const ObjMesh* mesh, const char* meshFile, const MeshProcessParams* params, CookedMesh* cooked) {
+    const VertexLayout* layout = VertexFormat_GetLayout(params->vertexLayout);
+    if (!layout) {
+        fprintf(stderr, "[MeshCooker] Unknown vertex layout %u\n", params->vertexLayout);
+        return 1;
+    }
+    VertexPackError error;
+    cooked->vertices = VertexFormat_Pack(mesh->unique_vertices, mesh->unique_vertex_count, layout->id,
+                                         &cooked->quantization, &error);
+    if (!cooked->vertices) return 2;
+    if (layout->id != VERTEX_LAYOUT_FLOAT32) {
+        printf("[VertexFormat] %s: %s, %u bytes per vertex instead of %u (%zu KB saved)\n", meshFile, layout->name,
+               layout->stride, (unsigned)(FLOATS_PER_VERTEX * sizeof(float)),
+               mesh->unique_vertex_count * (FLOATS_PER_VERTEX * sizeof(float) - layout->stride) / 1024);
+        printf("[VertexFormat] %s: max error position %.5f, uv %.5f, normal %.3f deg (mean %.3f), "
+               "tangent %.3f deg (mean %.3f)\n", meshFile, error.maxPosition, error.maxTexcoord,
+               error.maxNormalDegrees, error.meanNormalDegrees, error.maxTangentDegrees, error.meanTangentDegrees);
+    }
+
+    uint32_t indexSize = (mesh->unique_vertex_count <= 65536) ? sizeof(uint16_t) : sizeof(uint32_t);
+    cooked->indices = malloc(mesh->element_count * indexSize + 1);
+    if (!cooked->indices) return 2;
+    if (indexSize == sizeof(uint16_t)) {
+        uint16_t* shortIndices = (uint16_t*)cooked->indices;
+        for (size_t i = 0; i < mesh->element_count; ++i) {
+            shortIndices[i] = (uint16_t)mesh->elements[i];
+        }
+    } else {
+        memcpy(cooked->indices, mesh->elements, mesh->element_count * sizeof(uint32_t));
+    }
+
+    cooked->data.vertices = cooked->vertices;
+    cooked->data.vertexCount = mesh->unique_vertex_count;
+    cooked->data.indices = cooked->indices;
+    cooked->data.indexCount = mesh->element_count;
+    cooked->data.indexSize = indexSize;
+    cooked->data.quantization = &cooked->quantization;
+    return 0;
+}
+
+int MeshCooker_Cook(const char* meshFile, const MeshProcessParams* params, int threadCount, CookedMesh* cooked) {
+    memset(cooked, 0, sizeof(*cooked));
+    VertexFormat_IdentityQuantization(&cooked->quantization);
+
+    ObjMesh mesh;
+    double startTime = GetTimeSeconds();
+    if (LoadOBJThreaded(meshFile, &mesh, threadCount)) {
+        return 1;
+    }
+    printf("[MeshCooker] %s: %zu triangles parsed in %.1f ms (%d threads)\n", meshFile,
+           mesh.triangle_vertex_count / (3 * FLOATS_PER_VERTEX), (GetTimeSeconds() - startTime) * 1000.0,
+           threadCount);
+
+    if (params->flags & MESH_PROCESS_SMOOTH_NORMALS) {
+        ComputeSmoothNormalsThreaded(&mesh, threadCount);
+    }
+    if (params->flags & MESH_PROCESS_TANGENTS) {
+        ComputeTangentsThreaded(&mesh, threadCount);
+    }
+
+    int result = BuildIndexedMesh(&mesh);
+    if (result == 0) {
+        unsigned optimizeFlags = 0;
+        if (params->flags & MESH_PROCESS_OPTIMIZE_VERTEX_CACHE) optimizeFlags |= MESH_OPTIMIZE_VERTEX_CACHE;
+        if (params->flags & MESH_PROCESS_OPTIMIZE_OVERDRAW) optimizeFlags |= MESH_OPTIMIZE_OVERDRAW;
+        if (params->flags & MESH_PROCESS_OPTIMIZE_VERTEX_FETCH) optimizeFlags |= MESH_OPTIMIZE_VERTEX_FETCH;
+        MeshOptimizer_OptimizeMesh(&mesh, optimizeFlags, meshFile);
+        if (params->flags & MESH_PROCESS_LODS) {
+            MeshSimplifier_BuildLods(&mesh, MESH_LOD_LEVELS, meshFile);
+        }
+        // Without clusters every range is drawn whole
+        int withMeshlets = (params->flags & MESH_PROCESS_MESHLETS) && MeshletBuilder_BuildMeshlets(&mesh, meshFile) == 0;
+        if (withMeshlets) result = copyMeshlets(&mesh, cooked);
+        if (result == 0) result = copySubmeshes(&mesh, withMeshlets, cooked);
+        if (result == 0) result = packBuffers(&mesh, meshFile, params, cooked);
+    }
+
+    if (result == 0) {
+        snprintf(cooked->materialLibrary, sizeof(cooked->materialLibrary), "%s", mesh.material_library);
+        memcpy(cooked->boundsCenter, mesh.bounds_center, sizeof(cooked->boundsCenter));
+        cooked->data.materialLibrary = cooked->materialLibrary;
+        cooked->data.boundsCenter = cooked->boundsCenter;
+        cooked->data.boundsRadius = mesh.bounds_radius;
+    } else {
+        fprintf(stderr, "[MeshCooker] Failed to process %s\n", meshFile);
+        MeshCooker_Free(cooked);
+    }
+    freeMesh(&mesh);
+    return result;
+}
+
+void MeshCooker_Free(CookedMesh* cooked) {
+    if (!cooked) return;
+    free(cooked->vertices);
+    free(cooked->indices);
+    free(cooked->submeshes);
+    free(cooked->meshlets);
+    memset(cooked, 0, sizeof(*cooked));
+}
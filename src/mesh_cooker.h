@@ -0,0 +1,29 @@
+#ifndef MESH_COOKER_H
+#define MESH_COOKER_H
+
+#include "mesh_cache.h"
+
+// Mesh processing without GL, shared by the scene loader and the cook tool: OBJ parse, smooth
+// normals and tangents, welding, optimization passes, LODs and meshlets, with the vertices
+// packed into params->vertexLayout. The result is what MeshCache_Write stores.
+
+typedef struct {
+    MeshCacheData data;                        // points into the fields below
+    void* vertices;
+    void* indices;
+    MeshCacheSubmesh* submeshes;
+    MeshCacheMeshlet* meshlets;
+    float lodErrors[MESH_CACHE_MAX_LODS];
+    float boundsCenter[3];
+    char materialLibrary[MESH_CACHE_PATH_SIZE];
+    VertexQuantization quantization;
+} CookedMesh;
+
+// The parameters a scene object's mesh is processed with; smooth objects also get tangents.
+void MeshCooker_GetParams(int smooth, VertexLayoutId vertexLayout, MeshProcessParams* params);
+
+// Returns 0 on success, 1 if the OBJ cannot be loaded, 2 when out of memory.
+int MeshCooker_Cook(const char* meshFile, const MeshProcessParams* params, int threadCount, CookedMesh* cooked);
+void MeshCooker_Free(CookedMesh* cooked);
+
+#endif
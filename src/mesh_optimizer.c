@@ -0,0 +1,427 @@
+#include "mesh_optimizer.h"
+#include "time_utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+VertexCacheStats MeshOptimizer_AnalyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount,
+                                                  int cacheSize) {
+    VertexCacheStats stats = {0, 0.0f, 0.0f};
+    // Timestamp of the vertex's entry into the FIFO; it is cached while younger than cacheSize
+    size_t* timestamps = calloc(vertexCount + 1, sizeof(size_t));
+    if (!timestamps) return stats;
+
+    size_t time = (size_t)cacheSize + 1;
+    for (size_t i = 0; i < indexCount; ++i) {
+        uint32_t v = indices[i];
+        if (time - timestamps[v] > (size_t)cacheSize) {
+            timestamps[v] = time++;
+            stats.misses++;
+        }
+    }
+    free(timestamps);
+
+    if (indexCount >= 3) stats.acmr = (float)stats.misses / (float)(indexCount / 3);
+    if (vertexCount > 0) stats.atvr = (float)stats.misses / (float)vertexCount;
+    return stats;
+}
+
+// --- Forsyth vertex cache optimization ---
+
+#define FORSYTH_CACHE_SIZE 32
+#define FORSYTH_MAX_VALENCE 64
+
+// Built per call rather than once into globals, so meshes can be optimized on several threads
+typedef struct {
+    float cacheScore[FORSYTH_CACHE_SIZE + 3];
+    float valenceScore[FORSYTH_MAX_VALENCE + 1];
+} ForsythTables;
+
+static void initForsythTables(ForsythTables* tables) {
+    for (int i = 0; i < FORSYTH_CACHE_SIZE + 3; ++i) {
+        if (i < 3) {
+            // The last triangle's vertices score lower so it is not just repeated
+            tables->cacheScore[i] = 0.75f;
+        } else if (i < FORSYTH_CACHE_SIZE) {
+            float scale = 1.0f - (float)(i - 3) / (float)(FORSYTH_CACHE_SIZE - 3);
+            tables->cacheScore[i] = powf(scale, 1.5f);
+        } else {
+            tables->cacheScore[i] = 0.0f;
+        }
+    }
+    // Vertices with few triangles left get a boost so they are finished off
+    tables->valenceScore[0] = 0.0f;
+    for (int i = 1; i <= FORSYTH_MAX_VALENCE; ++i) {
+        tables->valenceScore[i] = 2.0f / sqrtf((float)i);
+    }
+}
+
+static inline float forsythVertexScore(const ForsythTables* tables, int cachePosition, uint32_t liveTriangles) {
+    if (liveTriangles == 0) return -1.0f;
+    float score = cachePosition >= 0 ? tables->cacheScore[cachePosition] : 0.0f;
+    return score + tables->valenceScore[liveTriangles < FORSYTH_MAX_VALENCE ? liveTriangles : FORSYTH_MAX_VALENCE];
+}
+
+int MeshOptimizer_OptimizeVertexCache(uint32_t* destination, const uint32_t* indices, size_t indexCount,
+                                      size_t vertexCount) {
+    size_t triangleCount = indexCount / 3;
+    if (triangleCount == 0) return 0;
+    ForsythTables tables;
+    initForsythTables(&tables);
+
+    uint32_t* liveCount = calloc(vertexCount, sizeof(uint32_t));
+    uint32_t* adjacencyOffset = malloc((vertexCount + 1) * sizeof(uint32_t));
+    uint32_t* adjacency = malloc(triangleCount * 3 * sizeof(uint32_t));
+    int* cachePosition = malloc(vertexCount * sizeof(int));
+    float* vertexScore = malloc(vertexCount * sizeof(float));
+    unsigned char* emitted = calloc(triangleCount, 1);
+    uint32_t* output = malloc(triangleCount * 3 * sizeof(uint32_t));
+    if (!liveCount || !adjacencyOffset || !adjacency || !cachePosition || !vertexScore || !emitted || !output) {
+        free(liveCount);
+        free(adjacencyOffset);
+        free(adjacency);
+        free(cachePosition);
+        free(vertexScore);
+        free(emitted);
+        free(output);
+        return 2;
+    }
+
+    // Vertex -> triangle adjacency; each vertex's live triangles are kept at the front of its list
+    for (size_t i = 0; i < triangleCount * 3; ++i) liveCount[indices[i]]++;
+    uint32_t offset = 0;
+    for (size_t v = 0; v < vertexCount; ++v) {
+        adjacencyOffset[v] = offset;
+        offset += liveCount[v];
+        liveCount[v] = 0;
+    }
+    adjacencyOffset[vertexCount] = offset;
+    for (size_t t = 0; t < triangleCount; ++t) {
+        for (int k = 0; k < 3; ++k) {
+            uint32_t v = indices[t * 3 + k];
+            adjacency[adjacencyOffset[v] + liveCount[v]++] = (uint32_t)t;
+        }
+    }
+
+    for (size_t v = 0; v < vertexCount; ++v) {
+        cachePosition[v] = -1;
+        vertexScore[v] = forsythVertexScore(&tables, -1, liveCount[v]);
+    }
+
+    size_t best = 0;
+    float bestScore = -1.0f;
+    for (size_t t = 0; t < triangleCount; ++t) {
+        const uint32_t* tri = &indices[t * 3];
+        float score = vertexScore[tri[0]] + vertexScore[tri[1]] + vertexScore[tri[2]];
+        if (score > bestScore) {
+            bestScore = score;
+            best = t;
+        }
+    }
+
+    uint32_t cache[FORSYTH_CACHE_SIZE + 3];
+    uint32_t newCache[FORSYTH_CACHE_SIZE + 3];
+    int cacheCount = 0;
+    size_t cursor = 0; // everything before this has been emitted
+
+    for (size_t written = 0; written < triangleCount; ++written) {
+        if (bestScore < 0.0f) {
+            // Dead end: continue with the next triangle in input order
+            while (emitted[cursor]) cursor++;
+            best = cursor;
+        }
+
+        const uint32_t* tri = &indices[best * 3];
+        memcpy(&output[written * 3], tri, 3 * sizeof(uint32_t));
+        emitted[best] = 1;
+
+        // Remove the triangle from its vertices' live lists
+        for (int k = 0; k < 3; ++k) {
+            uint32_t v = tri[k];
+            uint32_t* list = &adjacency[adjacencyOffset[v]];
+            for (uint32_t j = 0; j < liveCount[v]; ++j) {
+                if (list[j] == best) {
+                    list[j] = list[liveCount[v] - 1];
+                    list[liveCount[v] - 1] = (uint32_t)best;
+                    liveCount[v]--;
+                    break;
+                }
+            }
+        }
+
+        // LRU update: the triangle's vertices move to the front
+        int newCount = 0;
+        for (int k = 0; k < 3; ++k) {
+            if (k > 0 && (tri[k] == tri[0] || (k == 2 && tri[2] == tri[1]))) continue;
+            newCache[newCount++] = tri[k];
+        }
+        for (int i = 0; i < cacheCount; ++i) {
+            uint32_t v = cache[i];
+            if (v != tri[0] && v != tri[1] && v != tri[2]) newCache[newCount++] = v;
+        }
+        for (int i = FORSYTH_CACHE_SIZE; i < newCount; ++i) {
+            cachePosition[newCache[i]] = -1;
+            vertexScore[newCache[i]] = forsythVertexScore(&tables, -1, liveCount[newCache[i]]);
+        }
+        cacheCount = newCount < FORSYTH_CACHE_SIZE ? newCount : FORSYTH_CACHE_SIZE;
+        memcpy(cache, newCache, (size_t)cacheCount * sizeof(uint32_t));
+
+        for (int i = 0; i < cacheCount; ++i) {
+            cachePosition[cache[i]] = i;
+            vertexScore[cache[i]] = forsythVertexScore(&tables, i, liveCount[cache[i]]);
+        }
+
+        // Only triangles touching the cache changed score; pick the best of them
+        bestScore = -1.0f;
+        for (int i = 0; i < cacheCount; ++i) {
+            uint32_t v = cache[i];
+            const uint32_t* list = &adjacency[adjacencyOffset[v]];
+            for (uint32_t j = 0; j < liveCount[v]; ++j) {
+                uint32_t t = list[j];
+                const uint32_t* other = &indices[t * 3];
+                float score = vertexScore[other[0]] + vertexScore[other[1]] + vertexScore[other[2]];
+                if (score > bestScore) {
+                    bestScore = score;
+                    best = t;
+                }
+            }
+        }
+    }
+
+    memcpy(destination, output, triangleCount * 3 * sizeof(uint32_t));
+    free(liveCount);
+    free(adjacencyOffset);
+    free(adjacency);
+    free(cachePosition);
+    free(vertexScore);
+    free(emitted);
+    free(output);
+    return 0;
+}
+
+// --- Overdraw-aware cluster ordering ---
+
+typedef struct {
+    size_t first;     // triangle
+    size_t count;
+    float sortKey;
+} TriangleCluster;
+
+static int compareClusters(const void* a, const void* b) {
+    const TriangleCluster* ca = (const TriangleCluster*)a;
+    const TriangleCluster* cb = (const TriangleCluster*)b;
+    if (ca->sortKey != cb->sortKey) return ca->sortKey > cb->sortKey ? -1 : 1;
+    return ca->first < cb->first ? -1 : (ca->first > cb->first);
+}
+
+// FIFO hit test used while splitting; returns the number of misses for one triangle.
+static int simulateTriangle(const uint32_t* tri, size_t* timestamps, size_t* time, int cacheSize) {
+    int misses = 0;
+    for (int k = 0; k < 3; ++k) {
+        if (*time - timestamps[tri[k]] > (size_t)cacheSize) {
+            timestamps[tri[k]] = (*time)++;
+            misses++;
+        }
+    }
+    return misses;
+}
+
+int MeshOptimizer_OptimizeOverdraw(uint32_t* destination, const uint32_t* indices, size_t indexCount,
+                                   const float* vertices, size_t vertexCount, size_t stride, float threshold) {
+    size_t triangleCount = indexCount / 3;
+    if (triangleCount == 0) return 0;
+
+    size_t* timestamps = calloc(vertexCount, sizeof(size_t));
+    TriangleCluster* clusters = malloc(triangleCount * sizeof(TriangleCluster));
+    uint32_t* output = malloc(triangleCount * 3 * sizeof(uint32_t));
+    if (!timestamps || !clusters || !output) {
+        free(timestamps);
+        free(clusters);
+        free(output);
+        return 2;
+    }
+    const int cacheSize = MESH_OPTIMIZER_FIFO_SIZE;
+
+    // Hard boundaries: triangles that miss on all three vertices start over anyway
+    size_t hardCount = 0;
+    size_t time = (size_t)cacheSize + 1;
+    for (size_t t = 0; t < triangleCount; ++t) {
+        if (simulateTriangle(&indices[t * 3], timestamps, &time, cacheSize) == 3 || t == 0) {
+            clusters[hardCount].first = t;
+            clusters[hardCount].count = 0;
+            hardCount++;
+        }
+        clusters[hardCount - 1].count++;
+    }
+
+    // Soft boundaries: split a hard cluster wherever the part so far, drawn with a cold
+    // cache, is still within threshold of the cluster's ACMR
+    TriangleCluster* soft = malloc(triangleCount * sizeof(TriangleCluster));
+    if (!soft) {
+        free(timestamps);
+        free(clusters);
+        free(output);
+        return 2;
+    }
+    size_t softCount = 0;
+    for (size_t c = 0; c < hardCount; ++c) {
+        size_t first = clusters[c].first;
+        size_t last = first + clusters[c].count;
+
+        time += (size_t)cacheSize + 1;
+        size_t clusterMisses = 0;
+        for (size_t t = first; t < last; ++t) {
+            clusterMisses += (size_t)simulateTriangle(&indices[t * 3], timestamps, &time, cacheSize);
+        }
+        float target = (float)clusterMisses / (float)clusters[c].count * threshold;
+
+        size_t start = first;
+        size_t misses = 0;
+        time += (size_t)cacheSize + 1;
+        for (size_t t = first; t < last; ++t) {
+            misses += (size_t)simulateTriangle(&indices[t * 3], timestamps, &time, cacheSize);
+            if ((float)misses / (float)(t - start + 1) <= target || t + 1 == last) {
+                soft[softCount].first = start;
+                soft[softCount].count = t - start + 1;
+                softCount++;
+                start = t + 1;
+                misses = 0;
+                time += (size_t)cacheSize + 1;
+            }
+        }
+    }
+    free(timestamps);
+    free(clusters);
+
+    // Mesh centroid, then each cluster's area-weighted centroid and normal
+    double center[3] = {0.0, 0.0, 0.0};
+    double totalArea = 0.0;
+    for (size_t t = 0; t < triangleCount; ++t) {
+        const float* a = &vertices[indices[t * 3 + 0] * stride];
+        const float* b = &vertices[indices[t * 3 + 1] * stride];
+        const float* c = &vertices[indices[t * 3 + 2] * stride];
+        float e1[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+        float e2[3] = {c[0] - a[0], c[1] - a[1], c[2] - a[2]};
+        float n[3] = {e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0]};
+        double area = sqrt((double)n[0] * n[0] + (double)n[1] * n[1] + (double)n[2] * n[2]);
+        for (int k = 0; k < 3; ++k) center[k] += area * (a[k] + b[k] + c[k]) / 3.0;
+        totalArea += area;
+    }
+    if (totalArea > 0.0) {
+        for (int k = 0; k < 3; ++k) center[k] /= totalArea;
+    }
+
+    for (size_t s = 0; s < softCount; ++s) {
+        double centroid[3] = {0.0, 0.0, 0.0};
+        double normal[3] = {0.0, 0.0, 0.0};
+        double area = 0.0;
+        for (size_t t = soft[s].first; t < soft[s].first + soft[s].count; ++t) {
+            const float* a = &vertices[indices[t * 3 + 0] * stride];
+            const float* b = &vertices[indices[t * 3 + 1] * stride];
+            const float* c = &vertices[indices[t * 3 + 2] * stride];
+            float e1[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+            float e2[3] = {c[0] - a[0], c[1] - a[1], c[2] - a[2]};
+            float n[3] = {e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0]};
+            double triangleArea = sqrt((double)n[0] * n[0] + (double)n[1] * n[1] + (double)n[2] * n[2]);
+            for (int k = 0; k < 3; ++k) {
+                centroid[k] += triangleArea * (a[k] + b[k] + c[k]) / 3.0;
+                normal[k] += n[k];
+            }
+            area += triangleArea;
+        }
+        double normalLength = sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+        float key = 0.0f;
+        if (area > 0.0 && normalLength > 0.0) {
+            for (int k = 0; k < 3; ++k) {
+                key += (float)((centroid[k] / area - center[k]) * normal[k] / normalLength);
+            }
+        }
+        // Clusters facing away from the centre occlude the rest: draw them first
+        soft[s].sortKey = key;
+    }
+
+    qsort(soft, softCount, sizeof(TriangleCluster), compareClusters);
+
+    size_t written = 0;
+    for (size_t s = 0; s < softCount; ++s) {
+        memcpy(&output[written * 3], &indices[soft[s].first * 3], soft[s].count * 3 * sizeof(uint32_t));
+        written += soft[s].count;
+    }
+    memcpy(destination, output, triangleCount * 3 * sizeof(uint32_t));
+
+    free(soft);
+    free(output);
+    return 0;
+}
+
+// --- Vertex fetch ---
+
+size_t MeshOptimizer_OptimizeVertexFetch(float* vertices, uint32_t* indices, size_t indexCount,
+                                         size_t vertexCount, size_t stride) {
+    uint32_t* remap = malloc(vertexCount * sizeof(uint32_t));
+    float* reordered = malloc(vertexCount * stride * sizeof(float) + 1);
+    if (!remap || !reordered) {
+        free(remap);
+        free(reordered);
+        return vertexCount;
+    }
+    memset(remap, 0xFF, vertexCount * sizeof(uint32_t));
+
+    uint32_t next = 0;
+    for (size_t i = 0; i < indexCount; ++i) {
+        uint32_t v = indices[i];
+        if (remap[v] == UINT32_MAX) {
+            memcpy(&reordered[(size_t)next * stride], &vertices[(size_t)v * stride], stride * sizeof(float));
+            remap[v] = next++;
+        }
+        indices[i] = remap[v];
+    }
+    memcpy(vertices, reordered, (size_t)next * stride * sizeof(float));
+
+    free(remap);
+    free(reordered);
+    return next;
+}
+
+int MeshOptimizer_OptimizeMesh(ObjMesh* mesh, unsigned flags, const char* name) {
+    if (!mesh || !mesh->elements || mesh->element_count == 0) return 1;
+
+    double startTime = GetTimeSeconds();
+    VertexCacheStats before = MeshOptimizer_AnalyzeVertexCache(mesh->elements, mesh->element_count,
+                                                               mesh->unique_vertex_count, MESH_OPTIMIZER_FIFO_SIZE);
+
+    // Triangles never move between submeshes, so materials keep their ranges
+    ObjSubmesh whole = {"", 0, (uint32_t)mesh->element_count, 0, 0};
+    const ObjSubmesh* submeshes = mesh->submesh_count ? mesh->submeshes : &whole;
+    size_t submeshCount = mesh->submesh_count ? mesh->submesh_count : 1;
+
+    for (size_t s = 0; s < submeshCount; ++s) {
+        uint32_t* range = &mesh->elements[submeshes[s].firstIndex];
+        size_t count = submeshes[s].indexCount;
+        if ((flags & MESH_OPTIMIZE_VERTEX_CACHE) &&
+            MeshOptimizer_OptimizeVertexCache(range, range, count, mesh->unique_vertex_count)) {
+            fprintf(stderr, "[MeshOptimizer] Out of memory optimizing %s\n", name);
+            return 2;
+        }
+        if ((flags & MESH_OPTIMIZE_OVERDRAW) &&
+            MeshOptimizer_OptimizeOverdraw(range, range, count, mesh->unique_vertices, mesh->unique_vertex_count,
+                                           FLOATS_PER_VERTEX, MESH_OPTIMIZER_OVERDRAW_THRESHOLD)) {
+            fprintf(stderr, "[MeshOptimizer] Out of memory optimizing %s\n", name);
+            return 2;
+        }
+    }
+
+    if (flags & MESH_OPTIMIZE_VERTEX_FETCH) {
+        mesh->unique_vertex_count = MeshOptimizer_OptimizeVertexFetch(mesh->unique_vertices, mesh->elements,
+                                                                      mesh->element_count, mesh->unique_vertex_count,
+                                                                      FLOATS_PER_VERTEX);
+    }
+
+    VertexCacheStats after = MeshOptimizer_AnalyzeVertexCache(mesh->elements, mesh->element_count,
+                                                              mesh->unique_vertex_count, MESH_OPTIMIZER_FIFO_SIZE);
+    printf("[MeshOptimizer] %s: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f (FIFO %d, %zu triangles) in %.1f ms\n",
+           name, before.acmr, after.acmr, before.atvr, after.atvr, MESH_OPTIMIZER_FIFO_SIZE,
+           mesh->element_count / 3, (GetTimeSeconds() - startTime) * 1000.0);
+    return 0;
+}
@@ -0,0 +1,47 @@
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "OBJ_file_loader.h"
+
+// FIFO size used when reporting cache statistics
+#define MESH_OPTIMIZER_FIFO_SIZE 16
+// Vertex cache optimization may lose this much ACMR to let clusters be sorted for overdraw
+#define MESH_OPTIMIZER_OVERDRAW_THRESHOLD 1.05f
+
+enum {
+    MESH_OPTIMIZE_VERTEX_CACHE = 1 << 0,
+    MESH_OPTIMIZE_OVERDRAW     = 1 << 1,
+    MESH_OPTIMIZE_VERTEX_FETCH = 1 << 2
+};
+
+typedef struct {
+    size_t misses;          // vertex shader invocations
+    float acmr;             // misses per triangle: 0.5 is ideal for grids, 3 is worst
+    float atvr;             // misses per vertex: 1 is ideal
+} VertexCacheStats;
+
+// Simulates a FIFO post-transform cache of cacheSize entries over a triangle list.
+VertexCacheStats MeshOptimizer_AnalyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount,
+                                                  int cacheSize);
+
+// Forsyth's linear-speed triangle reordering. destination may equal indices.
+int MeshOptimizer_OptimizeVertexCache(uint32_t* destination, const uint32_t* indices, size_t indexCount,
+                                      size_t vertexCount);
+
+// Splits a cache-optimized list into clusters (keeping ACMR within threshold) and orders
+// them so outward-facing clusters draw first. vertices is pos(3)... with `stride` floats.
+int MeshOptimizer_OptimizeOverdraw(uint32_t* destination, const uint32_t* indices, size_t indexCount,
+                                   const float* vertices, size_t vertexCount, size_t stride, float threshold);
+
+// Reorders vertices in order of first use and rewrites indices; unused vertices are dropped.
+// Returns the new vertex count.
+size_t MeshOptimizer_OptimizeVertexFetch(float* vertices, uint32_t* indices, size_t indexCount,
+                                         size_t vertexCount, size_t stride);
+
+// Runs the selected passes on every submesh of an indexed mesh (after BuildIndexedMesh)
+// and logs ACMR/ATVR before and after.
+int MeshOptimizer_OptimizeMesh(ObjMesh* mesh, unsigned flags, const char* name);
+
+#endif
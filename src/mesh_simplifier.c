@@ -0,0 +1,558 @@
+#include "mesh_simplifier.h"
+#include "mesh_optimizer.h"
+#include "time_utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+// Edge quadrics hold open borders and seams in place. Borders weigh more since nothing
+// on the other side hides their movement.
+#define SIMPLIFY_BORDER_WEIGHT 10.0
+#define SIMPLIFY_SEAM_WEIGHT 1.0
+// A collapse may not turn any remaining triangle's normal by more than ~75 degrees
+#define SIMPLIFY_MIN_NORMAL_COSINE 0.25f
+#define SIMPLIFY_MAX_PASSES 64
+
+#define NO_VERTEX 0xffffffffu
+
+// Sum of squared distances to planes: p^T A p + 2 b.p + c, with the total plane weight w
+typedef struct {
+    double a00, a11, a22, a10, a20, a21;
+    double b0, b1, b2;
+    double c;
+    double w;
+} Quadric;
+
+enum {
+    KIND_MANIFOLD,   // interior vertex with a single set of attributes
+    KIND_BORDER,     // on one open border
+    KIND_SEAM,       // one of two copies split along a UV or normal seam
+    KIND_LOCKED      // corners, seam ends, non-manifold: never removed
+};
+
+// Triangle corner (v, next, prev), stored with v
+typedef struct {
+    uint32_t next;
+    uint32_t prev;
+} HalfEdge;
+
+typedef struct {
+    uint32_t from;
+    uint32_t to;
+    float error;
+} Collapse;
+
+typedef struct {
+    size_t vertexCount;
+    float* positions;          // 3 per vertex
+    uint32_t* remap;           // lowest vertex with the same position
+    uint32_t* wedge;           // next vertex with the same position, circular
+    unsigned char* kind;
+    uint32_t* openIn;          // NO_VERTEX: none, the vertex itself: more than one
+    uint32_t* openOut;
+    Quadric* quadrics;         // per position, indexed by remap
+    uint32_t* edgeOffsets;     // vertexCount + 1
+    HalfEdge* edges;
+} Simplifier;
+
+static void quadricFromPlane(Quadric* q, double a, double b, double c, double d, double weight) {
+    q->a00 = weight * a * a;
+    q->a11 = weight * b * b;
+    q->a22 = weight * c * c;
+    q->a10 = weight * a * b;
+    q->a20 = weight * a * c;
+    q->a21 = weight * b * c;
+    q->b0 = weight * a * d;
+    q->b1 = weight * b * d;
+    q->b2 = weight * c * d;
+    q->c = weight * d * d;
+    q->w = weight;
+}
+
+static void quadricAdd(Quadric* q, const Quadric* r) {
+    q->a00 += r->a00;
+    q->a11 += r->a11;
+    q->a22 += r->a22;
+    q->a10 += r->a10;
+    q->a20 += r->a20;
+    q->a21 += r->a21;
+    q->b0 += r->b0;
+    q->b1 += r->b1;
+    q->b2 += r->b2;
+    q->c += r->c;
+    q->w += r->w;
+}
+
+// Mean squared distance from p to the quadric's planes
+static float quadricError(const Quadric* q, const float* p) {
+    double x = p[0], y = p[1], z = p[2];
+    double r = q->a00 * x * x + q->a11 * y * y + q->a22 * z * z +
+               2.0 * (q->a10 * x * y + q->a20 * x * z + q->a21 * y * z) +
+               2.0 * (q->b0 * x + q->b1 * y + q->b2 * z) + q->c;
+    return (float)(fabs(r) / (q->w > 0.0 ? q->w : 1.0));
+}
+
+static void sub3(const float* a, const float* b, float* out) {
+    out[0] = a[0] - b[0];
+    out[1] = a[1] - b[1];
+    out[2] = a[2] - b[2];
+}
+
+static void cross3(const float* a, const float* b, float* out) {
+    out[0] = a[1] * b[2] - a[2] * b[1];
+    out[1] = a[2] * b[0] - a[0] * b[2];
+    out[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+static float dot3(const float* a, const float* b) {
+    return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+static uint32_t hashPosition(const float* p) {
+    uint32_t bits[3];
+    float normalized[3] = {p[0] + 0.0f, p[1] + 0.0f, p[2] + 0.0f};   // -0 and 0 hash alike
+    memcpy(bits, normalized, sizeof(bits));
+    return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+}
+
+// Links vertices that differ only in attributes (UV/normal seams) into wedge rings.
+static int buildPositionRemap(Simplifier* s) {
+    size_t tableSize = 1;
+    while (tableSize < s->vertexCount * 2) tableSize *= 2;
+    uint32_t* table = malloc(tableSize * sizeof(uint32_t));
+    if (!table) return 2;
+    memset(table, 0xff, tableSize * sizeof(uint32_t));
+
+    for (uint32_t v = 0; v < s->vertexCount; ++v) {
+        const float* p = &s->positions[v * 3];
+        size_t slot = hashPosition(p) & (tableSize - 1);
+        while (table[slot] != NO_VERTEX) {
+            const float* q = &s->positions[table[slot] * 3];
+            if (p[0] == q[0] && p[1] == q[1] && p[2] == q[2]) break;
+            slot = (slot + 1) & (tableSize - 1);
+        }
+        if (table[slot] == NO_VERTEX) {
+            table[slot] = v;
+            s->remap[v] = v;
+            s->wedge[v] = v;
+        } else {
+            uint32_t first = table[slot];
+            s->remap[v] = first;
+            s->wedge[v] = s->wedge[first];
+            s->wedge[first] = v;
+        }
+    }
+    free(table);
+    return 0;
+}
+
+static void buildAdjacency(Simplifier* s, const uint32_t* indices, size_t indexCount) {
+    memset(s->edgeOffsets, 0, (s->vertexCount + 1) * sizeof(uint32_t));
+    for (size_t i = 0; i < indexCount; ++i) s->edgeOffsets[indices[i] + 1]++;
+    for (size_t v = 0; v < s->vertexCount; ++v) s->edgeOffsets[v + 1] += s->edgeOffsets[v];
+
+    // Fill using the start offsets as cursors, then shift them back
+    for (size_t i = 0; i < indexCount; i += 3) {
+        for (int k = 0; k < 3; ++k) {
+            uint32_t v = indices[i + k];
+            HalfEdge* edge = &s->edges[s->edgeOffsets[v]++];
+            edge->next = indices[i + (k + 1) % 3];
+            edge->prev = indices[i + (k + 2) % 3];
+        }
+    }
+    for (size_t v = s->vertexCount; v > 0; --v) s->edgeOffsets[v] = s->edgeOffsets[v - 1];
+    s->edgeOffsets[0] = 0;
+}
+
+static int hasEdge(const Simplifier* s, uint32_t a, uint32_t b) {
+    for (uint32_t e = s->edgeOffsets[a]; e < s->edgeOffsets[a + 1]; ++e) {
+        if (s->edges[e].next == b) return 1;
+    }
+    return 0;
+}
+
+// Whether any copy of a has an edge to any copy of b, i.e. the edge is not on a true border
+static int hasPositionEdge(const Simplifier* s, uint32_t a, uint32_t b) {
+    uint32_t w = a;
+    do {
+        for (uint32_t e = s->edgeOffsets[w]; e < s->edgeOffsets[w + 1]; ++e) {
+            if (s->remap[s->edges[e].next] == s->remap[b]) return 1;
+        }
+        w = s->wedge[w];
+    } while (w != a);
+    return 0;
+}
+
+// openIn/openOut hold exactly one vertex
+static int isSingleLink(uint32_t v, uint32_t link) {
+    return link != NO_VERTEX && link != v;
+}
+
+static void classifyVertices(Simplifier* s) {
+    for (uint32_t v = 0; v < s->vertexCount; ++v) {
+        s->openIn[v] = NO_VERTEX;
+        s->openOut[v] = NO_VERTEX;
+    }
+    for (uint32_t v = 0; v < s->vertexCount; ++v) {
+        for (uint32_t e = s->edgeOffsets[v]; e < s->edgeOffsets[v + 1]; ++e) {
+            uint32_t target = s->edges[e].next;
+            if (hasEdge(s, target, v)) continue;
+            s->openOut[v] = (s->openOut[v] == NO_VERTEX) ? target : v;
+            s->openIn[target] = (s->openIn[target] == NO_VERTEX) ? v : target;
+        }
+    }
+
+    for (uint32_t v = 0; v < s->vertexCount; ++v) {
+        uint32_t w = s->wedge[v];
+        if (w == v) {
+            if (s->openIn[v] == NO_VERTEX && s->openOut[v] == NO_VERTEX) {
+                s->kind[v] = KIND_MANIFOLD;
+            } else if (isSingleLink(v, s->openIn[v]) && isSingleLink(v, s->openOut[v])) {
+                s->kind[v] = KIND_BORDER;
+            } else {
+                s->kind[v] = KIND_LOCKED;
+            }
+        } else if (s->wedge[w] == v &&
+                   isSingleLink(v, s->openIn[v]) && isSingleLink(v, s->openOut[v]) &&
+                   isSingleLink(w, s->openIn[w]) && isSingleLink(w, s->openOut[w]) &&
+                   s->remap[s->openIn[v]] == s->remap[s->openOut[w]] &&
+                   s->remap[s->openOut[v]] == s->remap[s->openIn[w]]) {
+            // Exactly two copies whose open edges run along the same positions in opposite directions
+            s->kind[v] = KIND_SEAM;
+        } else {
+            s->kind[v] = KIND_LOCKED;
+        }
+    }
+}
+
+static void buildQuadrics(Simplifier* s, const uint32_t* indices, size_t indexCount) {
+    memset(s->quadrics, 0, s->vertexCount * sizeof(Quadric));
+    for (size_t i = 0; i < indexCount; i += 3) {
+        const float* p[3];
+        for (int k = 0; k < 3; ++k) p[k] = &s->positions[indices[i + k] * 3];
+
+        float e1[3], e2[3], normal[3];
+        sub3(p[1], p[0], e1);
+        sub3(p[2], p[0], e2);
+        cross3(e1, e2, normal);
+        float area = sqrtf(dot3(normal, normal));
+        if (area == 0.0f) continue;
+        for (int c = 0; c < 3; ++c) normal[c] /= area;
+
+        Quadric plane;
+        quadricFromPlane(&plane, normal[0], normal[1], normal[2], -dot3(normal, p[0]), area);
+        for (int k = 0; k < 3; ++k) quadricAdd(&s->quadrics[s->remap[indices[i + k]]], &plane);
+
+        for (int k = 0; k < 3; ++k) {
+            uint32_t a = indices[i + k];
+            uint32_t b = indices[i + (k + 1) % 3];
+            if (hasEdge(s, b, a)) continue;
+
+            // Plane through the open edge, perpendicular to the triangle
+            float edge[3], edgeNormal[3];
+            sub3(p[(k + 1) % 3], p[k], edge);
+            cross3(edge, normal, edgeNormal);
+            float length = sqrtf(dot3(edgeNormal, edgeNormal));
+            if (length == 0.0f) continue;
+            for (int c = 0; c < 3; ++c) edgeNormal[c] /= length;
+
+            double weight = hasPositionEdge(s, b, a) ? SIMPLIFY_SEAM_WEIGHT : SIMPLIFY_BORDER_WEIGHT;
+            Quadric constraint;
+            quadricFromPlane(&constraint, edgeNormal[0], edgeNormal[1], edgeNormal[2], -dot3(edgeNormal, p[k]),
+                             weight * dot3(edge, edge));
+            constraint.w = 0.0;   // constrains position without diluting the surface error
+            quadricAdd(&s->quadrics[s->remap[a]], &constraint);
+            quadricAdd(&s->quadrics[s->remap[b]], &constraint);
+        }
+    }
+}
+
+static int isOpenNeighbour(const Simplifier* s, uint32_t v, uint32_t other) {
+    return s->openOut[v] == other || s->openIn[v] == other;
+}
+
+static int canCollapse(const Simplifier* s, uint32_t from, uint32_t to) {
+    switch (s->kind[from]) {
+        case KIND_MANIFOLD:
+            return 1;
+        case KIND_BORDER:
+            return (s->kind[to] == KIND_BORDER || s->kind[to] == KIND_LOCKED) && isOpenNeighbour(s, from, to);
+        case KIND_SEAM:
+            // Both copies must slide along the seam to the two copies of `to`
+            return s->kind[to] == KIND_SEAM && isOpenNeighbour(s, from, to) &&
+                   isOpenNeighbour(s, s->wedge[from], s->wedge[to]);
+        default:
+            return 0;
+    }
+}
+
+// Whether moving v onto target's position turns one of v's other triangles over
+static int collapseFlips(const Simplifier* s, uint32_t v, uint32_t target) {
+    const float* p0 = &s->positions[v * 3];
+    const float* p1 = &s->positions[target * 3];
+    for (uint32_t e = s->edgeOffsets[v]; e < s->edgeOffsets[v + 1]; ++e) {
+        uint32_t b = s->edges[e].next;
+        uint32_t c = s->edges[e].prev;
+        if (s->remap[b] == s->remap[target] || s->remap[c] == s->remap[target]) continue;
+
+        const float* pb = &s->positions[b * 3];
+        const float* pc = &s->positions[c * 3];
+        float e1[3], e2[3], before[3], after[3];
+        sub3(pb, p0, e1);
+        sub3(pc, p0, e2);
+        cross3(e1, e2, before);
+        sub3(pb, p1, e1);
+        sub3(pc, p1, e2);
+        cross3(e1, e2, after);
+
+        float lengths = sqrtf(dot3(before, before) * dot3(after, after));
+        if (lengths > 0.0f && dot3(before, after) < SIMPLIFY_MIN_NORMAL_COSINE * lengths) return 1;
+    }
+    return 0;
+}
+
+static int compareCollapses(const void* a, const void* b) {
+    float ea = ((const Collapse*)a)->error;
+    float eb = ((const Collapse*)b)->error;
+    return (ea > eb) - (ea < eb);
+}
+
+// Collapse candidates, one per edge in its cheaper allowed direction.
+static size_t gatherCollapses(const Simplifier* s, const uint32_t* indices, size_t indexCount, Collapse* collapses) {
+    size_t count = 0;
+    for (size_t i = 0; i < indexCount; i += 3) {
+        for (int k = 0; k < 3; ++k) {
+            uint32_t a = indices[i + k];
+            uint32_t b = indices[i + (k + 1) % 3];
+            // Interior edges appear twice; keep the copy starting at the lower vertex
+            if (a > b && hasEdge(s, b, a)) continue;
+
+            float errorAB = canCollapse(s, a, b) ? quadricError(&s->quadrics[s->remap[a]], &s->positions[b * 3]) : INFINITY;
+            float errorBA = canCollapse(s, b, a) ? quadricError(&s->quadrics[s->remap[b]], &s->positions[a * 3]) : INFINITY;
+            if (errorAB == INFINITY && errorBA == INFINITY) continue;
+
+            Collapse* collapse = &collapses[count++];
+            collapse->from = (errorAB <= errorBA) ? a : b;
+            collapse->to = (errorAB <= errorBA) ? b : a;
+            collapse->error = (errorAB <= errorBA) ? errorAB : errorBA;
+        }
+    }
+    return count;
+}
+
+static void lockRing(const Simplifier* s, uint32_t v, unsigned char* locked) {
+    locked[s->remap[v]] = 1;
+    for (uint32_t e = s->edgeOffsets[v]; e < s->edgeOffsets[v + 1]; ++e) {
+        locked[s->remap[s->edges[e].next]] = 1;
+        locked[s->remap[s->edges[e].prev]] = 1;
+    }
+}
+
+size_t MeshSimplifier_Simplify(uint32_t* destination, const uint32_t* indices, size_t indexCount,
+                               const float* vertices, size_t vertexCount, size_t stride,
+                               size_t targetIndexCount, float targetError, float* resultError) {
+    if (resultError) *resultError = 0.0f;
+    indexCount -= indexCount % 3;
+    if (destination != indices) memmove(destination, indices, indexCount * sizeof(uint32_t));
+    if (indexCount <= targetIndexCount || indexCount == 0) return indexCount;
+
+    // Work on a compact copy of the vertices this range uses
+    size_t localCapacity = indexCount < vertexCount ? indexCount : vertexCount;
+    uint32_t* localOf = malloc(vertexCount * sizeof(uint32_t));
+    uint32_t* globalOf = malloc(localCapacity * sizeof(uint32_t));
+    uint32_t* work = malloc(indexCount * sizeof(uint32_t));
+    if (!localOf || !globalOf || !work) {
+        free(localOf);
+        free(globalOf);
+        free(work);
+        return indexCount;
+    }
+    memset(localOf, 0xff, vertexCount * sizeof(uint32_t));
+
+    Simplifier s;
+    memset(&s, 0, sizeof(s));
+    for (size_t i = 0; i < indexCount; ++i) {
+        uint32_t v = destination[i];
+        if (localOf[v] == NO_VERTEX) {
+            localOf[v] = (uint32_t)s.vertexCount;
+            globalOf[s.vertexCount++] = v;
+        }
+        work[i] = localOf[v];
+    }
+    free(localOf);
+
+    size_t n = s.vertexCount;
+    s.positions = malloc(n * 3 * sizeof(float));
+    s.remap = malloc(n * sizeof(uint32_t));
+    s.wedge = malloc(n * sizeof(uint32_t));
+    s.kind = malloc(n);
+    s.openIn = malloc(n * sizeof(uint32_t));
+    s.openOut = malloc(n * sizeof(uint32_t));
+    s.quadrics = malloc(n * sizeof(Quadric));
+    s.edgeOffsets = malloc((n + 1) * sizeof(uint32_t));
+    s.edges = malloc(indexCount * sizeof(HalfEdge));
+    uint32_t* collapseRemap = malloc(n * sizeof(uint32_t));
+    unsigned char* locked = malloc(n);
+    Collapse* collapses = malloc(indexCount * sizeof(Collapse));
+
+    size_t count = indexCount;
+    float maxError = 0.0f;
+    if (s.positions && s.remap && s.wedge && s.kind && s.openIn && s.openOut && s.quadrics &&
+        s.edgeOffsets && s.edges && collapseRemap && locked && collapses) {
+        for (size_t v = 0; v < n; ++v) memcpy(&s.positions[v * 3], &vertices[globalOf[v] * stride], 3 * sizeof(float));
+
+        if (buildPositionRemap(&s) == 0) {
+            buildAdjacency(&s, work, count);
+            classifyVertices(&s);
+            buildQuadrics(&s, work, count);
+
+            float errorLimit = targetError * targetError;
+            for (int pass = 0; pass < SIMPLIFY_MAX_PASSES && count > targetIndexCount; ++pass) {
+                if (pass > 0) buildAdjacency(&s, work, count);
+
+                size_t candidateCount = gatherCollapses(&s, work, count, collapses);
+                qsort(collapses, candidateCount, sizeof(Collapse), compareCollapses);
+
+                for (size_t v = 0; v < n; ++v) collapseRemap[v] = (uint32_t)v;
+                memset(locked, 0, n);
+
+                // Manifold and seam collapses remove two triangles, border collapses one
+                size_t removable = (count - targetIndexCount) / 3;
+                size_t removed = 0, applied = 0;
+                for (size_t i = 0; i < candidateCount && removed < removable; ++i) {
+                    const Collapse* c = &collapses[i];
+                    if (c->error > errorLimit) break;
+                    if (locked[s.remap[c->from]] || locked[s.remap[c->to]]) continue;
+
+                    int seam = s.kind[c->from] == KIND_SEAM;
+                    if (collapseFlips(&s, c->from, c->to) || (seam && collapseFlips(&s, s.wedge[c->from], c->to))) {
+                        continue;
+                    }
+
+                    // Neighbours are locked too so later collapses this pass see current positions
+                    lockRing(&s, c->from, locked);
+                    if (seam) lockRing(&s, s.wedge[c->from], locked);
+                    locked[s.remap[c->to]] = 1;
+
+                    collapseRemap[c->from] = c->to;
+                    if (seam) collapseRemap[s.wedge[c->from]] = s.wedge[c->to];
+                    quadricAdd(&s.quadrics[s.remap[c->to]], &s.quadrics[s.remap[c->from]]);
+
+                    removed += (s.kind[c->from] == KIND_BORDER) ? 1 : 2;
+                    applied++;
+                    if (c->error > maxError) maxError = c->error;
+                }
+                if (applied == 0) break;
+
+                size_t write = 0;
+                for (size_t i = 0; i < count; i += 3) {
+                    uint32_t a = collapseRemap[work[i]];
+                    uint32_t b = collapseRemap[work[i + 1]];
+                    uint32_t c = collapseRemap[work[i + 2]];
+                    if (s.remap[a] == s.remap[b] || s.remap[b] == s.remap[c] || s.remap[a] == s.remap[c]) continue;
+                    work[write++] = a;
+                    work[write++] = b;
+                    work[write++] = c;
+                }
+                count = write;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < count; ++i) destination[i] = globalOf[work[i]];
+    if (resultError) *resultError = sqrtf(maxError);
+
+    free(s.positions);
+    free(s.remap);
+    free(s.wedge);
+    free(s.kind);
+    free(s.openIn);
+    free(s.openOut);
+    free(s.quadrics);
+    free(s.edgeOffsets);
+    free(s.edges);
+    free(collapseRemap);
+    free(locked);
+    free(collapses);
+    free(globalOf);
+    free(work);
+    return count;
+}
+
+int MeshSimplifier_BuildLods(ObjMesh* mesh, int levelCount, const char* name) {
+    if (!mesh || !mesh->elements || mesh->submesh_count == 0) return 0;
+    if (levelCount > OBJ_MAX_LODS) levelCount = OBJ_MAX_LODS;
+
+    double startTime = GetTimeSeconds();
+    size_t baseIndices = 0, largestRange = 0;
+    for (size_t s = 0; s < mesh->submesh_count; ++s) {
+        baseIndices += mesh->submeshes[s].indexCount;
+        if (mesh->submeshes[s].indexCount > largestRange) largestRange = mesh->submeshes[s].indexCount;
+    }
+    uint32_t* scratch = malloc(largestRange * sizeof(uint32_t) + 1);
+    if (!scratch) return 2;
+
+    float errorLimit = MESH_LOD_MAX_ERROR * mesh->bounds_radius;
+    const ObjSubmesh* previous = mesh->submeshes;
+    size_t previousIndices = baseIndices;
+    float previousError = 0.0f;
+
+    for (int level = 0; level < levelCount; ++level) {
+        // A level never has more indices than the one it is simplified from
+        uint32_t* grown = realloc(mesh->elements, (mesh->element_count + previousIndices) * sizeof(uint32_t));
+        ObjSubmesh* submeshes = malloc(mesh->submesh_count * sizeof(ObjSubmesh));
+        if (grown) mesh->elements = grown;
+        if (!grown || !submeshes) {
+            free(submeshes);
+            free(scratch);
+            fprintf(stderr, "[LOD] Out of memory simplifying %s\n", name);
+            return 2;
+        }
+
+        size_t levelStart = mesh->element_count;
+        size_t levelIndices = 0;
+        float levelError = 0.0f;
+        for (size_t s = 0; s < mesh->submesh_count; ++s) {
+            const uint32_t* source = &mesh->elements[previous[s].firstIndex];
+            size_t target = (size_t)((float)(previous[s].indexCount / 3) * MESH_LOD_REDUCTION) * 3;
+            float error = 0.0f;
+            size_t count = MeshSimplifier_Simplify(scratch, source, previous[s].indexCount, mesh->unique_vertices,
+                                                   mesh->unique_vertex_count, FLOATS_PER_VERTEX, target,
+                                                   errorLimit, &error);
+
+            uint32_t* destination = &mesh->elements[mesh->element_count];
+            if (MeshOptimizer_OptimizeVertexCache(destination, scratch, count, mesh->unique_vertex_count)) {
+                memcpy(destination, scratch, count * sizeof(uint32_t));
+            }
+            submeshes[s] = previous[s];
+            submeshes[s].firstIndex = (uint32_t)mesh->element_count;
+            submeshes[s].indexCount = (uint32_t)count;
+            mesh->element_count += count;
+            levelIndices += count;
+            if (error > levelError) levelError = error;
+        }
+
+        if ((float)levelIndices > (float)previousIndices * (1.0f - MESH_LOD_MIN_REDUCTION)) {
+            // Hit the error limit (or locked geometry) before getting meaningfully smaller
+            mesh->element_count = levelStart;
+            free(submeshes);
+            break;
+        }
+
+        ObjLod* lod = &mesh->lods[mesh->lod_count++];
+        lod->submeshes = submeshes;
+        lod->error = previousError + levelError;
+        printf("[LOD] %s: level %zu has %zu triangles (%.0f%% of base), error %.4f (radius %.2f)\n", name,
+               mesh->lod_count, levelIndices / 3, 100.0 * (double)levelIndices / (double)baseIndices, lod->error,
+               mesh->bounds_radius);
+
+        previous = submeshes;
+        previousIndices = levelIndices;
+        previousError = lod->error;
+    }
+    free(scratch);
+
+    printf("[LOD] %s: %zu levels built in %.1f ms\n", name, mesh->lod_count, (GetTimeSeconds() - startTime) * 1000.0);
+    return 0;
+}
@@ -0,0 +1,30 @@
+#ifndef MESH_SIMPLIFIER_H
+#define MESH_SIMPLIFIER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "OBJ_file_loader.h"
+
+// Simplified levels generated per mesh, each aiming at this fraction of the previous level's triangles
+#define MESH_LOD_LEVELS 3
+#define MESH_LOD_REDUCTION 0.5f
+// A level may deviate from the one before by at most this fraction of the mesh radius
+#define MESH_LOD_MAX_ERROR 0.05f
+// Levels that remove fewer triangles than this fraction are dropped and end the chain
+#define MESH_LOD_MIN_REDUCTION 0.1f
+
+// Quadric edge-collapse simplification (Garland & Heckbert) of a triangle list. Vertices are
+// only removed, never moved, so the result indexes the same vertex buffer. Vertices split by
+// UV or normal seams collapse only along the seam, together with their twin on the other side,
+// and open borders only along the border. Stops at targetIndexCount or when the next collapse
+// would move the surface more than targetError (object units). destination may equal indices.
+// Returns the new index count; *resultError (may be NULL) receives the largest error made.
+size_t MeshSimplifier_Simplify(uint32_t* destination, const uint32_t* indices, size_t indexCount,
+                               const float* vertices, size_t vertexCount, size_t stride,
+                               size_t targetIndexCount, float targetError, float* resultError);
+
+// Appends up to levelCount simplified levels of every submesh to mesh->elements and fills
+// mesh->lods (run after MeshOptimizer_OptimizeMesh). Returns 0 on success, 2 when out of memory.
+int MeshSimplifier_BuildLods(ObjMesh* mesh, int levelCount, const char* name);
+
+#endif
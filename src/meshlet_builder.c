@@ -0,0 +1,286 @@
+#include "meshlet_builder.h"
+#include "mesh_optimizer.h"
+#include "time_utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stdbool.h>
+
+// Sphere around the cluster's vertices and the cone of its triangle normals.
+static void computeBounds(ObjMeshlet* meshlet, const uint32_t* indices, const float* vertices, size_t stride) {
+    const uint32_t* triangles = &indices[meshlet->firstIndex];
+    float lo[3] = {INFINITY, INFINITY, INFINITY};
+    float hi[3] = {-INFINITY, -INFINITY, -INFINITY};
+    float axis[3] = {0.0f, 0.0f, 0.0f};
+    for (uint32_t i = 0; i < meshlet->indexCount; i += 3) {
+        const float* a = &vertices[triangles[i] * stride];
+        const float* b = &vertices[triangles[i + 1] * stride];
+        const float* c = &vertices[triangles[i + 2] * stride];
+        for (int k = 0; k < 3; ++k) {
+            lo[k] = fminf(lo[k], fminf(a[k], fminf(b[k], c[k])));
+            hi[k] = fmaxf(hi[k], fmaxf(a[k], fmaxf(b[k], c[k])));
+        }
+
+        float e1[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+        float e2[3] = {c[0] - a[0], c[1] - a[1], c[2] - a[2]};
+        float n[3] = {e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0]};
+        float length = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        if (length > 0.0f) {
+            axis[0] += n[0] / length;
+            axis[1] += n[1] / length;
+            axis[2] += n[2] / length;
+        }
+    }
+
+    float radius = 0.0f;
+    for (int k = 0; k < 3; ++k) meshlet->center[k] = (lo[k] + hi[k]) * 0.5f;
+    for (uint32_t i = 0; i < meshlet->indexCount; ++i) {
+        const float* p = &vertices[triangles[i] * stride];
+        float dx = p[0] - meshlet->center[0];
+        float dy = p[1] - meshlet->center[1];
+        float dz = p[2] - meshlet->center[2];
+        float d = dx * dx + dy * dy + dz * dz;
+        if (d > radius) radius = d;
+    }
+    meshlet->radius = sqrtf(radius);
+
+    // The widest normal sets the cone; degenerate triangles face nowhere and are ignored
+    float axisLength = sqrtf(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+    meshlet->coneAxis[0] = meshlet->coneAxis[1] = meshlet->coneAxis[2] = 0.0f;
+    meshlet->coneCutoff = 1.0f;
+    if (axisLength == 0.0f) return;
+    for (int k = 0; k < 3; ++k) meshlet->coneAxis[k] = axis[k] / axisLength;
+
+    float minDot = 1.0f;
+    for (uint32_t i = 0; i < meshlet->indexCount; i += 3) {
+        const float* a = &vertices[triangles[i] * stride];
+        const float* b = &vertices[triangles[i + 1] * stride];
+        const float* c = &vertices[triangles[i + 2] * stride];
+        float e1[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+        float e2[3] = {c[0] - a[0], c[1] - a[1], c[2] - a[2]};
+        float n[3] = {e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0]};
+        float length = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        if (length == 0.0f) continue;
+        float d = (n[0] * meshlet->coneAxis[0] + n[1] * meshlet->coneAxis[1] + n[2] * meshlet->coneAxis[2]) / length;
+        if (d < minDot) minDot = d;
+    }
+    if (minDot >= MESHLET_MIN_CONE_COSINE) {
+        // Back-facing once the view direction is within 90 - acos(minDot) degrees of the axis
+        meshlet->coneCutoff = sqrtf(1.0f - minDot * minDot);
+    }
+}
+
+// Vertex -> triangle adjacency in CSR form, with a count of the triangles not yet emitted
+typedef struct {
+    uint32_t* offsets;    // vertexCount + 1
+    uint32_t* triangles;
+    uint32_t* live;
+} Adjacency;
+
+static int buildAdjacency(Adjacency* adjacency, const uint32_t* indices, size_t indexCount, size_t vertexCount) {
+    adjacency->offsets = calloc(vertexCount + 1, sizeof(uint32_t));
+    adjacency->triangles = malloc(indexCount * sizeof(uint32_t) + 1);
+    adjacency->live = calloc(vertexCount + 1, sizeof(uint32_t));
+    if (!adjacency->offsets || !adjacency->triangles || !adjacency->live) return 2;
+
+    for (size_t i = 0; i < indexCount; ++i) adjacency->live[indices[i]]++;
+    uint32_t sum = 0;
+    for (size_t v = 0; v < vertexCount; ++v) {
+        adjacency->offsets[v] = sum;
+        sum += adjacency->live[v];
+    }
+    adjacency->offsets[vertexCount] = sum;
+    for (size_t v = 0; v < vertexCount; ++v) adjacency->live[v] = 0;
+    for (size_t i = 0; i < indexCount; ++i) {
+        uint32_t v = indices[i];
+        adjacency->triangles[adjacency->offsets[v] + adjacency->live[v]++] = (uint32_t)(i / 3);
+    }
+    return 0;
+}
+
+static void freeAdjacency(Adjacency* adjacency) {
+    free(adjacency->offsets);
+    free(adjacency->triangles);
+    free(adjacency->live);
+}
+
+// Vertices of triangle `corner` not yet in the meshlet tagged `tag`
+static size_t newVertexCount(const uint32_t* corner, const uint32_t* stamp, uint32_t tag) {
+    return (stamp[corner[0]] != tag) + (stamp[corner[1]] != tag && corner[1] != corner[0]) +
+           (stamp[corner[2]] != tag && corner[2] != corner[0] && corner[2] != corner[1]);
+}
+
+size_t MeshletBuilder_Build(ObjMeshlet* destination, uint32_t* indices, size_t indexCount,
+                            const float* vertices, size_t vertexCount, size_t stride,
+                            size_t maxVertices, size_t maxTriangles) {
+    size_t triangleCount = indexCount / 3;
+    if (triangleCount == 0) return 0;
+
+    Adjacency adjacency;
+    // stamp[v] == meshlet number + 1 while v is in the open meshlet
+    uint32_t* stamp = calloc(vertexCount + 1, sizeof(uint32_t));
+    uint8_t* emitted = calloc(triangleCount, 1);
+    uint32_t* ordered = malloc(triangleCount * 3 * sizeof(uint32_t));
+    uint32_t* meshletVertices = malloc(maxVertices * sizeof(uint32_t));
+    if (buildAdjacency(&adjacency, indices, triangleCount * 3, vertexCount) || !stamp || !emitted || !ordered ||
+        !meshletVertices) {
+        freeAdjacency(&adjacency);
+        free(stamp);
+        free(emitted);
+        free(ordered);
+        free(meshletVertices);
+        return 0;
+    }
+
+    size_t count = 0, written = 0, seed = 0;
+    size_t openVertices = 0;
+    float lo[3] = {0.0f, 0.0f, 0.0f}, hi[3] = {0.0f, 0.0f, 0.0f};   // bounds of the open meshlet
+    ObjMeshlet* open = &destination[0];
+    open->firstIndex = 0;
+    open->indexCount = 0;
+
+    for (size_t emittedCount = 0; emittedCount < triangleCount; ++emittedCount) {
+        // Grow through shared vertices, preferring triangles that add the fewest new ones;
+        // the newest vertices are searched first and high-valence fans are cut short
+        uint32_t tag = (uint32_t)count + 1;
+        size_t best = triangleCount, bestAdded = 4, examined = 0;
+        for (size_t i = openVertices; i-- > 0 && bestAdded > 0 && examined < MESHLET_MAX_CANDIDATES;) {
+            uint32_t v = meshletVertices[i];
+            if (adjacency.live[v] == 0) continue;
+            for (uint32_t k = adjacency.offsets[v]; k < adjacency.offsets[v + 1]; ++k) {
+                uint32_t t = adjacency.triangles[k];
+                if (emitted[t]) continue;
+                size_t added = newVertexCount(&indices[t * 3], stamp, tag);
+                if (added < bestAdded || (added == bestAdded && t < best)) {
+                    best = t;
+                    bestAdded = added;
+                }
+                examined++;
+            }
+        }
+
+        bool full = open->indexCount / 3 >= maxTriangles;
+        if (best < triangleCount) {
+            full = full || openVertices + bestAdded > maxVertices;
+        } else {
+            // Nothing connected is left: continue from the earliest triangle in the input order,
+            // in the same meshlet only if it lies close to it
+            while (emitted[seed]) seed++;
+            const uint32_t* corner = &indices[seed * 3];
+            float extent = 0.0f, grown = 0.0f;
+            for (int k = 0; k < 3; ++k) {
+                float low = lo[k], high = hi[k];
+                for (int c = 0; c < 3; ++c) {
+                    const float* p = &vertices[corner[c] * stride];
+                    low = fminf(low, p[k]);
+                    high = fmaxf(high, p[k]);
+                }
+                extent += (hi[k] - lo[k]) * (hi[k] - lo[k]);
+                grown += (high - low) * (high - low);
+            }
+            full = full || openVertices + newVertexCount(corner, stamp, tag) > maxVertices ||
+                   grown > extent * MESHLET_JOIN_EXTENT_RATIO * MESHLET_JOIN_EXTENT_RATIO;
+        }
+        if (full || best == triangleCount) {
+            if (full && open->indexCount > 0) {
+                computeBounds(open, ordered, vertices, stride);
+                count++;
+                open = &destination[count];
+                open->firstIndex = (uint32_t)written;
+                open->indexCount = 0;
+                openVertices = 0;
+                tag = (uint32_t)count + 1;
+            }
+            while (emitted[seed]) seed++;
+            best = seed;
+        }
+
+        const uint32_t* corner = &indices[best * 3];
+        for (int k = 0; k < 3; ++k) {
+            uint32_t v = corner[k];
+            const float* p = &vertices[v * stride];
+            for (int c = 0; c < 3; ++c) {
+                lo[c] = (openVertices == 0) ? p[c] : fminf(lo[c], p[c]);
+                hi[c] = (openVertices == 0) ? p[c] : fmaxf(hi[c], p[c]);
+            }
+            adjacency.live[v]--;
+            if (stamp[v] != tag) {
+                stamp[v] = tag;
+                meshletVertices[openVertices++] = v;
+            }
+            ordered[written++] = v;
+        }
+        emitted[best] = 1;
+        open->indexCount += 3;
+    }
+    computeBounds(open, ordered, vertices, stride);
+    count++;
+
+    memcpy(indices, ordered, written * sizeof(uint32_t));
+    freeAdjacency(&adjacency);
+    free(stamp);
+    free(emitted);
+    free(ordered);
+    free(meshletVertices);
+    return count;
+}
+
+// Builds the clusters of submeshes[0..submeshCount) into mesh->meshlets starting at *count.
+static void buildRanges(ObjMesh* mesh, ObjSubmesh* submeshes, size_t* count) {
+    for (size_t s = 0; s < mesh->submesh_count; ++s) {
+        ObjSubmesh* submesh = &submeshes[s];
+        ObjMeshlet* destination = &mesh->meshlets[*count];
+        size_t built = MeshletBuilder_Build(destination, &mesh->elements[submesh->firstIndex], submesh->indexCount,
+                                            mesh->unique_vertices, mesh->unique_vertex_count, FLOATS_PER_VERTEX,
+                                            MESHLET_MAX_VERTICES, MESHLET_MAX_TRIANGLES);
+        for (size_t i = 0; i < built; ++i) destination[i].firstIndex += submesh->firstIndex;
+        submesh->firstMeshlet = (uint32_t)*count;
+        submesh->meshletCount = (uint32_t)built;
+        *count += built;
+    }
+}
+
+int MeshletBuilder_BuildMeshlets(ObjMesh* mesh, const char* name) {
+    if (!mesh || !mesh->elements || mesh->submesh_count == 0) return 0;
+
+    double startTime = GetTimeSeconds();
+    // Every meshlet holds at least one triangle
+    size_t capacity = mesh->element_count / 3 + 1;
+    free(mesh->meshlets);
+    mesh->meshlet_count = 0;
+    mesh->meshlets = malloc(capacity * sizeof(ObjMeshlet));
+    if (!mesh->meshlets) {
+        fprintf(stderr, "[Meshlets] Out of memory clustering %s\n", name);
+        return 2;
+    }
+
+    const ObjSubmesh* last = &mesh->submeshes[mesh->submesh_count - 1];
+    size_t baseIndices = last->firstIndex + last->indexCount;
+    VertexCacheStats before = MeshOptimizer_AnalyzeVertexCache(mesh->elements, baseIndices, mesh->unique_vertex_count,
+                                                               MESH_OPTIMIZER_FIFO_SIZE);
+    size_t count = 0;
+    buildRanges(mesh, mesh->submeshes, &count);
+    size_t baseCount = count;
+    for (size_t level = 0; level < mesh->lod_count; ++level) {
+        buildRanges(mesh, mesh->lods[level].submeshes, &count);
+    }
+
+    ObjMeshlet* shrunk = realloc(mesh->meshlets, (count + 1) * sizeof(ObjMeshlet));
+    if (shrunk) mesh->meshlets = shrunk;
+    mesh->meshlet_count = count;
+
+    VertexCacheStats after = MeshOptimizer_AnalyzeVertexCache(mesh->elements, baseIndices, mesh->unique_vertex_count,
+                                                              MESH_OPTIMIZER_FIFO_SIZE);
+    size_t baseTriangles = 0, withCone = 0;
+    for (size_t i = 0; i < baseCount; ++i) {
+        baseTriangles += mesh->meshlets[i].indexCount / 3;
+        if (mesh->meshlets[i].coneCutoff < 1.0f) withCone++;
+    }
+    printf("[Meshlets] %s: %zu clusters at level 0 (%.1f triangles each, %.0f%% with a usable normal cone), "
+           "%zu over all levels, ACMR %.3f -> %.3f, built in %.1f ms\n", name, baseCount,
+           baseCount ? (double)baseTriangles / (double)baseCount : 0.0,
+           baseCount ? 100.0 * (double)withCone / (double)baseCount : 0.0, count, before.acmr, after.acmr,
+           (GetTimeSeconds() - startTime) * 1000.0);
+    return 0;
+}
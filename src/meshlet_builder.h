@@ -0,0 +1,31 @@
+#ifndef MESHLET_BUILDER_H
+#define MESHLET_BUILDER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "OBJ_file_loader.h"
+
+// Cluster limits; they match what mesh-shader hardware handles per workgroup
+#define MESHLET_MAX_VERTICES 64
+#define MESHLET_MAX_TRIANGLES 124
+// Cones wider than this (cosine of the half angle from the axis) are not worth testing
+#define MESHLET_MIN_CONE_COSINE 0.1f
+// Candidate triangles examined per growth step; bounds the cost on high-valence vertices
+#define MESHLET_MAX_CANDIDATES 256
+// A triangle not connected to the meshlet joins it only if the bounds diagonal grows at most this much
+#define MESHLET_JOIN_EXTENT_RATIO 2.0f
+
+// Splits a triangle list into clusters of at most maxVertices unique vertices and maxTriangles
+// triangles. Each cluster grows across shared vertices from the earliest triangle left, and the
+// triangles are rewritten in cluster order so every cluster is a contiguous range of indices.
+// vertices is pos(3), normal(3)... with `stride` floats. Writes at most indexCount / 3 meshlets
+// whose firstIndex is relative to indices and returns how many were written (0 when out of memory).
+size_t MeshletBuilder_Build(ObjMeshlet* destination, uint32_t* indices, size_t indexCount,
+                            const float* vertices, size_t vertexCount, size_t stride,
+                            size_t maxVertices, size_t maxTriangles);
+
+// Fills mesh->meshlets for the ranges of every level (run after MeshSimplifier_BuildLods)
+// and sets firstMeshlet / meshletCount on the submeshes. Returns 0 on success, 2 when out of memory.
+int MeshletBuilder_BuildMeshlets(ObjMesh* mesh, const char* name);
+
+#endif
@@ -0,0 +1,167 @@
+#include "mtl_loader.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <sys/stat.h>
+
+static int fileExists(const char* path) {
+    struct stat st;
+    return stat(path, &st) == 0 && (st.st_mode & S_IFMT) == S_IFREG;
+}
+
+static char* trim(char* s) {
+    while (*s == ' ' || *s == '\t') s++;
+    size_t len = strlen(s);
+    while (len > 0 && isspace((unsigned char)s[len - 1])) s[--len] = '\0';
+    return s;
+}
+
+// Option arguments are numbers, on/off or single channel letters (-imfchan r).
+static int isOptionArgument(const char* token, size_t length) {
+    if (length == 1 && isalpha((unsigned char)token[0])) return 1;
+    if ((length == 2 && strncmp(token, "on", 2) == 0) || (length == 3 && strncmp(token, "off", 3) == 0)) return 1;
+    char* end;
+    strtod(token, &end);
+    return end == token + length;
+}
+
+// Skips "-bm 0.3 -o 0 0 0" style options in front of a map file name.
+static const char* skipMapOptions(const char* s) {
+    while (*s == '-') {
+        s += strcspn(s, " \t");
+        for (;;) {
+            s += strspn(s, " \t");
+            size_t length = strcspn(s, " \t");
+            if (length == 0 || *s == '-' || !isOptionArgument(s, length)) break;
+            s += length;
+        }
+    }
+    return s;
+}
+
+// Writes directory + prefix + name to out. Returns 0 when the path does not fit; a
+// truncated path could name a different file.
+static int joinPath(char* out, size_t outSize, const char* directory, const char* prefix, const char* name) {
+    int length = snprintf(out, outSize, "%s%s%s", directory, prefix, name);
+    return length >= 0 && (size_t)length < outSize;
+}
+
+// Exporters write whatever path the texture had on the artist's machine
+// (e.g. "D:\modes\...\Rock_01_01_Diffuse.png"), so besides the path as written
+// the file name is also looked up next to the .mtl and in its textures folder.
+static void resolveMapPath(const char* directory, const char* rawPath, char* out, size_t outSize) {
+    char path[MTL_MAX_PATH];
+    if (!joinPath(path, sizeof(path), "", "", skipMapOptions(rawPath))) {
+        fprintf(stderr, "[MTL] Texture path too long: %s\n", rawPath);
+        out[0] = '\0';
+        return;
+    }
+    for (char* c = path; *c; ++c) {
+        if (*c == '\\') *c = '/';
+    }
+    const char* slash = strrchr(path, '/');
+    const char* name = slash ? slash + 1 : path;
+    int absolute = path[0] == '/' || (path[0] && path[1] == ':');
+    const char* prefixes[] = {"", "textures/", "Textures/"};
+
+    if (name[0] == '\0') {
+        out[0] = '\0';
+        return;
+    }
+    if (!absolute && joinPath(out, outSize, directory, "", path) && fileExists(out)) return;
+    for (size_t i = 0; i < sizeof(prefixes) / sizeof(prefixes[0]); ++i) {
+        if (joinPath(out, outSize, directory, prefixes[i], name) && fileExists(out)) return;
+    }
+    out[0] = '\0';
+    fprintf(stderr, "[MTL] Texture not found: %s\n", path);
+}
+
+static ObjMaterial* addMaterial(MaterialLibrary* library, int* capacity, const char* name) {
+    if (library->count >= *capacity) {
+        int newCapacity = (*capacity == 0) ? 8 : *capacity * 2;
+        ObjMaterial* grown = realloc(library->materials, (size_t)newCapacity * sizeof(ObjMaterial));
+        if (!grown) return NULL;
+        library->materials = grown;
+        *capacity = newCapacity;
+    }
+    ObjMaterial* material = &library->materials[library->count++];
+    memset(material, 0, sizeof(*material));
+    snprintf(material->name, sizeof(material->name), "%s", name);
+    return material;
+}
+
+int LoadMTL(const char* filename, MaterialLibrary* library) {
+    library->materials = NULL;
+    library->count = 0;
+
+    FILE* f = fopen(filename, "r");
+    if (!f) {
+        fprintf(stderr, "[MTL] Failed to open %s\n", filename);
+        return 1;
+    }
+
+    // Map paths are relative to the folder of the .mtl
+    char directory[MTL_MAX_PATH];
+    if (!joinPath(directory, sizeof(directory), "", "", filename)) {
+        fprintf(stderr, "[MTL] Path too long: %s\n", filename);
+        fclose(f);
+        return 1;
+    }
+    char* slash = strrchr(directory, '/');
+    char* backslash = strrchr(directory, '\\');
+    if (backslash && (!slash || backslash > slash)) slash = backslash;
+    if (slash) slash[1] = '\0';
+    else directory[0] = '\0';
+
+    int capacity = 0;
+    ObjMaterial* current = NULL;
+    char line[1024];
+    while (fgets(line, sizeof(line), f)) {
+        char* s = trim(line);
+        size_t keywordLength = strcspn(s, " \t");
+        char* value = trim(s + keywordLength);
+        s[keywordLength] = '\0';
+
+        if (strcmp(s, "newmtl") == 0) {
+            current = addMaterial(library, &capacity, value);
+            if (!current) {
+                fprintf(stderr, "[MTL] Out of memory reading %s\n", filename);
+                fclose(f);
+                FreeMaterialLibrary(library);
+                return 2;
+            }
+        } else if (!current) {
+            continue;
+        } else if (strcmp(s, "map_Kd") == 0) {
+            resolveMapPath(directory, value, current->diffuseMap, sizeof(current->diffuseMap));
+        } else if (strcmp(s, "map_bump") == 0 || strcmp(s, "map_Bump") == 0 ||
+                   strcmp(s, "bump") == 0 || strcmp(s, "norm") == 0) {
+            if (current->normalMap[0] == '\0') {
+                resolveMapPath(directory, value, current->normalMap, sizeof(current->normalMap));
+            }
+        } else if (strcmp(s, "map_Pr") == 0) {
+            resolveMapPath(directory, value, current->roughnessMap, sizeof(current->roughnessMap));
+        } else if (strcmp(s, "map_Pm") == 0) {
+            resolveMapPath(directory, value, current->metalnessMap, sizeof(current->metalnessMap));
+        }
+    }
+    fclose(f);
+
+    printf("[MTL] %s: %d materials\n", filename, library->count);
+    return 0;
+}
+
+void FreeMaterialLibrary(MaterialLibrary* library) {
+    if (!library) return;
+    free(library->materials);
+    library->materials = NULL;
+    library->count = 0;
+}
+
+const ObjMaterial* FindMaterial(const MaterialLibrary* library, const char* name) {
+    for (int i = 0; i < library->count; ++i) {
+        if (strcmp(library->materials[i].name, name) == 0) return &library->materials[i];
+    }
+    return NULL;
+}
@@ -0,0 +1,29 @@
+#ifndef MTL_LOADER_H
+#define MTL_LOADER_H
+
+#define MTL_MAX_NAME 64
+#define MTL_MAX_PATH 260
+
+// One `newmtl` block. Map paths are resolved against the .mtl folder when loading;
+// an empty string means the map is absent or its file could not be found.
+typedef struct {
+    char name[MTL_MAX_NAME];
+    char diffuseMap[MTL_MAX_PATH];     // map_Kd
+    char normalMap[MTL_MAX_PATH];      // map_bump, bump or norm
+    char roughnessMap[MTL_MAX_PATH];   // map_Pr
+    char metalnessMap[MTL_MAX_PATH];   // map_Pm
+} ObjMaterial;
+
+typedef struct {
+    ObjMaterial* materials;
+    int count;
+} MaterialLibrary;
+
+// Returns 0 on success. The library must be freed with FreeMaterialLibrary.
+int LoadMTL(const char* filename, MaterialLibrary* library);
+void FreeMaterialLibrary(MaterialLibrary* library);
+
+// Returns the material called name, or NULL.
+const ObjMaterial* FindMaterial(const MaterialLibrary* library, const char* name);
+
+#endif
@@ -1,5 +1,6 @@
 
 #include "object_manager.h"
+#include <stdlib.h>
 #include <gl/gl.h>
 #include "matrix_utils.h"
 void ObjectVector_Init(ObjectVector* vec){
@@ -20,15 +21,49 @@ void ObjectVector_Push(ObjectVector* vec, RenderableObject obj){
     vec->data[vec->size++] = obj;
 }
 void ObjectVector_Free(ObjectVector* vec){
+    for (int i = 0; i < vec->size; ++i) {
+        RenderableObject* obj = &vec->data[i];
+        for (int r = 0; r < obj->resourceCount; ++r) ResourceManager_Release(obj->resources[r]);
+        free(obj->resources);
+        free(obj->submeshes);
+    }
     free(vec->data);
     vec->data = NULL;
     vec->size = 0;
     vec->capacity = 0;
 }
 RenderableObject CreateRenderableObject(GLuint vao, int vertexCount, float x, float y, float z) {
-    RenderableObject obj;
+    RenderableObject obj = {0};
     obj.vao = vao;
     obj.vertexCount = vertexCount;
+    obj.vertexEncoding = VERTEX_ENCODING_FLOAT;
+    VertexFormat_IdentityQuantization(&obj.quantization);
     CreateTranslationMatrix(x, y, z, obj.modelMatrix); 
     return obj;
-}
\ No newline at end of file
+}
+
+int RenderableObject_AddResource(RenderableObject* obj, ResourceHandle handle) {
+    if (handle.generation == 0) return 0;
+    // Capacity is the next power of two of the count, at least 4
+    int count = obj->resourceCount;
+    if (count == 0 || (count >= 4 && (count & (count - 1)) == 0)) {
+        int capacity = count ? count * 2 : 4;
+        ResourceHandle* grown = realloc(obj->resources, (size_t)capacity * sizeof(ResourceHandle));
+        if (!grown) {
+            ResourceManager_Release(handle);
+            return 2;
+        }
+        obj->resources = grown;
+    }
+    obj->resources[obj->resourceCount++] = handle;
+    return 0;
+}
+
+void RenderableObject_RemoveResource(RenderableObject* obj, ResourceHandle handle) {
+    for (int i = 0; i < obj->resourceCount; ++i) {
+        if (obj->resources[i].index != handle.index || obj->resources[i].generation != handle.generation) continue;
+        ResourceManager_Release(handle);
+        obj->resources[i] = obj->resources[--obj->resourceCount];
+        return;
+    }
+}
@@ -2,18 +2,73 @@
 #include <GL/gl.h>
 #include <stddef.h>
 #include <stdbool.h>
+#include "vertex_format.h"
+#include "resource_manager.h"
+
+// Simplified levels an object can carry after its base mesh
+#define OBJECT_MAX_LODS 4
+
+// Where a texture moved into a texture array is drawn from: a layer, and the part of the
+// layer it covers as a scale and offset of the texture coordinates (atlas pages hold several).
+typedef struct {
+    GLuint arrayID;         // 0 = the 2D texture is drawn
+    float layer;
+    float uvTransform[4];   // scale x, y, offset x, y
+} TextureLayer;
+
+// One material's index range within the object's element buffer.
+typedef struct {
+    int firstIndex;
+    int indexCount;
+    GLuint textureID;
+    GLuint normalID;
+    GLuint ormID;       // occlusion, roughness, metalness in R, G, B
+    TextureLayer layers[3];   // of the texture, normal and ORM maps
+    int firstMeshlet;   // into RenderableObject.meshlets
+    int meshletCount;   // 0 = draw the whole range
+} Submesh;
+
+// Cluster of a submesh range, culled against the frustum and by its normal cone.
+typedef struct {
+    int firstIndex;
+    int indexCount;
+    float center[3];      // bounding sphere, object space
+    float radius;
+    float coneAxis[3];
+    float coneCutoff;     // >= 1: may face the camera from any direction
+} Meshlet;
+
 typedef struct {
     GLuint vao;
     int vertexCount;
+    int indexCount;     // 0 = draw vertexCount vertices with glDrawArrays
+    GLenum indexType;   // GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
     float modelMatrix[16];
     
     GLuint textureID;
     GLuint normalID;
-    GLuint roughnessID;
-    GLuint metalnessID;
-    GLuint aoID;
+    GLuint ormID;         // occlusion, roughness, metalness in R, G, B; 0 = defaults
+    TextureLayer layers[3];   // of the texture, normal and ORM maps
 
     bool castsShadows;
+    bool doubleSided;     // back faces are visible, so clusters are never cone culled
+
+    Submesh* submeshes;   // owned, (lodCount + 1) * submeshCount level by level; NULL = one draw
+    int submeshCount;     // per level
+
+    int lodCount;                        // simplified levels after the base mesh
+    float lodErrors[OBJECT_MAX_LODS];    // object-space error of each simplified level
+    float boundsCenter[3];               // object space
+    float boundsRadius;
+
+    Meshlet* meshlets;    // of the mesh resource, referenced by the submeshes of every level
+    int meshletCount;
+
+    ResourceHandle* resources;   // owned references to the mesh and textures drawn
+    int resourceCount;
+
+    VertexEncoding vertexEncoding;      // how the vertex shader decodes the VAO's attributes
+    VertexQuantization quantization;    // position/UV ranges of packed layouts
 
 } RenderableObject;
 
@@ -27,3 +82,8 @@ void ObjectVector_Init(ObjectVector* vec);
 void ObjectVector_Push(ObjectVector* vec, RenderableObject obj);
 void ObjectVector_Free(ObjectVector* vec);
 RenderableObject CreateRenderableObject(GLuint vao, int vertexCount, float x, float y, float z);
+// Hands a reference to the object, released with it. Empty handles are skipped. Returns 0 on
+// success, 2 when out of memory, in which case the reference is released right away.
+int RenderableObject_AddResource(RenderableObject* obj, ResourceHandle handle);
+// Releases the object's reference to the resource, if it holds one.
+void RenderableObject_RemoveResource(RenderableObject* obj, ResourceHandle handle);
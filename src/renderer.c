@@ -6,6 +6,8 @@
 #include <stddef.h>
 #include <stdbool.h>
 #include <math.h>
+#include <float.h>
+#include <string.h>
 #include <stdio.h>
 #include "renderer.h"
 #include "gl_loader.h"
@@ -20,6 +22,20 @@
 #include "scene_loader.h"
 #include <GL/glu.h>
 #include "texture_utils.h"
+#include "texture_loader.h"
+#include "texture_packer.h"
+#include "texture_streamer.h"
+#include "texture_array.h"
+#include "user_input.h"
+#include "asset_pack.h"
+#include "resource_manager.h"
+
+// Coarsest level whose simplification error projects to at most this many pixels
+#define LOD_PIXEL_ERROR_THRESHOLD 1.0f
+// Normal cones are only tested when the model's axis scales differ by less than this ratio
+#define CULL_UNIFORM_SCALE_TOLERANCE 1.01f
+
+extern UserInput g_input;
 
 static ObjMesh terrainMesh = {0};
 static ObjMesh treeMesh = {0};
@@ -40,6 +56,13 @@ static GLint uniformProjectionLoc = -1;
 static GLint uniformModelLoc = -1;
 static GLint uniformViewLoc = -1;
 static GLint uniformCastsShadowsLoc = -1;
+static GLint uniformVertexEncodingLoc = -1;
+static GLint uniformPositionScaleLoc = -1;
+static GLint uniformPositionOffsetLoc = -1;
+static GLint uniformTexCoordScaleLoc = -1;
+static GLint uniformTexCoordOffsetLoc = -1;
+static GLint uniformLayersLoc = -1;
+static GLint uniformLayerTransformsLoc = -1;
 float projectionMatrix[16];
 float viewMatrix[16];
 
@@ -48,7 +71,78 @@ float lightColor[3] = {0.0f, 1.01f, 1.0f};
 
 static ObjectVector objects; 
 
+// GPU uploads of the scene loader get this much of each frame until the scene is complete
+#define SCENE_UPLOAD_BUDGET_SECONDS 0.004
+static bool sceneLoading = false;
+
+// LOD selection can be toggled with L to compare triangle counts and frame times. The
+// frames since the last L or C toggle are summed and reported when either key is pressed.
+static bool lodEnabled = true;
+static bool lodKeyWasDown = false;
+static double lodStatsTime = 0.0;
+static int lodStatsFrames = 0;
+static size_t lodStatsTriangles = 0;
+static size_t lodStatsFullTriangles = 0;
+
+// Triangle and cluster counts of the culling pass, summed over frames
+typedef struct {
+    size_t lodTriangles;         // in the selected level of every object
+    size_t objectTriangles;      // left after culling whole objects against the frustum
+    size_t submittedTriangles;   // left after culling clusters by frustum and normal cone
+    size_t frustumClusters;
+    size_t coneClusters;
+    size_t culledObjects;
+    size_t textureBinds;
+} CullStats;
+
+// Frustum and camera moved into one object's space, so clusters are tested untransformed
+typedef struct {
+    float planes[6][4];   // dot(plane.xyz, p) + plane.w is the world distance of object point p
+    float scale;          // largest axis scale of the model matrix
+    float camera[3];
+    bool coneTest;        // off for double-sided objects and non-uniform scale
+} CullFrame;
+
+// Clusters are culled on the CPU before the range draws; C toggles it, P plays the camera path
+static bool cullingEnabled = true;
+static bool cullKeyWasDown = false;
+static bool pathKeyWasDown = false;
+static bool pathRecording = false;
+static int pathFrames = 0;
+static double pathSeconds = 0.0;
+static CullStats pathStats;
+static CullStats intervalStats;
+
+// Visible cluster runs of one submesh, handed to glMultiDrawElements
+static GLsizei* runCounts = NULL;
+static const void** runOffsets = NULL;
+static int runCapacity = 0;
+
 GLuint emptyTexture;
+// Bound for objects and materials without occlusion, roughness or metalness maps
+static GLuint defaultOrmTexture;
+
+// The texture, normal and ORM maps sample units 0-2, or units 3-5 when they are layers of
+// texture arrays; samplers of different types cannot share a unit
+#define MATERIAL_MAP_COUNT 3
+#define ARRAY_TEXTURE_UNIT 3
+// What the units and layer uniforms hold during a frame, so draws only change what differs
+static GLuint boundTextures[ARRAY_TEXTURE_UNIT + MATERIAL_MAP_COUNT];
+static float boundLayers[MATERIAL_MAP_COUNT];
+static float boundLayerTransforms[MATERIAL_MAP_COUNT * 4];
+static bool boundLayersValid = false;
+// Face culling the last draw set: -1 unknown, 0 off, else GL_CCW or GL_CW front faces
+static GLint boundFrontFace = -1;
+
+static int HasExtension(const char* name) {
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; ++i) {
+        const char* extension = (const char*)glGetStringi(GL_EXTENSIONS, (GLuint)i);
+        if (extension && strcmp(extension, name) == 0) return 1;
+    }
+    return 0;
+}
 
 void Renderer_Init(void) {
 
@@ -74,8 +168,17 @@ void Renderer_Init(void) {
     // }
     ObjectVector_Init(&objects);
 
-    LoadSceneFromFile("assets/scene.json", &objects);
-    printf("Number of objects loaded: %d\n", objects.size);
+    // BC4 and BC5 are core, but BC1 and BC3 come with S3TC; without it textures stay uncompressed
+    if (!HasExtension("GL_EXT_texture_compression_s3tc")) {
+        printf("[Renderer] No S3TC support, textures are not block compressed\n");
+        TextureCache_SetBlockCompression(0);
+    }
+
+    // A pack written by `cook -p` replaces the loose cooked files; with texture streaming off
+    // everything it holds is on the GPU once the scene is loaded. Objects appear as the loader threads finish them.
+    AssetPack_Mount(ASSET_PACK_DEFAULT_PATH);
+    sceneLoading = SceneLoader_Begin("assets/scene.json") == 0;
+    if (!sceneLoading) AssetPack_Unmount();
 
     shaderProgram = ShaderManager_CreateProgram("shaders/vertex_shader.glsl", "shaders/fragment_shader.glsl");
     if (!shaderProgram) {
@@ -87,12 +190,24 @@ void Renderer_Init(void) {
     uniformViewLoc       = ShaderManager_GetUniformLocation(shaderProgram, "uView");
     uniformModelLoc      = ShaderManager_GetUniformLocation(shaderProgram, "uModel");
     uniformCastsShadowsLoc = glGetUniformLocation(shaderProgram, "uCastsShadows");
+    uniformVertexEncodingLoc = glGetUniformLocation(shaderProgram, "uVertexEncoding");
+    uniformPositionScaleLoc = glGetUniformLocation(shaderProgram, "uPositionScale");
+    uniformPositionOffsetLoc = glGetUniformLocation(shaderProgram, "uPositionOffset");
+    uniformTexCoordScaleLoc = glGetUniformLocation(shaderProgram, "uTexCoordScale");
+    uniformTexCoordOffsetLoc = glGetUniformLocation(shaderProgram, "uTexCoordOffset");
     
-    GLint uTextureLoc = glGetUniformLocation(shaderProgram, "uTexture");
-    GLint uNormalMapLoc = glGetUniformLocation(shaderProgram, "uNormalMap");
-    GLint uRoughnessMapLoc = glGetUniformLocation(shaderProgram, "uRoughnessMap");
-    GLint uMetalnessMapLoc = glGetUniformLocation(shaderProgram, "uMetalnessMap");
-    GLint uAOMapLoc = glGetUniformLocation(shaderProgram, "uAOMap");
+    uniformLayersLoc = glGetUniformLocation(shaderProgram, "uLayers");
+    uniformLayerTransformsLoc = glGetUniformLocation(shaderProgram, "uLayerTransforms");
+
+    // Uniforms go to the program in use
+    glUseProgram(shaderProgram);
+    static const char* samplerNames[ARRAY_TEXTURE_UNIT + MATERIAL_MAP_COUNT] = {
+        "uTexture", "uNormalMap", "uORMMap", "uTextureArray", "uNormalMapArray", "uORMMapArray"
+    };
+    for (int unit = 0; unit < ARRAY_TEXTURE_UNIT + MATERIAL_MAP_COUNT; ++unit) {
+        GLint location = glGetUniformLocation(shaderProgram, samplerNames[unit]);
+        if (location != -1) glUniform1i(location, unit);
+    }
 
 
     GLint uLightDirLoc = glGetUniformLocation(shaderProgram, "uLightDir");
@@ -106,35 +221,283 @@ void Renderer_Init(void) {
         glUniform3fv(uLightDirLoc, 1, normDir);
     }
 
-    if (uNormalMapLoc != -1) {
-        glUniform1i(uNormalMapLoc, 1); 
+    emptyTexture = CreateWhiteTexture();
+    defaultOrmTexture = CreateSolidTexture(TEXTURE_ORM_DEFAULT_OCCLUSION, TEXTURE_ORM_DEFAULT_ROUGHNESS,
+                                           TEXTURE_ORM_DEFAULT_METALNESS);
+
+
+    float fovY = 45.0f * (3.1415926f / 180.0f); 
+    float aspect = 800.0f / 600.0f;
+    float nearr = 0.1f;
+    float farr = 10000.0f;
+    CreatePerspectiveProjection(fovY, aspect, nearr, farr, projectionMatrix);
+}
+
+// Triangles drawn for obj at the given level.
+static size_t ObjectTriangleCount(const RenderableObject* obj, int lod) {
+    if (obj->submeshCount == 0) {
+        return (size_t)(obj->indexCount > 0 ? obj->indexCount : obj->vertexCount) / 3;
+    }
+    size_t indices = 0;
+    for (int i = 0; i < obj->submeshCount; ++i) {
+        indices += (size_t)obj->submeshes[lod * obj->submeshCount + i].indexCount;
     }
+    return indices / 3;
+}
 
-    if (uTextureLoc != -1) {
-        glUniform1i(uTextureLoc, 0); 
+// Distance from the camera to the nearest point of the object's bounding sphere, <= 0 inside
+// it; scale is the largest axis scale of the model matrix.
+static float ObjectNearestDistance(const RenderableObject* obj, const float* cameraPosition, float* scale) {
+    const float* m = obj->modelMatrix;
+    float center[3];
+    TransformVertex(m, obj->boundsCenter, center);
+    *scale = 0.0f;
+    for (int column = 0; column < 3; ++column) {
+        const float* axis = &m[column * 4];
+        float length = sqrtf(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+        if (length > *scale) *scale = length;
     }
-    if (uRoughnessMapLoc != -1) {
-        glUniform1i(uRoughnessMapLoc, 2); 
+
+    float dx = center[0] - cameraPosition[0];
+    float dy = center[1] - cameraPosition[1];
+    float dz = center[2] - cameraPosition[2];
+    return sqrtf(dx * dx + dy * dy + dz * dz) - obj->boundsRadius * *scale;
+}
+
+// Picks the coarsest level whose error, projected at the nearest point of the object's
+// bounding sphere, stays under LOD_PIXEL_ERROR_THRESHOLD. pixelsPerUnit is the size in
+// pixels of one world unit at distance 1.
+static int SelectLod(const RenderableObject* obj, const float* cameraPosition, float pixelsPerUnit) {
+    if (obj->lodCount == 0) return 0;
+
+    float scale;
+    float distance = ObjectNearestDistance(obj, cameraPosition, &scale);
+    if (distance <= 0.0f) return 0;   // inside the bounds, e.g. the skybox
+
+    int lod = 0;
+    for (int i = 0; i < obj->lodCount; ++i) {
+        if (obj->lodErrors[i] * scale * pixelsPerUnit / distance > LOD_PIXEL_ERROR_THRESHOLD) break;
+        lod = i + 1;
     }
-    if (uMetalnessMapLoc != -1) {
-        glUniform1i(uMetalnessMapLoc, 3); 
+    return lod;
+}
+
+// Diameter in pixels of the bounding sphere projected at its nearest point. Objects without
+// bounds, or around the camera, may fill the screen.
+static float ObjectScreenSize(const RenderableObject* obj, const float* cameraPosition, float pixelsPerUnit) {
+    if (obj->boundsRadius <= 0.0f) return FLT_MAX;
+    float scale;
+    float distance = ObjectNearestDistance(obj, cameraPosition, &scale);
+    if (distance <= 0.0f) return FLT_MAX;
+    return 2.0f * obj->boundsRadius * scale * pixelsPerUnit / distance;
+}
+
+// Asks the streamer for the levels of every texture the object draws with at this size.
+static void RequestObjectTextures(const RenderableObject* obj, int lod, float screenSize) {
+    TextureStreamer_Request(obj->textureID, screenSize);
+    TextureStreamer_Request(obj->normalID, screenSize);
+    TextureStreamer_Request(obj->ormID, screenSize);
+    if (obj->submeshCount == 0) return;
+    const Submesh* levelSubmeshes = &obj->submeshes[lod * obj->submeshCount];
+    for (int i = 0; i < obj->submeshCount; ++i) {
+        TextureStreamer_Request(levelSubmeshes[i].textureID, screenSize);
+        TextureStreamer_Request(levelSubmeshes[i].normalID, screenSize);
+        TextureStreamer_Request(levelSubmeshes[i].ormID, screenSize);
     }
-    if (uAOMapLoc != -1) {
-        glUniform1i(uAOMapLoc, 4); 
+}
+
+// Gribb-Hartmann planes of clip = projection * view, normalized to world distances.
+static void ExtractFrustumPlanes(const float* clip, float planes[6][4]) {
+    for (int i = 0; i < 6; ++i) {
+        int row = i / 2;
+        float sign = (i % 2 == 0) ? 1.0f : -1.0f;
+        for (int column = 0; column < 4; ++column) {
+            planes[i][column] = clip[column * 4 + 3] + sign * clip[column * 4 + row];
+        }
+        float length = sqrtf(planes[i][0] * planes[i][0] + planes[i][1] * planes[i][1] + planes[i][2] * planes[i][2]);
+        if (length > 0.0f) {
+            for (int k = 0; k < 4; ++k) planes[i][k] /= length;
+        }
     }
+}
 
-    emptyTexture = CreateWhiteTexture();
+// Returns false when the object's bounding sphere lies outside the frustum.
+static bool PrepareCullFrame(const RenderableObject* obj, const float worldPlanes[6][4], const float* cameraPosition,
+                             CullFrame* cull) {
+    const float* m = obj->modelMatrix;
+    float minScale = INFINITY;
+    cull->scale = 0.0f;
+    for (int column = 0; column < 3; ++column) {
+        const float* axis = &m[column * 4];
+        float length = sqrtf(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+        if (length > cull->scale) cull->scale = length;
+        if (length < minScale) minScale = length;
+    }
 
+    // Plane (n, w) in world space is (M^T n, n.t + w) for object points
+    for (int i = 0; i < 6; ++i) {
+        const float* plane = worldPlanes[i];
+        for (int column = 0; column < 4; ++column) {
+            const float* c = &m[column * 4];
+            cull->planes[i][column] = plane[0] * c[0] + plane[1] * c[1] + plane[2] * c[2];
+        }
+        cull->planes[i][3] += plane[3];
+    }
+    // Streamed meshes have no bounds and are never culled as a whole
+    float radius = obj->boundsRadius * cull->scale;
+    for (int i = 0; i < 6 && obj->boundsRadius > 0.0f; ++i) {
+        const float* plane = cull->planes[i];
+        if (plane[0] * obj->boundsCenter[0] + plane[1] * obj->boundsCenter[1] + plane[2] * obj->boundsCenter[2] +
+            plane[3] < -radius) {
+            return false;
+        }
+    }
 
-    float fovY = 45.0f * (3.1415926f / 180.0f); 
-    float aspect = 800.0f / 600.0f;
-    float nearr = 0.1f;
-    float farr = 10000.0f;
-    CreatePerspectiveProjection(fovY, aspect, nearr, farr, projectionMatrix);
+    // Camera in object space: solve M3 x = camera - translation with the inverse built from cross products
+    float rows[3][3];
+    CrossProduct(&m[4], &m[8], rows[0]);
+    CrossProduct(&m[8], &m[0], rows[1]);
+    CrossProduct(&m[0], &m[4], rows[2]);
+    float det = m[0] * rows[0][0] + m[1] * rows[0][1] + m[2] * rows[0][2];
+    float d[3] = {cameraPosition[0] - m[12], cameraPosition[1] - m[13], cameraPosition[2] - m[14]};
+    for (int i = 0; i < 3; ++i) {
+        cull->camera[i] = (det != 0.0f) ? (rows[i][0] * d[0] + rows[i][1] * d[1] + rows[i][2] * d[2]) / det : 0.0f;
+    }
+    // A mirroring matrix flips which side of a triangle faces the camera
+    cull->coneTest = !obj->doubleSided && det > 0.0f && cull->scale <= minScale * CULL_UNIFORM_SCALE_TOLERANCE;
+    return true;
+}
+
+enum { CLUSTER_VISIBLE, CLUSTER_OUTSIDE, CLUSTER_BACKFACING };
+
+static int ClassifyCluster(const Meshlet* meshlet, const CullFrame* cull) {
+    float radius = meshlet->radius * cull->scale;
+    const float* c = meshlet->center;
+    for (int i = 0; i < 6; ++i) {
+        const float* plane = cull->planes[i];
+        if (plane[0] * c[0] + plane[1] * c[1] + plane[2] * c[2] + plane[3] < -radius) return CLUSTER_OUTSIDE;
+    }
+    if (cull->coneTest && meshlet->coneCutoff < 1.0f) {
+        // Every triangle faces away when the view direction to the sphere stays inside the cone
+        float d[3] = {c[0] - cull->camera[0], c[1] - cull->camera[1], c[2] - cull->camera[2]};
+        float distance = sqrtf(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+        float along = d[0] * meshlet->coneAxis[0] + d[1] * meshlet->coneAxis[1] + d[2] * meshlet->coneAxis[2];
+        if (along >= meshlet->coneCutoff * distance + meshlet->radius) return CLUSTER_BACKFACING;
+    }
+    return CLUSTER_VISIBLE;
 }
 
-void DrawObject(GLuint vao, int vertexCount, float* modelMatrix, GLuint textureID, GLuint normalID, GLuint roughnessID, GLuint metalnessID, GLuint aoID) {
-    glBindVertexArray(vao);
+static bool EnsureRunCapacity(int count) {
+    if (count <= runCapacity) return true;
+    GLsizei* counts = realloc(runCounts, (size_t)count * sizeof(GLsizei));
+    if (counts) runCounts = counts;
+    const void** offsets = realloc(runOffsets, (size_t)count * sizeof(const void*));
+    if (offsets) runOffsets = offsets;
+    if (!counts || !offsets) return false;
+    runCapacity = count;
+    return true;
+}
+
+// Fills runCounts/runOffsets with the visible clusters of submesh, merging neighbours into
+// one run. Returns the run count, or -1 if the submesh should be drawn whole.
+static int CollectVisibleRuns(const RenderableObject* obj, const Submesh* submesh, const CullFrame* cull,
+                              GLsizeiptr indexSize, CullStats* stats) {
+    if (!EnsureRunCapacity(submesh->meshletCount)) return -1;
+    int runs = 0;
+    int runEnd = -1;
+    for (int i = 0; i < submesh->meshletCount; ++i) {
+        const Meshlet* meshlet = &obj->meshlets[submesh->firstMeshlet + i];
+        int result = ClassifyCluster(meshlet, cull);
+        if (result == CLUSTER_OUTSIDE) {
+            stats->frustumClusters++;
+            continue;
+        }
+        if (result == CLUSTER_BACKFACING) {
+            stats->coneClusters++;
+            continue;
+        }
+        stats->submittedTriangles += (size_t)meshlet->indexCount / 3;
+        if (meshlet->firstIndex == runEnd) {
+            runCounts[runs - 1] += meshlet->indexCount;
+        } else {
+            runCounts[runs] = meshlet->indexCount;
+            runOffsets[runs] = (const void*)(meshlet->firstIndex * indexSize);
+            runs++;
+        }
+        runEnd = meshlet->firstIndex + meshlet->indexCount;
+    }
+    return runs;
+}
+
+static void BindTextureUnit(int unit, GLenum target, GLuint texture, CullStats* stats) {
+    if (boundTextures[unit] == texture) return;
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glBindTexture(target, texture);
+    boundTextures[unit] = texture;
+    if (stats) stats->textureBinds++;
+}
+
+// Binds the texture, normal and ORM maps of a material: a map with an array layer samples
+// the array, where the next material usually finds it bound already, and the layer uniforms
+// say where in the array it is. Units and uniforms that hold the same are left alone.
+static void BindMaterial(const GLuint textures[MATERIAL_MAP_COUNT], const TextureLayer layers[MATERIAL_MAP_COUNT],
+                         CullStats* stats) {
+    GLuint fallback[MATERIAL_MAP_COUNT] = {emptyTexture, emptyTexture, defaultOrmTexture};
+    float layerIndices[MATERIAL_MAP_COUNT];
+    float layerTransforms[MATERIAL_MAP_COUNT * 4];
+    for (int map = 0; map < MATERIAL_MAP_COUNT; ++map) {
+        const TextureLayer* layer = &layers[map];
+        float* transform = &layerTransforms[map * 4];
+        if (layer->arrayID) {
+            BindTextureUnit(ARRAY_TEXTURE_UNIT + map, GL_TEXTURE_2D_ARRAY, layer->arrayID, stats);
+            layerIndices[map] = layer->layer;
+            memcpy(transform, layer->uvTransform, sizeof(layer->uvTransform));
+            continue;
+        }
+        BindTextureUnit(map, GL_TEXTURE_2D, textures[map] ? textures[map] : fallback[map], stats);
+        layerIndices[map] = -1.0f;
+        transform[0] = transform[1] = 1.0f;
+        transform[2] = transform[3] = 0.0f;
+    }
+    if (boundLayersValid && memcmp(layerIndices, boundLayers, sizeof(boundLayers)) == 0 &&
+        memcmp(layerTransforms, boundLayerTransforms, sizeof(boundLayerTransforms)) == 0) {
+        return;
+    }
+    if (uniformLayersLoc != -1) glUniform1fv(uniformLayersLoc, MATERIAL_MAP_COUNT, layerIndices);
+    if (uniformLayerTransformsLoc != -1) {
+        glUniform4fv(uniformLayerTransformsLoc, MATERIAL_MAP_COUNT, layerTransforms);
+    }
+    memcpy(boundLayers, layerIndices, sizeof(boundLayers));
+    memcpy(boundLayerTransforms, layerTransforms, sizeof(boundLayerTransforms));
+    boundLayersValid = true;
+}
+
+// Back faces are culled unless the object is double-sided, so every triangle is drawn the way
+// the cluster cone test assumes. A mirroring model matrix turns front faces clockwise.
+static void ApplyFaceCulling(const RenderableObject* obj) {
+    const float* m = obj->modelMatrix;
+    float det = m[0] * (m[5] * m[10] - m[6] * m[9]) - m[4] * (m[1] * m[10] - m[2] * m[9]) +
+                m[8] * (m[1] * m[6] - m[2] * m[5]);
+    GLint frontFace = obj->doubleSided ? 0 : (det < 0.0f ? GL_CW : GL_CCW);
+    if (frontFace == boundFrontFace) return;
+    if (frontFace == 0) {
+        glDisable(GL_CULL_FACE);
+    } else {
+        if (boundFrontFace <= 0) {
+            glEnable(GL_CULL_FACE);
+            glCullFace(GL_BACK);
+        }
+        glFrontFace((GLenum)frontFace);
+    }
+    boundFrontFace = frontFace;
+}
+
+// Draws the object at the given level. With a cull frame, clusters outside the frustum or
+// facing away are skipped; stats (may be NULL without cull) receives the submitted triangles.
+void DrawObject(const RenderableObject* obj, int lod, const CullFrame* cull, CullStats* stats) {
+    const float* modelMatrix = obj->modelMatrix;
+
+    glBindVertexArray(obj->vao);
 
     GLenum err;
     while ((err = glGetError()) != GL_NO_ERROR) {
@@ -145,40 +508,125 @@ void DrawObject(GLuint vao, int vertexCount, float* modelMatrix, GLuint textureI
     if (uniformModelLoc != -1) {
         glUniformMatrix4fv(uniformModelLoc, 1, GL_FALSE, modelMatrix);
     }
+    ApplyFaceCulling(obj);
+    // Packed layouts are decoded in the vertex shader
+    if (uniformVertexEncodingLoc != -1) {
+        glUniform1i(uniformVertexEncodingLoc, obj->vertexEncoding);
+        glUniform3fv(uniformPositionScaleLoc, 1, obj->quantization.positionScale);
+        glUniform3fv(uniformPositionOffsetLoc, 1, obj->quantization.positionOffset);
+        glUniform2fv(uniformTexCoordScaleLoc, 1, obj->quantization.texcoordScale);
+        glUniform2fv(uniformTexCoordOffsetLoc, 1, obj->quantization.texcoordOffset);
+    }
     while ((err = glGetError()) != GL_NO_ERROR) {
         printf("OpenGL error: %s\n", gluErrorString(err));
     }
-    // Bind the texture
-   if (textureID != 0) {
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, textureID);
+    if (obj->submeshCount > 0) {
+        // One VAO, one range draw per material
+        GLsizeiptr indexSize = (obj->indexType == GL_UNSIGNED_SHORT) ? 2 : 4;
+        const Submesh* levelSubmeshes = &obj->submeshes[lod * obj->submeshCount];
+        for (int i = 0; i < obj->submeshCount; ++i) {
+            const Submesh* submesh = &levelSubmeshes[i];
+            int runs = -1;
+            if (cull && submesh->meshletCount > 0) {
+                runs = CollectVisibleRuns(obj, submesh, cull, indexSize, stats);
+                if (runs == 0) continue;
+            }
+            GLuint textures[MATERIAL_MAP_COUNT] = {submesh->textureID, submesh->normalID, submesh->ormID};
+            BindMaterial(textures, submesh->layers, stats);
+            if (runs > 0) {
+                glMultiDrawElements(GL_TRIANGLES, runCounts, obj->indexType, runOffsets, runs);
+                continue;
+            }
+            glDrawElements(GL_TRIANGLES, submesh->indexCount, obj->indexType,
+                           (const void*)(submesh->firstIndex * indexSize));
+            if (stats) stats->submittedTriangles += (size_t)submesh->indexCount / 3;
+        }
+        glBindVertexArray(0);
+        return;
+    }
+
+    GLuint textures[MATERIAL_MAP_COUNT] = {obj->textureID, obj->normalID, obj->ormID};
+    BindMaterial(textures, obj->layers, stats);
+
+    if (obj->indexCount > 0) {
+        glDrawElements(GL_TRIANGLES, obj->indexCount, obj->indexType, (void*)0);
+    } else {
+        glDrawArrays(GL_TRIANGLES, 0, obj->vertexCount);
     }
+    if (stats) stats->submittedTriangles += ObjectTriangleCount(obj, 0);
 
-    glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, normalID ? normalID : emptyTexture);
+    glBindVertexArray(0);
+}
 
-    glActiveTexture(GL_TEXTURE2);
-    glBindTexture(GL_TEXTURE_2D, roughnessID ? roughnessID : emptyTexture);
-    glActiveTexture(GL_TEXTURE3);
-    glBindTexture(GL_TEXTURE_2D, metalnessID ? metalnessID : emptyTexture);
-    glActiveTexture(GL_TEXTURE4);
-    glBindTexture(GL_TEXTURE_2D, aoID ? aoID : emptyTexture);
+static void AccumulateCullStats(CullStats* total, const CullStats* frame) {
+    total->lodTriangles += frame->lodTriangles;
+    total->objectTriangles += frame->objectTriangles;
+    total->submittedTriangles += frame->submittedTriangles;
+    total->frustumClusters += frame->frustumClusters;
+    total->coneClusters += frame->coneClusters;
+    total->culledObjects += frame->culledObjects;
+    total->textureBinds += frame->textureBinds;
+}
 
+static double Percent(size_t part, size_t whole) {
+    return whole ? 100.0 * (double)part / (double)whole : 100.0;
+}
 
-    glDrawArrays(GL_TRIANGLES, 0, vertexCount); // Or glDrawElements if using EBO
+// Per-frame averages of stats summed over frames.
+static void PrintCullStats(const char* tag, const CullStats* stats, int frames) {
+    if (frames <= 0) return;
+    size_t n = (size_t)frames;
+    printf("%s: %zu triangles/frame in the selected levels, %zu after object culling (%.0f%%), "
+           "%zu submitted after cluster culling (%.0f%%)\n", tag, stats->lodTriangles / n,
+           stats->objectTriangles / n, Percent(stats->objectTriangles, stats->lodTriangles),
+           stats->submittedTriangles / n, Percent(stats->submittedTriangles, stats->lodTriangles));
+    printf("%s: per frame %zu objects outside the frustum, %zu clusters outside, %zu clusters back-facing, "
+           "%zu texture binds\n", tag, stats->culledObjects / n, stats->frustumClusters / n, stats->coneClusters / n,
+           stats->textureBinds / n);
+}
 
-    glBindTexture(GL_TEXTURE_2D, 0);
-    glBindVertexArray(0);
+// Frame time, LOD and culling stats of the frames drawn since the last toggle, under the
+// settings they were drawn with; called before L or C flips a setting
+static void PrintToggleStats(void) {
+    if (lodStatsFrames > 0) {
+        size_t triangles = lodStatsTriangles / (size_t)lodStatsFrames;
+        size_t fullTriangles = lodStatsFullTriangles / (size_t)lodStatsFrames;
+        printf("[LOD] %s for %d frames: %.2f ms/frame, %zu triangles/frame of %zu at full detail (%.0f%%)\n",
+               lodEnabled ? "on" : "off", lodStatsFrames, lodStatsTime * 1000.0 / lodStatsFrames, triangles,
+               fullTriangles, Percent(triangles, fullTriangles));
+        PrintCullStats(cullingEnabled ? "[Culling] on" : "[Culling] off", &intervalStats, lodStatsFrames);
+    }
+    memset(&intervalStats, 0, sizeof(intervalStats));
+    lodStatsTime = 0.0;
+    lodStatsFrames = 0;
+    lodStatsTriangles = 0;
+    lodStatsFullTriangles = 0;
 }
 
 // --- [ draw ] ---
 void Renderer_Draw(float deltaTime) {
+    if (sceneLoading && !SceneLoader_Update(&objects, SCENE_UPLOAD_BUDGET_SECONDS)) {
+        sceneLoading = false;
+        // Arrays are built from the cooked pixels, so the pack stays mounted until then;
+        // streamed textures upload their finer levels from it later on
+        TextureArrayStats arrayStats;
+        TextureArray_Build(&objects, &arrayStats);
+        if (!TextureStreamer_IsEnabled()) AssetPack_Unmount();
+        printf("Number of objects loaded: %d\n", objects.size);
+        ResourceManager_PrintStats();
+        if (TextureStreamer_IsEnabled()) TextureStreamer_PrintStats();
+    }
+
     // Clear screen and enable depth test
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     glEnable(GL_DEPTH_TEST);
 
     // Use the shader program
     glUseProgram(shaderProgram);
+    // Loading and streaming bind textures between frames
+    memset(boundTextures, 0xff, sizeof(boundTextures));
+    boundLayersValid = false;
+    boundFrontFace = -1;
 
     // Upload the projection matrix
     if (uniformProjectionLoc != -1) {
@@ -197,6 +645,48 @@ void Renderer_Draw(float deltaTime) {
         printf("At line: %d\n", __LINE__);
     }
 
+    if (g_input.keys['L'] && !lodKeyWasDown) {
+        PrintToggleStats();
+        lodEnabled = !lodEnabled;
+        printf("[LOD] Level selection %s\n", lodEnabled ? "on" : "off");
+    }
+    lodKeyWasDown = g_input.keys['L'];
+
+    if (g_input.keys['C'] && !cullKeyWasDown) {
+        PrintToggleStats();
+        cullingEnabled = !cullingEnabled;
+        printf("[Culling] Cluster culling %s\n", cullingEnabled ? "on" : "off");
+    }
+    cullKeyWasDown = g_input.keys['C'];
+
+    if (g_input.keys['P'] && !pathKeyWasDown && !pathRecording) {
+        if (CameraControl_StartPath()) {
+            pathRecording = true;
+            pathFrames = 0;
+            pathSeconds = 0.0;
+            memset(&pathStats, 0, sizeof(pathStats));
+            TextureStreamer_BeginReport();
+            printf("[CameraPath] Playing, culling %s, LOD %s\n", cullingEnabled ? "on" : "off",
+                   lodEnabled ? "on" : "off");
+        } else {
+            printf("[CameraPath] No camera_path in the scene\n");
+        }
+    }
+    pathKeyWasDown = g_input.keys['P'];
+
+    float cameraPosition[3];
+    CameraControl_GetPosition(&cameraPosition[0], &cameraPosition[1], &cameraPosition[2]);
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    float pixelsPerUnit = projectionMatrix[5] * 0.5f * (float)viewport[3];
+
+    float clip[16];
+    float frustum[6][4];
+    MultiplyMatrices(viewMatrix, projectionMatrix, clip);
+    ExtractFrustumPlanes(clip, frustum);
+    CullStats frameStats;
+    memset(&frameStats, 0, sizeof(frameStats));
+
     // Draw all objects in the vector
     for (int i = 0; i < objects.size; i++) {
         RenderableObject* obj = &objects.data[i];
@@ -204,42 +694,68 @@ void Renderer_Draw(float deltaTime) {
             glUniform1i(uniformCastsShadowsLoc, obj->castsShadows ? 1 : 0);
         }
 
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, obj->normalID ? obj->normalID : emptyTexture);
-
-        glActiveTexture(GL_TEXTURE2);
-        glBindTexture(GL_TEXTURE_2D, obj->roughnessID ? obj->roughnessID : emptyTexture);
-
-        glActiveTexture(GL_TEXTURE3);
-        glBindTexture(GL_TEXTURE_2D, obj->metalnessID ? obj->metalnessID : emptyTexture);
-
-        glActiveTexture(GL_TEXTURE4);
-        glBindTexture(GL_TEXTURE_2D, obj->aoID ? obj->aoID : emptyTexture);
-
-        // Make sure shader uses unit 1
-        GLint uNormalMapLoc = glGetUniformLocation(shaderProgram, "uNormalMap");
-        glUniform1i(uNormalMapLoc, 1);
-
-        GLint uRoughnessMapLoc = glGetUniformLocation(shaderProgram, "uRoughnessMap");
-        glUniform1i(uRoughnessMapLoc, 2);
-
-        GLint uMetalnessMapLoc = glGetUniformLocation(shaderProgram, "uMetalnessMap");
-        glUniform1i(uMetalnessMapLoc, 3);
-
-        GLint uAOMapLoc = glGetUniformLocation(shaderProgram, "uAOMap");
-        glUniform1i(uAOMapLoc, 4);
-
-        DrawObject(obj->vao, obj->vertexCount, obj->modelMatrix,obj->textureID,obj->normalID,obj->roughnessID,obj->metalnessID,obj->aoID);
+        int lod = lodEnabled ? SelectLod(obj, cameraPosition, pixelsPerUnit) : 0;
+        size_t triangles = ObjectTriangleCount(obj, lod);
+        lodStatsTriangles += triangles;
+        lodStatsFullTriangles += ObjectTriangleCount(obj, 0);
+        frameStats.lodTriangles += triangles;
+        if (!cullingEnabled) {
+            frameStats.objectTriangles += triangles;
+            RequestObjectTextures(obj, lod, ObjectScreenSize(obj, cameraPosition, pixelsPerUnit));
+            DrawObject(obj, lod, NULL, &frameStats);
+            continue;
+        }
+        CullFrame cull;
+        if (!PrepareCullFrame(obj, frustum, cameraPosition, &cull)) {
+            frameStats.culledObjects++;
+            continue;
+        }
+        frameStats.objectTriangles += triangles;
+        RequestObjectTextures(obj, lod, ObjectScreenSize(obj, cameraPosition, pixelsPerUnit));
+        DrawObject(obj, lod, &cull, &frameStats);
         
     
     }
+
+    // Levels requested while drawing are uploaded for the next frame
+    TextureStreamer_Update();
+
+    AccumulateCullStats(&intervalStats, &frameStats);
+    if (pathRecording) {
+        AccumulateCullStats(&pathStats, &frameStats);
+        pathFrames++;
+        pathSeconds += deltaTime;
+        if (!CameraControl_PathActive()) {
+            pathRecording = false;
+            PrintCullStats("[CameraPath]", &pathStats, pathFrames);
+            printf("[CameraPath] %d frames in %.1f s (%.2f ms/frame)\n", pathFrames, pathSeconds,
+                   pathSeconds * 1000.0 / pathFrames);
+            TextureStreamer_EndReport("[CameraPath]");
+        }
+    }
+
+    lodStatsFrames++;
+    lodStatsTime += deltaTime;
 }
 
 
 // --- [ cleanup ] ---
 void Renderer_Cleanup(void) {
+    if (sceneLoading) {
+        SceneLoader_Cancel();
+        sceneLoading = false;
+    }
     glDeleteVertexArrays(1, &vaoTerrain);
     glDeleteVertexArrays(1, &vaoTree);
+    ObjectVector_Free(&objects);
+    free(runCounts);
+    free(runOffsets);
+    runCounts = NULL;
+    runOffsets = NULL;
+    runCapacity = 0;
+    ResourceManager_Shutdown();
+    TextureStreamer_Shutdown();
+    AssetPack_Unmount();
     glDeleteProgram(shaderProgram);
 }
 
@@ -264,7 +780,7 @@ void UpdateProjectionMatrix(float aspect) {
 
 void PrintVertexAndNormalBuffer(float* buffer, int vertexCount) {
     for (int i = 0; i < vertexCount; i++) {
-        int baseIdx = i * 11;
+        int baseIdx = i * FLOATS_PER_VERTEX;
         printf("Vertex %d: Pos(%.3f, %.3f, %.3f), Normal(%.3f, %.3f, %.3f)\n",
             i,
             buffer[baseIdx], buffer[baseIdx + 1], buffer[baseIdx + 2],
@@ -0,0 +1,333 @@
+#include "resource_manager.h"
+#include "hash_utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    ResourceData data;
+    uint64_t contentHash;
+    uint32_t generation;        // bumped when the slot is freed, never 0
+    int references;             // 0 = free slot
+    ResourceType type;
+    const char* path;           // interned path and variant it was added under
+    uint64_t variant;
+    uint32_t nextFree;          // free list link, UINT32_MAX ends it
+} ResourceSlot;
+
+typedef enum {
+    KEY_EMPTY,
+    KEY_USED,
+    KEY_REMOVED
+} KeyState;
+
+// Lookup key of a slot: an interned path and variant, or a content hash with path NULL.
+// Interned paths compare by pointer.
+typedef struct {
+    uint64_t hash;
+    const char* path;
+    uint64_t value;
+    uint32_t slot;
+    uint8_t type;
+    uint8_t state;
+} ResourceKey;
+
+typedef struct {
+    ResourceSlot* slots;
+    uint32_t slotCount;
+    uint32_t slotCapacity;
+    uint32_t firstFree;
+
+    ResourceKey* keys;          // open addressing, linear probing
+    size_t keyMask;
+    size_t keysInUse;           // used and removed entries, which both lengthen probes
+
+    char** strings;             // interned paths, open addressing
+    size_t stringMask;
+    size_t stringCount;
+
+    int contentDedupeOff;
+    ResourceStats stats[RESOURCE_TYPE_COUNT];
+} ResourceManager;
+
+static ResourceManager manager = { .firstFree = UINT32_MAX };
+
+static const char* typeNames[RESOURCE_TYPE_COUNT] = { "meshes", "textures" };
+
+const char* ResourceManager_Intern(const char* path) {
+    if (manager.stringCount * 2 >= manager.stringMask) {
+        size_t capacity = manager.stringMask ? (manager.stringMask + 1) * 2 : 256;
+        char** grown = calloc(capacity, sizeof(char*));
+        if (!grown) return NULL;
+        for (size_t i = 0; manager.strings && i <= manager.stringMask; ++i) {
+            char* string = manager.strings[i];
+            if (!string) continue;
+            size_t j = Hash64(string, strlen(string), 0) & (capacity - 1);
+            while (grown[j]) j = (j + 1) & (capacity - 1);
+            grown[j] = string;
+        }
+        free(manager.strings);
+        manager.strings = grown;
+        manager.stringMask = capacity - 1;
+    }
+
+    size_t length = strlen(path);
+    size_t i = Hash64(path, length, 0) & manager.stringMask;
+    for (; manager.strings[i]; i = (i + 1) & manager.stringMask) {
+        if (strcmp(manager.strings[i], path) == 0) return manager.strings[i];
+    }
+    char* copy = malloc(length + 1);
+    if (!copy) return NULL;
+    memcpy(copy, path, length + 1);
+    manager.strings[i] = copy;
+    manager.stringCount++;
+    return copy;
+}
+
+void ResourceManager_SetContentDedupe(int enabled) {
+    manager.contentDedupeOff = !enabled;
+}
+
+static uint64_t KeyHash(ResourceType type, const char* path, uint64_t value) {
+    uint64_t fields[3] = { (uint64_t)(uintptr_t)path, value, (uint64_t)type };
+    return Hash64(fields, sizeof(fields), 0);
+}
+
+static ResourceKey* FindKey(ResourceType type, const char* path, uint64_t value) {
+    if (!manager.keys) return NULL;
+    uint64_t hash = KeyHash(type, path, value);
+    for (size_t i = hash & manager.keyMask;; i = (i + 1) & manager.keyMask) {
+        ResourceKey* key = &manager.keys[i];
+        if (key->state == KEY_EMPTY) return NULL;
+        if (key->state == KEY_USED && key->hash == hash && key->path == path && key->value == value &&
+            key->type == type) {
+            return key;
+        }
+    }
+}
+
+// Rebuilds the table without removed entries, doubling it when it is more than a quarter full.
+static int RehashKeys(void) {
+    size_t used = 0;
+    for (size_t i = 0; manager.keys && i <= manager.keyMask; ++i) {
+        if (manager.keys[i].state == KEY_USED) used++;
+    }
+    size_t capacity = 64;
+    while (capacity < (used + 1) * 4) capacity *= 2;
+    ResourceKey* grown = calloc(capacity, sizeof(ResourceKey));
+    if (!grown) return 2;
+    for (size_t i = 0; manager.keys && i <= manager.keyMask; ++i) {
+        const ResourceKey* key = &manager.keys[i];
+        if (key->state != KEY_USED) continue;
+        size_t j = key->hash & (capacity - 1);
+        while (grown[j].state != KEY_EMPTY) j = (j + 1) & (capacity - 1);
+        grown[j] = *key;
+    }
+    free(manager.keys);
+    manager.keys = grown;
+    manager.keyMask = capacity - 1;
+    manager.keysInUse = used;
+    return 0;
+}
+
+static int InsertKey(ResourceType type, const char* path, uint64_t value, uint32_t slot) {
+    if (!manager.keys || (manager.keysInUse + 1) * 2 > manager.keyMask + 1) {
+        if (RehashKeys()) return 2;
+    }
+    uint64_t hash = KeyHash(type, path, value);
+    size_t i = hash & manager.keyMask;
+    while (manager.keys[i].state != KEY_EMPTY) i = (i + 1) & manager.keyMask;
+    ResourceKey* key = &manager.keys[i];
+    key->hash = hash;
+    key->path = path;
+    key->value = value;
+    key->slot = slot;
+    key->type = (uint8_t)type;
+    key->state = KEY_USED;
+    manager.keysInUse++;
+    return 0;
+}
+
+// Frees are rare next to lookups, so the keys of a slot are found by a scan instead of
+// being linked from it.
+static void RemoveKeys(uint32_t slot) {
+    for (size_t i = 0; manager.keys && i <= manager.keyMask; ++i) {
+        if (manager.keys[i].state == KEY_USED && manager.keys[i].slot == slot) {
+            manager.keys[i].state = KEY_REMOVED;
+        }
+    }
+}
+
+static ResourceSlot* GetSlot(ResourceHandle handle) {
+    if (handle.generation == 0 || handle.index >= manager.slotCount) return NULL;
+    ResourceSlot* slot = &manager.slots[handle.index];
+    if (slot->generation != handle.generation || slot->references == 0) return NULL;
+    return slot;
+}
+
+static ResourceHandle Reference(uint32_t index) {
+    ResourceSlot* slot = &manager.slots[index];
+    slot->references++;
+    manager.stats[slot->type].references++;
+    ResourceHandle handle = { index, slot->generation };
+    return handle;
+}
+
+ResourceHandle ResourceManager_Find(ResourceType type, const char* path, uint64_t variant) {
+    ResourceHandle none = { 0, 0 };
+    const char* interned = ResourceManager_Intern(path);
+    ResourceKey* key = interned ? FindKey(type, interned, variant) : NULL;
+    if (!key) return none;
+    manager.stats[type].pathHits++;
+    return Reference(key->slot);
+}
+
+int ResourceManager_Exists(ResourceType type, const char* path, uint64_t variant) {
+    const char* interned = ResourceManager_Intern(path);
+    return interned && FindKey(type, interned, variant) != NULL;
+}
+
+ResourceHandle ResourceManager_FindByContent(ResourceType type, const char* path, uint64_t variant,
+                                             uint64_t contentHash) {
+    ResourceHandle none = { 0, 0 };
+    if (manager.contentDedupeOff || contentHash == 0) return none;
+    ResourceKey* key = FindKey(type, NULL, contentHash);
+    if (!key) return none;
+    uint32_t slot = key->slot;
+    const char* interned = ResourceManager_Intern(path);
+    if (interned) InsertKey(type, interned, variant, slot);
+    manager.stats[type].contentHits++;
+    return Reference(slot);
+}
+
+static void FreeData(const ResourceData* data) {
+    if (data->freeData) data->freeData(data->data);
+}
+
+ResourceHandle ResourceManager_Add(ResourceType type, const char* path, uint64_t variant, uint64_t contentHash,
+                                   const ResourceData* data) {
+    ResourceHandle none = { 0, 0 };
+    const char* interned = ResourceManager_Intern(path);
+    if (!interned) {
+        FreeData(data);
+        return none;
+    }
+
+    uint32_t index = manager.firstFree;
+    if (index == UINT32_MAX) {
+        if (manager.slotCount == manager.slotCapacity) {
+            uint32_t capacity = manager.slotCapacity ? manager.slotCapacity * 2 : 64;
+            ResourceSlot* grown = realloc(manager.slots, capacity * sizeof(ResourceSlot));
+            if (!grown) {
+                FreeData(data);
+                return none;
+            }
+            manager.slots = grown;
+            manager.slotCapacity = capacity;
+        }
+        index = manager.slotCount++;
+        manager.slots[index].generation = 1;
+    } else {
+        manager.firstFree = manager.slots[index].nextFree;
+    }
+
+    ResourceSlot* slot = &manager.slots[index];
+    slot->data = *data;
+    slot->contentHash = manager.contentDedupeOff ? 0 : contentHash;
+    slot->references = 0;
+    slot->type = type;
+    slot->path = interned;
+    slot->variant = variant;
+    slot->nextFree = UINT32_MAX;
+    // A content hash already taken by another resource stays with it
+    int failed = InsertKey(type, interned, variant, index);
+    if (!failed && slot->contentHash && !FindKey(type, NULL, slot->contentHash)) {
+        failed = InsertKey(type, NULL, slot->contentHash, index);
+    }
+    if (failed) {
+        RemoveKeys(index);
+        FreeData(data);
+        slot->nextFree = manager.firstFree;
+        manager.firstFree = index;
+        return none;
+    }
+
+    ResourceStats* stats = &manager.stats[type];
+    stats->count++;
+    stats->cpuBytes += data->cpuBytes;
+    stats->gpuBytes += data->gpuBytes;
+    return Reference(index);
+}
+
+void ResourceManager_AddRef(ResourceHandle handle) {
+    ResourceSlot* slot = GetSlot(handle);
+    if (slot) Reference(handle.index);
+}
+
+static void FreeSlot(uint32_t index) {
+    ResourceSlot* slot = &manager.slots[index];
+    ResourceStats* stats = &manager.stats[slot->type];
+    stats->count--;
+    stats->references -= slot->references;
+    stats->cpuBytes -= slot->data.cpuBytes;
+    stats->gpuBytes -= slot->data.gpuBytes;
+    RemoveKeys(index);
+    FreeData(&slot->data);
+    memset(&slot->data, 0, sizeof(slot->data));
+    slot->references = 0;
+    if (++slot->generation == 0) slot->generation = 1;
+    slot->nextFree = manager.firstFree;
+    manager.firstFree = index;
+}
+
+void ResourceManager_Release(ResourceHandle handle) {
+    ResourceSlot* slot = GetSlot(handle);
+    if (!slot) return;
+    if (slot->references == 1) {
+        FreeSlot(handle.index);
+        return;
+    }
+    slot->references--;
+    manager.stats[slot->type].references--;
+}
+
+void* ResourceManager_Get(ResourceHandle handle) {
+    ResourceSlot* slot = GetSlot(handle);
+    return slot ? slot->data.data : NULL;
+}
+
+int ResourceManager_GetKey(ResourceHandle handle, ResourceType* type, const char** path, uint64_t* variant) {
+    const ResourceSlot* slot = GetSlot(handle);
+    if (!slot) return 1;
+    *type = slot->type;
+    *path = slot->path;
+    *variant = slot->variant;
+    return 0;
+}
+
+void ResourceManager_GetStats(ResourceType type, ResourceStats* stats) {
+    *stats = manager.stats[type];
+}
+
+void ResourceManager_PrintStats(void) {
+    for (int type = 0; type < RESOURCE_TYPE_COUNT; ++type) {
+        const ResourceStats* stats = &manager.stats[type];
+        printf("[Resources] %d %s, %d references, %.2f MB CPU, %.2f MB GPU, %d reused by path, %d by content\n",
+               stats->count, typeNames[type], stats->references, stats->cpuBytes / (1024.0 * 1024.0),
+               stats->gpuBytes / (1024.0 * 1024.0), stats->pathHits, stats->contentHits);
+    }
+}
+
+void ResourceManager_Shutdown(void) {
+    for (uint32_t i = 0; i < manager.slotCount; ++i) {
+        if (manager.slots[i].references > 0) FreeData(&manager.slots[i].data);
+    }
+    for (size_t i = 0; manager.strings && i <= manager.stringMask; ++i) free(manager.strings[i]);
+    free(manager.strings);
+    free(manager.keys);
+    free(manager.slots);
+    int contentDedupeOff = manager.contentDedupeOff;
+    memset(&manager, 0, sizeof(manager));
+    manager.firstFree = UINT32_MAX;
+    manager.contentDedupeOff = contentDedupeOff;
+}
@@ -0,0 +1,80 @@
+#ifndef RESOURCE_MANAGER_H
+#define RESOURCE_MANAGER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Shared meshes and textures with reference counts. A resource is found by its interned
+// path and a variant (e.g. the hash of the processing parameters), and optionally by a hash
+// of its content, so two paths to the same file share one copy. Objects hold handles; when
+// the last reference is released the free callback deletes the GL names and CPU data.
+// A handle is a slot index plus the slot's generation, so a handle kept past the release
+// of its resource stops resolving instead of pointing at whatever reuses the slot.
+// Everything here runs on the GL thread.
+
+typedef enum {
+    RESOURCE_MESH,
+    RESOURCE_TEXTURE,
+    RESOURCE_TYPE_COUNT
+} ResourceType;
+
+typedef struct {
+    uint32_t index;
+    uint32_t generation;        // 0 = no resource
+} ResourceHandle;
+
+typedef void (*ResourceFreeFunc)(void* data);
+
+// What a resource owns; data goes to freeData once nothing refers to it.
+typedef struct {
+    void* data;
+    size_t cpuBytes;
+    size_t gpuBytes;
+    ResourceFreeFunc freeData;
+} ResourceData;
+
+typedef struct {
+    int count;
+    int references;
+    size_t cpuBytes;
+    size_t gpuBytes;
+    int pathHits;               // finds that reused a resource by path
+    int contentHits;            // finds that reused a resource loaded under another path
+} ResourceStats;
+
+// Returns one shared copy of the string for equal paths, valid until ResourceManager_Shutdown.
+// NULL when out of memory.
+const char* ResourceManager_Intern(const char* path);
+
+// Dedupe by content hash is on by default; with it off only equal paths share resources.
+void ResourceManager_SetContentDedupe(int enabled);
+
+// Finds a resource and adds a reference the caller releases. Returns a handle with
+// generation 0 if there is none.
+ResourceHandle ResourceManager_Find(ResourceType type, const char* path, uint64_t variant);
+// Whether Find would succeed, without taking a reference.
+int ResourceManager_Exists(ResourceType type, const char* path, uint64_t variant);
+// Same as Find for a content hash; a hit is also registered under path and variant, so the next
+// Find by path reuses it directly. Never finds anything with content dedupe off or hash 0.
+ResourceHandle ResourceManager_FindByContent(ResourceType type, const char* path, uint64_t variant,
+                                             uint64_t contentHash);
+// Registers a resource with one reference. contentHash 0 leaves it out of content dedupe.
+// On failure the data is freed and the handle has generation 0.
+ResourceHandle ResourceManager_Add(ResourceType type, const char* path, uint64_t variant, uint64_t contentHash,
+                                   const ResourceData* data);
+
+void ResourceManager_AddRef(ResourceHandle handle);
+// Frees the resource when this was the last reference. Stale or empty handles are ignored.
+void ResourceManager_Release(ResourceHandle handle);
+// The resource's data, NULL for stale or empty handles.
+void* ResourceManager_Get(ResourceHandle handle);
+// The type, path and variant the resource was added under; path stays valid until
+// ResourceManager_Shutdown. Returns 0 on success, 1 for stale or empty handles.
+int ResourceManager_GetKey(ResourceHandle handle, ResourceType* type, const char** path, uint64_t* variant);
+
+void ResourceManager_GetStats(ResourceType type, ResourceStats* stats);
+void ResourceManager_PrintStats(void);
+// Frees every resource, whatever its references, and the interned paths.
+void ResourceManager_Shutdown(void);
+
+#endif
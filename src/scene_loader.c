@@ -2,244 +2,893 @@
 #include "scene_loader.h"
 #include "OBJ_file_loader.h"
 #include "gl_setup.h"
-#include "matrix_utils.h"
-#include "cJSON.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include "texture_loader.h"
-void LoadSceneFromFile(const char* filename, ObjectVector* objects) {
-    FILE* f = fopen(filename, "r");
-    if (!f) {
-        printf("Failed to open scene file: %s\n", filename);
-        return;
+#include "texture_packer.h"
+#include "texture_streamer.h"
+#include "thread_utils.h"
+#include "mesh_cache.h"
+#include "asset_cache.h"
+#include "asset_pack.h"
+#include "hash_utils.h"
+#include "time_utils.h"
+#include "mtl_loader.h"
+#include "vertex_format.h"
+#include "mesh_cooker.h"
+#include "camera_control.h"
+#include "scene_manifest.h"
+#include "concurrent_queue.h"
+#include "resource_manager.h"
+#include <stdatomic.h>
+// GPU-side geometry of one scene object.
+typedef struct {
+    GLuint vao;
+    GLuint vbo;
+    GLuint ebo;
+    size_t gpuBytes;
+    int vertexCount;
+    int indexCount;
+    GLenum indexType;
+    MeshCacheSubmesh* submeshes;   // owned, NULL for non-indexed meshes
+    int submeshCount;
+    char materialLibrary[MESH_CACHE_PATH_SIZE];
+    VertexEncoding vertexEncoding;
+    VertexQuantization quantization;
+    int lodCount;                             // submeshes holds (lodCount + 1) * submeshCount ranges
+    float lodErrors[MESH_CACHE_MAX_LODS];
+    float boundsCenter[3];
+    float boundsRadius;
+    MeshCacheMeshlet* meshlets;    // owned, referenced by submeshes
+    int meshletCount;
+} MeshGeometry;
+
+static int CopySubmeshes(MeshGeometry* geometry, const MeshCacheSubmesh* submeshes, size_t count, int lodCount) {
+    size_t total = count * (size_t)(lodCount + 1);
+    geometry->submeshes = malloc(total * sizeof(MeshCacheSubmesh) + 1);
+    if (!geometry->submeshes) return 1;
+    memcpy(geometry->submeshes, submeshes, total * sizeof(MeshCacheSubmesh));
+    geometry->submeshCount = (int)count;
+    geometry->lodCount = lodCount;
+    return 0;
+}
+
+static int CopyMeshlets(MeshGeometry* geometry, const MeshCacheMeshlet* meshlets, size_t count) {
+    geometry->meshlets = malloc(count * sizeof(MeshCacheMeshlet) + 1);
+    if (!geometry->meshlets) return 1;
+    memcpy(geometry->meshlets, meshlets, count * sizeof(MeshCacheMeshlet));
+    geometry->meshletCount = (int)count;
+    return 0;
+}
+
+// Base level indices come first; simplified levels follow in the same element buffer.
+static int BaseIndexCount(const MeshCacheSubmesh* submeshes, size_t submeshCount, size_t totalIndexCount) {
+    if (submeshCount == 0) return (int)totalIndexCount;
+    const MeshCacheSubmesh* last = &submeshes[submeshCount - 1];
+    return (int)(last->firstIndex + last->indexCount);
+}
+
+// Creates the VAO and copies the ranges and clusters of a cooked mesh, whether it was
+// just processed or mapped from the cache.
+static void UploadCookedGeometry(const MeshCacheData* data, const VertexLayout* layout, MeshGeometry* geometry) {
+    geometry->indexType = (data->indexSize == 2) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+    geometry->vertexCount = (int)data->vertexCount;
+    geometry->vertexEncoding = layout->encoding;
+    if (data->quantization) geometry->quantization = *data->quantization;
+    geometry->vao = GLSetup_CreateIndexedVAO(data->vertices, data->vertexCount, layout, data->indices,
+                                             data->indexCount, geometry->indexType, &geometry->vbo, &geometry->ebo);
+    geometry->gpuBytes = data->vertexCount * layout->stride + data->indexCount * data->indexSize;
+    snprintf(geometry->materialLibrary, sizeof(geometry->materialLibrary), "%s",
+             data->materialLibrary ? data->materialLibrary : "");
+    if (CopySubmeshes(geometry, data->submeshes, data->submeshCount, (int)data->lodCount) == 0) {
+        memcpy(geometry->lodErrors, data->lodErrors, data->lodCount * sizeof(float));
     }
+    if (data->meshletCount > 0 && CopyMeshlets(geometry, data->meshlets, data->meshletCount)) {
+        // Without clusters every range is drawn whole
+        for (int i = 0; i < (geometry->lodCount + 1) * geometry->submeshCount; ++i) {
+            geometry->submeshes[i].meshletCount = 0;
+        }
+    }
+    geometry->indexCount = BaseIndexCount(data->submeshes, data->submeshCount, data->indexCount);
+    if (data->boundsCenter) memcpy(geometry->boundsCenter, data->boundsCenter, sizeof(geometry->boundsCenter));
+    geometry->boundsRadius = data->boundsRadius;
+}
 
-    fseek(f, 0, SEEK_END);
-    long size = ftell(f);
-    fseek(f, 0, SEEK_SET);
-    char* buffer = (char*)malloc(size + 1);
-    fread(buffer, 1, size, f);
-    buffer[size] = '\0';
-    fclose(f);
+// Cooked mesh of one object on the CPU, read on a loader thread and uploaded on the GL thread.
+typedef struct {
+    MeshCache cache;
+    CookedMesh cooked;
+    int isOpen;                 // cache holds the data
+    int isCooked;               // cooked holds the data
+    MeshCacheData data;
+    const VertexLayout* layout;
+    uint64_t sourceHash;        // Hash64 of the OBJ
+} MeshPayload;
+
+// Reads the mesh from the mounted asset pack or its cooked cache when valid, otherwise cooks
+// the OBJ and writes the cache. Meshes are stored and drawn in vertexLayout. Touches no GL
+// state. Returns 0 on success; *fromCache tells whether the OBJ was skipped.
+static int ReadMeshPayload(const char* meshFile, int smooth, VertexLayoutId vertexLayout, int threadCount,
+                           MeshPayload* mesh, int* fromCache) {
+    MeshProcessParams params;
+    MeshCooker_GetParams(smooth, vertexLayout, &params);
+
+    double startTime = GetTimeSeconds();
+    memset(mesh, 0, sizeof(*mesh));
+
+    size_t packedSize;
+    const void* packed = AssetPack_FindMounted(AssetPack_MakeKey(ASSET_PACK_MESH, meshFile, &params, sizeof(params)),
+                                               ASSET_PACK_MESH, &packedSize);
+    if (packed && MeshCache_OpenMemory(packed, packedSize, meshFile, &params, &mesh->cache) == 0) {
+        mesh->isOpen = 1;
+        MeshCache_GetData(&mesh->cache, &mesh->data);
+        mesh->layout = VertexFormat_GetLayout(mesh->cache.header->vertexLayout);
+        mesh->sourceHash = mesh->cache.header->sourceHash;
+        *fromCache = 1;
+        printf("[Scene] %s: loaded from pack in %.1f ms\n", meshFile, (GetTimeSeconds() - startTime) * 1000.0);
+        return 0;
+    }
 
-    cJSON* root = cJSON_Parse(buffer);
-    free(buffer);
-    if (!root) {
-        printf("Failed to parse scene JSON.\n");
-        return;
+    // The cache is addressed by what it was built from, so edited sources and changed
+    // parameters look up a different entry
+    uint64_t sourceHash;
+    if (HashFile64(meshFile, 0, &sourceHash)) {
+        fprintf(stderr, "[Scene] Cannot read %s\n", meshFile);
+        return 1;
+    }
+    mesh->sourceHash = sourceHash;
+    char cachePath[ASSET_CACHE_PATH_SIZE];
+    MeshCache_GetPath(sourceHash, &params, cachePath, sizeof(cachePath));
+
+    if (MeshCache_Open(cachePath, sourceHash, &params, &mesh->cache) == 0) {
+        mesh->isOpen = 1;
+        MeshCache_GetData(&mesh->cache, &mesh->data);
+        mesh->layout = VertexFormat_GetLayout(mesh->cache.header->vertexLayout);
+        AssetCache_Touch(cachePath);
+        *fromCache = 1;
+        printf("[Scene] %s: warm load from %s in %.1f ms\n", meshFile, cachePath, (GetTimeSeconds() - startTime) * 1000.0);
+        return 0;
     }
 
-    cJSON* objectsArray = cJSON_GetObjectItem(root, "objects");
-    int objectCount = cJSON_GetArraySize(objectsArray);
-    printf("Loading %d objects from scene file.\n", objectCount);
-    for (int i = 0; i < objectCount; i++) {
-        cJSON* objItem = cJSON_GetArrayItem(objectsArray, i);
-        cJSON* meshItem = cJSON_GetObjectItem(objItem, "mesh");
-        if (!meshItem || !meshItem->valuestring) {
-            printf("Object %d missing mesh file!\n", i);
-            continue;
-        }
-        const char* meshFile = meshItem->valuestring;
+    if (MeshCooker_Cook(meshFile, &params, threadCount, &mesh->cooked)) {
+        return 1;
+    }
+    mesh->isCooked = 1;
+    mesh->data = mesh->cooked.data;
+    mesh->layout = VertexFormat_GetLayout(params.vertexLayout);
+    MeshCache_Write(cachePath, sourceHash, &params, &mesh->data);
+
+    *fromCache = 0;
+    printf("[Scene] %s: cold load from OBJ in %.1f ms\n", meshFile, (GetTimeSeconds() - startTime) * 1000.0);
+    return 0;
+}
 
-        ObjMesh mesh;
-        if (LoadOBJ(meshFile, &mesh)) {
-            printf("Failed to load OBJ: %s\n", meshFile);
-            continue;
-        }
-        
-        cJSON* textureItem = cJSON_GetObjectItem(objItem, "textures");
-        const char* textureFile = NULL;
-        if (textureItem && textureItem->valuestring) {
-            printf("Object %d tex file!\n", i);
-            printf("Texture file: %s\n", textureItem->valuestring);
-            textureFile = textureItem->valuestring;
-            printf("Texture file: %s\n", textureFile);
-
-            GLuint myTexture = LoadTexture(textureFile); // path to your image
-            if (myTexture == 0) {
-                fprintf(stderr, "Failed to load texture!\n");
-                continue;
+static void FreeMeshPayload(MeshPayload* mesh) {
+    if (mesh->isCooked) MeshCooker_Free(&mesh->cooked);
+    if (mesh->isOpen) MeshCache_Close(&mesh->cache);
+    memset(mesh, 0, sizeof(*mesh));
+}
 
-            }
-            else{
-                printf("Texture loaded successfully with ID: %u\n", myTexture);
-                mesh.textureID = myTexture;
-            }
-        }
-        else{
-            printf("Object %d has no texture file.\n", i);
-            mesh.textureID = 0;
+static void UploadMeshPayload(const MeshPayload* mesh, MeshGeometry* geometry) {
+    memset(geometry, 0, sizeof(*geometry));
+    VertexFormat_IdentityQuantization(&geometry->quantization);
+    UploadCookedGeometry(&mesh->data, mesh->layout, geometry);
+}
 
-        }
+#define STREAM_CHUNK_VERTICES 65536
 
-        cJSON* normalItem = cJSON_GetObjectItem(objItem, "normals");
-        const char* normalFile = NULL;
-        if (normalItem && normalItem->valuestring) {
-            printf("Object %d normal map file!\n", i);
-            printf("Normal map file: %s\n", normalItem->valuestring);
-            normalFile = normalItem->valuestring;
-            printf("Normal map file: %s\n", normalFile);
+typedef struct {
+    GLStreamBuffers buffers;
+    uint32_t* rebased;       // chunk indices shifted to the buffer's vertex offset
+    size_t vertexBase;
+    size_t indexCount;
+} StreamUpload;
 
-            GLuint myNormalMap = LoadTexture(normalFile); // path to your image
-            if (myNormalMap == 0) {
-                fprintf(stderr, "Failed to load normal map texture!\n");
-                continue;
+static int UploadStreamChunk(const ObjStreamChunk* chunk, void* user) {
+    StreamUpload* upload = (StreamUpload*)user;
+    for (size_t i = 0; i < chunk->index_count; ++i) {
+        upload->rebased[i] = (uint32_t)(upload->vertexBase + chunk->indices[i]);
+    }
+    if (GLSetup_AppendStreamBuffers(&upload->buffers, chunk->vertices, chunk->vertex_count * FLOATS_PER_VERTEX * sizeof(float),
+                                    upload->rebased, chunk->index_count * sizeof(uint32_t))) {
+        return 1;
+    }
+    upload->vertexBase += chunk->vertex_count;
+    upload->indexCount += chunk->index_count;
+    return 0;
+}
 
-            }
-            else{
-                printf("Normal map loaded successfully with ID: %u\n", myNormalMap);
-                mesh.normalID = myNormalMap;
+// Streams a large OBJ straight into GPU buffers; CPU memory stays bounded by the chunk
+// size instead of the file. Streamed meshes skip smoothing and the mesh cache, and keep
+// the float vertex layout since chunks go to the GPU as they are parsed.
+static int LoadStreamedGeometry(const char* meshFile, MeshGeometry* geometry) {
+    memset(geometry, 0, sizeof(*geometry));
+    VertexFormat_IdentityQuantization(&geometry->quantization);
+
+    StreamUpload upload;
+    memset(&upload, 0, sizeof(upload));
+    upload.rebased = malloc(STREAM_CHUNK_VERTICES * OBJ_STREAM_INDICES_PER_VERTEX * sizeof(uint32_t));
+    if (!upload.rebased) return 1;
+
+    ObjStreamStats stats;
+    int result = LoadOBJStreaming(meshFile, STREAM_CHUNK_VERTICES, UploadStreamChunk, &upload, &stats);
+    free(upload.rebased);
+    if (result || upload.indexCount == 0 || upload.vertexBase > UINT32_MAX) {
+        glDeleteBuffers(1, &upload.buffers.vbo);
+        glDeleteBuffers(1, &upload.buffers.ebo);
+        return 1;
+    }
 
-            }
-        }
-        else{
-            printf("Object %d has no normal map file.\n", i);
-            mesh.normalID = 0;
+    geometry->vao = GLSetup_FinishStreamedVAO(&upload.buffers, VertexFormat_GetLayout(VERTEX_LAYOUT_FLOAT32));
+    geometry->vbo = upload.buffers.vbo;
+    geometry->ebo = upload.buffers.ebo;
+    geometry->gpuBytes = upload.buffers.vertexCapacity + upload.buffers.indexCapacity;
+    geometry->vertexCount = (int)upload.vertexBase;
+    geometry->indexCount = (int)upload.indexCount;
+    geometry->indexType = GL_UNSIGNED_INT;
+    printf("[Scene] %s: streamed %zu chunks, %zu KB vertices + %zu KB indices on the GPU\n", meshFile, stats.chunks,
+           upload.buffers.vertexBytes / 1024, upload.buffers.indexBytes / 1024);
+    return 0;
+}
 
-        }
+// The packed table has the map paths resolved at cook time, when the files were on disk.
+static int LoadMaterials(const char* filename, MaterialLibrary* library) {
+    size_t size;
+    const ObjMaterial* packed = (const ObjMaterial*)AssetPack_FindMounted(
+        AssetPack_MakeKey(ASSET_PACK_MATERIALS, filename, NULL, 0), ASSET_PACK_MATERIALS, &size);
+    if (!packed || size % sizeof(ObjMaterial) != 0) {
+        return LoadMTL(filename, library);
+    }
+    library->count = (int)(size / sizeof(ObjMaterial));
+    library->materials = malloc(size + 1);
+    if (!library->materials) {
+        library->count = 0;
+        return 2;
+    }
+    memcpy(library->materials, packed, size);
+    for (int i = 0; i < library->count; ++i) {
+        ObjMaterial* material = &library->materials[i];
+        material->name[sizeof(material->name) - 1] = '\0';
+        material->diffuseMap[sizeof(material->diffuseMap) - 1] = '\0';
+        material->normalMap[sizeof(material->normalMap) - 1] = '\0';
+        material->roughnessMap[sizeof(material->roughnessMap) - 1] = '\0';
+        material->metalnessMap[sizeof(material->metalnessMap) - 1] = '\0';
+    }
+    return 0;
+}
+
+// A mesh shared by every object that draws it: its GL names, and the ranges and clusters
+// the objects' submeshes refer to.
+typedef struct {
+    MeshGeometry geometry;      // geometry.meshlets moved into meshlets
+    Meshlet* meshlets;
+} MeshResource;
+
+// Streamed meshes are read one way; cooked ones are keyed by the hash of their parameters,
+// with the low bit set so they never collide with the streamed variant.
+#define STREAMED_MESH_VARIANT 0
+
+static uint64_t MeshVariant(const SceneObjectDesc* desc) {
+    if (desc->flags & SCENE_OBJECT_STREAM) return STREAMED_MESH_VARIANT;
+    MeshProcessParams params;
+    MeshCooker_GetParams(desc->flags & SCENE_OBJECT_SMOOTH, (VertexLayoutId)desc->vertexLayout, &params);
+    return Hash64(&params, sizeof(params), 0) | 1;
+}
 
-        cJSON * roughnessItem = cJSON_GetObjectItem(objItem, "roughness");
-        const char* roughnessFile = NULL;
-        if (roughnessItem && roughnessItem->valuestring) {
-            printf("Object %d roughness map file!\n", i);
-            printf("Roughness map file: %s\n", roughnessItem->valuestring);
-            roughnessFile = roughnessItem->valuestring;
-            printf("Roughness map file: %s\n", roughnessFile);
+static void FreeGeometry(MeshGeometry* geometry) {
+    glDeleteVertexArrays(1, &geometry->vao);
+    glDeleteBuffers(1, &geometry->vbo);
+    glDeleteBuffers(1, &geometry->ebo);
+    free(geometry->submeshes);
+    free(geometry->meshlets);
+}
 
-            GLuint myRoughnessMap = LoadTexture(roughnessFile); // path to your image
-            if (myRoughnessMap == 0) {
-                fprintf(stderr, "Failed to load roughness map texture!\n");
-                continue;
+static void FreeMeshResource(void* data) {
+    MeshResource* mesh = (MeshResource*)data;
+    FreeGeometry(&mesh->geometry);
+    free(mesh->meshlets);
+    free(mesh);
+}
 
+// Takes over the geometry. Returns a handle with one reference, or generation 0 on failure.
+static ResourceHandle AddMeshResource(const char* meshFile, uint64_t variant, uint64_t contentHash,
+                                      MeshGeometry* geometry) {
+    ResourceHandle none = { 0, 0 };
+    MeshResource* mesh = calloc(1, sizeof(MeshResource));
+    if (!mesh) {
+        FreeGeometry(geometry);
+        return none;
+    }
+    mesh->geometry = *geometry;
+    mesh->geometry.meshlets = NULL;
+    if (geometry->meshletCount > 0) {
+        mesh->meshlets = malloc((size_t)geometry->meshletCount * sizeof(Meshlet));
+        if (mesh->meshlets) {
+            for (int i = 0; i < geometry->meshletCount; ++i) {
+                const MeshCacheMeshlet* source = &geometry->meshlets[i];
+                Meshlet* meshlet = &mesh->meshlets[i];
+                meshlet->firstIndex = (int)source->firstIndex;
+                meshlet->indexCount = (int)source->indexCount;
+                memcpy(meshlet->center, source->center, sizeof(meshlet->center));
+                meshlet->radius = source->radius;
+                memcpy(meshlet->coneAxis, source->coneAxis, sizeof(meshlet->coneAxis));
+                meshlet->coneCutoff = source->coneCutoff;
             }
-            else{
-                printf("Roughness map loaded successfully with ID: %u\n", myRoughnessMap);
-                mesh.roughnessID = myRoughnessMap;
+        } else {
+            mesh->geometry.meshletCount = 0;
+            for (int i = 0; i < (geometry->lodCount + 1) * geometry->submeshCount; ++i) {
+                mesh->geometry.submeshes[i].meshletCount = 0;
             }
         }
-        else{
-            printf("Object %d has no roughness map file.\n", i);
-            mesh.roughnessID = 0;
-        }
+        free(geometry->meshlets);
+    }
+
+    ResourceData resource;
+    resource.data = mesh;
+    resource.cpuBytes = sizeof(MeshResource) +
+                        (size_t)(mesh->geometry.lodCount + 1) * mesh->geometry.submeshCount * sizeof(MeshCacheSubmesh) +
+                        (size_t)mesh->geometry.meshletCount * sizeof(Meshlet);
+    resource.gpuBytes = mesh->geometry.gpuBytes;
+    resource.freeData = FreeMeshResource;
+    return ResourceManager_Add(RESOURCE_MESH, meshFile, variant, contentHash, &resource);
+}
 
-        cJSON * metalnessItem = cJSON_GetObjectItem(objItem, "metalness");
-        const char* metalnessFile = NULL;
-        if (metalnessItem && metalnessItem->valuestring) {
-            printf("Object %d metalness map file!\n", i);
-            printf("Metalness map file: %s\n", metalnessItem->valuestring);
-            metalnessFile = metalnessItem->valuestring;
-            printf("Metalness map file: %s\n", metalnessFile);
+// A mesh cooked the same way from a file with the same contents is the same mesh.
+static uint64_t MeshContentHash(uint64_t sourceHash, uint64_t variant) {
+    return sourceHash ? Hash64(&sourceHash, sizeof(sourceHash), variant) : 0;
+}
 
-            GLuint myMetalnessMap = LoadTexture(metalnessFile); // path to your image
-            if (myMetalnessMap == 0) {
-                fprintf(stderr, "Failed to load metalness map texture!\n");
-                continue;
+// Adds a reference to the texture to the object. Returns its ID, 0 if it failed to load.
+static GLuint AcquireObjectTexture(RenderableObject* obj, const char* path, TextureKind kind) {
+    ResourceHandle handle = AcquireTexture(path, kind);
+    GLuint texture = GetTextureID(handle);
+    RenderableObject_AddResource(obj, handle);
+    return texture;
+}
 
-            }
-            else{
-                printf("Metalness map loaded successfully with ID: %u\n", myMetalnessMap);
-                mesh.metalnessID = myMetalnessMap;
-            }
+static GLuint LoadMaterialMap(RenderableObject* obj, const char* path, TextureKind kind, GLuint fallback) {
+    if (path[0] == '\0') return fallback;
+    GLuint texture = AcquireObjectTexture(obj, path, kind);
+    return texture ? texture : fallback;
+}
+
+// Gives every submesh the textures of its MTL material; maps the material lacks (or a
+// mesh without mtllib) fall back to the textures named in scene.json, channel by channel for
+// the packed ones. Simplified levels reuse the base level's textures.
+static void AssignSubmeshMaterials(RenderableObject* obj, const SceneObjectDesc* desc, const MeshResource* mesh,
+                                   const MaterialLibrary* library) {
+    const MeshGeometry* geometry = &mesh->geometry;
+    if (geometry->submeshCount == 0) return;
+
+    int levels = geometry->lodCount + 1;
+    Submesh* submeshes = calloc((size_t)levels * geometry->submeshCount, sizeof(Submesh));
+    if (!submeshes) return;
+
+    int fromMaterials = 0;
+    for (int i = 0; i < geometry->submeshCount; ++i) {
+        const MeshCacheSubmesh* range = &geometry->submeshes[i];
+        const ObjMaterial* material = FindMaterial(library, range->material);
+        Submesh* submesh = &submeshes[i];
+        submesh->firstIndex = (int)range->firstIndex;
+        submesh->indexCount = (int)range->indexCount;
+        submesh->textureID = obj->textureID;
+        submesh->normalID = obj->normalID;
+        submesh->ormID = obj->ormID;
+        submesh->firstMeshlet = (int)range->firstMeshlet;
+        submesh->meshletCount = (int)range->meshletCount;
+        if (material) {
+            fromMaterials++;
+            submesh->textureID = LoadMaterialMap(obj, material->diffuseMap, TEXTURE_KIND_COLOR, obj->textureID);
+            submesh->normalID = LoadMaterialMap(obj, material->normalMap, TEXTURE_KIND_NORMAL, obj->normalID);
+            char orm[TEXTURE_PACKER_NAME_SIZE];
+            SceneManifest_GetOrmName(desc, material->roughnessMap, material->metalnessMap, orm, sizeof(orm));
+            submesh->ormID = LoadMaterialMap(obj, orm, TEXTURE_KIND_DATA, obj->ormID);
+        } else if (range->material[0] != '\0') {
+            printf("[Scene] Material '%s' not found in '%s', using the object textures\n",
+                   range->material, geometry->materialLibrary);
+        }
+        for (int level = 1; level < levels; ++level) {
+            const MeshCacheSubmesh* levelRange = &geometry->submeshes[level * geometry->submeshCount + i];
+            Submesh* levelSubmesh = &submeshes[level * geometry->submeshCount + i];
+            *levelSubmesh = *submesh;
+            levelSubmesh->firstIndex = (int)levelRange->firstIndex;
+            levelSubmesh->indexCount = (int)levelRange->indexCount;
+            levelSubmesh->firstMeshlet = (int)levelRange->firstMeshlet;
+            levelSubmesh->meshletCount = (int)levelRange->meshletCount;
         }
-        else{
-            mesh.metalnessID = 0;
-            printf("Object %d has no metalness map file.\n", i);
+    }
+
+    obj->submeshes = submeshes;
+    obj->submeshCount = geometry->submeshCount;
+    obj->lodCount = geometry->lodCount;
+    memcpy(obj->lodErrors, geometry->lodErrors, sizeof(float) * (size_t)geometry->lodCount);
+    obj->meshlets = mesh->meshlets;
+    obj->meshletCount = geometry->meshletCount;
+    printf("[Scene] %d submeshes (%d with MTL materials) drawn from one VAO\n", obj->submeshCount, fromMaterials);
+}
 
+// Loads the scene.json textures of an object, its occlusion, roughness and metalness maps
+// packed into one. Returns 1 if one that is named fails to load.
+static int LoadObjectTextures(const SceneObjectDesc* desc, int index, RenderableObject* obj) {
+    static const char* textureNames[3] = { "texture", "normal map", "occlusion/roughness/metalness map" };
+    char orm[TEXTURE_PACKER_NAME_SIZE];
+    SceneManifest_GetOrmName(desc, NULL, NULL, orm, sizeof(orm));
+    const char* files[3] = { desc->textures[SCENE_TEXTURE_ALBEDO], desc->textures[SCENE_TEXTURE_NORMAL], orm };
+    TextureKind kinds[3] = { TEXTURE_KIND_COLOR, TEXTURE_KIND_NORMAL, TEXTURE_KIND_DATA };
+    GLuint* ids[3] = { &obj->textureID, &obj->normalID, &obj->ormID };
+    for (int i = 0; i < 3; ++i) {
+        const char* file = files[i];
+        *ids[i] = 0;
+        if (file[0] == '\0') {
+            printf("Object %d has no %s file.\n", index, textureNames[i]);
+            continue;
         }
+        *ids[i] = AcquireObjectTexture(obj, file, kinds[i]);
+        if (*ids[i] == 0) {
+            fprintf(stderr, "Failed to load %s %s!\n", textureNames[i], file);
+            return 1;
+        }
+        printf("Object %d %s %s loaded with ID: %u\n", index, textureNames[i], file, *ids[i]);
+    }
+    return 0;
+}
 
-            
-        cJSON * aoItem = cJSON_GetObjectItem(objItem, "ambient_occlusion");
-        const char* aoFile = NULL;
-        if (aoItem && aoItem->valuestring) {
-            printf("Object %d ambient occlusion map file!\n", i);
-            printf("Ambient occlusion map file: %s\n", aoItem->valuestring);
-            aoFile = aoItem->valuestring;
-            printf("Ambient occlusion map file: %s\n", aoFile);
+// Releases what an object that is not pushed holds.
+static void FreeObject(RenderableObject* obj) {
+    for (int i = 0; i < obj->resourceCount; ++i) ResourceManager_Release(obj->resources[i]);
+    free(obj->resources);
+    free(obj->submeshes);
+}
 
-            GLuint myAOMap = LoadTexture(aoFile); // path to your image
-            if (myAOMap == 0) {
-                fprintf(stderr, "Failed to load ambient occlusion map texture!\n");
-                continue;
+#define SCENE_LOADER_MAX_THREADS 16
+#define SCENE_LOADER_QUEUE_SIZE 256
+
+typedef enum {
+    SCENE_ITEM_TEXTURE,
+    SCENE_ITEM_OBJECT
+} SceneItemType;
+
+// Finished CPU work a loader thread hands to the GL thread.
+typedef struct {
+    SceneItemType type;
+    int failed;
+    char path[TEXTURE_PACKER_NAME_SIZE];   // textures, a file or a packed name
+    TextureKind kind;                 // textures
+    TexturePixels pixels;             // textures
+    int objectIndex;                  // objects, into the manifest
+    int fromCache;                    // objects
+    int sharedMesh;                   // objects whose mesh another object reads
+    MeshPayload mesh;                 // objects, unless streamed or shared
+    MaterialLibrary materials;        // objects
+} SceneLoadItem;
+
+// Loader threads take objects in priority order and push their textures, then the object
+// itself; the GL thread uploads what arrives a frame budget at a time.
+typedef struct {
+    SceneManifest manifest;
+    char filename[SCENE_PATH_SIZE];
+    int* order;                       // object indices, skybox first, then nearest first
+    atomic_int nextObject;            // into order
+    atomic_int finishedThreads;
+    atomic_int cancel;
+    int threadCount;                  // started; 0 makes the GL thread do the loading
+    int innerThreads;                 // for cooking one mesh
+    Thread threads[SCENE_LOADER_MAX_THREADS];
+    ConcurrentQueue queue;
+    // Hash64 of every texture and mesh a thread has taken on, so each is read once; 0 = free slot
+    _Atomic uint64_t* claimed;
+    size_t claimMask;
+    ResourceHandle* held;             // a reference to every texture uploaded, until the end
+    int heldCount;
+    int heldCapacity;
+    SceneLoadItem** deferred;         // objects waiting for textures still on the way
+    int deferredCount;
+    int loadedObjects;
+    int warmMeshes;
+    int coldMeshes;
+    int sharedMeshes;
+    double startTime;
+    double firstObjectTime;
+} SceneLoad;
+
+static SceneLoad* activeLoad = NULL;
+
+// Returns 1 if the caller should read the asset; 0 if another thread already took it on.
+// Meshes seed the hash with their variant, textures with their kind.
+static int Claim(SceneLoad* load, const char* path, uint64_t seed) {
+    uint64_t hash = Hash64(path, strlen(path), seed) | 1;
+    for (size_t i = 0; i <= load->claimMask; ++i) {
+        _Atomic uint64_t* slot = &load->claimed[(hash + i) & load->claimMask];
+        uint64_t expected = 0;
+        if (atomic_compare_exchange_strong(slot, &expected, hash)) return 1;
+        if (expected == hash) return 0;
+    }
+    return 1;   // table full: read it anyway, the GL thread drops the duplicate
+}
 
-            }
-            else{
-                printf("Ambient occlusion map loaded successfully with ID: %u\n", myAOMap);
-                mesh.aoID = myAOMap;
+// Waits while the queue is full; returns 1 if the load was cancelled and the item dropped.
+static int PushItem(SceneLoad* load, SceneLoadItem* item) {
+    while (ConcurrentQueue_Push(&load->queue, item)) {
+        if (atomic_load(&load->cancel)) return 1;
+        YieldThread();
+    }
+    return 0;
+}
+
+static void FreeItem(SceneLoadItem* item) {
+    if (item->type == SCENE_ITEM_TEXTURE) {
+        if (!item->failed) FreeTexturePixels(&item->pixels);
+    } else {
+        FreeMeshPayload(&item->mesh);
+        FreeMaterialLibrary(&item->materials);
+    }
+    free(item);
+}
+
+static void ReadTexture(SceneLoad* load, const char* path, TextureKind kind) {
+    if (path[0] == '\0' || !Claim(load, path, kind)) return;
+    SceneLoadItem* item = calloc(1, sizeof(SceneLoadItem));
+    if (!item) return;   // the GL thread loads it when the object needs it
+    item->type = SCENE_ITEM_TEXTURE;
+    snprintf(item->path, sizeof(item->path), "%s", path);
+    item->kind = kind;
+    item->failed = ReadTexturePixels(path, kind, load->innerThreads, &item->pixels) != 0;
+    if (PushItem(load, item)) FreeItem(item);
+}
+
+// Everything about one object that does not need GL: its scene.json textures, the cooked
+// mesh, the MTL library and the maps it names.
+static void ReadObject(SceneLoad* load, int objectIndex) {
+    const SceneObjectDesc* desc = &load->manifest.objects[objectIndex];
+    SceneLoadItem* item = calloc(1, sizeof(SceneLoadItem));
+    if (!item) {
+        fprintf(stderr, "[Scene] Out of memory loading %s\n", desc->mesh);
+        return;
+    }
+    item->type = SCENE_ITEM_OBJECT;
+    item->objectIndex = objectIndex;
+    char orm[TEXTURE_PACKER_NAME_SIZE];
+    SceneManifest_GetOrmName(desc, NULL, NULL, orm, sizeof(orm));
+    ReadTexture(load, desc->textures[SCENE_TEXTURE_ALBEDO], TEXTURE_KIND_COLOR);
+    ReadTexture(load, desc->textures[SCENE_TEXTURE_NORMAL], TEXTURE_KIND_NORMAL);
+    ReadTexture(load, orm, TEXTURE_KIND_DATA);
+
+    // Streamed meshes go to the GPU while they are parsed, so the GL thread reads them. Objects
+    // drawing a mesh another thread reads wait for its resource, and load its materials then.
+    if (!(desc->flags & SCENE_OBJECT_STREAM) && !Claim(load, desc->mesh, MeshVariant(desc))) {
+        item->sharedMesh = 1;
+    } else if (!(desc->flags & SCENE_OBJECT_STREAM)) {
+        item->failed = ReadMeshPayload(desc->mesh, desc->flags & SCENE_OBJECT_SMOOTH, (VertexLayoutId)desc->vertexLayout,
+                                       load->innerThreads, &item->mesh, &item->fromCache) != 0;
+        if (!item->failed && item->mesh.data.materialLibrary && item->mesh.data.materialLibrary[0] != '\0') {
+            LoadMaterials(item->mesh.data.materialLibrary, &item->materials);
+            for (int m = 0; m < item->materials.count; ++m) {
+                const ObjMaterial* material = &item->materials.materials[m];
+                ReadTexture(load, material->diffuseMap, TEXTURE_KIND_COLOR);
+                ReadTexture(load, material->normalMap, TEXTURE_KIND_NORMAL);
+                SceneManifest_GetOrmName(desc, material->roughnessMap, material->metalnessMap, orm, sizeof(orm));
+                ReadTexture(load, orm, TEXTURE_KIND_DATA);
             }
         }
-        else{
-            printf("Object %d has no ambient occlusion map file.\n", i);
-            mesh.aoID = 0;
+    }
+    if (PushItem(load, item)) FreeItem(item);
+}
+
+static void LoaderThread(void* arg) {
+    SceneLoad* load = (SceneLoad*)arg;
+    while (!atomic_load(&load->cancel)) {
+        int next = atomic_fetch_add(&load->nextObject, 1);
+        if (next >= load->manifest.objectCount) break;
+        ReadObject(load, load->order[next]);
+    }
+    atomic_fetch_add(&load->finishedThreads, 1);
+}
+
+static int TextureReady(const char* path, TextureKind kind) {
+    return path[0] == '\0' || TextureResourceExists(path, kind);
+}
 
+// An object is uploaded once the textures it names are, so AcquireTexture finds them all,
+// and once a mesh it shares is.
+static int ObjectReady(const SceneLoad* load, const SceneLoadItem* item) {
+    const SceneObjectDesc* desc = &load->manifest.objects[item->objectIndex];
+    if (item->sharedMesh && !ResourceManager_Exists(RESOURCE_MESH, desc->mesh, MeshVariant(desc))) return 0;
+    char orm[TEXTURE_PACKER_NAME_SIZE];
+    SceneManifest_GetOrmName(desc, NULL, NULL, orm, sizeof(orm));
+    if (!TextureReady(desc->textures[SCENE_TEXTURE_ALBEDO], TEXTURE_KIND_COLOR) ||
+        !TextureReady(desc->textures[SCENE_TEXTURE_NORMAL], TEXTURE_KIND_NORMAL) ||
+        !TextureReady(orm, TEXTURE_KIND_DATA)) {
+        return 0;
+    }
+    for (int m = 0; m < item->materials.count; ++m) {
+        const ObjMaterial* material = &item->materials.materials[m];
+        SceneManifest_GetOrmName(desc, material->roughnessMap, material->metalnessMap, orm, sizeof(orm));
+        if (!TextureReady(material->diffuseMap, TEXTURE_KIND_COLOR) ||
+            !TextureReady(material->normalMap, TEXTURE_KIND_NORMAL) ||
+            !TextureReady(orm, TEXTURE_KIND_DATA)) {
+            return 0;
         }
+    }
+    return 1;
+}
 
+// The loader keeps the texture until the end, so objects that arrive later find it.
+static void UploadTextureItem(SceneLoad* load, SceneLoadItem* item) {
+    if (!TextureResourceExists(item->path, item->kind)) {
+        ResourceHandle handle = AddTextureResource(item->path, item->kind, item->failed ? NULL : &item->pixels);
+        if (load->heldCount == load->heldCapacity) {
+            int capacity = load->heldCapacity ? load->heldCapacity * 2 : 64;
+            ResourceHandle* grown = realloc(load->held, (size_t)capacity * sizeof(ResourceHandle));
+            if (grown) {
+                load->held = grown;
+                load->heldCapacity = capacity;
+            }
+        }
+        if (load->heldCount < load->heldCapacity) load->held[load->heldCount++] = handle;
+        else ResourceManager_Release(handle);
+    }
+    FreeItem(item);
+}
 
+// Finds the object's mesh, or uploads it and adds it to the resource manager. Returns a
+// handle with a reference for the object, generation 0 if the mesh failed to load.
+static ResourceHandle AcquireObjectMesh(SceneLoad* load, SceneLoadItem* item) {
+    const SceneObjectDesc* desc = &load->manifest.objects[item->objectIndex];
+    const char* meshFile = desc->mesh;
+    uint64_t variant = MeshVariant(desc);
+    ResourceHandle handle = ResourceManager_Find(RESOURCE_MESH, meshFile, variant);
+    if (handle.generation) {
+        load->sharedMeshes++;
+        return handle;
+    }
 
-        
+    MeshGeometry geometry;
+    if (desc->flags & SCENE_OBJECT_STREAM) {
+        if (LoadStreamedGeometry(meshFile, &geometry)) {
+            printf("Failed to stream OBJ: %s\n", meshFile);
+            return handle;
+        }
+        load->coldMeshes++;
+        return AddMeshResource(meshFile, variant, 0, &geometry);
+    }
 
-        printf("Loaded mesh with %zu triangle vertices.\n", mesh.triangle_vertex_count);
+    // The object that claimed the mesh failed, or never got it to the GL thread
+    if (item->sharedMesh) {
+        item->failed = ReadMeshPayload(meshFile, desc->flags & SCENE_OBJECT_SMOOTH, (VertexLayoutId)desc->vertexLayout,
+                                       load->innerThreads, &item->mesh, &item->fromCache) != 0;
+    }
+    if (item->failed) {
+        printf("Failed to load OBJ: %s\n", meshFile);
+        return handle;
+    }
+    uint64_t contentHash = MeshContentHash(item->mesh.sourceHash, variant);
+    handle = ResourceManager_FindByContent(RESOURCE_MESH, meshFile, variant, contentHash);
+    if (handle.generation) {
+        printf("[Scene] %s: same contents as a loaded mesh, shared\n", meshFile);
+        load->sharedMeshes++;
+        return handle;
+    }
+    UploadMeshPayload(&item->mesh, &geometry);
+    if (item->fromCache) load->warmMeshes++;
+    else load->coldMeshes++;
+    return AddMeshResource(meshFile, variant, contentHash, &geometry);
+}
 
-        cJSON* folder = cJSON_GetObjectItem(objItem, "folder");
-         const char* folderString = NULL; 
-         if (folder && folder->valuestring) {
-            folderString = folder->valuestring;
-             char file[512];
-             snprintf(file, sizeof(file), "%s/smoothNormals.bins", folderString);
-             printf("Looking for smooth normals file: %s\n", file);
-             ComputeSmoothNormals(file,&mesh);
-             ComputeTangents(&mesh);
+static void UploadObjectItem(SceneLoad* load, SceneLoadItem* item, ObjectVector* objects) {
+    int i = item->objectIndex;
+    const SceneObjectDesc* desc = &load->manifest.objects[i];
 
-         }
+    RenderableObject obj = {0};
+    if (LoadObjectTextures(desc, i, &obj)) {
+        FreeObject(&obj);
+        FreeItem(item);
+        return;
+    }
+    ResourceHandle meshHandle = AcquireObjectMesh(load, item);
+    const MeshResource* mesh = (const MeshResource*)ResourceManager_Get(meshHandle);
+    if (!mesh || RenderableObject_AddResource(&obj, meshHandle)) {
+        FreeObject(&obj);
+        FreeItem(item);
+        return;
+    }
+    const MeshGeometry* geometry = &mesh->geometry;
+    if (item->sharedMesh && geometry->materialLibrary[0] != '\0') {
+        LoadMaterials(geometry->materialLibrary, &item->materials);
+    }
 
+    obj.castsShadows = (desc->flags & SCENE_OBJECT_SHADOWS) != 0;
+    printf("Object %d will %scast shadows.\n", i, obj.castsShadows ? "" : "NOT ");
+    obj.doubleSided = (desc->flags & SCENE_OBJECT_DOUBLE_SIDED) != 0;
+    obj.vao = geometry->vao;
+    obj.vertexCount = geometry->vertexCount;
+    obj.indexCount = geometry->indexCount;
+    obj.indexType = geometry->indexType;
+    obj.vertexEncoding = geometry->vertexEncoding;
+    obj.quantization = geometry->quantization;
+    memcpy(obj.boundsCenter, geometry->boundsCenter, sizeof(obj.boundsCenter));
+    obj.boundsRadius = geometry->boundsRadius;
+    AssignSubmeshMaterials(&obj, desc, mesh, &item->materials);
+    FreeItem(item);
+
+    memcpy(obj.modelMatrix, desc->modelMatrix, sizeof(float) * 16);
+
+    // Add to vector
+    ObjectVector_Push(objects, obj);
+    if (load->loadedObjects++ == 0) load->firstObjectTime = GetTimeSeconds();
+}
 
+static const SceneManifest* sortManifest;
+static float sortCamera[3];
 
+static float ObjectDistanceSquared(int index) {
+    const float* m = sortManifest->objects[index].modelMatrix;
+    float dx = m[12] - sortCamera[0], dy = m[13] - sortCamera[1], dz = m[14] - sortCamera[2];
+    return dx * dx + dy * dy + dz * dz;
+}
 
+static int CompareLoadPriority(const void* a, const void* b) {
+    int ia = *(const int*)a, ib = *(const int*)b;
+    int skyA = (sortManifest->objects[ia].flags & SCENE_OBJECT_SKYBOX) != 0;
+    int skyB = (sortManifest->objects[ib].flags & SCENE_OBJECT_SKYBOX) != 0;
+    if (skyA != skyB) return skyB - skyA;
+    float da = ObjectDistanceSquared(ia), db = ObjectDistanceSquared(ib);
+    if (da != db) return (da < db) ? -1 : 1;
+    return ia - ib;
+}
 
+static void FreeLoad(SceneLoad* load) {
+    SceneLoadItem* item;
+    while (load->queue.cells && (item = ConcurrentQueue_Pop(&load->queue)) != NULL) FreeItem(item);
+    for (int i = 0; i < load->deferredCount; ++i) FreeItem(load->deferred[i]);
+    for (int i = 0; i < load->heldCount; ++i) ResourceManager_Release(load->held[i]);
+    free(load->held);
+    ConcurrentQueue_Free(&load->queue);
+    free((void*)load->claimed);
+    free(load->deferred);
+    free(load->order);
+    SceneManifest_Free(&load->manifest);
+    free(load);
+}
 
-        printf("Computed smooth normals for mesh.\n");
-        GLuint vao = GLSetup_CreateVAO(mesh.triangle_vertices, mesh.triangle_vertex_count,11);
+// The cooked manifest is used when it matches the scene file; otherwise scene.json is parsed
+// here. "camera_path" keys are played back with P to measure culling along a repeatable route.
+int SceneLoader_Begin(const char* filename) {
+    SceneLoader_Cancel();
+    SceneLoad* load = calloc(1, sizeof(SceneLoad));
+    if (!load) return 2;
+    load->startTime = GetTimeSeconds();
+    snprintf(load->filename, sizeof(load->filename), "%s", filename);
+
+    SceneManifest* manifest = &load->manifest;
+    size_t packedSize;
+    const void* packed = AssetPack_FindMounted(AssetPack_MakeKey(ASSET_PACK_SCENE, filename, NULL, 0),
+                                               ASSET_PACK_SCENE, &packedSize);
+    const char* source = "asset pack";
+    if (!packed || SceneManifest_OpenMemory(packed, packedSize, filename, manifest)) {
+        source = "cooked manifest";
+        if (SceneManifest_Open(filename, manifest)) {
+            source = "scene file";
+            if (SceneManifest_Parse(filename, manifest)) {
+                free(load);
+                return 1;
+            }
+        }
+    }
 
-        cJSON* pos = cJSON_GetObjectItem(objItem, "position");
-        cJSON* rot = cJSON_GetObjectItem(objItem, "rotation");
-        cJSON* scale = cJSON_GetObjectItem(objItem, "scale");
+    int objectCount = manifest->objectCount;
+    size_t claimSize = 64;
+    while (claimSize < (size_t)(objectCount + 16) * (SCENE_TEXTURE_COUNT + 1) * 2) claimSize *= 2;
+    load->claimed = calloc(claimSize, sizeof(uint64_t));
+    load->claimMask = claimSize - 1;
+    load->order = malloc((size_t)objectCount * sizeof(int) + 1);
+    load->deferred = malloc((size_t)objectCount * sizeof(SceneLoadItem*) + 1);
+    if (!load->claimed || !load->order || !load->deferred ||
+        ConcurrentQueue_Init(&load->queue, SCENE_LOADER_QUEUE_SIZE)) {
+        fprintf(stderr, "[Scene] Out of memory loading %s\n", filename);
+        FreeLoad(load);
+        return 2;
+    }
+    for (int i = 0; i < objectCount; ++i) load->order[i] = i;
+    sortManifest = manifest;
+    CameraControl_GetPosition(&sortCamera[0], &sortCamera[1], &sortCamera[2]);
+    qsort(load->order, (size_t)objectCount, sizeof(int), CompareLoadPriority);
+
+    if (manifest->cameraKeyCount > 0) {
+        CameraControl_SetPath(manifest->cameraKeys, manifest->cameraKeyCount, manifest->secondsPerKey);
+        printf("[Scene] Camera path with %d keys, %.1f s each (press P to play)\n", manifest->cameraKeyCount,
+               manifest->secondsPerKey);
+    }
 
-        float model[16];
-        CreateIdentityMatrix(model);
+    if (manifest->textureBudgetMB != SCENE_TEXTURE_BUDGET_UNSET) {
+        TextureStreamer_SetBudget((uint64_t)manifest->textureBudgetMB << 20);
+    }
+    if (TextureStreamer_IsEnabled()) {
+        TextureStreamerStats streamStats;
+        TextureStreamer_GetStats(&streamStats);
+        printf("[Scene] Streaming textures within %.0f MB\n", (double)streamStats.budgetBytes / (1024.0 * 1024.0));
+    }
 
-        CreateScaleMatrix(scale->child->valuedouble, scale->child->next->valuedouble, scale->child->next->next->valuedouble, model);
+    // The GL thread keeps a core for drawing and uploads
+    int hardwareThreads = GetHardwareThreadCount();
+    int threadCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+    if (threadCount > objectCount) threadCount = objectCount;
+    if (threadCount > SCENE_LOADER_MAX_THREADS) threadCount = SCENE_LOADER_MAX_THREADS;
+    load->innerThreads = (threadCount > 0 && threadCount < hardwareThreads) ? hardwareThreads / threadCount : 1;
+    atomic_init(&load->nextObject, 0);
+    atomic_init(&load->finishedThreads, 0);
+    atomic_init(&load->cancel, 0);
+    for (int i = 0; i < threadCount; ++i) {
+        if (StartThread(&load->threads[load->threadCount], LoaderThread, load) == 0) load->threadCount++;
+    }
 
-        float rotMat[16];
-        CreateRotationMatrix(rot->child->valuedouble, rot->child->next->valuedouble, rot->child->next->next->valuedouble, rotMat);
-        MultiplyMatrices(model, rotMat, model);
+    printf("Loading %d objects from %s on %d threads.\n", objectCount, source, load->threadCount);
+    activeLoad = load;
+    return 0;
+}
 
-        float trans[16];
-        CreateTranslationMatrix(pos->child->valuedouble, pos->child->next->valuedouble, pos->child->next->next->valuedouble, trans);
-        MultiplyMatrices(model, trans, model);
-        cJSON* shadows = cJSON_GetObjectItem(objItem, "shadows");
-        
-        RenderableObject obj;
-        if (shadows && shadows->type == cJSON_True) {
-            obj.castsShadows = 1;
-            printf("Object %d will cast shadows.\n", i);
+int SceneLoader_Update(ObjectVector* objects, double budgetSeconds) {
+    SceneLoad* load = activeLoad;
+    if (!load) return 0;
+    double startTime = GetTimeSeconds();
+
+    // Read finished before popping, so an empty queue then means nothing more will come
+    int finished = atomic_load(&load->finishedThreads) == load->threadCount &&
+                   atomic_load(&load->nextObject) >= load->manifest.objectCount;
+    if (load->threadCount == 0 && !finished) {
+        int next = atomic_fetch_add(&load->nextObject, 1);
+        if (next < load->manifest.objectCount) ReadObject(load, load->order[next]);
+    }
 
-        } else {
-            printf("Object %d will NOT cast shadows.\n", i);
-            obj.castsShadows = 0;
+    SceneLoadItem* item;
+    int uploaded = 1;
+    while (uploaded) {
+        uploaded = 0;
+        for (int i = 0; i < load->deferredCount; ++i) {
+            if (ObjectReady(load, load->deferred[i])) {
+                item = load->deferred[i];
+                load->deferred[i--] = load->deferred[--load->deferredCount];
+                UploadObjectItem(load, item, objects);
+                uploaded = 1;
+            }
         }
-        obj.vao = vao;
-        obj.vertexCount = mesh.triangle_vertex_count;
-        obj.textureID = mesh.textureID;
-        obj.normalID = mesh.normalID;
-        obj.roughnessID = mesh.roughnessID;
-        obj.metalnessID = mesh.metalnessID;
-        obj.aoID = mesh.aoID;
-
-        memcpy(obj.modelMatrix, model, sizeof(float) * 16);
+        if (budgetSeconds > 0.0 && GetTimeSeconds() - startTime >= budgetSeconds) return 1;
+        if ((item = ConcurrentQueue_Pop(&load->queue)) != NULL) {
+            if (item->type == SCENE_ITEM_TEXTURE) UploadTextureItem(load, item);
+            else load->deferred[load->deferredCount++] = item;
+            uploaded = 1;
+        }
+    }
+    if (!finished) return 1;
 
-        // Add to vector
-        ObjectVector_Push(objects, obj);
+    // A texture or shared mesh that never arrived (its item could not be allocated, or the
+    // object reading the mesh failed) is loaded here instead
+    while (load->deferredCount > 0) {
+        UploadObjectItem(load, load->deferred[--load->deferredCount], objects);
     }
+    for (int i = 0; i < load->threadCount; ++i) JoinThread(&load->threads[i]);
+    printf("[Scene] Loaded %s in %.1f ms on %d threads, first object after %.1f ms (%d objects, %d meshes from cache, %d from OBJ, %d shared)\n",
+           load->filename, (GetTimeSeconds() - load->startTime) * 1000.0, load->threadCount,
+           load->loadedObjects ? (load->firstObjectTime - load->startTime) * 1000.0 : 0.0, load->loadedObjects,
+           load->warmMeshes, load->coldMeshes, load->sharedMeshes);
+    activeLoad = NULL;
+    FreeLoad(load);
+    return 0;
+}
 
-    cJSON_Delete(root);
+void SceneLoader_Cancel(void) {
+    SceneLoad* load = activeLoad;
+    if (!load) return;
+    atomic_store(&load->cancel, 1);
+    for (int i = 0; i < load->threadCount; ++i) JoinThread(&load->threads[i]);
+    printf("[Scene] Loading %s cancelled after %d objects\n", load->filename, load->loadedObjects);
+    activeLoad = NULL;
+    FreeLoad(load);
+}
+
+void LoadSceneFromFile(const char* filename, ObjectVector* objects) {
+    if (SceneLoader_Begin(filename)) return;
+    while (SceneLoader_Update(objects, 0.0)) {
+        YieldThread();
+    }
 }
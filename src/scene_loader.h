@@ -1,4 +1,18 @@
 #pragma once
 #include "object_manager.h"
 
-void LoadSceneFromFile(const char* filename, ObjectVector* objects);
\ No newline at end of file
+// Scene loading runs on loader threads: file I/O, decoding and mesh processing happen there,
+// and the finished payloads go through a lock-free queue to the GL thread, which uploads them.
+// The skybox is loaded first, then objects nearest the camera.
+
+// Starts loading a scene; a load still running is cancelled. Returns 0 if it started.
+int SceneLoader_Begin(const char* filename);
+// Uploads what the loader threads have finished and adds the objects that are complete.
+// Stops after about budgetSeconds, or when nothing is ready if it is 0. Call on the GL
+// thread; returns 1 while the scene is still loading.
+int SceneLoader_Update(ObjectVector* objects, double budgetSeconds);
+// Stops the loader threads and drops everything not yet uploaded.
+void SceneLoader_Cancel(void);
+
+// Loads the whole scene before returning.
+void LoadSceneFromFile(const char* filename, ObjectVector* objects);
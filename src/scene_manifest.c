@@ -0,0 +1,272 @@
+#include "scene_manifest.h"
+#include "asset_cache.h"
+#include "hash_utils.h"
+#include "texture_packer.h"
+#include "matrix_utils.h"
+#include "vertex_format.h"
+#include "cJSON.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+static const char* textureKeys[SCENE_TEXTURE_COUNT] = {
+    "textures", "normals", "roughness", "metalness", "ambient_occlusion"
+};
+
+void SceneManifest_GetOrmName(const SceneObjectDesc* desc, const char* roughness, const char* metalness, char* out,
+                              size_t outSize) {
+    if (!roughness || roughness[0] == '\0') roughness = desc->textures[SCENE_TEXTURE_ROUGHNESS];
+    if (!metalness || metalness[0] == '\0') metalness = desc->textures[SCENE_TEXTURE_METALNESS];
+    TexturePacker_GetOrmName(desc->textures[SCENE_TEXTURE_AO], roughness, metalness, out, outSize);
+}
+
+void SceneManifest_GetPath(const char* sceneFile, char* out, size_t outSize) {
+    uint64_t key = AssetCache_MakeKey(Hash64(sceneFile, strlen(sceneFile), 0), SCENE_MANIFEST_VERSION, NULL, 0);
+    AssetCache_GetPath(key, SCENE_MANIFEST_EXTENSION, out, outSize);
+}
+
+// Returns 1 when the path does not fit
+static int copyPath(char* out, const cJSON* item) {
+    out[0] = '\0';
+    if (!item || !cJSON_IsString(item)) return 0;
+    return snprintf(out, SCENE_PATH_SIZE, "%s", item->valuestring) >= SCENE_PATH_SIZE;
+}
+
+static void readVector3(const cJSON* item, float fallback, float* out) {
+    const cJSON* value = (item && cJSON_GetArraySize(item) == 3) ? item->child : NULL;
+    for (int i = 0; i < 3; ++i) {
+        out[i] = value ? (float)value->valuedouble : fallback;
+        if (value) value = value->next;
+    }
+}
+
+static int parseObject(const cJSON* objItem, int index, SceneObjectDesc* desc) {
+    memset(desc, 0, sizeof(*desc));
+    const cJSON* meshItem = cJSON_GetObjectItem(objItem, "mesh");
+    if (!meshItem || !cJSON_IsString(meshItem)) {
+        printf("Object %d missing mesh file!\n", index);
+        return 1;
+    }
+    int tooLong = copyPath(desc->mesh, meshItem);
+    for (int slot = 0; slot < SCENE_TEXTURE_COUNT; ++slot) {
+        tooLong |= copyPath(desc->textures[slot], cJSON_GetObjectItem(objItem, textureKeys[slot]));
+    }
+    if (tooLong) {
+        printf("[Scene] Object %d has a path longer than %d characters, skipped\n", index, SCENE_PATH_SIZE - 1);
+        return 1;
+    }
+
+    const cJSON* folder = cJSON_GetObjectItem(objItem, "folder");
+    if (folder && folder->valuestring) desc->flags |= SCENE_OBJECT_SMOOTH;
+    if (cJSON_IsTrue(cJSON_GetObjectItem(objItem, "stream"))) desc->flags |= SCENE_OBJECT_STREAM;
+    if (cJSON_IsTrue(cJSON_GetObjectItem(objItem, "shadows"))) desc->flags |= SCENE_OBJECT_SHADOWS;
+    if (cJSON_IsTrue(cJSON_GetObjectItem(objItem, "double_sided"))) desc->flags |= SCENE_OBJECT_DOUBLE_SIDED;
+    if (cJSON_IsTrue(cJSON_GetObjectItem(objItem, "skybox"))) desc->flags |= SCENE_OBJECT_SKYBOX;
+
+    const cJSON* vertexFormat = cJSON_GetObjectItem(objItem, "vertex_format");
+    desc->vertexLayout = VERTEX_LAYOUT_PACKED20;
+    if (vertexFormat && vertexFormat->valuestring) {
+        VertexLayoutId layout = VertexFormat_ParseLayoutName(vertexFormat->valuestring);
+        if (layout) {
+            desc->vertexLayout = layout;
+        } else {
+            printf("Object %d has unknown vertex_format '%s', using packed20\n", index, vertexFormat->valuestring);
+        }
+    }
+
+    float position[3], rotation[3], scale[3];
+    readVector3(cJSON_GetObjectItem(objItem, "position"), 0.0f, position);
+    readVector3(cJSON_GetObjectItem(objItem, "rotation"), 0.0f, rotation);
+    readVector3(cJSON_GetObjectItem(objItem, "scale"), 1.0f, scale);
+
+    float* model = desc->modelMatrix;
+    CreateIdentityMatrix(model);
+    CreateScaleMatrix(scale[0], scale[1], scale[2], model);
+    float rotMat[16];
+    CreateRotationMatrix(rotation[0], rotation[1], rotation[2], rotMat);
+    MultiplyMatrices(model, rotMat, model);
+    float trans[16];
+    CreateTranslationMatrix(position[0], position[1], position[2], trans);
+    MultiplyMatrices(model, trans, model);
+    return 0;
+}
+
+// "camera_path": {"seconds_per_key": s, "keys": [[x, y, z, pitch, yaw], ...]}
+static void parseCameraPath(const cJSON* pathItem, SceneManifest* manifest) {
+    const cJSON* keysItem = cJSON_GetObjectItem(pathItem, "keys");
+    const cJSON* secondsItem = cJSON_GetObjectItem(pathItem, "seconds_per_key");
+    const cJSON* keyItem = keysItem ? keysItem->child : NULL;
+    for (; keyItem && manifest->cameraKeyCount < CAMERA_PATH_MAX_KEYS; keyItem = keyItem->next) {
+        if (cJSON_GetArraySize(keyItem) != CAMERA_PATH_KEY_FLOATS) {
+            printf("[Scene] Camera path key %d needs %d numbers, skipped\n", manifest->cameraKeyCount,
+                   CAMERA_PATH_KEY_FLOATS);
+            continue;
+        }
+        const cJSON* value = keyItem->child;
+        for (int i = 0; i < CAMERA_PATH_KEY_FLOATS; ++i, value = value->next) {
+            manifest->cameraKeys[manifest->cameraKeyCount * CAMERA_PATH_KEY_FLOATS + i] = (float)value->valuedouble;
+        }
+        manifest->cameraKeyCount++;
+    }
+    manifest->secondsPerKey = (secondsItem && cJSON_IsNumber(secondsItem)) ? (float)secondsItem->valuedouble : 1.0f;
+}
+
+int SceneManifest_Parse(const char* sceneFile, SceneManifest* manifest) {
+    memset(manifest, 0, sizeof(*manifest));
+    FileMap_Init(&manifest->map);
+
+    FileMap map;
+    if (FileMap_Open(sceneFile, &map)) {
+        printf("Failed to open scene file: %s\n", sceneFile);
+        return 1;
+    }
+    manifest->sceneHash = Hash64(map.data, map.size, 0);
+    cJSON* root = map.data ? cJSON_ParseWithLength(map.data, map.size) : NULL;
+    FileMap_Close(&map);
+    if (!root) {
+        printf("Failed to parse scene JSON.\n");
+        return 1;
+    }
+
+    const cJSON* objectsArray = cJSON_GetObjectItem(root, "objects");
+    int objectCount = cJSON_GetArraySize(objectsArray);
+    manifest->ownedObjects = malloc((size_t)objectCount * sizeof(SceneObjectDesc) + 1);
+    if (!manifest->ownedObjects) {
+        cJSON_Delete(root);
+        return 2;
+    }
+    int index = 0;
+    for (const cJSON* objItem = objectsArray ? objectsArray->child : NULL; objItem; objItem = objItem->next, ++index) {
+        if (parseObject(objItem, index, &manifest->ownedObjects[manifest->objectCount]) == 0) {
+            manifest->objectCount++;
+        }
+    }
+    manifest->objects = manifest->ownedObjects;
+
+    const cJSON* cameraPath = cJSON_GetObjectItem(root, "camera_path");
+    if (cameraPath) {
+        parseCameraPath(cameraPath, manifest);
+    }
+    const cJSON* budget = cJSON_GetObjectItem(root, "texture_budget_mb");
+    manifest->textureBudgetMB = SCENE_TEXTURE_BUDGET_UNSET;
+    if (budget && cJSON_IsNumber(budget)) {
+        double megabytes = budget->valuedouble;
+        manifest->textureBudgetMB = (megabytes <= 0.0) ? 0 : (megabytes >= 1e9) ? 1000000000u : (uint32_t)megabytes;
+    }
+    cJSON_Delete(root);
+    return 0;
+}
+
+static int validateObject(const SceneObjectDesc* desc) {
+    if (!memchr(desc->mesh, '\0', SCENE_PATH_SIZE) || desc->mesh[0] == '\0') return 1;
+    for (int slot = 0; slot < SCENE_TEXTURE_COUNT; ++slot) {
+        if (!memchr(desc->textures[slot], '\0', SCENE_PATH_SIZE)) return 1;
+    }
+    return VertexFormat_GetLayout((VertexLayoutId)desc->vertexLayout) == NULL;
+}
+
+// sceneHash is NULL when the scene file is not checked
+static int openData(SceneManifest* manifest, const char* data, size_t size, const char* name, const uint64_t* sceneHash) {
+    const SceneManifestHeader* h = (const SceneManifestHeader*)data;
+    int valid = size >= sizeof(SceneManifestHeader) && h->magic == SCENE_MANIFEST_MAGIC &&
+                h->version == SCENE_MANIFEST_VERSION && h->cameraKeyCount <= CAMERA_PATH_MAX_KEYS &&
+                (size - sizeof(SceneManifestHeader)) / sizeof(SceneObjectDesc) >= h->objectCount;
+    if (!valid) {
+        printf("[Scene] %s is not a scene manifest of version %d\n", name, SCENE_MANIFEST_VERSION);
+        return 1;
+    }
+    if (sceneHash && h->sceneHash != *sceneHash) {
+        printf("[Scene] %s was cooked from a different scene file\n", name);
+        return 1;
+    }
+
+    const SceneObjectDesc* objects = (const SceneObjectDesc*)(data + sizeof(SceneManifestHeader));
+    for (uint32_t i = 0; i < h->objectCount; ++i) {
+        if (validateObject(&objects[i])) {
+            printf("[Scene] %s has a bad object %u\n", name, i);
+            return 1;
+        }
+    }
+    manifest->objects = objects;
+    manifest->objectCount = (int)h->objectCount;
+    manifest->sceneHash = h->sceneHash;
+    manifest->cameraKeyCount = (int)h->cameraKeyCount;
+    manifest->secondsPerKey = h->secondsPerKey;
+    manifest->textureBudgetMB = h->textureBudgetMB;
+    memcpy(manifest->cameraKeys, h->cameraKeys, sizeof(manifest->cameraKeys));
+    return 0;
+}
+
+int SceneManifest_Open(const char* sceneFile, SceneManifest* manifest) {
+    memset(manifest, 0, sizeof(*manifest));
+    FileMap_Init(&manifest->map);
+
+    char path[ASSET_CACHE_PATH_SIZE];
+    SceneManifest_GetPath(sceneFile, path, sizeof(path));
+    uint64_t sceneHash;
+    if (HashFile64(sceneFile, 0, &sceneHash)) {
+        printf("Failed to open scene file: %s\n", sceneFile);
+        return 1;
+    }
+    struct stat st;
+    if (stat(path, &st) != 0) {
+        printf("[Scene] No cooked manifest at %s\n", path);
+        return 1;
+    }
+    if (FileMap_Open(path, &manifest->map)) {
+        return 1;
+    }
+    if (openData(manifest, manifest->map.data, manifest->map.size, path, &sceneHash)) {
+        SceneManifest_Free(manifest);
+        return 1;
+    }
+    AssetCache_Touch(path);
+    return 0;
+}
+
+int SceneManifest_OpenMemory(const void* data, size_t size, const char* name, SceneManifest* manifest) {
+    memset(manifest, 0, sizeof(*manifest));
+    FileMap_Init(&manifest->map);
+    if (openData(manifest, (const char*)data, size, name, NULL)) {
+        SceneManifest_Free(manifest);
+        return 1;
+    }
+    return 0;
+}
+
+int SceneManifest_Write(const char* sceneFile, const SceneManifest* manifest) {
+    SceneManifestHeader h;
+    memset(&h, 0, sizeof(h));
+    h.magic = SCENE_MANIFEST_MAGIC;
+    h.version = SCENE_MANIFEST_VERSION;
+    h.sceneHash = manifest->sceneHash;
+    h.objectCount = (uint32_t)manifest->objectCount;
+    h.cameraKeyCount = (uint32_t)manifest->cameraKeyCount;
+    h.secondsPerKey = manifest->secondsPerKey;
+    h.textureBudgetMB = manifest->textureBudgetMB;
+    memcpy(h.cameraKeys, manifest->cameraKeys, sizeof(h.cameraKeys));
+
+    char path[ASSET_CACHE_PATH_SIZE];
+    char tempPath[ASSET_CACHE_PATH_SIZE];
+    SceneManifest_GetPath(sceneFile, path, sizeof(path));
+    FILE* f = AssetCache_BeginWrite(path, tempPath, sizeof(tempPath));
+    if (!f) {
+        return 1;
+    }
+    size_t count = (size_t)manifest->objectCount;
+    int failed = fwrite(&h, sizeof(h), 1, f) != 1;
+    failed |= fwrite(manifest->objects, sizeof(SceneObjectDesc), count, f) != count;
+    if (AssetCache_EndWrite(f, tempPath, path, failed)) {
+        return 1;
+    }
+    printf("[Scene] Wrote %s (%d objects)\n", path, manifest->objectCount);
+    return 0;
+}
+
+void SceneManifest_Free(SceneManifest* manifest) {
+    if (!manifest) return;
+    FileMap_Close(&manifest->map);
+    free(manifest->ownedObjects);
+    memset(manifest, 0, sizeof(*manifest));
+}
@@ -0,0 +1,89 @@
+#ifndef SCENE_MANIFEST_H
+#define SCENE_MANIFEST_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "file_map.h"
+#include "camera_control.h"
+
+// Flat description of scene.json: one fixed-size record per object with its source paths,
+// processing options and model matrix. The cook tool writes it to the asset cache next to
+// the cooked meshes and textures, and the runtime maps it instead of parsing the JSON.
+// Entries are keyed by the scene path and checked against the hash of the scene file.
+
+#define SCENE_MANIFEST_MAGIC   0x53443342u   // "B3DS"
+#define SCENE_MANIFEST_VERSION 3
+#define SCENE_MANIFEST_EXTENSION ".scene"
+#define SCENE_PATH_SIZE 260
+#define SCENE_TEXTURE_BUDGET_UNSET UINT32_MAX   // scene.json leaves the budget to the runtime
+
+typedef enum {
+    SCENE_TEXTURE_ALBEDO,              // "textures"
+    SCENE_TEXTURE_NORMAL,              // "normals"
+    SCENE_TEXTURE_ROUGHNESS,           // "roughness"
+    SCENE_TEXTURE_METALNESS,           // "metalness"
+    SCENE_TEXTURE_AO,                  // "ambient_occlusion"
+    SCENE_TEXTURE_COUNT
+} SceneTextureSlot;
+
+enum {
+    SCENE_OBJECT_SMOOTH       = 1u << 0,   // "folder" is set: smooth normals and tangents
+    SCENE_OBJECT_STREAM       = 1u << 1,
+    SCENE_OBJECT_SHADOWS      = 1u << 2,
+    SCENE_OBJECT_DOUBLE_SIDED = 1u << 3,
+    SCENE_OBJECT_SKYBOX       = 1u << 4    // loaded before everything else
+};
+
+typedef struct {
+    char mesh[SCENE_PATH_SIZE];
+    char textures[SCENE_TEXTURE_COUNT][SCENE_PATH_SIZE];   // empty when not set
+    uint32_t flags;
+    uint32_t vertexLayout;             // VertexLayoutId
+    float modelMatrix[16];
+} SceneObjectDesc;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t sceneHash;                // Hash64 of the scene file
+    uint32_t objectCount;
+    uint32_t cameraKeyCount;
+    float secondsPerKey;
+    uint32_t textureBudgetMB;          // "texture_budget_mb", SCENE_TEXTURE_BUDGET_UNSET if not set
+    float cameraKeys[CAMERA_PATH_MAX_KEYS * CAMERA_PATH_KEY_FLOATS];
+} SceneManifestHeader;
+
+// Either parsed from JSON into owned memory or mapped from a cooked manifest.
+typedef struct {
+    FileMap map;                       // unused when parsed or opened from memory
+    SceneObjectDesc* ownedObjects;
+    const SceneObjectDesc* objects;
+    int objectCount;
+    uint64_t sceneHash;
+    int cameraKeyCount;
+    float secondsPerKey;
+    uint32_t textureBudgetMB;          // GPU memory for streamed textures; 0 turns streaming off
+    float cameraKeys[CAMERA_PATH_MAX_KEYS * CAMERA_PATH_KEY_FLOATS];
+} SceneManifest;
+
+// Name of the texture the object's occlusion, roughness and metalness maps are packed into
+// (see texture_packer.h), empty when it has none of them. A material's roughness and
+// metalness maps replace the object's when set; both may be NULL.
+void SceneManifest_GetOrmName(const SceneObjectDesc* desc, const char* roughness, const char* metalness, char* out,
+                              size_t outSize);
+
+// Asset cache path of the manifest for a scene file.
+void SceneManifest_GetPath(const char* sceneFile, char* out, size_t outSize);
+
+// Reads and parses scene.json. Returns 0 on success, 1 if it cannot be read or parsed, 2 when out of memory.
+int SceneManifest_Parse(const char* sceneFile, SceneManifest* manifest);
+// Maps a cooked manifest and checks it was cooked from the scene file as it is now. Returns 0 if usable.
+int SceneManifest_Open(const char* sceneFile, SceneManifest* manifest);
+// Validates a manifest already in memory, e.g. an asset pack entry, which must stay valid
+// until SceneManifest_Free. The scene file is not checked.
+int SceneManifest_OpenMemory(const void* data, size_t size, const char* name, SceneManifest* manifest);
+// Writes the manifest through a temporary file. Returns 0 on success.
+int SceneManifest_Write(const char* sceneFile, const SceneManifest* manifest);
+void SceneManifest_Free(SceneManifest* manifest);
+
+#endif
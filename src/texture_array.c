@@ -0,0 +1,397 @@
+#include "texture_array.h"
+#include "texture_loader.h"
+#include "texture_streamer.h"
+#include "resource_manager.h"
+#include "thread_utils.h"
+#include "time_utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <GL/gl.h>
+#include <GL/glext.h>
+
+typedef struct {
+    ResourceHandle handle;      // of the 2D texture
+    GLuint textureID;
+    TexturePixels pixels;
+    int readable;
+    int atlas;                  // small enough for an atlas page
+    int group;                  // -1 = stays 2D
+    uint32_t layer;
+    uint32_t x;                 // atlas position of the texture at level 0, inside its gutter
+    uint32_t y;
+} ArrayTexture;
+
+typedef struct {
+    int first;                  // members are textures[first..first+count-1]
+    int count;
+    int atlas;
+    uint32_t width;             // of a layer
+    uint32_t height;
+    uint32_t levelCount;
+    uint32_t layers;
+    GLuint arrayID;             // 0 = not built
+    ResourceHandle handle;
+    int stamp;                  // last object given a reference, + 1
+} ArrayGroup;
+
+static int compareHandle(const void* a, const void* b) {
+    const ResourceHandle* x = a;
+    const ResourceHandle* y = b;
+    return (x->index > y->index) - (x->index < y->index);
+}
+
+// Groups end up in runs: atlas textures by format, tallest first for the shelves, and the
+// others by format, size and mip count.
+static int compareTexture(const void* a, const void* b) {
+    const ArrayTexture* x = a;
+    const ArrayTexture* y = b;
+    if (x->readable != y->readable) return y->readable - x->readable;
+    if (!x->readable) return 0;
+    const TextureCacheData* p = &x->pixels.data;
+    const TextureCacheData* q = &y->pixels.data;
+    if (x->atlas != y->atlas) return y->atlas - x->atlas;
+    if (p->format != q->format) return (p->format > q->format) - (p->format < q->format);
+    if (p->channels != q->channels) return (p->channels > q->channels) - (p->channels < q->channels);
+    if (x->atlas) {
+        if (p->height != q->height) return (p->height < q->height) - (p->height > q->height);
+        return (p->width < q->width) - (p->width > q->width);
+    }
+    if (p->width != q->width) return (p->width > q->width) - (p->width < q->width);
+    if (p->height != q->height) return (p->height > q->height) - (p->height < q->height);
+    return (p->levelCount > q->levelCount) - (p->levelCount < q->levelCount);
+}
+
+static int sameGroup(const ArrayTexture* x, const ArrayTexture* y) {
+    const TextureCacheData* p = &x->pixels.data;
+    const TextureCacheData* q = &y->pixels.data;
+    if (!x->readable || !y->readable || x->atlas != y->atlas) return 0;
+    if (p->format != q->format || p->channels != q->channels) return 0;
+    return x->atlas || (p->width == q->width && p->height == q->height && p->levelCount == q->levelCount);
+}
+
+static int compareTextureID(const void* a, const void* b) {
+    const ArrayTexture* x = *(ArrayTexture* const*)a;
+    const ArrayTexture* y = *(ArrayTexture* const*)b;
+    return (x->textureID > y->textureID) - (x->textureID < y->textureID);
+}
+
+static int isAtlasSize(const TextureCacheData* data) {
+    return data->width <= TEXTURE_ATLAS_MAX_SIZE && data->height <= TEXTURE_ATLAS_MAX_SIZE &&
+           data->width % TEXTURE_ATLAS_GUTTER == 0 && data->height % TEXTURE_ATLAS_GUTTER == 0 &&
+           data->levelCount >= TEXTURE_ATLAS_LEVELS;
+}
+
+// Shelf packing on pages of pageSize, each texture in a cell with its gutter. Returns the
+// number of pages; with apply 0 the positions are only counted.
+static uint32_t packAtlas(ArrayTexture* textures, int count, uint32_t pageSize, int apply) {
+    uint32_t page = 0, x = 0, y = 0, shelfHeight = 0;
+    for (int i = 0; i < count; ++i) {
+        uint32_t cellWidth = textures[i].pixels.data.width + 2 * TEXTURE_ATLAS_GUTTER;
+        uint32_t cellHeight = textures[i].pixels.data.height + 2 * TEXTURE_ATLAS_GUTTER;
+        if (x + cellWidth > pageSize) {
+            y += shelfHeight;
+            x = 0;
+            shelfHeight = 0;
+        }
+        if (y + cellHeight > pageSize) {
+            page++;
+            y = 0;
+        }
+        if (apply) {
+            textures[i].layer = page;
+            textures[i].x = x + TEXTURE_ATLAS_GUTTER;
+            textures[i].y = y + TEXTURE_ATLAS_GUTTER;
+        }
+        x += cellWidth;
+        if (cellHeight > shelfHeight) shelfHeight = cellHeight;
+    }
+    return page + 1;
+}
+
+// Copies a level of an atlas texture into its page, block by block (4x4 texels for the
+// compressed formats, one texel otherwise), repeating its edge blocks into the gutter.
+static void blitAtlasLevel(const ArrayTexture* texture, uint32_t level, uint8_t* page, uint32_t pageSize) {
+    const TextureCacheData* data = &texture->pixels.data;
+    uint32_t blockSize = data->format == TEXTURE_FORMAT_RAW ? 1 : 4;
+    size_t blockBytes = (size_t)TextureCache_GetLevelSize((TextureFormat)data->format, data->channels, blockSize,
+                                                          blockSize);
+    uint32_t pageBlocks = (pageSize >> level) / blockSize;
+    uint32_t widthBlocks = data->levels[level].width / blockSize;
+    uint32_t heightBlocks = data->levels[level].height / blockSize;
+    uint32_t gutter = (TEXTURE_ATLAS_GUTTER >> level) / blockSize;
+    uint32_t originX = (texture->x >> level) / blockSize - gutter;
+    uint32_t originY = (texture->y >> level) / blockSize - gutter;
+    const uint8_t* source = data->pixels + data->levels[level].offset;
+    for (uint32_t row = 0; row < heightBlocks + 2 * gutter; ++row) {
+        uint32_t sourceRow = row < gutter ? 0 : (row - gutter < heightBlocks ? row - gutter : heightBlocks - 1);
+        const uint8_t* from = source + (size_t)sourceRow * widthBlocks * blockBytes;
+        uint8_t* to = page + ((size_t)(originY + row) * pageBlocks + originX) * blockBytes;
+        for (uint32_t g = 0; g < gutter; ++g) {
+            memcpy(to + g * blockBytes, from, blockBytes);
+            memcpy(to + (gutter + widthBlocks + g) * blockBytes, from + (widthBlocks - 1) * blockBytes, blockBytes);
+        }
+        memcpy(to + gutter * blockBytes, from, widthBlocks * blockBytes);
+    }
+}
+
+static void deleteArrayResource(void* data) {
+    FreeTexture((GLuint)(uintptr_t)data);
+}
+
+// Uploads every level of the group's array and registers it as a texture resource. Returns
+// 0 on success, 2 when out of memory.
+static int createArray(ArrayGroup* group, ArrayTexture* textures, int arrayIndex, size_t* gpuBytes) {
+    const TextureCacheData* format = &textures[group->first].pixels.data;
+    size_t largest = (size_t)TextureCache_GetLevelSize((TextureFormat)format->format, format->channels, group->width,
+                                                       group->height) * group->layers;
+    uint8_t* level = malloc(largest);
+    if (!level) return 2;
+
+    GLuint arrayID;
+    glGenTextures(1, &arrayID);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, arrayID);
+    size_t bytes = 0;
+    for (uint32_t l = 0; l < group->levelCount; ++l) {
+        uint32_t width = group->width >> l ? group->width >> l : 1;
+        uint32_t height = group->height >> l ? group->height >> l : 1;
+        size_t layerBytes = (size_t)TextureCache_GetLevelSize((TextureFormat)format->format, format->channels, width,
+                                                              height);
+        if (group->atlas) memset(level, 0, layerBytes * group->layers);
+        for (int i = group->first; i < group->first + group->count; ++i) {
+            const ArrayTexture* texture = &textures[i];
+            if (group->atlas) {
+                blitAtlasLevel(texture, l, level + texture->layer * layerBytes, group->width);
+            } else {
+                const TextureCacheData* data = &texture->pixels.data;
+                memcpy(level + texture->layer * layerBytes, data->pixels + data->levels[l].offset, layerBytes);
+            }
+        }
+        UploadTextureArrayLevel(format, l, width, height, group->layers, level);
+        bytes += layerBytes * group->layers;
+    }
+    free(level);
+    SetTextureSampling(GL_TEXTURE_2D_ARRAY, format, group->levelCount);
+    // Wrapped coordinates are folded into the texture's part of the layer by the shader;
+    // atlas pages clamp so their borders do not filter against the opposite side
+    GLint wrap = group->atlas ? GL_CLAMP_TO_EDGE : GL_REPEAT;
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, wrap);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, wrap);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    char name[96];
+    snprintf(name, sizeof(name), "texture array %d: %s %ux%u, %u %s", arrayIndex,
+             TextureCache_GetFormatName((TextureFormat)format->format), group->width, group->height, group->layers,
+             group->atlas ? "atlas pages" : "layers");
+    ResourceData resource = { (void*)(uintptr_t)arrayID, 0, bytes, deleteArrayResource };
+    group->handle = ResourceManager_Add(RESOURCE_TEXTURE, name, 0, 0, &resource);
+    if (!group->handle.generation) return 2;
+    group->arrayID = arrayID;
+    *gpuBytes += bytes;
+    return 0;
+}
+
+static ArrayTexture* findTexture(ArrayTexture** byID, int count, GLuint textureID) {
+    ArrayTexture key;
+    key.textureID = textureID;
+    ArrayTexture* keyPointer = &key;
+    ArrayTexture** found = textureID ? bsearch(&keyPointer, byID, (size_t)count, sizeof(*byID), compareTextureID)
+                                     : NULL;
+    return found ? *found : NULL;
+}
+
+static const ArrayGroup* findGroup(ArrayTexture** byID, int count, const ArrayGroup* groups, GLuint textureID) {
+    const ArrayTexture* texture = findTexture(byID, count, textureID);
+    if (!texture || texture->group < 0 || !groups[texture->group].arrayID) return NULL;
+    return &groups[texture->group];
+}
+
+// Points a texture unit at the array layer of its texture, if it has one the object holds.
+static void assignLayer(ArrayTexture** byID, int count, const ArrayGroup* groups, int stamp, GLuint* textureID,
+                        TextureLayer* layer) {
+    const ArrayGroup* group = findGroup(byID, count, groups, *textureID);
+    if (!group || group->stamp != stamp) return;
+    const ArrayTexture* texture = findTexture(byID, count, *textureID);
+    layer->arrayID = group->arrayID;
+    layer->layer = (float)texture->layer;
+    if (group->atlas) {
+        layer->uvTransform[0] = (float)texture->pixels.data.width / (float)group->width;
+        layer->uvTransform[1] = (float)texture->pixels.data.height / (float)group->height;
+        layer->uvTransform[2] = (float)texture->x / (float)group->width;
+        layer->uvTransform[3] = (float)texture->y / (float)group->height;
+    } else {
+        layer->uvTransform[0] = 1.0f;
+        layer->uvTransform[1] = 1.0f;
+        layer->uvTransform[2] = 0.0f;
+        layer->uvTransform[3] = 0.0f;
+    }
+    *textureID = 0;
+}
+
+static int isTexture(ResourceHandle handle) {
+    ResourceType type;
+    const char* path;
+    uint64_t variant;
+    return ResourceManager_GetKey(handle, &type, &path, &variant) == 0 && type == RESOURCE_TEXTURE;
+}
+
+// Swaps the object's references to textures now in arrays for one reference per array. The
+// array references come first, so a unit only moves to an array the object holds.
+static void assignObject(RenderableObject* obj, int stamp, ArrayTexture** byID, int count, ArrayGroup* groups) {
+    int resourceCount = obj->resourceCount;
+    for (int r = 0; r < resourceCount; ++r) {
+        ResourceHandle handle = obj->resources[r];
+        if (!isTexture(handle)) continue;
+        ArrayGroup* group = (ArrayGroup*)findGroup(byID, count, groups, GetTextureID(handle));
+        if (!group || group->stamp == stamp) continue;
+        ResourceManager_AddRef(group->handle);
+        if (RenderableObject_AddResource(obj, group->handle) == 0) group->stamp = stamp;
+    }
+
+    assignLayer(byID, count, groups, stamp, &obj->textureID, &obj->layers[0]);
+    assignLayer(byID, count, groups, stamp, &obj->normalID, &obj->layers[1]);
+    assignLayer(byID, count, groups, stamp, &obj->ormID, &obj->layers[2]);
+    int submeshes = obj->submeshes ? (obj->lodCount + 1) * obj->submeshCount : 0;
+    for (int i = 0; i < submeshes; ++i) {
+        Submesh* submesh = &obj->submeshes[i];
+        assignLayer(byID, count, groups, stamp, &submesh->textureID, &submesh->layers[0]);
+        assignLayer(byID, count, groups, stamp, &submesh->normalID, &submesh->layers[1]);
+        assignLayer(byID, count, groups, stamp, &submesh->ormID, &submesh->layers[2]);
+    }
+
+    for (int r = resourceCount - 1; r >= 0; --r) {
+        ResourceHandle handle = obj->resources[r];
+        if (!isTexture(handle)) continue;
+        const ArrayGroup* group = findGroup(byID, count, groups, GetTextureID(handle));
+        if (group && group->stamp == stamp) RenderableObject_RemoveResource(obj, handle);
+    }
+}
+
+int TextureArray_Build(ObjectVector* objects, TextureArrayStats* stats) {
+    memset(stats, 0, sizeof(*stats));
+    double startTime = GetTimeSeconds();
+
+    // Every texture an object holds, once
+    int handleCount = 0;
+    for (int i = 0; i < objects->size; ++i) handleCount += objects->data[i].resourceCount;
+    ResourceHandle* handles = malloc((size_t)handleCount * sizeof(ResourceHandle) + 1);
+    if (!handles) return 2;
+    int count = 0;
+    for (int i = 0; i < objects->size; ++i) {
+        const RenderableObject* obj = &objects->data[i];
+        for (int r = 0; r < obj->resourceCount; ++r) {
+            if (isTexture(obj->resources[r])) handles[count++] = obj->resources[r];
+        }
+    }
+    qsort(handles, (size_t)count, sizeof(ResourceHandle), compareHandle);
+    int unique = 0;
+    for (int i = 0; i < count; ++i) {
+        if (unique == 0 || handles[unique - 1].index != handles[i].index) handles[unique++] = handles[i];
+    }
+    count = unique;
+
+    ArrayTexture* textures = calloc((size_t)count + 1, sizeof(ArrayTexture));
+    ArrayGroup* groups = calloc((size_t)count + 1, sizeof(ArrayGroup));
+    ArrayTexture** byID = malloc(((size_t)count + 1) * sizeof(ArrayTexture*));
+    if (!textures || !groups || !byID) {
+        free(handles);
+        free(textures);
+        free(groups);
+        free(byID);
+        return 2;
+    }
+
+    // Cooked pixels come back from the pack or the asset cache; textures the streamer holds
+    // at part of their resolution are left to it
+    int threadCount = GetHardwareThreadCount();
+    for (int i = 0; i < count; ++i) {
+        ArrayTexture* texture = &textures[i];
+        texture->handle = handles[i];
+        texture->textureID = GetTextureID(handles[i]);
+        texture->group = -1;
+        ClearTexturePixels(&texture->pixels);
+        ResourceType type;
+        const char* path;
+        uint64_t variant;
+        ResourceManager_GetKey(handles[i], &type, &path, &variant);
+        if (!texture->textureID || TextureStreamer_IsStreamed(texture->textureID)) continue;
+        if (ReadTexturePixels(path, (TextureKind)variant, threadCount, &texture->pixels)) continue;
+        texture->readable = 1;
+        texture->atlas = isAtlasSize(&texture->pixels.data);
+    }
+    free(handles);
+    qsort(textures, (size_t)count, sizeof(ArrayTexture), compareTexture);
+
+    // Runs of two or more share an array; a single texture gains nothing from one
+    int groupCount = 0;
+    for (int first = 0; first < count;) {
+        int end = first + 1;
+        while (end < count && sameGroup(&textures[first], &textures[end])) end++;
+        while (first < end) {
+            ArrayTexture* run = &textures[first];
+            int runCount = end - first;
+            if (!run->readable || runCount < 2) break;
+            ArrayGroup* group = &groups[groupCount];
+            group->first = first;
+            group->atlas = run->atlas;
+            group->levelCount = run->pixels.data.levelCount;
+            if (run->atlas) {
+                uint32_t pageSize = TEXTURE_ATLAS_MAX_SIZE;
+                while (pageSize < TEXTURE_ATLAS_PAGE_SIZE && packAtlas(run, runCount, pageSize, 0) > 1) pageSize *= 2;
+                // Pages past the layer limit are left out with their textures
+                while (packAtlas(run, runCount, pageSize, 0) > TEXTURE_ARRAY_MAX_LAYERS) runCount--;
+                group->layers = packAtlas(run, runCount, pageSize, 1);
+                group->width = pageSize;
+                group->height = pageSize;
+                group->levelCount = TEXTURE_ATLAS_LEVELS;
+            } else {
+                if (runCount > TEXTURE_ARRAY_MAX_LAYERS) runCount = TEXTURE_ARRAY_MAX_LAYERS;
+                if (runCount < 2) break;
+                for (int i = 0; i < runCount; ++i) run[i].layer = (uint32_t)i;
+                group->layers = (uint32_t)runCount;
+                group->width = run->pixels.data.width;
+                group->height = run->pixels.data.height;
+            }
+            group->count = runCount;
+            for (int i = 0; i < runCount; ++i) run[i].group = groupCount;
+            groupCount++;
+            first += runCount;
+        }
+        first = end;
+    }
+
+    for (int g = 0; g < groupCount; ++g) {
+        ArrayGroup* group = &groups[g];
+        if (createArray(group, textures, stats->arrayCount, &stats->gpuBytes)) {
+            fprintf(stderr, "[TextureArrays] Out of memory building an array, its textures stay 2D\n");
+            continue;
+        }
+        stats->arrayCount++;
+        if (group->atlas) {
+            stats->atlasPages += (int)group->layers;
+            stats->atlasTextures += group->count;
+        } else {
+            stats->layerTextures += group->count;
+        }
+    }
+    stats->flatTextures = count - stats->atlasTextures - stats->layerTextures;
+
+    for (int i = 0; i < count; ++i) byID[i] = &textures[i];
+    qsort(byID, (size_t)count, sizeof(*byID), compareTextureID);
+    for (int i = 0; i < objects->size; ++i) assignObject(&objects->data[i], i + 1, byID, count, groups);
+
+    // The objects hold the arrays now
+    for (int g = 0; g < groupCount; ++g) {
+        if (groups[g].arrayID) ResourceManager_Release(groups[g].handle);
+    }
+    for (int i = 0; i < count; ++i) FreeTexturePixels(&textures[i].pixels);
+    free(textures);
+    free(groups);
+    free(byID);
+
+    printf("[TextureArrays] %d arrays (%.2f MB) in %.1f ms: %d textures as layers, %d in %d atlas pages, "
+           "%d left 2D\n", stats->arrayCount, stats->gpuBytes / (1024.0 * 1024.0),
+           (GetTimeSeconds() - startTime) * 1000.0, stats->layerTextures, stats->atlasTextures, stats->atlasPages,
+           stats->flatTextures);
+    return 0;
+}
@@ -0,0 +1,39 @@
+#ifndef TEXTURE_ARRAY_H
+#define TEXTURE_ARRAY_H
+
+#include <stddef.h>
+#include "object_manager.h"
+
+// Texture arrays built from the textures of loaded objects, so that draws move between
+// materials by changing a layer uniform instead of binding textures. Textures of one size,
+// format and mip count become the layers of a GL_TEXTURE_2D_ARRAY. Small textures are packed
+// into atlas pages, each surrounded by a gutter of repeated edge texels, and the pages of one
+// format become the layers of an array. Every texture unit of an object then names an array,
+// a layer and the UV transform of its texture within the layer. Textures the streamer holds
+// at part of their resolution stay 2D, since their residency is per texture.
+// Everything here runs on the GL thread.
+
+#define TEXTURE_ATLAS_MAX_SIZE 256       // larger textures get a layer of their own
+#define TEXTURE_ATLAS_PAGE_SIZE 1024     // largest page; fewer textures get a smaller one
+#define TEXTURE_ATLAS_LEVELS 3           // mip levels of the pages
+// Gutter around each atlas texture at level 0, one 4x4 block at the last page level. Atlas
+// textures are multiples of it in size, so their blocks stay aligned at every page level.
+#define TEXTURE_ATLAS_GUTTER (4 << (TEXTURE_ATLAS_LEVELS - 1))
+#define TEXTURE_ARRAY_MAX_LAYERS 256     // the least GL_MAX_ARRAY_TEXTURE_LAYERS of GL 3.3
+
+typedef struct {
+    int arrayCount;
+    int atlasPages;
+    int layerTextures;          // textures with a layer of their own
+    int atlasTextures;          // textures in atlas pages
+    int flatTextures;           // left 2D: streamed, alone in their group, or unreadable
+    size_t gpuBytes;            // of the arrays
+} TextureArrayStats;
+
+// Moves the textures the objects draw into arrays, points their texture units at the layers,
+// and swaps their references to the 2D textures for references to the arrays, so 2D
+// textures no object draws anymore are freed. Textures whose array cannot be built stay 2D.
+// Returns 0 on success, 2 when out of memory before anything changed.
+int TextureArray_Build(ObjectVector* objects, TextureArrayStats* stats);
+
+#endif
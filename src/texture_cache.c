@@ -0,0 +1,229 @@
+#include "texture_cache.h"
+#include "asset_cache.h"
+#include "block_codec.h"
+#include "thread_utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+static int blockCompression = 1;
+
+void TextureCache_SetBlockCompression(int enabled) {
+    blockCompression = enabled != 0;
+}
+
+int TextureCache_GetBlockCompression(void) {
+    return blockCompression;
+}
+
+const char* TextureCache_GetFormatName(TextureFormat format) {
+    static const char* names[TEXTURE_FORMAT_COUNT] = { "raw", "BC1", "BC3", "BC4", "BC5" };
+    return (format < TEXTURE_FORMAT_COUNT) ? names[format] : "unknown";
+}
+
+uint64_t TextureCache_GetLevelSize(TextureFormat format, uint32_t channels, uint32_t width, uint32_t height) {
+    uint64_t blocks = (uint64_t)((width + 3) / 4) * ((height + 3) / 4);
+    switch (format) {
+    case TEXTURE_FORMAT_BC1:
+    case TEXTURE_FORMAT_BC4:
+        return blocks * 8;
+    case TEXTURE_FORMAT_BC3:
+    case TEXTURE_FORMAT_BC5:
+        return blocks * 16;
+    default:
+        return (uint64_t)width * height * channels;
+    }
+}
+
+void TextureCache_GetPath(uint64_t sourceHash, TextureKind kind, char* out, size_t outSize) {
+    uint32_t params[2] = { (uint32_t)kind, (uint32_t)blockCompression };
+    uint64_t key = AssetCache_MakeKey(sourceHash, TEXTURE_PROCESSING_VERSION, params, sizeof(params));
+    AssetCache_GetPath(key, TEXTURE_CACHE_EXTENSION, out, outSize);
+}
+
+// sourceHash is NULL when the source is not checked
+static int validateHeader(const TextureCache* cache, const char* cachePath, const uint64_t* sourceHash,
+                          TextureKind kind) {
+    const TextureCacheHeader* h = cache->header;
+
+    if (h->magic != TEXTURE_CACHE_MAGIC) {
+        printf("[TextureCache] %s is not a texture cache\n", cachePath);
+        return 1;
+    }
+    if (h->version != TEXTURE_CACHE_VERSION || h->processingVersion != TEXTURE_PROCESSING_VERSION) {
+        printf("[TextureCache] %s has version %u/%u, expected %u/%u\n", cachePath,
+               h->version, h->processingVersion, TEXTURE_CACHE_VERSION, TEXTURE_PROCESSING_VERSION);
+        return 1;
+    }
+    if (sourceHash && h->sourceHash != *sourceHash) {
+        printf("[TextureCache] %s was cooked from a different source\n", cachePath);
+        return 1;
+    }
+    if (h->kind != (uint32_t)kind) {
+        printf("[TextureCache] %s was cooked as kind %u, expected %u\n", cachePath, h->kind, (uint32_t)kind);
+        return 1;
+    }
+    if (h->format != TEXTURE_FORMAT_RAW && !blockCompression) {
+        printf("[TextureCache] %s is block compressed, which is turned off\n", cachePath);
+        return 1;
+    }
+    if (h->width == 0 || h->height == 0 || h->channels < 1 || h->channels > 4 ||
+        h->levelCount < 1 || h->levelCount > TEXTURE_CACHE_MAX_LEVELS || h->format >= TEXTURE_FORMAT_COUNT ||
+        h->pixelOffset % TEXTURE_CACHE_ALIGNMENT || h->pixelOffset < sizeof(TextureCacheHeader) ||
+        h->pixelOffset > cache->size || h->storedSize > cache->size - h->pixelOffset || h->pixelSize > SIZE_MAX ||
+        (h->pixelEncoding == ASSET_CACHE_STORED && h->storedSize != h->pixelSize) ||
+        (h->pixelEncoding != ASSET_CACHE_STORED && h->pixelEncoding != ASSET_CACHE_BLOCK_CODEC)) {
+        printf("[TextureCache] %s is truncated or has a bad header\n", cachePath);
+        return 1;
+    }
+    for (uint32_t i = 0; i < h->levelCount; ++i) {
+        const TextureCacheLevel* level = &h->levels[i];
+        uint64_t levelSize = TextureCache_GetLevelSize((TextureFormat)h->format, h->channels, level->width,
+                                                       level->height);
+        if (level->width == 0 || level->height == 0 || level->offset + levelSize > h->pixelSize ||
+            (i == 0 && (level->width != h->width || level->height != h->height))) {
+            printf("[TextureCache] %s has a bad mip level %u\n", cachePath, i);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int openData(TextureCache* cache, const char* name, const uint64_t* sourceHash, TextureKind kind) {
+    if (cache->size < sizeof(TextureCacheHeader)) {
+        printf("[TextureCache] %s is too small\n", name);
+        return 1;
+    }
+    cache->header = (const TextureCacheHeader*)cache->data;
+    if (validateHeader(cache, name, sourceHash, kind)) {
+        return 1;
+    }
+    const TextureCacheHeader* h = cache->header;
+    cache->pixels = (const unsigned char*)cache->data + h->pixelOffset;
+    if (h->pixelEncoding == ASSET_CACHE_BLOCK_CODEC) {
+        cache->decoded = malloc((size_t)h->pixelSize + 1);
+        if (!cache->decoded) {
+            printf("[TextureCache] Out of memory decoding %s\n", name);
+            return 1;
+        }
+        if (BlockCodec_DecompressStream(cache->pixels, (size_t)h->storedSize, cache->decoded, (size_t)h->pixelSize,
+                                        GetHardwareThreadCount())) {
+            printf("[TextureCache] %s has corrupt compressed pixels\n", name);
+            return 1;
+        }
+        cache->pixels = (const unsigned char*)cache->decoded;
+    }
+    return 0;
+}
+
+int TextureCache_Open(const char* cachePath, uint64_t sourceHash, TextureKind kind, TextureCache* cache) {
+    memset(cache, 0, sizeof(*cache));
+    FileMap_Init(&cache->map);
+
+    struct stat st;
+    if (stat(cachePath, &st) != 0) {
+        printf("[TextureCache] No cache at %s\n", cachePath);
+        return 1;
+    }
+    if (FileMap_Open(cachePath, &cache->map)) {
+        return 1;
+    }
+    cache->data = cache->map.data;
+    cache->size = cache->map.size;
+    if (openData(cache, cachePath, &sourceHash, kind)) {
+        TextureCache_Close(cache);
+        return 1;
+    }
+    return 0;
+}
+
+int TextureCache_OpenMemory(const void* data, size_t size, const char* name, TextureKind kind, TextureCache* cache) {
+    memset(cache, 0, sizeof(*cache));
+    FileMap_Init(&cache->map);
+    cache->data = (const char*)data;
+    cache->size = size;
+    if (openData(cache, name, NULL, kind)) {
+        TextureCache_Close(cache);
+        return 1;
+    }
+    return 0;
+}
+
+void TextureCache_Close(TextureCache* cache) {
+    if (!cache) return;
+    FileMap_Close(&cache->map);
+    free(cache->decoded);
+    cache->decoded = NULL;
+    cache->data = NULL;
+    cache->size = 0;
+    cache->header = NULL;
+    cache->pixels = NULL;
+}
+
+void TextureCache_GetData(const TextureCache* cache, TextureCacheData* data) {
+    const TextureCacheHeader* h = cache->header;
+    data->pixels = cache->pixels;
+    data->pixelSize = h->pixelSize;
+    data->width = h->width;
+    data->height = h->height;
+    data->channels = h->channels;
+    data->levelCount = h->levelCount;
+    data->kind = h->kind;
+    data->format = h->format;
+    memcpy(data->levels, h->levels, sizeof(data->levels));
+}
+
+int TextureCache_Write(const char* cachePath, uint64_t sourceHash, const TextureCacheData* data) {
+    static const char zeros[TEXTURE_CACHE_ALIGNMENT] = {0};
+
+    TextureCacheHeader h;
+    memset(&h, 0, sizeof(h));
+    h.magic = TEXTURE_CACHE_MAGIC;
+    h.version = TEXTURE_CACHE_VERSION;
+    h.processingVersion = TEXTURE_PROCESSING_VERSION;
+    h.width = data->width;
+    h.height = data->height;
+    h.channels = data->channels;
+    h.levelCount = data->levelCount;
+    h.kind = data->kind;
+    h.format = data->format;
+    h.sourceHash = sourceHash;
+    h.pixelOffset = (sizeof(TextureCacheHeader) + TEXTURE_CACHE_ALIGNMENT - 1) & ~(uint64_t)(TEXTURE_CACHE_ALIGNMENT - 1);
+    h.pixelSize = data->pixelSize;
+    memcpy(h.levels, data->levels, sizeof(h.levels));
+
+    void* stream = NULL;
+    size_t streamSize = 0;
+    const void* stored = data->pixels;
+    h.pixelEncoding = ASSET_CACHE_STORED;
+    h.storedSize = h.pixelSize;
+    if (AssetCache_GetCompression() &&
+        BlockCodec_CompressStream(data->pixels, (size_t)h.pixelSize, GetHardwareThreadCount(), &stream, &streamSize) == 0 &&
+        streamSize < h.pixelSize) {
+        stored = stream;
+        h.pixelEncoding = ASSET_CACHE_BLOCK_CODEC;
+        h.storedSize = streamSize;
+    }
+
+    char tempPath[ASSET_CACHE_PATH_SIZE];
+    FILE* f = AssetCache_BeginWrite(cachePath, tempPath, sizeof(tempPath));
+    if (!f) {
+        free(stream);
+        return 1;
+    }
+
+    size_t padding = (size_t)h.pixelOffset - sizeof(h);
+    int failed = fwrite(&h, sizeof(h), 1, f) != 1;
+    failed |= fwrite(zeros, 1, padding, f) != padding;
+    failed |= fwrite(stored, 1, (size_t)h.storedSize, f) != (size_t)h.storedSize;
+    free(stream);
+    if (AssetCache_EndWrite(f, tempPath, cachePath, failed)) {
+        return 1;
+    }
+
+    printf("[TextureCache] Wrote %s (%ux%u, %u channels, %s, %u levels, %zu KB, %zu KB stored)\n", cachePath,
+           h.width, h.height, h.channels, TextureCache_GetFormatName((TextureFormat)h.format), h.levelCount, (size_t)(h.pixelOffset + h.pixelSize) / 1024,
+           (size_t)(h.pixelOffset + h.storedSize) / 1024);
+    return 0;
+}
@@ -0,0 +1,113 @@
+#ifndef TEXTURE_CACHE_H
+#define TEXTURE_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "file_map.h"
+
+// Cooked texture file: header, then a 64-byte aligned block with every mip level, largest
+// first, rows top to bottom. Levels hold 8-bit channels interleaved (what stb_image decodes
+// to) or, with block compression on, BCn blocks of 4x4 texels in the same order.
+// Files live in the asset cache under a key of the source hash, TEXTURE_PROCESSING_VERSION
+// and the texture kind, so warm starts skip PNG/JPEG decoding and mip generation. With compression on, the pixel
+// block is stored as a BlockCodec stream and decoded into memory on open.
+
+#define TEXTURE_CACHE_MAGIC   0x54443342u   // "B3DT"
+#define TEXTURE_CACHE_VERSION 5
+#define TEXTURE_CACHE_EXTENSION ".tex"
+#define TEXTURE_CACHE_ALIGNMENT 64
+#define TEXTURE_CACHE_MAX_LEVELS 16         // down to 1x1 from 32768 pixels
+
+// Bump when decoding or mip generation changes its output for the same source.
+#define TEXTURE_PROCESSING_VERSION 3
+
+// What a texture holds, which decides how its mip levels are filtered.
+typedef enum {
+    TEXTURE_KIND_COLOR,         // sRGB color, averaged as linear light; alpha is linear
+    TEXTURE_KIND_DATA,          // roughness, metalness, AO: linear values
+    TEXTURE_KIND_NORMAL,        // tangent-space normals, averaged as vectors and renormalized
+    TEXTURE_KIND_COUNT
+} TextureKind;
+
+// How the levels of a cooked texture are stored; BCn formats upload as is.
+typedef enum {
+    TEXTURE_FORMAT_RAW,         // 8-bit channels
+    TEXTURE_FORMAT_BC1,         // RGB, 8 bytes per block
+    TEXTURE_FORMAT_BC3,         // RGBA: BC1 color and BC4 alpha, 16 bytes per block
+    TEXTURE_FORMAT_BC4,         // channel 0, 8 bytes per block
+    TEXTURE_FORMAT_BC5,         // channels 0 and 1 (normal X and Y), 16 bytes per block
+    TEXTURE_FORMAT_COUNT
+} TextureFormat;
+
+typedef struct {
+    uint64_t offset;            // bytes from the start of the pixel block
+    uint32_t width;
+    uint32_t height;
+} TextureCacheLevel;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t processingVersion;
+    uint32_t width;
+    uint32_t height;
+    uint32_t channels;          // 1..4
+    uint32_t levelCount;
+    uint32_t pixelEncoding;     // ASSET_CACHE_STORED or ASSET_CACHE_BLOCK_CODEC
+    uint32_t kind;              // TextureKind
+    uint32_t format;            // TextureFormat
+    uint64_t sourceHash;        // Hash64 of the source file
+    uint64_t pixelOffset;
+    uint64_t pixelSize;         // all levels, decoded
+    uint64_t storedSize;        // bytes of the pixel block in the file
+    TextureCacheLevel levels[TEXTURE_CACHE_MAX_LEVELS];
+} TextureCacheHeader;
+
+typedef struct {
+    FileMap map;                // unused when opened from memory
+    const char* data;
+    size_t size;
+    void* decoded;              // decoded pixel block of a compressed cache, NULL otherwise
+    const TextureCacheHeader* header;
+    const unsigned char* pixels;
+} TextureCache;
+
+// Everything TextureCache_Write stores besides the source hash.
+typedef struct {
+    const unsigned char* pixels;     // levels packed as described by levels[]
+    uint64_t pixelSize;
+    uint32_t width;
+    uint32_t height;
+    uint32_t channels;
+    uint32_t levelCount;
+    uint32_t kind;                   // TextureKind
+    uint32_t format;                 // TextureFormat; channels stays that of the source
+    TextureCacheLevel levels[TEXTURE_CACHE_MAX_LEVELS];
+} TextureCacheData;
+
+// Block compression is on by default. It is part of the cache key, so turning it off (e.g. when
+// the GL lacks S3TC) finds or cooks uncompressed entries instead.
+void TextureCache_SetBlockCompression(int enabled);
+int TextureCache_GetBlockCompression(void);
+
+const char* TextureCache_GetFormatName(TextureFormat format);
+// Bytes of one level in the given format.
+uint64_t TextureCache_GetLevelSize(TextureFormat format, uint32_t channels, uint32_t width, uint32_t height);
+
+// Asset cache path of the cooked texture for a source hash and kind.
+void TextureCache_GetPath(uint64_t sourceHash, TextureKind kind, char* out, size_t outSize);
+
+// Maps and validates a cache cooked as kind from a source with the given hash. Returns 0 if it
+// can be used as is.
+int TextureCache_Open(const char* cachePath, uint64_t sourceHash, TextureKind kind, TextureCache* cache);
+// Validates a cache already in memory, e.g. an asset pack entry, which must stay valid while
+// the cache is open. The source is not checked.
+int TextureCache_OpenMemory(const void* data, size_t size, const char* name, TextureKind kind, TextureCache* cache);
+void TextureCache_Close(TextureCache* cache);
+// Describes an open cache the way TextureCache_Write takes it; the pixels are in the cache data.
+void TextureCache_GetData(const TextureCache* cache, TextureCacheData* data);
+
+// Writes the cache through a temporary file, so readers never see a partial one. Returns 0 on success.
+int TextureCache_Write(const char* cachePath, uint64_t sourceHash, const TextureCacheData* data);
+
+#endif
@@ -0,0 +1,450 @@
+#include "texture_compressor.h"
+#include "thread_utils.h"
+#include <math.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BLOCK_ROWS_PER_TASK 4
+
+typedef struct {
+    uint8_t texels[16][4];      // RGBA; missing channels are 0, missing alpha 255
+    uint32_t mask;              // texels inside the level, which count towards the error
+} Block;
+
+static void loadBlock(const uint8_t* pixels, uint32_t width, uint32_t height, uint32_t channels, uint32_t blockX,
+                      uint32_t blockY, Block* block) {
+    block->mask = 0;
+    for (uint32_t i = 0; i < 16; ++i) {
+        uint32_t x = blockX * 4 + (i & 3), y = blockY * 4 + (i >> 2);
+        if (x < width && y < height) block->mask |= 1u << i;
+        if (x >= width) x = width - 1;
+        if (y >= height) y = height - 1;
+        const uint8_t* texel = &pixels[((size_t)y * width + x) * channels];
+        for (uint32_t c = 0; c < 4; ++c) block->texels[i][c] = (c < channels) ? texel[c] : (c == 3 ? 255 : 0);
+    }
+}
+
+// BC4: two 8-bit endpoints and a 3-bit index per texel. a0 > a1 interpolates 6 values between
+// them; otherwise 4, plus 0 and 255.
+
+typedef struct {
+    int a0;
+    int a1;
+    uint8_t indices[16];
+    uint32_t error;
+} Bc4Fit;
+
+static void bc4Palette(int a0, int a1, int palette[8]) {
+    palette[0] = a0;
+    palette[1] = a1;
+    if (a0 > a1) {
+        for (int i = 1; i < 7; ++i) palette[i + 1] = ((7 - i) * a0 + i * a1 + 3) / 7;
+    } else {
+        for (int i = 1; i < 5; ++i) palette[i + 1] = ((5 - i) * a0 + i * a1 + 2) / 5;
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+}
+
+// Keeps the endpoints if they fit the block better than the best so far.
+static void bc4Try(const uint8_t values[16], uint32_t mask, int a0, int a1, Bc4Fit* best) {
+    int palette[8];
+    bc4Palette(a0, a1, palette);
+    Bc4Fit fit;
+    fit.a0 = a0;
+    fit.a1 = a1;
+    fit.error = 0;
+    // Entries run a0, 2.., a1 in order, so a value's position along the ramp lands within one
+    // entry of the nearest; the 6-value mode also has 0 and 255 to check
+    static const uint8_t ramp8[8] = { 0, 2, 3, 4, 5, 6, 7, 1 };
+    static const uint8_t ramp6[6] = { 0, 2, 3, 4, 5, 1 };
+    const uint8_t* ramp = (a0 > a1) ? ramp8 : ramp6;
+    int steps = (a0 > a1) ? 7 : 5;
+    float scale = (a0 != a1) ? (float)steps / (float)(a1 - a0) : 0.0f;
+    for (int i = 0; i < 16; ++i) {
+        int position = (int)((values[i] - a0) * scale + 0.5f);
+        position = (position < 0) ? 0 : (position > steps) ? steps : position;
+        int first = (position > 0) ? position - 1 : 0, last = (position < steps) ? position + 1 : steps;
+        int bestIndex = 0, bestError = 256 * 256;
+        for (int k = first; k <= last; ++k) {
+            int d = values[i] - palette[ramp[k]];
+            if (d * d < bestError) {
+                bestError = d * d;
+                bestIndex = ramp[k];
+            }
+        }
+        if (a0 <= a1) {
+            int low = values[i], high = 255 - values[i];
+            if (low * low < bestError) {
+                bestError = low * low;
+                bestIndex = 6;
+            }
+            if (high * high < bestError) {
+                bestError = high * high;
+                bestIndex = 7;
+            }
+        }
+        fit.indices[i] = (uint8_t)bestIndex;
+        if (mask & (1u << i)) fit.error += (uint32_t)bestError;
+    }
+    if (fit.error < best->error) *best = fit;
+}
+
+// Least-squares endpoints for the 8-value indices of fit; 0 if they are degenerate.
+static int bc4Refine(const uint8_t values[16], const Bc4Fit* fit, int* a0, int* a1) {
+    float a = 0.0f, b = 0.0f, c = 0.0f, x0 = 0.0f, x1 = 0.0f;
+    for (int i = 0; i < 16; ++i) {
+        int index = fit->indices[i];
+        float t = (index == 0) ? 0.0f : (index == 1) ? 1.0f : (index - 1) / 7.0f;
+        a += (1.0f - t) * (1.0f - t);
+        b += (1.0f - t) * t;
+        c += t * t;
+        x0 += (1.0f - t) * values[i];
+        x1 += t * values[i];
+    }
+    float det = a * c - b * b;
+    if (fabsf(det) < 1e-6f) return 0;
+    float e0 = (c * x0 - b * x1) / det, e1 = (a * x1 - b * x0) / det;
+    *a0 = (int)fminf(fmaxf(e0 + 0.5f, 0.0f), 255.0f);
+    *a1 = (int)fminf(fmaxf(e1 + 0.5f, 0.0f), 255.0f);
+    if (*a0 < *a1) {
+        int swap = *a0;
+        *a0 = *a1;
+        *a1 = swap;
+    }
+    return *a0 != *a1;
+}
+
+// Returns the squared error over the masked texels.
+static uint32_t encodeBc4(const uint8_t values[16], uint32_t mask, uint8_t out[8]) {
+    int low = 255, high = 0, innerLow = 255, innerHigh = 0;
+    for (int i = 0; i < 16; ++i) {
+        int v = values[i];
+        if (v < low) low = v;
+        if (v > high) high = v;
+        if (v > 0 && v < 255) {
+            if (v < innerLow) innerLow = v;
+            if (v > innerHigh) innerHigh = v;
+        }
+    }
+
+    Bc4Fit best;
+    best.error = UINT32_MAX;
+    bc4Try(values, mask, high, low, &best);
+    if (low != high) {
+        int a0, a1;
+        if (bc4Refine(values, &best, &a0, &a1)) bc4Try(values, mask, a0, a1, &best);
+        // The 6-value mode spends its interpolated values on the texels between 0 and 255
+        if ((low == 0 || high == 255) && innerLow <= innerHigh) bc4Try(values, mask, innerLow, innerHigh, &best);
+    }
+
+    out[0] = (uint8_t)best.a0;
+    out[1] = (uint8_t)best.a1;
+    uint64_t bits = 0;
+    for (int i = 0; i < 16; ++i) bits |= (uint64_t)best.indices[i] << (3 * i);
+    for (int i = 0; i < 6; ++i) out[2 + i] = (uint8_t)(bits >> (8 * i));
+    return best.error;
+}
+
+// BC1: two RGB565 endpoints and a 2-bit index per texel. Endpoints are always ordered
+// c0 >= c1, which selects the four-color mode BC3 also uses for its color block.
+
+typedef struct {
+    uint16_t c0;
+    uint16_t c1;
+    uint8_t indices[16];
+    uint32_t error;
+} Bc1Fit;
+
+static uint16_t pack565(const float color[3]) {
+    int r = (int)(fminf(fmaxf(color[0], 0.0f), 255.0f) * (31.0f / 255.0f) + 0.5f);
+    int g = (int)(fminf(fmaxf(color[1], 0.0f), 255.0f) * (63.0f / 255.0f) + 0.5f);
+    int b = (int)(fminf(fmaxf(color[2], 0.0f), 255.0f) * (31.0f / 255.0f) + 0.5f);
+    return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+static void unpack565(uint16_t color, int rgb[3]) {
+    int r = (color >> 11) & 31, g = (color >> 5) & 63, b = color & 31;
+    rgb[0] = (r << 3) | (r >> 2);
+    rgb[1] = (g << 2) | (g >> 4);
+    rgb[2] = (b << 3) | (b >> 2);
+}
+
+static void bc1Try(const Block* block, uint16_t c0, uint16_t c1, Bc1Fit* best) {
+    if (c0 < c1) {
+        uint16_t swap = c0;
+        c0 = c1;
+        c1 = swap;
+    }
+    int palette[4][3];
+    unpack565(c0, palette[0]);
+    unpack565(c1, palette[1]);
+    for (int c = 0; c < 3; ++c) {
+        palette[2][c] = (2 * palette[0][c] + palette[1][c] + 1) / 3;
+        palette[3][c] = (palette[0][c] + 2 * palette[1][c] + 1) / 3;
+    }
+
+    Bc1Fit fit;
+    fit.c0 = c0;
+    fit.c1 = c1;
+    fit.error = 0;
+    for (int i = 0; i < 16; ++i) {
+        const uint8_t* texel = block->texels[i];
+        int bestIndex = 0, bestError = 3 * 256 * 256;
+        for (int j = 0; j < 4; ++j) {
+            int dr = texel[0] - palette[j][0], dg = texel[1] - palette[j][1], db = texel[2] - palette[j][2];
+            int error = dr * dr + dg * dg + db * db;
+            if (error < bestError) {
+                bestError = error;
+                bestIndex = j;
+            }
+        }
+        fit.indices[i] = (uint8_t)bestIndex;
+        if (block->mask & (1u << i)) fit.error += (uint32_t)bestError;
+    }
+    if (fit.error < best->error) *best = fit;
+}
+
+// A solid block is matched channel by channel with the endpoint pair whose 2/3 point is
+// closest, which gets nearer than rounding to 565.
+static void bc1Solid(const Block* block, Bc1Fit* best) {
+    static const int bits[3] = { 5, 6, 5 };
+    int endpoints[2][3];
+    for (int c = 0; c < 3; ++c) {
+        int max = (1 << bits[c]) - 1, value = block->texels[0][c];
+        int q = (value * max + 127) / 255, bestError = 256;
+        for (int a = q - 2; a <= q + 2; ++a) {
+            for (int b = q - 2; b <= q + 2; ++b) {
+                if (a < 0 || b < 0 || a > max || b > max) continue;
+                int ea = (a << (8 - bits[c])) | (a >> (2 * bits[c] - 8));
+                int eb = (b << (8 - bits[c])) | (b >> (2 * bits[c] - 8));
+                int error = abs((2 * ea + eb + 1) / 3 - value);
+                if (error < bestError) {
+                    bestError = error;
+                    endpoints[0][c] = a;
+                    endpoints[1][c] = b;
+                }
+            }
+        }
+    }
+    uint16_t c0 = (uint16_t)((endpoints[0][0] << 11) | (endpoints[0][1] << 5) | endpoints[0][2]);
+    uint16_t c1 = (uint16_t)((endpoints[1][0] << 11) | (endpoints[1][1] << 5) | endpoints[1][2]);
+    bc1Try(block, c0, c1, best);
+}
+
+// The block's extreme colors along the principal axis of its covariance.
+static void bc1AxisEndpoints(const Block* block, float endpoints[2][3]) {
+    float mean[3] = { 0.0f, 0.0f, 0.0f };
+    for (int i = 0; i < 16; ++i) {
+        for (int c = 0; c < 3; ++c) mean[c] += block->texels[i][c];
+    }
+    for (int c = 0; c < 3; ++c) mean[c] /= 16.0f;
+    float cov[6] = { 0.0f };
+    for (int i = 0; i < 16; ++i) {
+        float r = block->texels[i][0] - mean[0], g = block->texels[i][1] - mean[1];
+        float b = block->texels[i][2] - mean[2];
+        cov[0] += r * r;
+        cov[1] += r * g;
+        cov[2] += r * b;
+        cov[3] += g * g;
+        cov[4] += g * b;
+        cov[5] += b * b;
+    }
+
+    // Power iteration from the covariance row of the widest channel
+    float axis[3];
+    if (cov[0] >= cov[3] && cov[0] >= cov[5]) {
+        axis[0] = cov[0], axis[1] = cov[1], axis[2] = cov[2];
+    } else if (cov[3] >= cov[5]) {
+        axis[0] = cov[1], axis[1] = cov[3], axis[2] = cov[4];
+    } else {
+        axis[0] = cov[2], axis[1] = cov[4], axis[2] = cov[5];
+    }
+    for (int iteration = 0; iteration < 8; ++iteration) {
+        float x = cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2];
+        float y = cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2];
+        float z = cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2];
+        float scale = fmaxf(fabsf(x), fmaxf(fabsf(y), fabsf(z)));
+        if (scale < 1e-12f) break;
+        axis[0] = x / scale;
+        axis[1] = y / scale;
+        axis[2] = z / scale;
+    }
+
+    int low = 0, high = 0;
+    float lowDot = INFINITY, highDot = -INFINITY;
+    for (int i = 0; i < 16; ++i) {
+        const uint8_t* texel = block->texels[i];
+        float d = texel[0] * axis[0] + texel[1] * axis[1] + texel[2] * axis[2];
+        if (d < lowDot) {
+            lowDot = d;
+            low = i;
+        }
+        if (d > highDot) {
+            highDot = d;
+            high = i;
+        }
+    }
+    for (int c = 0; c < 3; ++c) {
+        endpoints[0][c] = block->texels[high][c];
+        endpoints[1][c] = block->texels[low][c];
+    }
+}
+
+// Least-squares endpoints for the indices of fit; 0 if they are degenerate.
+static int bc1Refine(const Block* block, const Bc1Fit* fit, float endpoints[2][3]) {
+    static const float weights[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+    float a = 0.0f, b = 0.0f, c = 0.0f, x0[3] = { 0.0f }, x1[3] = { 0.0f };
+    for (int i = 0; i < 16; ++i) {
+        float w0 = weights[fit->indices[i]], w1 = 1.0f - w0;
+        a += w0 * w0;
+        b += w0 * w1;
+        c += w1 * w1;
+        for (int k = 0; k < 3; ++k) {
+            x0[k] += w0 * block->texels[i][k];
+            x1[k] += w1 * block->texels[i][k];
+        }
+    }
+    float det = a * c - b * b;
+    if (fabsf(det) < 1e-6f) return 0;
+    for (int k = 0; k < 3; ++k) {
+        endpoints[0][k] = (c * x0[k] - b * x1[k]) / det;
+        endpoints[1][k] = (a * x1[k] - b * x0[k]) / det;
+    }
+    return 1;
+}
+
+// Returns the squared error over the masked texels, summed over RGB.
+static uint32_t encodeBc1(const Block* block, uint8_t out[8]) {
+    int solid = 1;
+    for (int i = 1; i < 16 && solid; ++i) {
+        solid = memcmp(block->texels[i], block->texels[0], 3) == 0;
+    }
+
+    Bc1Fit best;
+    best.error = UINT32_MAX;
+    if (solid) {
+        bc1Solid(block, &best);
+    } else {
+        float endpoints[2][3];
+        bc1AxisEndpoints(block, endpoints);
+        bc1Try(block, pack565(endpoints[0]), pack565(endpoints[1]), &best);
+        for (int iteration = 0; iteration < 2 && best.error > 0; ++iteration) {
+            uint32_t error = best.error;
+            if (!bc1Refine(block, &best, endpoints)) break;
+            bc1Try(block, pack565(endpoints[0]), pack565(endpoints[1]), &best);
+            if (best.error == error) break;
+        }
+    }
+
+    uint32_t bits = 0;
+    for (int i = 0; i < 16; ++i) bits |= (uint32_t)best.indices[i] << (2 * i);
+    out[0] = (uint8_t)best.c0;
+    out[1] = (uint8_t)(best.c0 >> 8);
+    out[2] = (uint8_t)best.c1;
+    out[3] = (uint8_t)(best.c1 >> 8);
+    for (int i = 0; i < 4; ++i) out[4 + i] = (uint8_t)(bits >> (8 * i));
+    return best.error;
+}
+
+static uint32_t encodeChannel(const Block* block, int channel, uint8_t out[8]) {
+    uint8_t values[16];
+    for (int i = 0; i < 16; ++i) values[i] = block->texels[i][channel];
+    return encodeBc4(values, block->mask, out);
+}
+
+TextureFormat TextureCompressor_ChooseFormat(TextureKind kind, uint32_t channels, const uint8_t* pixels,
+                                             uint32_t width, uint32_t height) {
+    size_t count = (size_t)width * height;
+    if (kind == TEXTURE_KIND_NORMAL) {
+        return (channels >= 3) ? TEXTURE_FORMAT_BC5 : TEXTURE_FORMAT_RAW;
+    }
+    if (channels == 1) return TEXTURE_FORMAT_BC4;
+    if (channels == 3 && kind == TEXTURE_KIND_DATA) {
+        // Maps saved as gray RGB keep one channel
+        size_t i = 0;
+        while (i < count && pixels[i * 3] == pixels[i * 3 + 1] && pixels[i * 3] == pixels[i * 3 + 2]) i++;
+        return (i == count) ? TEXTURE_FORMAT_BC4 : TEXTURE_FORMAT_BC1;
+    }
+    if (channels == 3) return TEXTURE_FORMAT_BC1;
+    if (channels == 4) {
+        size_t i = 0;
+        while (i < count && pixels[i * 4 + 3] == 255) i++;
+        return (i == count) ? TEXTURE_FORMAT_BC1 : TEXTURE_FORMAT_BC3;
+    }
+    return TEXTURE_FORMAT_RAW;
+}
+
+typedef struct {
+    TextureFormat format;
+    const uint8_t* pixels;
+    uint32_t width;
+    uint32_t height;
+    uint32_t channels;
+    uint32_t blocksWide;
+    uint32_t blocksHigh;
+    uint8_t* out;
+    atomic_ullong squaredError;
+} EncodeJob;
+
+static void encodeTask(void* context, int taskIndex) {
+    EncodeJob* job = (EncodeJob*)context;
+    uint32_t first = (uint32_t)taskIndex * BLOCK_ROWS_PER_TASK;
+    uint32_t last = (first + BLOCK_ROWS_PER_TASK < job->blocksHigh) ? first + BLOCK_ROWS_PER_TASK : job->blocksHigh;
+    size_t blockBytes = (job->format == TEXTURE_FORMAT_BC1 || job->format == TEXTURE_FORMAT_BC4) ? 8 : 16;
+    unsigned long long error = 0;
+    Block block;
+    for (uint32_t y = first; y < last; ++y) {
+        for (uint32_t x = 0; x < job->blocksWide; ++x) {
+            loadBlock(job->pixels, job->width, job->height, job->channels, x, y, &block);
+            uint8_t* out = job->out + ((size_t)y * job->blocksWide + x) * blockBytes;
+            switch (job->format) {
+            case TEXTURE_FORMAT_BC1:
+                error += encodeBc1(&block, out);
+                break;
+            case TEXTURE_FORMAT_BC3:
+                error += encodeChannel(&block, 3, out);
+                error += encodeBc1(&block, out + 8);
+                break;
+            case TEXTURE_FORMAT_BC4:
+                error += encodeChannel(&block, 0, out);
+                break;
+            case TEXTURE_FORMAT_BC5:
+                error += encodeChannel(&block, 0, out);
+                error += encodeChannel(&block, 1, out + 8);
+                break;
+            default:
+                break;
+            }
+        }
+    }
+    atomic_fetch_add(&job->squaredError, error);
+}
+
+void TextureCompressor_EncodeLevel(TextureFormat format, const uint8_t* pixels, uint32_t width, uint32_t height,
+                                   uint32_t channels, uint8_t* out, int threadCount, TextureCompressorError* error) {
+    static const uint32_t keptChannels[TEXTURE_FORMAT_COUNT] = { 0, 3, 4, 1, 2 };
+    EncodeJob job;
+    job.format = format;
+    job.pixels = pixels;
+    job.width = width;
+    job.height = height;
+    job.channels = channels;
+    job.blocksWide = (width + 3) / 4;
+    job.blocksHigh = (height + 3) / 4;
+    job.out = out;
+    atomic_init(&job.squaredError, 0);
+    int tasks = (int)((job.blocksHigh + BLOCK_ROWS_PER_TASK - 1) / BLOCK_ROWS_PER_TASK);
+    ParallelFor(tasks, threadCount, encodeTask, &job);
+    if (error) {
+        error->squaredError += (uint64_t)atomic_load(&job.squaredError);
+        error->samples += (uint64_t)width * height * keptChannels[format];
+    }
+}
+
+double TextureCompressor_GetPsnr(const TextureCompressorError* error) {
+    if (error->squaredError == 0) return INFINITY;
+    double meanSquared = (double)error->squaredError / (double)error->samples;
+    return 10.0 * log10(255.0 * 255.0 / meanSquared);
+}
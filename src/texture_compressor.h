@@ -0,0 +1,33 @@
+#ifndef TEXTURE_COMPRESSOR_H
+#define TEXTURE_COMPRESSOR_H
+
+#include <stdint.h>
+#include "texture_cache.h"
+
+// CPU encoders for the BCn block formats, without GL. Each 4x4 block is fitted on its own:
+// BC1 endpoints start on the principal axis of the block's colors and are refined by least
+// squares on the chosen indices; BC4 tries its 8-value mode on the block's range and, when the
+// block holds 0 or 255, its 6-value mode. BC3 and BC5 are built from those two. Rows of blocks
+// are split across threads.
+
+typedef struct {
+    uint64_t squaredError;      // over the channels the format keeps
+    uint64_t samples;
+} TextureCompressorError;
+
+// The format a texture of this kind is compressed to, or TEXTURE_FORMAT_RAW when none fits:
+// BC1 for RGB and opaque RGBA, BC3 for RGBA, BC4 for one channel and for gray RGB data maps,
+// BC5 for normals. pixels is level 0.
+TextureFormat TextureCompressor_ChooseFormat(TextureKind kind, uint32_t channels, const uint8_t* pixels,
+                                             uint32_t width, uint32_t height);
+
+// Encodes one level of 8-bit pixels into out, which holds TextureCache_GetLevelSize bytes.
+// Blocks past the edge repeat the last row and column. The level's error is added to error,
+// which may be NULL.
+void TextureCompressor_EncodeLevel(TextureFormat format, const uint8_t* pixels, uint32_t width, uint32_t height,
+                                   uint32_t channels, uint8_t* out, int threadCount, TextureCompressorError* error);
+
+// Peak signal-to-noise ratio of 8-bit samples in dB; infinite for a lossless encode.
+double TextureCompressor_GetPsnr(const TextureCompressorError* error);
+
+#endif
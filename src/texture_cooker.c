@@ -0,0 +1,399 @@
+#include "texture_cooker.h"
+#include "texture_compressor.h"
+#include "texture_packer.h"
+#include "hash_utils.h"
+#include "thread_utils.h"
+#include "time_utils.h"
+#include <math.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define TEXTURE_COOKER_X86 1
+#include <emmintrin.h>
+#endif
+
+#if defined(__GNUC__)
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#else
+#define TARGET_SSE2
+#endif
+
+// Levels below the first are filtered from 16-bit working copies of the level above: linear
+// light for color, value * 257 for data and alpha, and the unnormalized average of the normals.
+// Filtering never goes back through 8 bits, so rounding does not build up down the chain, and
+// a normal level is the renormalized average of every normal under it. Working copies have 1,
+// 2 or 4 channels; 3-channel images get a padding channel so texels are a power of two wide.
+
+#define MIP_ROWS_PER_TASK 16
+
+// Per call, so concurrent cooks share nothing.
+typedef struct {
+    uint16_t toLinear[256];          // sRGB byte -> linear * 65535
+    uint8_t fromLinear[65536];       // linear * 65535 -> nearest sRGB byte
+} ColorTables;
+
+static float srgbToLinear(float value) {
+    return (value <= 0.04045f) ? value / 12.92f : powf((value + 0.055f) / 1.055f, 2.4f);
+}
+
+static void buildColorTables(ColorTables* tables) {
+    for (int i = 0; i < 256; ++i) {
+        tables->toLinear[i] = (uint16_t)(srgbToLinear(i / 255.0f) * 65535.0f + 0.5f);
+    }
+    // A linear value encodes to the byte whose range, between the midpoints to its
+    // neighbours in sRGB, holds it
+    uint32_t value = 0;
+    for (int i = 0; i < 255; ++i) {
+        float midpoint = srgbToLinear((i + 0.5f) / 255.0f) * 65535.0f;
+        while (value < 65536 && (float)value < midpoint) tables->fromLinear[value++] = (uint8_t)i;
+    }
+    while (value < 65536) tables->fromLinear[value++] = 255;
+}
+
+typedef struct {
+    TextureKind kind;
+    uint32_t channels;               // of the image
+    uint32_t workChannels;           // of the working copies
+    uint32_t colorChannels;          // leading channels stored in sRGB
+    const ColorTables* tables;
+} MipFormat;
+
+// One row of an 8-bit level into its working copy.
+static void expandRow(const MipFormat* format, const uint8_t* source, uint16_t* out, uint32_t width) {
+    uint32_t channels = format->channels, work = format->workChannels, color = format->colorChannels;
+    const uint16_t* toLinear = color ? format->tables->toLinear : NULL;
+    if (channels == work && color == 0) {
+        size_t i = 0, count = (size_t)width * channels;
+#ifdef TEXTURE_COOKER_X86
+        // Interleaving a byte with itself multiplies it by 257
+        for (; i + 16 <= count; i += 16) {
+            __m128i bytes = _mm_loadu_si128((const __m128i*)(source + i));
+            _mm_storeu_si128((__m128i*)(out + i), _mm_unpacklo_epi8(bytes, bytes));
+            _mm_storeu_si128((__m128i*)(out + i + 8), _mm_unpackhi_epi8(bytes, bytes));
+        }
+#endif
+        for (; i < count; ++i) out[i] = (uint16_t)(source[i] * 257);
+        return;
+    }
+    if (channels == 3) {
+        for (uint32_t x = 0; x < width; ++x, source += 3, out += 4) {
+            out[0] = color ? toLinear[source[0]] : (uint16_t)(source[0] * 257);
+            out[1] = color ? toLinear[source[1]] : (uint16_t)(source[1] * 257);
+            out[2] = color ? toLinear[source[2]] : (uint16_t)(source[2] * 257);
+            out[3] = 0;
+        }
+        return;
+    }
+    for (uint32_t x = 0; x < width; ++x, source += channels, out += work) {
+        for (uint32_t c = 0; c < channels; ++c) {
+            out[c] = (c < color) ? toLinear[source[c]] : (uint16_t)(source[c] * 257);
+        }
+    }
+}
+
+#ifdef TEXTURE_COOKER_X86
+// Rounded quarter of four 32-bit sums, packed back to unsigned 16 bits. packs is signed, so the
+// values are moved down by 32768 and back.
+TARGET_SSE2 static inline __m128i averagePack(__m128i sumsLow, __m128i sumsHigh) {
+    __m128i round = _mm_set1_epi32(2), bias = _mm_set1_epi32(32768);
+    __m128i low = _mm_sub_epi32(_mm_srli_epi32(_mm_add_epi32(sumsLow, round), 2), bias);
+    __m128i high = _mm_sub_epi32(_mm_srli_epi32(_mm_add_epi32(sumsHigh, round), 2), bias);
+    return _mm_xor_si128(_mm_packs_epi32(low, high), _mm_set1_epi16((short)0x8000));
+}
+
+// Adds two rows of 8 16-bit values into 32-bit low and high halves.
+TARGET_SSE2 static inline void sumRows(const uint16_t* row0, const uint16_t* row1, __m128i* low, __m128i* high) {
+    __m128i zero = _mm_setzero_si128();
+    __m128i a = _mm_loadu_si128((const __m128i*)row0);
+    __m128i b = _mm_loadu_si128((const __m128i*)row1);
+    *low = _mm_add_epi32(_mm_unpacklo_epi16(a, zero), _mm_unpacklo_epi16(b, zero));
+    *high = _mm_add_epi32(_mm_unpackhi_epi16(a, zero), _mm_unpackhi_epi16(b, zero));
+}
+
+// Adds neighbouring texels of two vertical sums; returns 8 / channels texel sums per input
+// vector pair, as four 32-bit lanes.
+TARGET_SSE2 static inline __m128i sumPairs(__m128i low, __m128i high, uint32_t channels) {
+    if (channels == 4) {
+        return _mm_add_epi32(low, high);
+    }
+    if (channels == 2) {
+        __m128i a = _mm_add_epi32(low, _mm_shuffle_epi32(low, _MM_SHUFFLE(1, 0, 3, 2)));
+        __m128i b = _mm_add_epi32(high, _mm_shuffle_epi32(high, _MM_SHUFFLE(1, 0, 3, 2)));
+        return _mm_unpacklo_epi64(a, b);
+    }
+    __m128i a = _mm_shuffle_epi32(_mm_add_epi32(low, _mm_srli_epi64(low, 32)), _MM_SHUFFLE(3, 1, 2, 0));
+    __m128i b = _mm_shuffle_epi32(_mm_add_epi32(high, _mm_srli_epi64(high, 32)), _MM_SHUFFLE(3, 1, 2, 0));
+    return _mm_unpacklo_epi64(a, b);
+}
+#endif
+
+// Each output texel averages its 2x2 footprint; a level one texel wide or tall repeats it.
+// row1 is row0 when the source is one row tall.
+static void downsampleRow(const uint16_t* row0, const uint16_t* row1, uint16_t* out, uint32_t width,
+                          uint32_t sourceWidth, uint32_t channels) {
+    if (sourceWidth == 1) {
+        for (uint32_t c = 0; c < channels; ++c) out[c] = (uint16_t)((row0[c] + row1[c] + 1) / 2);
+        return;
+    }
+    uint32_t x = 0;
+#ifdef TEXTURE_COOKER_X86
+    // 16 source values make 8 output values, whatever the channel count
+    uint32_t texelsPerStep = 8 / channels;
+    for (; x + texelsPerStep <= width; x += texelsPerStep) {
+        const uint16_t* a = &row0[(size_t)x * 2 * channels];
+        const uint16_t* b = &row1[(size_t)x * 2 * channels];
+        __m128i low, high;
+        sumRows(a, b, &low, &high);
+        __m128i first = sumPairs(low, high, channels);
+        sumRows(a + 8, b + 8, &low, &high);
+        __m128i second = sumPairs(low, high, channels);
+        _mm_storeu_si128((__m128i*)&out[(size_t)x * channels], averagePack(first, second));
+    }
+#endif
+    for (; x < width; ++x) {
+        const uint16_t* a = &row0[(size_t)x * 2 * channels];
+        const uint16_t* b = &row1[(size_t)x * 2 * channels];
+        for (uint32_t c = 0; c < channels; ++c) {
+            uint32_t sum = (uint32_t)a[c] + a[c + channels] + b[c] + b[c + channels];
+            out[(size_t)x * channels + c] = (uint16_t)((sum + 2) / 4);
+        }
+    }
+}
+
+// One row of a working copy into its 8-bit level.
+static void encodeRow(const MipFormat* format, const uint16_t* source, uint8_t* out, uint32_t width) {
+    uint32_t channels = format->channels, work = format->workChannels, color = format->colorChannels;
+    const uint8_t* fromLinear = color ? format->tables->fromLinear : NULL;
+    uint32_t first = (format->kind == TEXTURE_KIND_NORMAL && channels >= 3) ? 3 : 0;
+    for (uint32_t x = 0; x < width; ++x, source += work, out += channels) {
+        if (first) {
+            float n[3], length = 0.0f;
+            for (int i = 0; i < 3; ++i) {
+                n[i] = source[i] * (2.0f / 65535.0f) - 1.0f;
+                length += n[i] * n[i];
+            }
+            if (length > 1e-12f) {
+                length = 1.0f / sqrtf(length);
+                for (int i = 0; i < 3; ++i) out[i] = (uint8_t)((n[i] * length * 0.5f + 0.5f) * 255.0f + 0.5f);
+            } else {
+                out[0] = 128;
+                out[1] = 128;
+                out[2] = 255;
+            }
+        }
+        for (uint32_t c = first; c < channels; ++c) {
+            out[c] = (c < color) ? fromLinear[source[c]] : (uint8_t)((source[c] + 128) / 257);
+        }
+    }
+}
+
+typedef struct {
+    const MipFormat* format;
+    const uint8_t* sourcePixels;     // level 1 only: the 8-bit image
+    const uint16_t* source;          // other levels: working copy of the level above
+    uint32_t sourceWidth;
+    uint32_t sourceHeight;
+    uint16_t* work;                  // working copy of this level
+    uint8_t* out;                    // this level
+    uint32_t width;
+    uint32_t height;
+    atomic_int failed;
+} MipJob;
+
+static void mipTask(void* context, int taskIndex) {
+    MipJob* job = (MipJob*)context;
+    const MipFormat* format = job->format;
+    uint32_t work = format->workChannels;
+    uint32_t first = (uint32_t)taskIndex * MIP_ROWS_PER_TASK;
+    uint32_t last = (first + MIP_ROWS_PER_TASK < job->height) ? first + MIP_ROWS_PER_TASK : job->height;
+    size_t sourceRow = (size_t)job->sourceWidth * work;
+
+    uint16_t* expanded = NULL;
+    if (job->sourcePixels) {
+        expanded = malloc(2 * sourceRow * sizeof(uint16_t));
+        if (!expanded) {
+            atomic_store(&job->failed, 1);
+            return;
+        }
+    }
+    for (uint32_t y = first; y < last; ++y) {
+        uint32_t y0 = y * 2;
+        uint32_t y1 = (y0 + 1 < job->sourceHeight) ? y0 + 1 : y0;
+        const uint16_t* row0;
+        const uint16_t* row1;
+        if (expanded) {
+            size_t stride = (size_t)job->sourceWidth * format->channels;
+            expandRow(format, job->sourcePixels + y0 * stride, expanded, job->sourceWidth);
+            expandRow(format, job->sourcePixels + y1 * stride, expanded + sourceRow, job->sourceWidth);
+            row0 = expanded;
+            row1 = expanded + sourceRow;
+        } else {
+            row0 = job->source + y0 * sourceRow;
+            row1 = job->source + y1 * sourceRow;
+        }
+        uint16_t* workRow = job->work + (size_t)y * job->width * work;
+        downsampleRow(row0, row1, workRow, job->width, job->sourceWidth, work);
+        encodeRow(format, workRow, job->out + (size_t)y * job->width * format->channels, job->width);
+    }
+    free(expanded);
+}
+
+// Fills levels 1.. from level 0. Returns 0 on success, 2 when out of memory.
+static int buildMips(TextureCacheData* data, unsigned char* pixels, TextureKind kind, int threadCount) {
+    if (data->levelCount < 2) return 0;
+
+    MipFormat format;
+    format.kind = kind;
+    format.channels = data->channels;
+    format.workChannels = (data->channels == 3) ? 4 : data->channels;
+    format.colorChannels = 0;
+    format.tables = NULL;
+    ColorTables* tables = NULL;
+    if (kind == TEXTURE_KIND_COLOR) {
+        tables = malloc(sizeof(ColorTables));
+        if (!tables) return 2;
+        buildColorTables(tables);
+        format.colorChannels = (data->channels <= 2) ? 1 : 3;
+        format.tables = tables;
+    }
+
+    // Level i's working copy is written to one buffer while level i - 1's is read from the other
+    size_t level1 = (size_t)data->levels[1].width * data->levels[1].height * format.workChannels;
+    size_t level2 = 0;
+    if (data->levelCount > 2) level2 = (size_t)data->levels[2].width * data->levels[2].height * format.workChannels;
+    uint16_t* buffers[2] = { malloc(level1 * sizeof(uint16_t)), malloc(level2 * sizeof(uint16_t) + 1) };
+    int result = (buffers[0] && buffers[1]) ? 0 : 2;
+
+    for (uint32_t i = 1; i < data->levelCount && result == 0; ++i) {
+        const TextureCacheLevel* source = &data->levels[i - 1];
+        const TextureCacheLevel* level = &data->levels[i];
+        MipJob job;
+        job.format = &format;
+        job.sourcePixels = (i == 1) ? pixels : NULL;
+        job.source = buffers[i % 2];
+        job.sourceWidth = source->width;
+        job.sourceHeight = source->height;
+        job.work = buffers[(i - 1) % 2];
+        job.out = pixels + level->offset;
+        job.width = level->width;
+        job.height = level->height;
+        atomic_init(&job.failed, 0);
+        int tasks = (int)((level->height + MIP_ROWS_PER_TASK - 1) / MIP_ROWS_PER_TASK);
+        ParallelFor(tasks, threadCount, mipTask, &job);
+        if (atomic_load(&job.failed)) result = 2;
+    }
+    free(buffers[0]);
+    free(buffers[1]);
+    free(tables);
+    return result;
+}
+
+// Replaces the 8-bit levels with their blocks in format. Returns 0 on success, 2 when out of memory.
+static int compressLevels(const char* filename, TextureCacheData* data, unsigned char** pixels, TextureFormat format,
+                          int threadCount) {
+    double startTime = GetTimeSeconds();
+    TextureCacheLevel levels[TEXTURE_CACHE_MAX_LEVELS];
+    uint64_t total = 0, rawTotal = 0;
+    for (uint32_t i = 0; i < data->levelCount; ++i) {
+        levels[i] = data->levels[i];
+        levels[i].offset = total;
+        total += TextureCache_GetLevelSize(format, data->channels, levels[i].width, levels[i].height);
+        rawTotal += TextureCache_GetLevelSize(TEXTURE_FORMAT_RAW, data->channels, levels[i].width, levels[i].height);
+    }
+    unsigned char* blocks = malloc((size_t)total);
+    if (!blocks) return 2;
+
+    // Level 0 alone gives the reported quality; the smaller levels are a third more samples
+    TextureCompressorError error = {0};
+    for (uint32_t i = 0; i < data->levelCount; ++i) {
+        const TextureCacheLevel* level = &data->levels[i];
+        TextureCompressor_EncodeLevel(format, *pixels + level->offset, level->width, level->height, data->channels,
+                                      blocks + levels[i].offset, threadCount, (i == 0) ? &error : NULL);
+    }
+    double seconds = GetTimeSeconds() - startTime;
+    printf("[TextureCooker] %s: %s, %llu KB -> %llu KB, %.1f dB PSNR, %.1f MB/s\n", filename,
+           TextureCache_GetFormatName(format), (unsigned long long)(rawTotal / 1024),
+           (unsigned long long)(total / 1024), TextureCompressor_GetPsnr(&error),
+           rawTotal / (seconds > 0.0 ? seconds : 1e-9) / (1024.0 * 1024.0));
+
+    free(*pixels);
+    *pixels = blocks;
+    memcpy(data->levels, levels, sizeof(levels));
+    data->format = (uint32_t)format;
+    data->pixelSize = total;
+    return 0;
+}
+
+int TextureCooker_CookPixels(const char* name, const unsigned char* image, uint32_t width, uint32_t height,
+                             uint32_t channels, TextureKind kind, int threadCount, CookedTexture* cooked) {
+    memset(cooked, 0, sizeof(*cooked));
+    TextureCacheData* data = &cooked->data;
+    data->width = width;
+    data->height = height;
+    data->channels = channels;
+    data->kind = (uint32_t)kind;
+
+    // Level sizes halve, rounding down, until both reach 1
+    uint64_t total = 0;
+    uint32_t levelWidth = data->width, levelHeight = data->height;
+    for (;;) {
+        TextureCacheLevel* level = &data->levels[data->levelCount++];
+        level->offset = total;
+        level->width = levelWidth;
+        level->height = levelHeight;
+        total += (uint64_t)levelWidth * levelHeight * data->channels;
+        if ((levelWidth == 1 && levelHeight == 1) || data->levelCount == TEXTURE_CACHE_MAX_LEVELS) break;
+        levelWidth = (levelWidth > 1) ? levelWidth / 2 : 1;
+        levelHeight = (levelHeight > 1) ? levelHeight / 2 : 1;
+    }
+
+    cooked->pixels = malloc((size_t)total);
+    if (!cooked->pixels) return 2;
+    memcpy(cooked->pixels, image, (size_t)data->levels[0].width * data->levels[0].height * data->channels);
+
+    data->pixelSize = total;
+    int result = buildMips(data, cooked->pixels, kind, threadCount);
+    if (result == 0 && TextureCache_GetBlockCompression()) {
+        TextureFormat format = TextureCompressor_ChooseFormat(kind, data->channels, cooked->pixels, data->width,
+                                                              data->height);
+        if (format != TEXTURE_FORMAT_RAW) result = compressLevels(name, data, &cooked->pixels, format, threadCount);
+    }
+    if (result) {
+        TextureCooker_Free(cooked);
+        return 2;
+    }
+    data->pixels = cooked->pixels;
+    return 0;
+}
+
+int TextureCooker_Cook(const char* filename, TextureKind kind, int threadCount, CookedTexture* cooked) {
+    if (TexturePacker_IsPacked(filename)) return TexturePacker_Cook(filename, threadCount, cooked);
+    memset(cooked, 0, sizeof(*cooked));
+
+    int width, height, channels;
+    unsigned char* image = stbi_load(filename, &width, &height, &channels, 0);
+    if (!image) {
+        fprintf(stderr, "[TextureCooker] Failed to decode %s: %s\n", filename, stbi_failure_reason());
+        return 1;
+    }
+    int result = TextureCooker_CookPixels(filename, image, (uint32_t)width, (uint32_t)height, (uint32_t)channels,
+                                          kind, threadCount, cooked);
+    stbi_image_free(image);
+    return result;
+}
+
+int TextureCooker_HashSource(const char* filename, uint64_t* hash) {
+    if (TexturePacker_IsPacked(filename)) return TexturePacker_HashSources(filename, hash);
+    return HashFile64(filename, 0, hash);
+}
+
+void TextureCooker_Free(CookedTexture* cooked) {
+    if (!cooked) return;
+    free(cooked->pixels);
+    memset(cooked, 0, sizeof(*cooked));
+}
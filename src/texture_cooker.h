@@ -0,0 +1,27 @@
+#ifndef TEXTURE_COOKER_H
+#define TEXTURE_COOKER_H
+
+#include "texture_cache.h"
+
+// Texture processing without GL, shared by the texture loader and the cook tool: decodes the
+// image and builds its mip chain down to 1x1 with a 2x2 box filter, filtered the way the
+// texture's kind needs (see TextureKind), then block compresses every level when that is on
+// (see texture_compressor.h). Rows of each level are split across threads. The result is
+// what TextureCache_Write stores.
+
+typedef struct {
+    TextureCacheData data;      // points into pixels
+    unsigned char* pixels;
+} CookedTexture;
+
+// Returns 0 on success, 1 if the image cannot be decoded, 2 when out of memory. A packed
+// texture name (see texture_packer.h) is cooked from its maps.
+int TextureCooker_Cook(const char* filename, TextureKind kind, int threadCount, CookedTexture* cooked);
+// Cooks decoded 8-bit pixels, which the caller keeps; name is for the log.
+int TextureCooker_CookPixels(const char* name, const unsigned char* image, uint32_t width, uint32_t height,
+                             uint32_t channels, TextureKind kind, int threadCount, CookedTexture* cooked);
+// Hash64 of the image file, or of the maps of a packed texture. Returns 0 on success.
+int TextureCooker_HashSource(const char* filename, uint64_t* hash);
+void TextureCooker_Free(CookedTexture* cooked);
+
+#endif
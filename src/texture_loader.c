@@ -1,41 +1,218 @@
 #include "texture_loader.h"
+#include "texture_cooker.h"
+#include "texture_streamer.h"
+#include "asset_cache.h"
+#include "asset_pack.h"
+#include "hash_utils.h"
+#include "time_utils.h"
+#include "thread_utils.h"
 #include <stdio.h>
 #include <stdlib.h>
-#define STB_IMAGE_IMPLEMENTATION
-#include "stb_image.h"
+#include <string.h>
 #include <GL/gl.h>
-GLuint LoadTexture(const char* filename) {
-    if (!filename) return 0;
-
-    int width, height, channels;
-    unsigned char* data = stbi_load(filename, &width, &height, &channels, 0);
-    if (!data) return 0;
-
-    GLenum format;
-    if (channels == 1) format = GL_LUMINANCE;
-    else if (channels == 3) format = GL_RGB;
-    else if (channels == 4) format = GL_RGBA;
-    printf("Loaded texture %s: %dx%d, channels: %d\n", filename, width, height, channels);
+#include <GL/glext.h>
+#include "gl_loader.h"
+static const GLenum compressedFormats[TEXTURE_FORMAT_COUNT] = {
+    0, GL_COMPRESSED_RGB_S3TC_DXT1_EXT, GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, GL_COMPRESSED_RED_RGTC1,
+    GL_COMPRESSED_RG_RGTC2
+};
+
+static GLenum GetPixelFormat(const TextureCacheData* data) {
+    if (data->channels == 1) return GL_LUMINANCE;
+    if (data->channels == 2) return GL_LUMINANCE_ALPHA;
+    if (data->channels == 3) return GL_RGB;
+    return GL_RGBA;
+}
+
+// Block-compressed levels go to the GL as they are.
+void UploadTextureLevels(const TextureCacheData* data, uint32_t first, uint32_t last) {
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1); // IMPORTANT for 1,3 channel images
+    for (uint32_t i = first; i <= last; ++i) {
+        const TextureCacheLevel* level = &data->levels[i];
+        if (data->format == TEXTURE_FORMAT_RAW) {
+            GLenum format = GetPixelFormat(data);
+            glTexImage2D(GL_TEXTURE_2D, (GLint)i, format, (GLsizei)level->width, (GLsizei)level->height, 0, format,
+                         GL_UNSIGNED_BYTE, data->pixels + level->offset);
+        } else {
+            uint64_t size = TextureCache_GetLevelSize((TextureFormat)data->format, data->channels, level->width,
+                                                      level->height);
+            glCompressedTexImage2D(GL_TEXTURE_2D, (GLint)i, compressedFormats[data->format], (GLsizei)level->width,
+                                   (GLsizei)level->height, 0, (GLsizei)size, data->pixels + level->offset);
+        }
+    }
+}
+
+// A level redefined with no texels gives its memory back.
+void ReleaseTextureLevels(const TextureCacheData* data, uint32_t first, uint32_t last) {
+    for (uint32_t i = first; i <= last; ++i) {
+        if (data->format == TEXTURE_FORMAT_RAW) {
+            GLenum format = GetPixelFormat(data);
+            glTexImage2D(GL_TEXTURE_2D, (GLint)i, format, 0, 0, 0, format, GL_UNSIGNED_BYTE, NULL);
+        } else {
+            glCompressedTexImage2D(GL_TEXTURE_2D, (GLint)i, compressedFormats[data->format], 0, 0, 0, 0, NULL);
+        }
+    }
+}
+
+void UploadTextureArrayLevel(const TextureCacheData* data, uint32_t level, uint32_t width, uint32_t height,
+                             uint32_t layers, const void* pixels) {
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    if (data->format == TEXTURE_FORMAT_RAW) {
+        GLenum format = GetPixelFormat(data);
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, (GLint)level, (GLint)format, (GLsizei)width, (GLsizei)height,
+                     (GLsizei)layers, 0, format, GL_UNSIGNED_BYTE, pixels);
+    } else {
+        uint64_t size = TextureCache_GetLevelSize((TextureFormat)data->format, data->channels, width, height);
+        glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, (GLint)level, compressedFormats[data->format], (GLsizei)width,
+                               (GLsizei)height, (GLsizei)layers, 0, (GLsizei)(size * layers), pixels);
+    }
+}
+
+void SetTextureSampling(GLenum target, const TextureCacheData* data, uint32_t levelCount) {
+    // BC4 holds one channel in red; read it back the way GL_LUMINANCE was
+    if (data->format == TEXTURE_FORMAT_BC4) {
+        static const GLint swizzle[4] = { GL_RED, GL_RED, GL_RED, GL_ONE };
+        glTexParameteriv(target, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+    }
+    glTexParameteri(target, GL_TEXTURE_MAX_LEVEL, (GLint)levelCount - 1);
+    glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+}
+
+// Uploads every mip level from firstLevel; a full chain down to 1x1 makes the texture complete
+// for trilinear filtering, and GL_TEXTURE_BASE_LEVEL skips the levels above firstLevel.
+GLuint CreateTextureFromLevel(const char* filename, const TextureCacheData* data, uint32_t firstLevel) {
+    printf("Loaded texture %s: %ux%u, channels: %u, %s, levels: %u\n", filename, data->width, data->height,
+           data->channels, TextureCache_GetFormatName((TextureFormat)data->format), data->levelCount);
     GLuint textureID;
     glGenTextures(1, &textureID);
     glBindTexture(GL_TEXTURE_2D, textureID);
-    printf("Generated texture ID: %u\n", textureID);
-    glPixelStorei(GL_UNPACK_ALIGNMENT, 1); // IMPORTANT for 1,3 channel images
-    printf("Uploading texture data to GPU...\n");
-    glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-    printf("Texture data uploaded.\n");
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    printf("Texture parameters set: MIN_FILTER=LINEAR, MAG_FILTER=LINEAR\n");
-    stbi_image_free(data);
+    UploadTextureLevels(data, firstLevel, data->levelCount - 1);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, (GLint)firstLevel);
+    SetTextureSampling(GL_TEXTURE_2D, data, data->levelCount);
     glBindTexture(GL_TEXTURE_2D, 0);
     printf("Texture %s loaded with ID: %u\n", filename, textureID);
     return textureID;
 }
 
+// Cooked pixels and mips come from the mounted asset pack, or from the asset cache when the
+// source was cooked before; otherwise the image is cooked here and cached for the next start.
+int ReadTexturePixels(const char* filename, TextureKind kind, int threadCount, TexturePixels* pixels) {
+    ClearTexturePixels(pixels);
+    if (!filename) return 1;
+
+    double startTime = GetTimeSeconds();
+    size_t packedSize;
+    uint32_t params[2] = { (uint32_t)kind, (uint32_t)TextureCache_GetBlockCompression() };
+    uint64_t key = AssetPack_MakeKey(ASSET_PACK_TEXTURE, filename, params, sizeof(params));
+    const void* packed = AssetPack_FindMounted(key, ASSET_PACK_TEXTURE, &packedSize);
+    if (packed && TextureCache_OpenMemory(packed, packedSize, filename, kind, &pixels->cache) == 0) {
+        TextureCache_GetData(&pixels->cache, &pixels->data);
+        pixels->sourceHash = pixels->cache.header->sourceHash;
+        printf("[Texture] %s: loaded from pack in %.1f ms\n", filename, (GetTimeSeconds() - startTime) * 1000.0);
+        return 0;
+    }
+
+    uint64_t sourceHash;
+    if (TextureCooker_HashSource(filename, &sourceHash)) return 1;
+    pixels->sourceHash = sourceHash;
+    char cachePath[ASSET_CACHE_PATH_SIZE];
+    TextureCache_GetPath(sourceHash, kind, cachePath, sizeof(cachePath));
+
+    if (TextureCache_Open(cachePath, sourceHash, kind, &pixels->cache) == 0) {
+        TextureCache_GetData(&pixels->cache, &pixels->data);
+        AssetCache_Touch(cachePath);
+        printf("[Texture] %s: warm load from %s in %.1f ms\n", filename, cachePath, (GetTimeSeconds() - startTime) * 1000.0);
+        return 0;
+    }
+
+    if (TextureCooker_Cook(filename, kind, threadCount, &pixels->cooked)) return 1;
+    pixels->isCooked = 1;
+    pixels->data = pixels->cooked.data;
+    TextureCache_Write(cachePath, sourceHash, &pixels->data);
+    printf("[Texture] %s: cold load (decoded) in %.1f ms\n", filename, (GetTimeSeconds() - startTime) * 1000.0);
+    return 0;
+}
+
+GLuint UploadTexturePixels(const char* filename, const TexturePixels* pixels) {
+    return CreateTextureFromLevel(filename, &pixels->data, 0);
+}
+
+void FreeTexturePixels(TexturePixels* pixels) {
+    if (pixels->isCooked) TextureCooker_Free(&pixels->cooked);
+    else TextureCache_Close(&pixels->cache);
+    ClearTexturePixels(pixels);
+}
+
+void ClearTexturePixels(TexturePixels* pixels) {
+    memset(pixels, 0, sizeof(*pixels));
+    FileMap_Init(&pixels->cache.map);
+}
+
+void MoveTexturePixels(TexturePixels* to, TexturePixels* from) {
+    *to = *from;
+    ClearTexturePixels(from);
+}
+
+GLuint LoadTexture(const char* filename, TextureKind kind) {
+    TexturePixels pixels;
+    if (ReadTexturePixels(filename, kind, GetHardwareThreadCount(), &pixels)) return 0;
+    GLuint textureID = UploadTexturePixels(filename, &pixels);
+    FreeTexturePixels(&pixels);
+    return textureID;
+}
+
 
 void FreeTexture(GLuint textureID) {
     if (textureID != 0) {
         glDeleteTextures(1, &textureID);
     }
 }
+
+static void DeleteTextureResource(void* data) {
+    GLuint textureID = (GLuint)(uintptr_t)data;
+    TextureStreamer_Remove(textureID);
+    FreeTexture(textureID);
+}
+
+// The kind is the resource variant: a file used as color and as data is filtered twice.
+// Streamed textures count their resident levels in the streamer's stats, not here.
+ResourceHandle AddTextureResource(const char* filename, TextureKind kind, TexturePixels* pixels) {
+    ResourceData resource = {0};
+    uint64_t contentHash = 0;
+    if (pixels) {
+        contentHash = pixels->sourceHash ? Hash64(&pixels->sourceHash, sizeof(pixels->sourceHash), kind) : 0;
+        ResourceHandle shared = ResourceManager_FindByContent(RESOURCE_TEXTURE, filename, kind, contentHash);
+        if (shared.generation) {
+            printf("[Texture] %s: same contents as a loaded texture, shared\n", filename);
+            return shared;
+        }
+        size_t pixelSize = (size_t)pixels->data.pixelSize;
+        int streamed = TextureStreamer_IsEnabled();
+        GLuint textureID = streamed ? TextureStreamer_Add(filename, pixels) : UploadTexturePixels(filename, pixels);
+        resource.data = (void*)(uintptr_t)textureID;
+        resource.gpuBytes = (textureID && !streamed) ? pixelSize : 0;
+        resource.freeData = DeleteTextureResource;
+    }
+    return ResourceManager_Add(RESOURCE_TEXTURE, filename, kind, contentHash, &resource);
+}
+
+ResourceHandle AcquireTexture(const char* filename, TextureKind kind) {
+    ResourceHandle handle = ResourceManager_Find(RESOURCE_TEXTURE, filename, kind);
+    if (handle.generation) return handle;
+    TexturePixels pixels;
+    if (ReadTexturePixels(filename, kind, GetHardwareThreadCount(), &pixels)) {
+        return AddTextureResource(filename, kind, NULL);
+    }
+    handle = AddTextureResource(filename, kind, &pixels);
+    FreeTexturePixels(&pixels);
+    return handle;
+}
+
+int TextureResourceExists(const char* filename, TextureKind kind) {
+    return ResourceManager_Exists(RESOURCE_TEXTURE, filename, kind);
+}
+
+GLuint GetTextureID(ResourceHandle handle) {
+    return (GLuint)(uintptr_t)ResourceManager_Get(handle);
+}
@@ -2,8 +2,55 @@
 #define TEXTURE_LOADER_H
 
 #include <GL/gl.h>   
+#include "texture_cache.h"
+#include "texture_cooker.h"
+#include "resource_manager.h"
 
-GLuint LoadTexture(const char* filename);
+// Cooked pixels of one texture. Reading them touches no GL state, so loader threads can do
+// it; the upload then runs on the GL thread.
+typedef struct {
+    TextureCache cache;         // open unless cooked
+    CookedTexture cooked;
+    int isCooked;
+    TextureCacheData data;
+    uint64_t sourceHash;        // Hash64 of the source file, 0 if unknown
+} TexturePixels;
+
+// Reads from the mounted asset pack, the asset cache, or cooks the image as kind on up to
+// threadCount threads and caches it. filename may name a packed texture (see
+// texture_packer.h). Returns 0 on success.
+int ReadTexturePixels(const char* filename, TextureKind kind, int threadCount, TexturePixels* pixels);
+GLuint UploadTexturePixels(const char* filename, const TexturePixels* pixels);
+void FreeTexturePixels(TexturePixels* pixels);
+// Leaves pixels empty; freeing empty pixels does nothing.
+void ClearTexturePixels(TexturePixels* pixels);
+// Hands the pixels of from over to to and leaves from empty.
+void MoveTexturePixels(TexturePixels* to, TexturePixels* from);
+
+// Level uploads for the texture bound to GL_TEXTURE_2D. Released levels are redefined empty.
+void UploadTextureLevels(const TextureCacheData* data, uint32_t first, uint32_t last);
+void ReleaseTextureLevels(const TextureCacheData* data, uint32_t first, uint32_t last);
+// Creates a texture holding levels firstLevel..levelCount-1, with firstLevel as its base.
+GLuint CreateTextureFromLevel(const char* filename, const TextureCacheData* data, uint32_t firstLevel);
+// Defines one level of the GL_TEXTURE_2D_ARRAY bound, from layers packed one after another in
+// the format of data.
+void UploadTextureArrayLevel(const TextureCacheData* data, uint32_t level, uint32_t width, uint32_t height,
+                             uint32_t layers, const void* pixels);
+// Trilinear filtering over levelCount levels of the texture bound to target, in the format of data.
+void SetTextureSampling(GLenum target, const TextureCacheData* data, uint32_t levelCount);
+
+GLuint LoadTexture(const char* filename, TextureKind kind);
+
+// Shared textures in the resource manager: materials and objects that name the same file
+// as the same kind, or a file with the same contents, share one GL texture. Failed loads are registered too,
+// with ID 0, so they are not retried. Each handle holds a reference the caller releases.
+ResourceHandle AcquireTexture(const char* filename, TextureKind kind);
+// Registers pixels read elsewhere, uploading them unless a texture with the same contents
+// exists. pixels is NULL for a failed read. When texture streaming is on, the streamer takes
+// the pixels and leaves them empty.
+ResourceHandle AddTextureResource(const char* filename, TextureKind kind, TexturePixels* pixels);
+int TextureResourceExists(const char* filename, TextureKind kind);
+GLuint GetTextureID(ResourceHandle handle);
 
 void FreeTexture(GLuint textureID);
 
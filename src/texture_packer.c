@@ -0,0 +1,140 @@
+#include "texture_packer.h"
+#include "hash_utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "stb_image.h"
+
+#define ORM_PREFIX "orm:"
+#define ORM_CHANNELS 3
+
+static const uint8_t ormDefaults[ORM_CHANNELS] = {
+    TEXTURE_ORM_DEFAULT_OCCLUSION, TEXTURE_ORM_DEFAULT_ROUGHNESS, TEXTURE_ORM_DEFAULT_METALNESS
+};
+
+void TexturePacker_GetOrmName(const char* occlusion, const char* roughness, const char* metalness, char* out,
+                              size_t outSize) {
+    if (occlusion[0] == '\0' && roughness[0] == '\0' && metalness[0] == '\0') {
+        if (outSize > 0) out[0] = '\0';
+        return;
+    }
+    snprintf(out, outSize, ORM_PREFIX "%s|%s|%s", occlusion, roughness, metalness);
+}
+
+int TexturePacker_IsPacked(const char* name) {
+    return strncmp(name, ORM_PREFIX, sizeof(ORM_PREFIX) - 1) == 0;
+}
+
+int TexturePacker_GetSources(const char* name, char sources[3][TEXTURE_PACKER_SOURCE_SIZE]) {
+    if (!TexturePacker_IsPacked(name)) return 1;
+    const char* cursor = name + sizeof(ORM_PREFIX) - 1;
+    for (int c = 0; c < ORM_CHANNELS; ++c) {
+        const char* end = (c + 1 < ORM_CHANNELS) ? strchr(cursor, '|') : cursor + strlen(cursor);
+        if (!end || (size_t)(end - cursor) >= TEXTURE_PACKER_SOURCE_SIZE) return 1;
+        memcpy(sources[c], cursor, (size_t)(end - cursor));
+        sources[c][end - cursor] = '\0';
+        cursor = end + 1;
+    }
+    return 0;
+}
+
+// A missing map hashes as 0, so moving a map to another channel changes the hash.
+int TexturePacker_HashSources(const char* name, uint64_t* hash) {
+    char sources[ORM_CHANNELS][TEXTURE_PACKER_SOURCE_SIZE];
+    if (TexturePacker_GetSources(name, sources)) return 1;
+    uint64_t hashes[ORM_CHANNELS] = {0};
+    for (int c = 0; c < ORM_CHANNELS; ++c) {
+        if (sources[c][0] != '\0' && HashFile64(sources[c], 0, &hashes[c])) return 1;
+    }
+    *hash = Hash64(hashes, sizeof(hashes), ORM_CHANNELS);
+    return 0;
+}
+
+typedef struct {
+    unsigned char* pixels;       // NULL when the map is missing
+    int width;
+    int height;
+    int channels;
+} OrmSource;
+
+// Channel 0 of a source into channel c of the packed image, bilinearly resampled at texel
+// centers when the sizes differ.
+static void packChannel(const OrmSource* source, uint8_t* out, uint32_t width, uint32_t height, int c) {
+    uint32_t sourceWidth = (uint32_t)source->width, sourceHeight = (uint32_t)source->height;
+    uint32_t stride = (uint32_t)source->channels;
+    if (sourceWidth == width && sourceHeight == height) {
+        size_t count = (size_t)width * height;
+        for (size_t i = 0; i < count; ++i) out[i * ORM_CHANNELS + c] = source->pixels[i * stride];
+        return;
+    }
+    float scaleX = (float)sourceWidth / (float)width, scaleY = (float)sourceHeight / (float)height;
+    for (uint32_t y = 0; y < height; ++y) {
+        float sy = (y + 0.5f) * scaleY - 0.5f;
+        if (sy < 0.0f) sy = 0.0f;
+        uint32_t y0 = (uint32_t)sy;
+        uint32_t y1 = (y0 + 1 < sourceHeight) ? y0 + 1 : y0;
+        float fy = sy - (float)y0;
+        const unsigned char* row0 = source->pixels + (size_t)y0 * sourceWidth * stride;
+        const unsigned char* row1 = source->pixels + (size_t)y1 * sourceWidth * stride;
+        for (uint32_t x = 0; x < width; ++x) {
+            float sx = (x + 0.5f) * scaleX - 0.5f;
+            if (sx < 0.0f) sx = 0.0f;
+            uint32_t x0 = (uint32_t)sx;
+            uint32_t x1 = (x0 + 1 < sourceWidth) ? x0 + 1 : x0;
+            float fx = sx - (float)x0;
+            float top = row0[x0 * stride] + (row0[x1 * stride] - row0[x0 * stride]) * fx;
+            float bottom = row1[x0 * stride] + (row1[x1 * stride] - row1[x0 * stride]) * fx;
+            out[((size_t)y * width + x) * ORM_CHANNELS + c] = (uint8_t)(top + (bottom - top) * fy + 0.5f);
+        }
+    }
+}
+
+int TexturePacker_Cook(const char* name, int threadCount, CookedTexture* cooked) {
+    memset(cooked, 0, sizeof(*cooked));
+    char paths[ORM_CHANNELS][TEXTURE_PACKER_SOURCE_SIZE];
+    if (TexturePacker_GetSources(name, paths)) {
+        fprintf(stderr, "[TexturePacker] Not a packed texture name: %s\n", name);
+        return 1;
+    }
+
+    OrmSource sources[ORM_CHANNELS];
+    memset(sources, 0, sizeof(sources));
+    uint32_t width = 1, height = 1;
+    int result = 0;
+    for (int c = 0; c < ORM_CHANNELS && result == 0; ++c) {
+        if (paths[c][0] == '\0') continue;
+        OrmSource* source = &sources[c];
+        source->pixels = stbi_load(paths[c], &source->width, &source->height, &source->channels, 0);
+        if (!source->pixels) {
+            fprintf(stderr, "[TexturePacker] Failed to decode %s: %s\n", paths[c], stbi_failure_reason());
+            result = 1;
+            break;
+        }
+        if ((uint32_t)source->width > width) width = (uint32_t)source->width;
+        if ((uint32_t)source->height > height) height = (uint32_t)source->height;
+    }
+
+    uint8_t* image = NULL;
+    if (result == 0) {
+        image = malloc((size_t)width * height * ORM_CHANNELS);
+        if (!image) result = 2;
+    }
+    if (result == 0) {
+        size_t count = (size_t)width * height;
+        for (int c = 0; c < ORM_CHANNELS; ++c) {
+            if (sources[c].pixels) {
+                packChannel(&sources[c], image, width, height, c);
+            } else {
+                for (size_t i = 0; i < count; ++i) image[i * ORM_CHANNELS + c] = ormDefaults[c];
+            }
+        }
+    }
+    for (int c = 0; c < ORM_CHANNELS; ++c) stbi_image_free(sources[c].pixels);
+
+    if (result == 0) {
+        result = TextureCooker_CookPixels(name, image, width, height, ORM_CHANNELS, TEXTURE_KIND_DATA, threadCount,
+                                          cooked);
+    }
+    free(image);
+    return result;
+}
@@ -0,0 +1,37 @@
+#ifndef TEXTURE_PACKER_H
+#define TEXTURE_PACKER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "texture_cooker.h"
+
+// Channel packing without GL: ambient occlusion, roughness and metalness maps of a material
+// become one RGB data texture, so the shader samples it once and the renderer binds it once.
+// A packed texture is named by its sources ("orm:ao|roughness|metalness", empty for a missing
+// map) and is cooked, cached and shared under that name like an image file.
+
+#define TEXTURE_PACKER_SOURCE_SIZE 260
+#define TEXTURE_PACKER_NAME_SIZE (3 * TEXTURE_PACKER_SOURCE_SIZE + 8)
+
+// Value of a channel whose map is missing: no occlusion, fully rough, not metal.
+#define TEXTURE_ORM_DEFAULT_OCCLUSION 255
+#define TEXTURE_ORM_DEFAULT_ROUGHNESS 255
+#define TEXTURE_ORM_DEFAULT_METALNESS 0
+
+// Writes the name of the packed texture of the three maps, any of which may be empty; an
+// empty name when all are. The maps are read from their first channel.
+void TexturePacker_GetOrmName(const char* occlusion, const char* roughness, const char* metalness, char* out,
+                              size_t outSize);
+int TexturePacker_IsPacked(const char* name);
+// Splits a packed name into the paths of its occlusion, roughness and metalness maps.
+// Returns 0 on success, 1 if name is not a packed name.
+int TexturePacker_GetSources(const char* name, char sources[3][TEXTURE_PACKER_SOURCE_SIZE]);
+
+// Hash64 over the contents of the named maps. Returns 0 on success, 1 if one cannot be read.
+int TexturePacker_HashSources(const char* name, uint64_t* hash);
+
+// Decodes the maps, resamples them to the size of the largest and cooks the packed image as
+// a data texture. Returns 0 on success, 1 if a map cannot be decoded, 2 when out of memory.
+int TexturePacker_Cook(const char* name, int threadCount, CookedTexture* cooked);
+
+#endif
@@ -0,0 +1,338 @@
+#include "texture_streamer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <GL/glext.h>
+
+#define REPORT_STEPS 10
+
+typedef struct {
+    GLuint textureID;             // 0 = free entry
+    TexturePixels pixels;
+    uint64_t levelBytes[TEXTURE_CACHE_MAX_LEVELS];
+    uint32_t tailLevel;           // this level and the coarser ones are always resident
+    uint32_t residentLevel;       // finest resident level, the GL base level
+    uint32_t wantedLevel;         // finest level requested in requestFrame
+    uint32_t requestFrame;        // last frame the texture was drawn, 0 = never
+    uint32_t blockedFrame;        // frame in which no room could be made for its next level
+} StreamedTexture;
+
+typedef struct {
+    uint64_t residentBytes;
+    uint64_t wantedBytes;
+} ReportSample;
+
+static struct {
+    StreamedTexture* textures;
+    uint32_t count;
+    uint32_t capacity;
+    uint32_t* entryOfName;        // GL name -> entry + 1, 0 = not streamed
+    GLuint nameCapacity;
+    uint32_t frame;
+    TextureStreamerStats stats;
+    int reporting;
+    ReportSample* samples;
+    int sampleCount;
+    int sampleCapacity;
+    TextureStreamerStats reportStart;
+} streamer = { .frame = 1, .stats.budgetBytes = (uint64_t)TEXTURE_STREAMER_DEFAULT_BUDGET_MB << 20 };
+
+static uint32_t levelSize(const TextureCacheData* data, uint32_t level) {
+    const TextureCacheLevel* l = &data->levels[level];
+    return l->width > l->height ? l->width : l->height;
+}
+
+static uint64_t bytesFrom(const StreamedTexture* texture, uint32_t level) {
+    uint64_t bytes = 0;
+    for (uint32_t i = level; i < texture->pixels.data.levelCount; ++i) bytes += texture->levelBytes[i];
+    return bytes;
+}
+
+static StreamedTexture* findTexture(GLuint textureID) {
+    if (textureID == 0 || textureID >= streamer.nameCapacity) return NULL;
+    uint32_t entry = streamer.entryOfName[textureID];
+    return entry ? &streamer.textures[entry - 1] : NULL;
+}
+
+void TextureStreamer_SetBudget(uint64_t bytes) {
+    streamer.stats.budgetBytes = bytes;
+}
+
+int TextureStreamer_IsEnabled(void) {
+    return streamer.stats.budgetBytes > 0;
+}
+
+// A free entry, growing the array when there is none. NULL when out of memory.
+static StreamedTexture* allocateEntry(void) {
+    for (uint32_t i = 0; i < streamer.count; ++i) {
+        if (streamer.textures[i].textureID == 0) return &streamer.textures[i];
+    }
+    if (streamer.count == streamer.capacity) {
+        uint32_t capacity = streamer.capacity ? streamer.capacity * 2 : 64;
+        StreamedTexture* textures = realloc(streamer.textures, capacity * sizeof(*textures));
+        if (!textures) return NULL;
+        streamer.textures = textures;
+        streamer.capacity = capacity;
+    }
+    StreamedTexture* texture = &streamer.textures[streamer.count++];
+    memset(texture, 0, sizeof(*texture));
+    return texture;
+}
+
+static int reserveName(GLuint textureID) {
+    if (textureID < streamer.nameCapacity) return 0;
+    GLuint capacity = streamer.nameCapacity ? streamer.nameCapacity : 256;
+    while (capacity <= textureID) capacity *= 2;
+    uint32_t* entryOfName = realloc(streamer.entryOfName, capacity * sizeof(*entryOfName));
+    if (!entryOfName) return 2;
+    memset(entryOfName + streamer.nameCapacity, 0, (capacity - streamer.nameCapacity) * sizeof(*entryOfName));
+    streamer.entryOfName = entryOfName;
+    streamer.nameCapacity = capacity;
+    return 0;
+}
+
+GLuint TextureStreamer_Add(const char* filename, TexturePixels* pixels) {
+    const TextureCacheData* data = &pixels->data;
+    if (data->levelCount == 0) return 0;
+    uint32_t tail = data->levelCount - 1;
+    while (tail > 0 && levelSize(data, tail - 1) <= TEXTURE_STREAMER_TAIL_SIZE) --tail;
+
+    StreamedTexture* texture = allocateEntry();
+    if (!texture) {
+        fprintf(stderr, "[TextureStreamer] Out of memory for %s\n", filename);
+        return 0;
+    }
+    GLuint textureID = CreateTextureFromLevel(filename, data, tail);
+    if (!textureID) return 0;
+    if (reserveName(textureID)) {
+        fprintf(stderr, "[TextureStreamer] Out of memory for %s\n", filename);
+        FreeTexture(textureID);
+        return 0;
+    }
+
+    memset(texture, 0, sizeof(*texture));
+    MoveTexturePixels(&texture->pixels, pixels);
+    data = &texture->pixels.data;
+    for (uint32_t i = 0; i < data->levelCount; ++i) {
+        texture->levelBytes[i] = TextureCache_GetLevelSize((TextureFormat)data->format, data->channels,
+                                                           data->levels[i].width, data->levels[i].height);
+    }
+    texture->textureID = textureID;
+    texture->tailLevel = tail;
+    texture->residentLevel = tail;
+    texture->wantedLevel = tail;
+    streamer.entryOfName[textureID] = (uint32_t)(texture - streamer.textures) + 1;
+
+    TextureStreamerStats* stats = &streamer.stats;
+    stats->textureCount++;
+    stats->residentBytes += bytesFrom(texture, tail);
+    stats->fullBytes += bytesFrom(texture, 0);
+    if (stats->residentBytes > stats->peakResidentBytes) stats->peakResidentBytes = stats->residentBytes;
+    return textureID;
+}
+
+void TextureStreamer_Remove(GLuint textureID) {
+    StreamedTexture* texture = findTexture(textureID);
+    if (!texture) return;
+    streamer.stats.textureCount--;
+    streamer.stats.residentBytes -= bytesFrom(texture, texture->residentLevel);
+    streamer.stats.fullBytes -= bytesFrom(texture, 0);
+    FreeTexturePixels(&texture->pixels);
+    texture->textureID = 0;
+    streamer.entryOfName[textureID] = 0;
+}
+
+int TextureStreamer_IsStreamed(GLuint textureID) {
+    const StreamedTexture* texture = findTexture(textureID);
+    return texture && texture->tailLevel > 0;
+}
+
+// Coarsest level still at least as large as the texture on screen.
+void TextureStreamer_Request(GLuint textureID, float screenSize) {
+    StreamedTexture* texture = findTexture(textureID);
+    if (!texture) return;
+    const TextureCacheData* data = &texture->pixels.data;
+    uint32_t level = 0;
+    while (level < texture->tailLevel && (float)levelSize(data, level + 1) >= screenSize) ++level;
+    if (texture->requestFrame != streamer.frame || level < texture->wantedLevel) texture->wantedLevel = level;
+    texture->requestFrame = streamer.frame;
+}
+
+// The base level moves before levels are released and after they are uploaded, so the
+// texture stays complete.
+static void setResidentLevel(StreamedTexture* texture, uint32_t level) {
+    const TextureCacheData* data = &texture->pixels.data;
+    glBindTexture(GL_TEXTURE_2D, texture->textureID);
+    if (level < texture->residentLevel) {
+        UploadTextureLevels(data, level, texture->residentLevel - 1);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, (GLint)level);
+        uint64_t bytes = bytesFrom(texture, level) - bytesFrom(texture, texture->residentLevel);
+        streamer.stats.residentBytes += bytes;
+        streamer.stats.uploadedBytes += bytes;
+        streamer.stats.uploadedLevels += (int)(texture->residentLevel - level);
+    } else {
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, (GLint)level);
+        ReleaseTextureLevels(data, texture->residentLevel, level - 1);
+        streamer.stats.residentBytes -= bytesFrom(texture, texture->residentLevel) - bytesFrom(texture, level);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+    texture->residentLevel = level;
+    if (streamer.stats.residentBytes > streamer.stats.peakResidentBytes) {
+        streamer.stats.peakResidentBytes = streamer.stats.residentBytes;
+    }
+}
+
+// Drops the finest level of the least recently drawn texture with levels above its tail,
+// else a level this frame's requests do not need. Returns 0 if there is nothing to drop.
+static int evictLevel(const StreamedTexture* keep) {
+    StreamedTexture* victim = NULL;
+    for (uint32_t i = 0; i < streamer.count; ++i) {
+        StreamedTexture* texture = &streamer.textures[i];
+        if (!texture->textureID || texture->requestFrame == streamer.frame) continue;
+        if (texture->residentLevel >= texture->tailLevel) continue;
+        if (!victim || texture->requestFrame < victim->requestFrame) victim = texture;
+    }
+    for (uint32_t i = 0; i < streamer.count && !victim; ++i) {
+        StreamedTexture* texture = &streamer.textures[i];
+        if (!texture->textureID || texture == keep || texture->requestFrame != streamer.frame) continue;
+        if (texture->residentLevel < texture->wantedLevel) victim = texture;
+    }
+    if (!victim) return 0;
+    setResidentLevel(victim, victim->residentLevel + 1);
+    streamer.stats.evictedLevels++;
+    return 1;
+}
+
+// The requested texture furthest from its wanted level, skipping those that found no room.
+static StreamedTexture* nextUpgrade(void) {
+    StreamedTexture* best = NULL;
+    for (uint32_t i = 0; i < streamer.count; ++i) {
+        StreamedTexture* texture = &streamer.textures[i];
+        if (!texture->textureID || texture->requestFrame != streamer.frame) continue;
+        if (texture->residentLevel <= texture->wantedLevel || texture->blockedFrame == streamer.frame) continue;
+        uint32_t deficit = texture->residentLevel - texture->wantedLevel;
+        if (!best || deficit > best->residentLevel - best->wantedLevel) best = texture;
+    }
+    return best;
+}
+
+static void recordSample(void) {
+    if (streamer.sampleCount == streamer.sampleCapacity) {
+        int capacity = streamer.sampleCapacity ? streamer.sampleCapacity * 2 : 1024;
+        ReportSample* samples = realloc(streamer.samples, (size_t)capacity * sizeof(*samples));
+        if (!samples) return;
+        streamer.samples = samples;
+        streamer.sampleCapacity = capacity;
+    }
+    ReportSample* sample = &streamer.samples[streamer.sampleCount++];
+    sample->residentBytes = streamer.stats.residentBytes;
+    sample->wantedBytes = streamer.stats.wantedBytes;
+}
+
+void TextureStreamer_Update(void) {
+    TextureStreamerStats* stats = &streamer.stats;
+    // Textures sharper than they are drawn keep one level of slack, so a texture near the
+    // switching distance is not dropped and uploaded again every other frame
+    stats->wantedBytes = 0;
+    for (uint32_t i = 0; i < streamer.count; ++i) {
+        StreamedTexture* texture = &streamer.textures[i];
+        if (!texture->textureID) continue;
+        int requested = texture->requestFrame == streamer.frame;
+        stats->wantedBytes += bytesFrom(texture, requested ? texture->wantedLevel : texture->tailLevel);
+        if (requested && texture->residentLevel + 1 < texture->wantedLevel) {
+            stats->droppedLevels += (int)(texture->wantedLevel - 1 - texture->residentLevel);
+            setResidentLevel(texture, texture->wantedLevel - 1);
+        }
+    }
+    while (stats->residentBytes > stats->budgetBytes && evictLevel(NULL)) {
+    }
+
+    // One level at a time, coarsest first, so every texture on screen sharpens evenly; at
+    // least one level per frame whatever its size
+    uint64_t uploaded = 0;
+    StreamedTexture* texture;
+    while ((texture = nextUpgrade()) != NULL) {
+        uint64_t bytes = texture->levelBytes[texture->residentLevel - 1];
+        if (uploaded > 0 && uploaded + bytes > TEXTURE_STREAMER_UPLOAD_BYTES_PER_FRAME) break;
+        while (stats->residentBytes + bytes > stats->budgetBytes && evictLevel(texture)) {
+        }
+        if (stats->residentBytes + bytes > stats->budgetBytes) {
+            texture->blockedFrame = streamer.frame;
+            continue;
+        }
+        setResidentLevel(texture, texture->residentLevel - 1);
+        uploaded += bytes;
+    }
+
+    if (streamer.reporting) recordSample();
+    streamer.frame++;
+}
+
+void TextureStreamer_GetStats(TextureStreamerStats* stats) {
+    *stats = streamer.stats;
+}
+
+static double megabytes(uint64_t bytes) {
+    return (double)bytes / (1024.0 * 1024.0);
+}
+
+void TextureStreamer_PrintStats(void) {
+    const TextureStreamerStats* stats = &streamer.stats;
+    printf("[TextureStreamer] %d textures, %.2f MB resident of %.2f MB budget (peak %.2f MB), %.2f MB wanted, "
+           "%.2f MB at full resolution\n", stats->textureCount, megabytes(stats->residentBytes),
+           megabytes(stats->budgetBytes), megabytes(stats->peakResidentBytes), megabytes(stats->wantedBytes),
+           megabytes(stats->fullBytes));
+    printf("[TextureStreamer] %d levels uploaded (%.2f MB), %d dropped, %d evicted\n", stats->uploadedLevels,
+           megabytes(stats->uploadedBytes), stats->droppedLevels, stats->evictedLevels);
+}
+
+void TextureStreamer_BeginReport(void) {
+    if (!TextureStreamer_IsEnabled()) return;
+    streamer.reporting = 1;
+    streamer.sampleCount = 0;
+    streamer.reportStart = streamer.stats;
+}
+
+void TextureStreamer_EndReport(const char* tag) {
+    if (!streamer.reporting) return;
+    streamer.reporting = 0;
+    int count = streamer.sampleCount;
+    if (count == 0) return;
+    const TextureStreamerStats* stats = &streamer.stats;
+    printf("%s: texture memory over %d frames, budget %.2f MB, %.2f MB at full resolution\n", tag, count,
+           megabytes(stats->budgetBytes), megabytes(stats->fullBytes));
+    int overBudget = 0;
+    for (int step = 0; step < REPORT_STEPS; ++step) {
+        int first = count * step / REPORT_STEPS;
+        int last = count * (step + 1) / REPORT_STEPS;
+        if (first == last) continue;
+        uint64_t resident = 0, wanted = 0, peak = 0;
+        for (int i = first; i < last; ++i) {
+            const ReportSample* sample = &streamer.samples[i];
+            resident += sample->residentBytes;
+            wanted += sample->wantedBytes;
+            if (sample->residentBytes > peak) peak = sample->residentBytes;
+            if (sample->residentBytes > stats->budgetBytes) overBudget++;
+        }
+        uint64_t n = (uint64_t)(last - first);
+        printf("%s: frames %5d-%5d resident %7.2f MB (peak %7.2f MB), wanted %7.2f MB\n", tag, first, last - 1,
+               megabytes(resident / n), megabytes(peak), megabytes(wanted / n));
+    }
+    const TextureStreamerStats* start = &streamer.reportStart;
+    printf("%s: %d levels uploaded (%.2f MB), %d dropped, %d evicted, %d frames over budget\n", tag,
+           stats->uploadedLevels - start->uploadedLevels, megabytes(stats->uploadedBytes - start->uploadedBytes),
+           stats->droppedLevels - start->droppedLevels, stats->evictedLevels - start->evictedLevels, overBudget);
+}
+
+void TextureStreamer_Shutdown(void) {
+    for (uint32_t i = 0; i < streamer.count; ++i) {
+        if (streamer.textures[i].textureID) FreeTexturePixels(&streamer.textures[i].pixels);
+    }
+    free(streamer.textures);
+    free(streamer.entryOfName);
+    free(streamer.samples);
+    uint64_t budgetBytes = streamer.stats.budgetBytes;
+    memset(&streamer, 0, sizeof(streamer));
+    streamer.frame = 1;
+    streamer.stats.budgetBytes = budgetBytes;
+}
@@ -0,0 +1,62 @@
+#ifndef TEXTURE_STREAMER_H
+#define TEXTURE_STREAMER_H
+
+#include <stdint.h>
+#include <GL/gl.h>
+#include "texture_loader.h"
+
+// Mip residency under a GPU memory budget. A streamed texture starts with only its small mips
+// (the tail, TEXTURE_STREAMER_TAIL_SIZE and below) on the GPU and keeps its cooked pixels on
+// the CPU. Each frame the renderer requests the textures it draws with the projected size of
+// the object in pixels; Update then uploads finer levels, coarsest first and a few megabytes
+// per frame, and gives back levels that are no longer needed. When the budget is full the
+// least recently drawn textures lose their finest levels first. GL_TEXTURE_BASE_LEVEL is the
+// finest resident level, so a texture is complete whatever is resident.
+// Everything here runs on the GL thread.
+
+#define TEXTURE_STREAMER_TAIL_SIZE 64
+#define TEXTURE_STREAMER_DEFAULT_BUDGET_MB 128
+#define TEXTURE_STREAMER_UPLOAD_BYTES_PER_FRAME (8u << 20)
+
+typedef struct {
+    int textureCount;
+    uint64_t budgetBytes;
+    uint64_t residentBytes;
+    uint64_t peakResidentBytes;
+    uint64_t wantedBytes;         // levels the last frame asked for, plus the tails of the rest
+    uint64_t fullBytes;           // every level of every texture
+    uint64_t uploadedBytes;
+    int uploadedLevels;
+    int droppedLevels;            // given back because the texture got smaller on screen
+    int evictedLevels;            // given back to stay under the budget
+} TextureStreamerStats;
+
+// Budget in bytes for the levels of streamed textures; 0 turns streaming off. Set it before
+// textures are added: it only decides how later textures are loaded. Streaming is on with
+// TEXTURE_STREAMER_DEFAULT_BUDGET_MB by default.
+void TextureStreamer_SetBudget(uint64_t bytes);
+int TextureStreamer_IsEnabled(void);
+
+// Creates a texture with the tail levels of pixels and takes the pixels, leaving them empty.
+// Returns the GL name, 0 on failure.
+GLuint TextureStreamer_Add(const char* filename, TexturePixels* pixels);
+// Forgets a texture before its GL name is deleted. Names that are not streamed are ignored.
+void TextureStreamer_Remove(GLuint textureID);
+// Whether the texture has levels that may not be resident, i.e. is larger than its tail.
+int TextureStreamer_IsStreamed(GLuint textureID);
+// The texture is drawn this frame covering about screenSize pixels across.
+void TextureStreamer_Request(GLuint textureID, float screenSize);
+// Uploads and releases levels for this frame's requests and starts the next frame.
+void TextureStreamer_Update(void);
+
+void TextureStreamer_GetStats(TextureStreamerStats* stats);
+void TextureStreamer_PrintStats(void);
+// Records resident and wanted bytes of every Update between the two calls; EndReport prints
+// them in ten steps with the budget and the uploads, drops and evictions in between.
+void TextureStreamer_BeginReport(void);
+void TextureStreamer_EndReport(const char* tag);
+
+// Frees every streamed texture's pixels; the GL names belong to their owners.
+void TextureStreamer_Shutdown(void);
+
+#endif
@@ -3,12 +3,16 @@
 #include <stdio.h>
 #include <stdlib.h>
 GLuint CreateWhiteTexture(void) {
+    return CreateSolidTexture(255, 255, 255);
+}
+
+GLuint CreateSolidTexture(unsigned char r, unsigned char g, unsigned char b) {
     GLuint tex;
     glGenTextures(1, &tex);
     glBindTexture(GL_TEXTURE_2D, tex);
 
-    unsigned char white[3] = {255, 255, 255};
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, 1, 1, 0, GL_RGB, GL_UNSIGNED_BYTE, white);
+    unsigned char color[3] = {r, g, b};
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, 1, 1, 0, GL_RGB, GL_UNSIGNED_BYTE, color);
 
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
@@ -3,5 +3,7 @@
 #include <GL/gl.h>
 
 GLuint CreateWhiteTexture(void);
+// 1x1 RGB texture of one color, for maps an object lacks.
+GLuint CreateSolidTexture(unsigned char r, unsigned char g, unsigned char b);
 
 #endif
\ No newline at end of file
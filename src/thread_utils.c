@@ -0,0 +1,160 @@
+#include "thread_utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#endif
+
+#define MAX_PARALLEL_THREADS 64
+
+typedef struct {
+    ThreadFunction function;
+    void* arg;
+} ThreadStart;
+
+#ifdef _WIN32
+
+static DWORD WINAPI threadTrampoline(LPVOID param) {
+    ThreadStart start = *(ThreadStart*)param;
+    free(param);
+    start.function(start.arg);
+    return 0;
+}
+
+int StartThread(Thread* thread, ThreadFunction function, void* arg) {
+    ThreadStart* start = malloc(sizeof(ThreadStart));
+    if (!start) return 1;
+    start->function = function;
+    start->arg = arg;
+
+    HANDLE handle = CreateThread(NULL, 0, threadTrampoline, start, 0, NULL);
+    if (!handle) {
+        fprintf(stderr, "[Thread] CreateThread failed (error %lu)\n", GetLastError());
+        free(start);
+        return 1;
+    }
+    thread->handle = handle;
+    return 0;
+}
+
+void JoinThread(Thread* thread) {
+    if (!thread || !thread->handle) return;
+    WaitForSingleObject((HANDLE)thread->handle, INFINITE);
+    CloseHandle((HANDLE)thread->handle);
+    thread->handle = NULL;
+}
+
+int GetHardwareThreadCount(void) {
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors > 0 ? (int)info.dwNumberOfProcessors : 1;
+}
+
+void YieldThread(void) {
+    SwitchToThread();
+}
+
+#else
+
+static void* threadTrampoline(void* param) {
+    ThreadStart start = *(ThreadStart*)param;
+    free(param);
+    start.function(start.arg);
+    return NULL;
+}
+
+int StartThread(Thread* thread, ThreadFunction function, void* arg) {
+    ThreadStart* start = malloc(sizeof(ThreadStart));
+    pthread_t* handle = malloc(sizeof(pthread_t));
+    if (!start || !handle) {
+        free(start);
+        free(handle);
+        return 1;
+    }
+    start->function = function;
+    start->arg = arg;
+
+    if (pthread_create(handle, NULL, threadTrampoline, start) != 0) {
+        fprintf(stderr, "[Thread] pthread_create failed\n");
+        free(start);
+        free(handle);
+        return 1;
+    }
+    thread->handle = handle;
+    return 0;
+}
+
+void JoinThread(Thread* thread) {
+    if (!thread || !thread->handle) return;
+    pthread_join(*(pthread_t*)thread->handle, NULL);
+    free(thread->handle);
+    thread->handle = NULL;
+}
+
+int GetHardwareThreadCount(void) {
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (int)count : 1;
+}
+
+void YieldThread(void) {
+    sched_yield();
+}
+
+#endif
+
+typedef struct {
+    ParallelForFunction task;
+    void* context;
+    int taskCount;
+    atomic_int next;
+} ParallelForJob;
+
+static void parallelForWorker(void* arg) {
+    ParallelForJob* job = (ParallelForJob*)arg;
+    for (;;) {
+        int index = atomic_fetch_add(&job->next, 1);
+        if (index >= job->taskCount) break;
+        job->task(job->context, index);
+    }
+}
+
+void ParallelFor(int taskCount, int threadCount, ParallelForFunction task, void* context) {
+    if (taskCount <= 0) return;
+    if (threadCount > taskCount) threadCount = taskCount;
+    if (threadCount > MAX_PARALLEL_THREADS) threadCount = MAX_PARALLEL_THREADS;
+
+    if (threadCount <= 1) {
+        for (int i = 0; i < taskCount; ++i) {
+            task(context, i);
+        }
+        return;
+    }
+
+    ParallelForJob job;
+    job.task = task;
+    job.context = context;
+    job.taskCount = taskCount;
+    atomic_init(&job.next, 0);
+
+    Thread threads[MAX_PARALLEL_THREADS];
+    int started = 0;
+    for (int i = 0; i < threadCount - 1; ++i) {
+        if (StartThread(&threads[started], parallelForWorker, &job) == 0) {
+            started++;
+        }
+    }
+
+    // The calling thread works too; if no thread could be started it does everything.
+    parallelForWorker(&job);
+
+    for (int i = 0; i < started; ++i) {
+        JoinThread(&threads[i]);
+    }
+}
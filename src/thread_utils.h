@@ -0,0 +1,24 @@
+#ifndef THREAD_UTILS_H
+#define THREAD_UTILS_H
+
+typedef void (*ThreadFunction)(void* arg);
+typedef void (*ParallelForFunction)(void* context, int taskIndex);
+
+typedef struct {
+    void* handle;
+} Thread;
+
+// Returns 0 on success.
+int StartThread(Thread* thread, ThreadFunction function, void* arg);
+void JoinThread(Thread* thread);
+
+int GetHardwareThreadCount(void);
+// Gives the rest of the time slice to other threads, e.g. while waiting on a full queue.
+void YieldThread(void);
+
+// Runs task(context, i) for every i in [0, taskCount) on up to threadCount threads
+// (the calling thread included) and returns when all tasks are done.
+// threadCount <= 1 runs everything inline, in order.
+void ParallelFor(int taskCount, int threadCount, ParallelForFunction task, void* context);
+
+#endif
@@ -0,0 +1,7 @@
+#ifndef TIME_UTILS_H
+#define TIME_UTILS_H
+
+// Monotonic wall clock in seconds, for load-time measurements.
+double GetTimeSeconds(void);
+
+#endif
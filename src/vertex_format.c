@@ -0,0 +1,363 @@
+#include "vertex_format.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define PI_F 3.14159265358979f
+
+static const VertexLayout layouts[] = {
+    {VERTEX_LAYOUT_FLOAT32, "float", 44, VERTEX_ENCODING_FLOAT, {
+        {3, VERTEX_COMPONENT_FLOAT32, 0},
+        {3, VERTEX_COMPONENT_FLOAT32, 12},
+        {2, VERTEX_COMPONENT_FLOAT32, 24},
+        {3, VERTEX_COMPONENT_FLOAT32, 32}}},
+    // 2 bytes of padding after the position keep the other attributes 4-byte aligned
+    {VERTEX_LAYOUT_PACKED20, "packed20", 20, VERTEX_ENCODING_OCT16, {
+        {3, VERTEX_COMPONENT_UNORM16, 0},
+        {2, VERTEX_COMPONENT_SNORM16, 8},
+        {2, VERTEX_COMPONENT_HALF, 16},
+        {2, VERTEX_COMPONENT_SNORM16, 12}}},
+    {VERTEX_LAYOUT_PACKED16, "packed16", 16, VERTEX_ENCODING_OCT10_TANGENT_ANGLE, {
+        {3, VERTEX_COMPONENT_UNORM16, 0},
+        {4, VERTEX_COMPONENT_SNORM_10_10_10_2, 8},
+        {2, VERTEX_COMPONENT_UNORM16, 12},
+        {0, VERTEX_COMPONENT_FLOAT32, 0}}}
+};
+
+const VertexLayout* VertexFormat_GetLayout(uint32_t id) {
+    for (size_t i = 0; i < sizeof(layouts) / sizeof(layouts[0]); ++i) {
+        if ((uint32_t)layouts[i].id == id) return &layouts[i];
+    }
+    return NULL;
+}
+
+VertexLayoutId VertexFormat_ParseLayoutName(const char* name) {
+    for (size_t i = 0; i < sizeof(layouts) / sizeof(layouts[0]); ++i) {
+        if (strcmp(layouts[i].name, name) == 0) return layouts[i].id;
+    }
+    return (VertexLayoutId)0;
+}
+
+void VertexFormat_IdentityQuantization(VertexQuantization* quantization) {
+    for (int i = 0; i < 3; ++i) {
+        quantization->positionScale[i] = 1.0f;
+        quantization->positionOffset[i] = 0.0f;
+    }
+    for (int i = 0; i < 2; ++i) {
+        quantization->texcoordScale[i] = 1.0f;
+        quantization->texcoordOffset[i] = 0.0f;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Scalar encodings. Decoding follows the GL rules for normalized attributes.
+// ---------------------------------------------------------------------------
+
+static float clampf(float v, float lo, float hi) {
+    return v < lo ? lo : (v > hi ? hi : v);
+}
+
+static uint16_t encodeUnorm16(float v) {
+    return (uint16_t)lrintf(clampf(v, 0.0f, 1.0f) * 65535.0f);
+}
+
+static int16_t encodeSnorm16(float v) {
+    return (int16_t)lrintf(clampf(v, -1.0f, 1.0f) * 32767.0f);
+}
+
+static float decodeSnorm16(int16_t v) {
+    return fmaxf((float)v / 32767.0f, -1.0f);
+}
+
+static uint32_t encodeSnorm10(float v) {
+    return (uint32_t)lrintf(clampf(v, -1.0f, 1.0f) * 511.0f) & 0x3ff;
+}
+
+static float decodeSnorm10(uint32_t bits) {
+    int32_t v = (int32_t)(bits << 22) >> 22;
+    return fmaxf((float)v / 511.0f, -1.0f);
+}
+
+// Round to nearest even; values past the half range become infinity.
+static uint16_t floatToHalf(float value) {
+    uint32_t f;
+    memcpy(&f, &value, sizeof(f));
+    uint32_t sign = (f >> 16) & 0x8000;
+    uint32_t exponent = (f >> 23) & 0xff;
+    uint32_t mantissa = f & 0x7fffff;
+
+    if (exponent == 0xff) return (uint16_t)(sign | 0x7c00 | (mantissa ? 0x200 : 0));
+    int e = (int)exponent - 127 + 15;
+    if (e >= 31) return (uint16_t)(sign | 0x7c00);
+    if (e <= 0) {
+        if (e < -10) return (uint16_t)sign;
+        mantissa |= 0x800000;
+        uint32_t shift = (uint32_t)(14 - e);
+        uint32_t half = mantissa >> shift;
+        uint32_t rest = mantissa & ((1u << shift) - 1);
+        uint32_t halfway = 1u << (shift - 1);
+        if (rest > halfway || (rest == halfway && (half & 1))) half++;
+        return (uint16_t)(sign | half);
+    }
+    uint32_t half = ((uint32_t)e << 10) | (mantissa >> 13);
+    uint32_t rest = mantissa & 0x1fff;
+    if (rest > 0x1000 || (rest == 0x1000 && (half & 1))) half++;   // may carry into the exponent, which is correct
+    return (uint16_t)(sign | half);
+}
+
+static float halfToFloat(uint16_t h) {
+    uint32_t sign = (uint32_t)(h & 0x8000) << 16;
+    uint32_t exponent = (h >> 10) & 0x1f;
+    uint32_t mantissa = h & 0x3ff;
+    uint32_t f;
+
+    if (exponent == 0) {
+        float v = ldexpf((float)mantissa, -24);
+        return sign ? -v : v;
+    }
+    if (exponent == 31) f = sign | 0x7f800000 | (mantissa << 13);
+    else f = sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+    float v;
+    memcpy(&v, &f, sizeof(v));
+    return v;
+}
+
+// ---------------------------------------------------------------------------
+// Direction encodings
+// ---------------------------------------------------------------------------
+
+static int normalize3(const float* v, float* out) {
+    float length = sqrtf(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+    if (length < 1e-12f) return 0;
+    out[0] = v[0] / length;
+    out[1] = v[1] / length;
+    out[2] = v[2] / length;
+    return 1;
+}
+
+static float signNotZero(float v) {
+    return v >= 0.0f ? 1.0f : -1.0f;
+}
+
+// Octahedral mapping of a unit vector to [-1, 1]^2 (Cigolle et al. 2014)
+static void octEncode(const float* n, float* out) {
+    float sum = fabsf(n[0]) + fabsf(n[1]) + fabsf(n[2]);
+    float x = n[0] / sum;
+    float y = n[1] / sum;
+    if (n[2] < 0.0f) {
+        float folded = (1.0f - fabsf(y)) * signNotZero(x);
+        y = (1.0f - fabsf(x)) * signNotZero(y);
+        x = folded;
+    }
+    out[0] = x;
+    out[1] = y;
+}
+
+static void octDecode(float x, float y, float* out) {
+    float v[3] = {x, y, 1.0f - fabsf(x) - fabsf(y)};
+    if (v[2] < 0.0f) {
+        float folded = (1.0f - fabsf(y)) * signNotZero(x);
+        v[1] = (1.0f - fabsf(x)) * signNotZero(y);
+        v[0] = folded;
+    }
+    normalize3(v, out);
+}
+
+// Continuous tangent frame around n without a singularity (Duff et al. 2017).
+// The vertex shader builds the same frame from the decoded normal.
+static void tangentFrame(const float* n, float* b1, float* b2) {
+    float sign = signNotZero(n[2]);
+    float a = -1.0f / (sign + n[2]);
+    float b = n[0] * n[1] * a;
+    b1[0] = 1.0f + sign * n[0] * n[0] * a;
+    b1[1] = sign * b;
+    b1[2] = -sign * n[0];
+    b2[0] = b;
+    b2[1] = sign + n[1] * n[1] * a;
+    b2[2] = -n[1];
+}
+
+static float dot3(const float* a, const float* b) {
+    return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+// Gram-Schmidt against the normal; falls back to the frame's first axis for degenerate tangents.
+void VertexFormat_OrthogonalTangent(const float* n, const float* t, float* out) {
+    float d = dot3(n, t);
+    float projected[3] = {t[0] - n[0] * d, t[1] - n[1] * d, t[2] - n[2] * d};
+    if (!normalize3(projected, out)) {
+        float b2[3];
+        tangentFrame(n, out, b2);
+    }
+}
+
+static float angleDegrees(const float* a, const float* b) {
+    return acosf(clampf(dot3(a, b), -1.0f, 1.0f)) * (180.0f / PI_F);
+}
+
+// ---------------------------------------------------------------------------
+// Packing
+// ---------------------------------------------------------------------------
+
+// Bounds of `count` floats at `offset` in every vertex, as the scale/offset that maps unorm16 back.
+static void quantizationRange(const float* vertices, size_t vertexCount, int offset, int count,
+                              float* scale, float* bias) {
+    for (int c = 0; c < count; ++c) {
+        float lo = INFINITY, hi = -INFINITY;
+        for (size_t i = 0; i < vertexCount; ++i) {
+            float v = vertices[i * FLOATS_PER_VERTEX + offset + c];
+            if (v < lo) lo = v;
+            if (v > hi) hi = v;
+        }
+        if (vertexCount == 0) lo = hi = 0.0f;
+        bias[c] = lo;
+        scale[c] = hi - lo;
+    }
+}
+
+static uint16_t quantize(float v, float scale, float bias) {
+    return scale > 0.0f ? encodeUnorm16((v - bias) / scale) : 0;
+}
+
+static void packVertex(const float* src, const VertexLayout* layout, const VertexQuantization* q, uint8_t* dst) {
+    float normal[3] = {0.0f, 0.0f, 1.0f};
+    normalize3(&src[3], normal);
+    float oct[2];
+
+    uint16_t position[4] = {0, 0, 0, 0};
+    for (int c = 0; c < 3; ++c) position[c] = quantize(src[c], q->positionScale[c], q->positionOffset[c]);
+    memcpy(dst, position, sizeof(position));
+
+    // Tangents are encoded relative to the normal the shader will decode, not the exact one
+    octEncode(normal, oct);
+    if (layout->id == VERTEX_LAYOUT_PACKED20) {
+        int16_t encodedNormal[2] = {encodeSnorm16(oct[0]), encodeSnorm16(oct[1])};
+        float decodedNormal[3], tangent[3], encodedTangent[2];
+        octDecode(decodeSnorm16(encodedNormal[0]), decodeSnorm16(encodedNormal[1]), decodedNormal);
+        VertexFormat_OrthogonalTangent(decodedNormal, &src[8], tangent);
+        octEncode(tangent, encodedTangent);
+        int16_t tangentBits[2] = {encodeSnorm16(encodedTangent[0]), encodeSnorm16(encodedTangent[1])};
+        uint16_t uv[2] = {floatToHalf(src[6]), floatToHalf(src[7])};
+        memcpy(dst + 8, encodedNormal, sizeof(encodedNormal));
+        memcpy(dst + 12, tangentBits, sizeof(tangentBits));
+        memcpy(dst + 16, uv, sizeof(uv));
+    } else {
+        uint32_t nx = encodeSnorm10(oct[0]);
+        uint32_t ny = encodeSnorm10(oct[1]);
+        float decodedNormal[3], tangent[3], b1[3], b2[3];
+        octDecode(decodeSnorm10(nx), decodeSnorm10(ny), decodedNormal);
+        VertexFormat_OrthogonalTangent(decodedNormal, &src[8], tangent);
+        tangentFrame(decodedNormal, b1, b2);
+        float angle = atan2f(dot3(tangent, b2), dot3(tangent, b1)) / PI_F;
+        // GL_INT_2_10_10_10_REV: x in the low bits, w (unused) in the top two
+        uint32_t packed = nx | (ny << 10) | (encodeSnorm10(angle) << 20);
+        uint16_t uv[2] = {quantize(src[6], q->texcoordScale[0], q->texcoordOffset[0]),
+                          quantize(src[7], q->texcoordScale[1], q->texcoordOffset[1])};
+        memcpy(dst + 8, &packed, sizeof(packed));
+        memcpy(dst + 12, uv, sizeof(uv));
+    }
+}
+
+void VertexFormat_Unpack(const void* vertex, VertexLayoutId layoutId, const VertexQuantization* q, float* out) {
+    const uint8_t* src = vertex;
+    if (layoutId == VERTEX_LAYOUT_FLOAT32) {
+        memcpy(out, src, FLOATS_PER_VERTEX * sizeof(float));
+        return;
+    }
+
+    uint16_t position[3];
+    memcpy(position, src, sizeof(position));
+    for (int c = 0; c < 3; ++c) {
+        out[c] = (float)position[c] / 65535.0f * q->positionScale[c] + q->positionOffset[c];
+    }
+
+    if (layoutId == VERTEX_LAYOUT_PACKED20) {
+        int16_t normal[2], tangent[2];
+        uint16_t uv[2];
+        memcpy(normal, src + 8, sizeof(normal));
+        memcpy(tangent, src + 12, sizeof(tangent));
+        memcpy(uv, src + 16, sizeof(uv));
+        octDecode(decodeSnorm16(normal[0]), decodeSnorm16(normal[1]), &out[3]);
+        out[6] = halfToFloat(uv[0]);
+        out[7] = halfToFloat(uv[1]);
+        octDecode(decodeSnorm16(tangent[0]), decodeSnorm16(tangent[1]), &out[8]);
+    } else {
+        uint32_t packed;
+        uint16_t uv[2];
+        memcpy(&packed, src + 8, sizeof(packed));
+        memcpy(uv, src + 12, sizeof(uv));
+        octDecode(decodeSnorm10(packed), decodeSnorm10(packed >> 10), &out[3]);
+        float angle = decodeSnorm10(packed >> 20) * PI_F;
+        float b1[3], b2[3];
+        tangentFrame(&out[3], b1, b2);
+        for (int c = 0; c < 3; ++c) out[8 + c] = cosf(angle) * b1[c] + sinf(angle) * b2[c];
+        for (int c = 0; c < 2; ++c) {
+            out[6 + c] = (float)uv[c] / 65535.0f * q->texcoordScale[c] + q->texcoordOffset[c];
+        }
+    }
+}
+
+static void measureError(const float* vertices, size_t vertexCount, const uint8_t* packed,
+                         const VertexLayout* layout, const VertexQuantization* q, VertexPackError* error) {
+    double normalSum = 0.0, tangentSum = 0.0;
+    size_t normalCount = 0, tangentCount = 0;
+    memset(error, 0, sizeof(*error));
+
+    for (size_t i = 0; i < vertexCount; ++i) {
+        const float* src = &vertices[i * FLOATS_PER_VERTEX];
+        float decoded[FLOATS_PER_VERTEX];
+        VertexFormat_Unpack(packed + i * layout->stride, layout->id, q, decoded);
+
+        for (int c = 0; c < 3; ++c) error->maxPosition = fmaxf(error->maxPosition, fabsf(decoded[c] - src[c]));
+        for (int c = 6; c < 8; ++c) error->maxTexcoord = fmaxf(error->maxTexcoord, fabsf(decoded[c] - src[c]));
+
+        float normal[3];
+        if (!normalize3(&src[3], normal)) continue;
+        float normalError = angleDegrees(normal, &decoded[3]);
+        error->maxNormalDegrees = fmaxf(error->maxNormalDegrees, normalError);
+        normalSum += normalError;
+        normalCount++;
+
+        float tangent[3];
+        float d = dot3(normal, &src[8]);
+        float projected[3] = {src[8] - normal[0] * d, src[9] - normal[1] * d, src[10] - normal[2] * d};
+        if (!normalize3(projected, tangent)) continue;
+        float tangentError = angleDegrees(tangent, &decoded[8]);
+        error->maxTangentDegrees = fmaxf(error->maxTangentDegrees, tangentError);
+        tangentSum += tangentError;
+        tangentCount++;
+    }
+    if (normalCount) error->meanNormalDegrees = (float)(normalSum / (double)normalCount);
+    if (tangentCount) error->meanTangentDegrees = (float)(tangentSum / (double)tangentCount);
+}
+
+void* VertexFormat_Pack(const float* vertices, size_t vertexCount, VertexLayoutId layoutId,
+                        VertexQuantization* quantization, VertexPackError* error) {
+    const VertexLayout* layout = VertexFormat_GetLayout(layoutId);
+    if (!layout) return NULL;
+
+    uint8_t* packed = malloc(vertexCount * layout->stride + 1);
+    if (!packed) {
+        fprintf(stderr, "[VertexFormat] Out of memory packing %zu vertices\n", vertexCount);
+        return NULL;
+    }
+
+    VertexFormat_IdentityQuantization(quantization);
+    if (layoutId == VERTEX_LAYOUT_FLOAT32) {
+        memcpy(packed, vertices, vertexCount * layout->stride);
+        if (error) memset(error, 0, sizeof(*error));
+        return packed;
+    }
+
+    quantizationRange(vertices, vertexCount, 0, 3, quantization->positionScale, quantization->positionOffset);
+    if (layoutId == VERTEX_LAYOUT_PACKED16) {
+        quantizationRange(vertices, vertexCount, 6, 2, quantization->texcoordScale, quantization->texcoordOffset);
+    }
+    for (size_t i = 0; i < vertexCount; ++i) {
+        packVertex(&vertices[i * FLOATS_PER_VERTEX], layout, quantization, packed + i * layout->stride);
+    }
+
+    if (error) measureError(vertices, vertexCount, packed, layout, quantization, error);
+    return packed;
+}
@@ -0,0 +1,93 @@
+#ifndef VERTEX_FORMAT_H
+#define VERTEX_FORMAT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Vertex layouts for the GPU copy of a mesh. Processing always works on the float
+// layout; the packed layouts are produced just before upload.
+
+// pos(3), normal(3), uv(2), tangent(3)
+#define FLOATS_PER_VERTEX 11
+
+typedef enum {
+    VERTEX_LAYOUT_FLOAT32  = 1,   // pos, normal, uv, tangent as floats: 44 bytes
+    VERTEX_LAYOUT_PACKED20 = 2,   // unorm16 pos, oct snorm16 normal + tangent, half uv: 20 bytes
+    VERTEX_LAYOUT_PACKED16 = 3    // unorm16 pos, oct normal + tangent angle in 10_10_10_2, unorm16 uv: 16 bytes
+} VertexLayoutId;
+
+// How the vertex shader decodes normals and tangents (uniform uVertexEncoding)
+typedef enum {
+    VERTEX_ENCODING_FLOAT = 0,
+    VERTEX_ENCODING_OCT16 = 1,               // oct normal in aNormal.xy, oct tangent in aTangent.xy
+    VERTEX_ENCODING_OCT10_TANGENT_ANGLE = 2  // oct normal in aNormal.xy, tangent angle in aNormal.z
+} VertexEncoding;
+
+typedef enum {
+    VERTEX_ATTRIBUTE_POSITION,   // location 0
+    VERTEX_ATTRIBUTE_NORMAL,     // location 1
+    VERTEX_ATTRIBUTE_TEXCOORD,   // location 2
+    VERTEX_ATTRIBUTE_TANGENT,    // location 3
+    VERTEX_ATTRIBUTE_COUNT
+} VertexAttribute;
+
+typedef enum {
+    VERTEX_COMPONENT_FLOAT32,
+    VERTEX_COMPONENT_HALF,
+    VERTEX_COMPONENT_UNORM16,
+    VERTEX_COMPONENT_SNORM16,
+    VERTEX_COMPONENT_SNORM_10_10_10_2   // one packed 32-bit value, 4 components
+} VertexComponentType;
+
+typedef struct {
+    int components;              // 0 = not stored, the shader sees the default value
+    VertexComponentType type;
+    uint32_t offset;             // bytes from the start of the vertex
+} VertexAttributeFormat;
+
+typedef struct {
+    VertexLayoutId id;
+    const char* name;
+    uint32_t stride;
+    VertexEncoding encoding;
+    VertexAttributeFormat attributes[VERTEX_ATTRIBUTE_COUNT];
+} VertexLayout;
+
+// Maps unorm16 positions and UVs back: value = attribute * scale + offset, where the
+// attribute is the normalized [0, 1] value the vertex shader receives.
+typedef struct {
+    float positionScale[3];
+    float positionOffset[3];
+    float texcoordScale[2];
+    float texcoordOffset[2];
+} VertexQuantization;
+
+// Largest and average difference between decoded packed attributes and the float source
+typedef struct {
+    float maxPosition;           // world units
+    float maxNormalDegrees;
+    float meanNormalDegrees;
+    float maxTangentDegrees;     // against the tangent made orthogonal to the normal
+    float meanTangentDegrees;
+    float maxTexcoord;           // UV units
+} VertexPackError;
+
+// Returns NULL for unknown ids.
+const VertexLayout* VertexFormat_GetLayout(uint32_t id);
+// Accepts "float", "packed20" and "packed16"; returns 0 for anything else.
+VertexLayoutId VertexFormat_ParseLayoutName(const char* name);
+void VertexFormat_IdentityQuantization(VertexQuantization* quantization);
+
+// Converts FLOATS_PER_VERTEX float vertices to the layout. Returns a malloc'd buffer of
+// vertexCount * stride bytes, or NULL. error may be NULL.
+void* VertexFormat_Pack(const float* vertices, size_t vertexCount, VertexLayoutId layout,
+                        VertexQuantization* quantization, VertexPackError* error);
+
+// Decodes one packed vertex back to FLOATS_PER_VERTEX floats, as the vertex shader does.
+void VertexFormat_Unpack(const void* vertex, VertexLayoutId layout, const VertexQuantization* quantization,
+                         float* out);
+
+// Unit tangent orthogonal to the unit normal n. out may alias t.
+void VertexFormat_OrthogonalTangent(const float* n, const float* t, float* out);
+
+#endif
@@ -0,0 +1,262 @@
+#include "test.h"
+#include "OBJ_file_loader.h"
+#include "mesh_optimizer.h"
+#include "block_codec.h"
+#include "texture_cache.h"
+#include "texture_compressor.h"
+#include "vertex_format.h"
+#include "time_utils.h"
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BENCH_BLOCK_RUNS 5
+#define BENCH_BLOCK_GRID_SIZE 400
+#define BENCH_BLOCK_TEXTURE_SIZE 1024
+
+static const char* formatNames[TEXTURE_FORMAT_COUNT] = {"raw", "BC1", "BC3", "BC4", "BC5"};
+
+static uint32_t nextRandom(uint32_t* state) {
+    *state = *state * 1664525u + 1013904223u;
+    return *state;
+}
+
+static double megabytes(size_t bytes) {
+    return (double)bytes / (1024.0 * 1024.0);
+}
+
+// One stream compression and the best of BENCH_BLOCK_RUNS decodes, all on one thread
+static int benchPayload(const char* name, const void* data, size_t size) {
+    void* stream;
+    size_t streamSize;
+    double startTime = GetTimeSeconds();
+    if (BlockCodec_CompressStream(data, size, 1, &stream, &streamSize)) {
+        printf("[Bench] Cannot compress %s\n", name);
+        return 1;
+    }
+    double compressSeconds = GetTimeSeconds() - startTime;
+    uint8_t* decoded = malloc(size ? size : 1);
+    if (!decoded) {
+        printf("[Bench] Out of memory for %s\n", name);
+        free(stream);
+        return 1;
+    }
+    double best = 1e30;
+    int failed = 0;
+    for (int run = 0; run < BENCH_BLOCK_RUNS; ++run) {
+        startTime = GetTimeSeconds();
+        failed |= BlockCodec_DecompressStream(stream, streamSize, decoded, size, 1) != 0;
+        double seconds = GetTimeSeconds() - startTime;
+        if (seconds < best) best = seconds;
+    }
+    failed |= memcmp(decoded, data, size) != 0;
+    printf("  %-31s %7.2f MB -> %7.2f MB %6.2fx, compress %6.0f MB/s, decode %5.2f GB/s%s\n", name,
+           megabytes(size), megabytes(streamSize), (double)size / (double)streamSize,
+           megabytes(size) / compressSeconds, (double)size / best / 1e9, failed ? "  ROUND TRIP FAILED" : "");
+    free(decoded);
+    free(stream);
+    return failed;
+}
+
+// Vertices and indices of the mesh as the cooker orders them, then with the vertices in
+// random order, which leaves LZ4 only the repeats inside each vertex
+static int benchMeshPayloads(const char* label, ObjMesh* mesh) {
+    size_t vertexCount = mesh->unique_vertex_count;
+    size_t floatSize = vertexCount * FLOATS_PER_VERTEX * sizeof(float);
+    size_t indexSize = mesh->element_count * sizeof(uint32_t);
+    char name[64];
+    int failed = 0;
+
+    VertexQuantization quantization;
+    const VertexLayout* packed = VertexFormat_GetLayout(VERTEX_LAYOUT_PACKED16);
+    void* packedVertices = VertexFormat_Pack(mesh->unique_vertices, vertexCount, VERTEX_LAYOUT_PACKED16,
+                                             &quantization, NULL);
+    snprintf(name, sizeof(name), "%s float32 vertices", label);
+    failed |= benchPayload(name, mesh->unique_vertices, floatSize);
+    if (packedVertices) {
+        snprintf(name, sizeof(name), "%s %s vertices", label, packed->name);
+        failed |= benchPayload(name, packedVertices, vertexCount * packed->stride);
+    }
+    snprintf(name, sizeof(name), "%s indices", label);
+    failed |= benchPayload(name, mesh->elements, indexSize);
+    free(packedVertices);
+    return failed;
+}
+
+static int shuffleMesh(ObjMesh* mesh) {
+    size_t vertexCount = mesh->unique_vertex_count;
+    uint32_t* order = malloc(vertexCount * sizeof(uint32_t));
+    float* shuffled = malloc(vertexCount * FLOATS_PER_VERTEX * sizeof(float));
+    if (!order || !shuffled) {
+        free(order);
+        free(shuffled);
+        return 2;
+    }
+    uint32_t seed = 7;
+    for (size_t i = 0; i < vertexCount; ++i) order[i] = (uint32_t)i;
+    for (size_t i = vertexCount; i > 1; --i) {
+        size_t j = nextRandom(&seed) % i;
+        uint32_t swap = order[i - 1];
+        order[i - 1] = order[j];
+        order[j] = swap;
+    }
+    // order[new] = old; the elements need old -> new
+    for (size_t i = 0; i < vertexCount; ++i) {
+        memcpy(&shuffled[i * FLOATS_PER_VERTEX], &mesh->unique_vertices[order[i] * FLOATS_PER_VERTEX],
+               FLOATS_PER_VERTEX * sizeof(float));
+    }
+    uint32_t* newIndex = (uint32_t*)mesh->unique_vertices;
+    for (size_t i = 0; i < vertexCount; ++i) newIndex[order[i]] = (uint32_t)i;
+    for (size_t i = 0; i < mesh->element_count; ++i) mesh->elements[i] = newIndex[mesh->elements[i]];
+    free(mesh->unique_vertices);
+    mesh->unique_vertices = shuffled;
+    free(order);
+    return 0;
+}
+
+static int benchMesh(void) {
+    char path[256];
+    ObjMesh mesh;
+    Test_ScratchPath("bench_block.obj", path, sizeof(path));
+    if (!Test_WriteGridOBJ(path, BENCH_BLOCK_GRID_SIZE, BENCH_BLOCK_GRID_SIZE, 0)) return 1;
+    int failed = LoadOBJ(path, &mesh);
+    remove(path);
+    if (failed) {
+        printf("[Bench] Cannot load %s\n", path);
+        return 1;
+    }
+    ComputeTangents(&mesh);
+    failed = BuildIndexedMesh(&mesh) ||
+             MeshOptimizer_OptimizeMesh(&mesh, MESH_OPTIMIZE_VERTEX_CACHE | MESH_OPTIMIZE_OVERDRAW |
+                                               MESH_OPTIMIZE_VERTEX_FETCH, "grid");
+    if (!failed) {
+        failed = benchMeshPayloads("grid", &mesh);
+        failed |= shuffleMesh(&mesh) || benchMeshPayloads("shuffled grid", &mesh);
+    }
+    freeMesh(&mesh);
+    return failed;
+}
+
+typedef enum {
+    TEXTURE_ALBEDO,         // smooth color gradients with grain
+    TEXTURE_AO,             // soft blobs
+    TEXTURE_ROUGHNESS,      // flat regions
+    TEXTURE_FLAT_NORMAL,    // (0, 0, 1) everywhere
+    TEXTURE_BUMPY_NORMAL,   // noisy bumps
+    TEXTURE_TYPE_COUNT
+} TextureType;
+
+static const char* textureNames[TEXTURE_TYPE_COUNT] = {"albedo", "AO", "roughness", "flat normal", "bumpy normal"};
+static const TextureKind textureKinds[TEXTURE_TYPE_COUNT] = {TEXTURE_KIND_COLOR, TEXTURE_KIND_DATA, TEXTURE_KIND_DATA,
+                                                             TEXTURE_KIND_NORMAL, TEXTURE_KIND_NORMAL};
+static const uint32_t textureChannels[TEXTURE_TYPE_COUNT] = {3, 1, 1, 3, 3};
+
+static uint8_t toByte(float value) {
+    value = value < 0.0f ? 0.0f : (value > 1.0f ? 1.0f : value);
+    return (uint8_t)(value * 255.0f + 0.5f);
+}
+
+static void fillTexture(TextureType type, uint8_t* pixels, uint32_t size) {
+    uint32_t seed = 11 + (uint32_t)type;
+    uint32_t channels = textureChannels[type];
+    for (uint32_t y = 0; y < size; ++y) {
+        for (uint32_t x = 0; x < size; ++x) {
+            float u = (float)x / (float)size;
+            float v = (float)y / (float)size;
+            float grain = (float)(nextRandom(&seed) >> 24) / 255.0f - 0.5f;
+            uint8_t* pixel = &pixels[((size_t)y * size + x) * channels];
+            switch (type) {
+            case TEXTURE_ALBEDO:
+                pixel[0] = toByte(0.6f * u + 0.2f + 0.04f * grain);
+                pixel[1] = toByte(0.4f + 0.3f * v + 0.04f * grain);
+                pixel[2] = toByte(0.3f + 0.2f * u * v + 0.04f * grain);
+                break;
+            case TEXTURE_AO:
+                pixel[0] = toByte(0.75f + 0.25f * sinf(u * 25.0f) * cosf(v * 19.0f));
+                break;
+            case TEXTURE_ROUGHNESS:
+                pixel[0] = (uint8_t)(((x / 128) + (y / 128)) % 3 * 80 + 40);
+                break;
+            case TEXTURE_FLAT_NORMAL:
+                pixel[0] = 128;
+                pixel[1] = 128;
+                pixel[2] = 255;
+                break;
+            default: {
+                float nx = 0.3f * sinf(u * 60.0f) + 0.1f * grain;
+                float ny = 0.3f * cosf(v * 45.0f) + 0.1f * grain;
+                float nz = sqrtf(1.0f - nx * nx - ny * ny);
+                pixel[0] = toByte(nx * 0.5f + 0.5f);
+                pixel[1] = toByte(ny * 0.5f + 0.5f);
+                pixel[2] = toByte(nz * 0.5f + 0.5f);
+                break;
+            }
+            }
+        }
+    }
+}
+
+// Each texture as 8-bit pixels and as the level the cooker stores
+static int benchTextures(void) {
+    uint32_t size = BENCH_BLOCK_TEXTURE_SIZE;
+    uint8_t* pixels = malloc((size_t)size * size * 3);
+    uint8_t* encoded = malloc((size_t)size * size * 3);
+    if (!pixels || !encoded) {
+        printf("[Bench] Out of memory for %ux%u textures\n", size, size);
+        free(pixels);
+        free(encoded);
+        return 1;
+    }
+    int failed = 0;
+    char name[64];
+    for (int type = 0; type < TEXTURE_TYPE_COUNT; ++type) {
+        uint32_t channels = textureChannels[type];
+        fillTexture((TextureType)type, pixels, size);
+        snprintf(name, sizeof(name), "%s %u-channel", textureNames[type], channels);
+        failed |= benchPayload(name, pixels, (size_t)size * size * channels);
+
+        TextureFormat format = TextureCompressor_ChooseFormat(textureKinds[type], channels, pixels, size, size);
+        if (format == TEXTURE_FORMAT_RAW) continue;
+        TextureCompressor_EncodeLevel(format, pixels, size, size, channels, encoded, 1, NULL);
+        snprintf(name, sizeof(name), "%s %s", textureNames[type], formatNames[format]);
+        failed |= benchPayload(name, encoded, (size_t)TextureCache_GetLevelSize(format, channels, size, size));
+    }
+    free(pixels);
+    free(encoded);
+    return failed;
+}
+
+static int benchFile(const char* path) {
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        printf("[Bench] Cannot open %s\n", path);
+        return 1;
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    uint8_t* data = size > 0 ? malloc((size_t)size) : NULL;
+    int failed = !data || fread(data, 1, (size_t)size, file) != (size_t)size;
+    fclose(file);
+    if (failed) {
+        printf("[Bench] Cannot read %s\n", path);
+        free(data);
+        return 1;
+    }
+    const char* name = strrchr(path, '/');
+    failed = benchPayload(name ? name + 1 : path, data, (size_t)size);
+    free(data);
+    return failed;
+}
+
+int Bench_BlockCodec(int argc, char** argv) {
+    printf("[Bench] BlockCodec, one thread, best of %d decodes\n", BENCH_BLOCK_RUNS);
+    if (argc > 0) {
+        int failed = 0;
+        for (int i = 0; i < argc; ++i) failed |= benchFile(argv[i]);
+        return failed;
+    }
+    return benchMesh() | benchTextures();
+}
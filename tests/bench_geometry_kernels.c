@@ -0,0 +1,119 @@
+#include "test.h"
+#include "geometry_kernels.h"
+#include "vertex_format.h"
+#include "time_utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BENCH_KERNEL_RUNS 5
+
+// One soup that stays in the caches and one that does not
+static const size_t defaultTriangleCounts[] = {100000, 1000000};
+
+typedef enum { KERNEL_FACE_NORMALS, KERNEL_TANGENTS, KERNEL_NORMALIZE, KERNEL_COUNT } KernelKind;
+
+static const char* kernelNames[KERNEL_COUNT] = {"faceNormals", "tangents", "normalize"};
+
+// Random soup with positions, normals and UVs in [-1, 1]; the same seed for every level
+static void fillSoup(float* vertices, size_t triangleCount) {
+    unsigned state = 12345u;
+    size_t floatCount = triangleCount * 3 * FLOATS_PER_VERTEX;
+    for (size_t i = 0; i < floatCount; ++i) {
+        state = state * 1664525u + 1013904223u;
+        vertices[i] = (float)(state >> 8) * (2.0f / 16777216.0f) - 1.0f;
+    }
+}
+
+// One run of a kernel over a fresh copy of the soup in work; returns seconds. work and normals
+// keep what the kernel wrote so the levels can be compared.
+static double runKernel(const GeometryKernels* kernels, KernelKind kind, const float* soup, float* work,
+                        float* normals, size_t triangleCount) {
+    size_t cornerCount = triangleCount * 3;
+    memcpy(work, soup, cornerCount * FLOATS_PER_VERTEX * sizeof(float));
+    double startTime = GetTimeSeconds();
+    switch (kind) {
+    case KERNEL_FACE_NORMALS: kernels->faceNormals(work, triangleCount, normals); break;
+    case KERNEL_TANGENTS: kernels->tangents(work, triangleCount); break;
+    default: kernels->normalize(&work[3], cornerCount, FLOATS_PER_VERTEX); break;
+    }
+    return GetTimeSeconds() - startTime;
+}
+
+// Throughput is in soup triangles for all three; normalize does the three corner normals.
+static int benchKernels(size_t triangleCount) {
+    size_t floatCount = triangleCount * 3 * FLOATS_PER_VERTEX;
+    float* soup = malloc(floatCount * sizeof(float));
+    float* work = malloc(floatCount * sizeof(float));
+    float* reference = malloc(floatCount * sizeof(float));
+    float* normals = malloc(triangleCount * 3 * sizeof(float));
+    float* referenceNormals = malloc(triangleCount * 3 * sizeof(float));
+    if (!soup || !work || !reference || !normals || !referenceNormals) {
+        printf("[Bench] Out of memory for %zu triangles\n", triangleCount);
+        free(soup); free(work); free(reference); free(normals); free(referenceNormals);
+        return 1;
+    }
+    fillSoup(soup, triangleCount);
+
+    printf("[Bench] geometry kernels, %zu triangles, best of %d runs\n", triangleCount, BENCH_KERNEL_RUNS);
+    int failed = 0;
+    for (int kind = 0; kind < KERNEL_COUNT; ++kind) {
+        double scalarSeconds = 0.0;
+        for (int level = GEOMETRY_KERNELS_SCALAR; level <= GEOMETRY_KERNELS_AVX2; ++level) {
+            const GeometryKernels* kernels = GeometryKernels_GetLevel((GeometryKernelLevel)level);
+            if (!kernels) {
+                printf("  %-12s %-7s not supported on this CPU\n", kernelNames[kind], level == 1 ? "SSE2" : "AVX2");
+                continue;
+            }
+            double best = 1e30;
+            for (int run = 0; run < BENCH_KERNEL_RUNS; ++run) {
+                double seconds = runKernel(kernels, (KernelKind)kind, soup, work, normals, triangleCount);
+                if (seconds < best) best = seconds;
+            }
+
+            // Every level does the same float operations, so the results must match bit for bit
+            int same = 1;
+            if (level == GEOMETRY_KERNELS_SCALAR) {
+                scalarSeconds = best;
+                memcpy(reference, work, floatCount * sizeof(float));
+                memcpy(referenceNormals, normals, triangleCount * 3 * sizeof(float));
+            } else if (kind == KERNEL_FACE_NORMALS) {
+                same = memcmp(normals, referenceNormals, triangleCount * 3 * sizeof(float)) == 0;
+            } else {
+                same = memcmp(work, reference, floatCount * sizeof(float)) == 0;
+            }
+            failed |= !same;
+
+            printf("  %-12s %-7s %8.2f ms %8.1f M triangles/s  %5.2fx%s\n", kernelNames[kind], kernels->name,
+                   best * 1000.0, (double)triangleCount / best / 1e6, scalarSeconds / best,
+                   same ? "" : "  DIFFERS from scalar");
+        }
+    }
+
+    free(soup);
+    free(work);
+    free(reference);
+    free(normals);
+    free(referenceNormals);
+    return failed;
+}
+
+int Bench_GeometryKernels(int argc, char** argv) {
+    if (argc > 0) {
+        int failed = 0;
+        for (int i = 0; i < argc; ++i) {
+            long long triangles = atoll(argv[i]);
+            if (triangles <= 0) {
+                printf("[Bench] Bad triangle count %s\n", argv[i]);
+                return 1;
+            }
+            failed |= benchKernels((size_t)triangles);
+        }
+        return failed;
+    }
+    int failed = 0;
+    for (size_t i = 0; i < sizeof(defaultTriangleCounts) / sizeof(defaultTriangleCounts[0]); ++i) {
+        failed |= benchKernels(defaultTriangleCounts[i]);
+    }
+    return failed;
+}
@@ -0,0 +1,45 @@
+// Benchmarks for the loading pipeline. Numbers go to stdout; nothing is checked.
+//
+//   bench [name [args...]]
+//
+// Without a name every benchmark runs with its default inputs. Scratch files go to
+// TEST_SCRATCH_DIRECTORY.
+
+#include "test.h"
+#include <stdio.h>
+#include <string.h>
+
+typedef struct {
+    const char* name;
+    int (*run)(int argc, char** argv);
+    const char* usage;
+} Benchmark;
+
+static const Benchmark benchmarks[] = {
+    {"obj", Bench_ObjLoader, "obj [file.obj ...]   MB/s of the old fgets/sscanf loader, LoadOBJ and LoadOBJThreaded"},
+    {"stream", Bench_ObjStreaming, "stream [file.obj ...]   LoadOBJStreaming peak scratch memory against LoadOBJ"},
+    {"cache", Bench_VertexCache, "cache [file.obj ...]   ACMR/ATVR before and after the vertex cache and overdraw passes"},
+    {"smooth", Bench_SmoothNormals, "smooth [corners ...]   ComputeSmoothNormals and 2-8 threads on UV spheres and cones"},
+    {"kernels", Bench_GeometryKernels, "kernels [triangles ...]   scalar, SSE2 and AVX2 face normal, tangent and normalize kernels"},
+    {"meshcodec", Bench_MeshCodec, "meshcodec [file.obj ...]   MeshCodec ratio against LZ4 and decode GB/s, scalar and SSE2"},
+    {"lz4", Bench_BlockCodec, "lz4 [file ...]   BlockCodec ratio and decode GB/s on mesh and texture payloads"},
+};
+
+#define BENCHMARK_COUNT ((int)(sizeof(benchmarks) / sizeof(benchmarks[0])))
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        int failed = 0;
+        for (int i = 0; i < BENCHMARK_COUNT; ++i) {
+            printf("[Bench] %s\n", benchmarks[i].name);
+            failed |= benchmarks[i].run(0, NULL);
+        }
+        return failed;
+    }
+    for (int i = 0; i < BENCHMARK_COUNT; ++i) {
+        if (strcmp(argv[1], benchmarks[i].name) == 0) return benchmarks[i].run(argc - 2, argv + 2);
+    }
+    printf("Usage: bench [name [args...]]\n");
+    for (int i = 0; i < BENCHMARK_COUNT; ++i) printf("  %s\n", benchmarks[i].usage);
+    return 1;
+}
@@ -0,0 +1,178 @@
+#include "test.h"
+#include "OBJ_file_loader.h"
+#include "mesh_codec.h"
+#include "mesh_optimizer.h"
+#include "block_codec.h"
+#include "vertex_format.h"
+#include "time_utils.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BENCH_CODEC_RUNS 5
+#define BENCH_CODEC_GRID_SIZE 400
+
+static const VertexLayoutId layouts[] = {VERTEX_LAYOUT_PACKED16, VERTEX_LAYOUT_PACKED20, VERTEX_LAYOUT_FLOAT32};
+#define LAYOUT_COUNT ((int)(sizeof(layouts) / sizeof(layouts[0])))
+
+static double megabytes(size_t bytes) {
+    return (double)bytes / (1024.0 * 1024.0);
+}
+
+// Size of data after BlockCodec alone, or 0 when it fails
+static size_t blockCodecSize(const void* data, size_t size) {
+    void* stream;
+    size_t streamSize;
+    if (BlockCodec_CompressStream(data, size, 1, &stream, &streamSize)) return 0;
+    free(stream);
+    return streamSize;
+}
+
+static double timeVertexDecode(const void* stream, size_t streamSize, void* vertices, size_t vertexCount,
+                               size_t stride, int simd) {
+    MeshCodec_SetSimd(simd);
+    double best = 1e30;
+    for (int run = 0; run < BENCH_CODEC_RUNS; ++run) {
+        double startTime = GetTimeSeconds();
+        int failed = MeshCodec_DecodeVertices(stream, streamSize, vertices, vertexCount, stride);
+        double seconds = GetTimeSeconds() - startTime;
+        if (failed) best = -1.0;
+        if (seconds < best) best = seconds;
+    }
+    MeshCodec_SetSimd(1);
+    return best;
+}
+
+static int benchVertices(const float* source, size_t vertexCount, VertexLayoutId id) {
+    const VertexLayout* layout = VertexFormat_GetLayout(id);
+    VertexQuantization quantization;
+    void* vertices = VertexFormat_Pack(source, vertexCount, id, &quantization, NULL);
+    size_t size = vertexCount * layout->stride;
+    size_t bound = MeshCodec_VertexBound(vertexCount, layout->stride);
+    void* stream = malloc(bound);
+    void* decoded = malloc(size);
+    if (!vertices || !stream || !decoded) {
+        printf("[Bench] Out of memory for %zu vertices\n", vertexCount);
+        free(vertices);
+        free(stream);
+        free(decoded);
+        return 1;
+    }
+
+    double startTime = GetTimeSeconds();
+    size_t streamSize = MeshCodec_EncodeVertices(vertices, vertexCount, layout->stride, stream, bound);
+    double encodeSeconds = GetTimeSeconds() - startTime;
+    double simdSeconds = timeVertexDecode(stream, streamSize, decoded, vertexCount, layout->stride, 1);
+    double scalarSeconds = timeVertexDecode(stream, streamSize, decoded, vertexCount, layout->stride, 0);
+    int same = streamSize > 0 && simdSeconds > 0.0 && scalarSeconds > 0.0 && memcmp(decoded, vertices, size) == 0;
+    size_t lz4Only = blockCodecSize(vertices, size);
+    size_t lz4After = blockCodecSize(stream, streamSize);
+
+    printf("  vertices %-9s %8.2f MB -> %7.2f MB %5.2fx, +LZ4 %5.2fx, LZ4 alone %5.2fx\n", layout->name,
+           megabytes(size), megabytes(streamSize), (double)size / (double)streamSize,
+           lz4After ? (double)size / (double)lz4After : 0.0, lz4Only ? (double)size / (double)lz4Only : 0.0);
+    printf("  %-18s encode %7.0f MB/s, decode scalar %5.2f GB/s, SSE2 %5.2f GB/s%s\n", "", megabytes(size) / encodeSeconds,
+           (double)size / scalarSeconds / 1e9, (double)size / simdSeconds / 1e9, same ? "" : "  ROUND TRIP FAILED");
+    free(vertices);
+    free(stream);
+    free(decoded);
+    return !same;
+}
+
+static int benchIndices(const uint32_t* indices, size_t indexCount, size_t vertexCount) {
+    int failed = 0;
+    for (uint32_t indexSize = 2; indexSize <= 4; indexSize += 2) {
+        if (indexSize == 2 && vertexCount > 0xffff) continue;
+        size_t size = indexCount * indexSize;
+        size_t bound = MeshCodec_IndexBound(indexCount);
+        uint8_t* narrow = malloc(size + 1);
+        uint8_t* stream = malloc(bound);
+        uint8_t* decoded = malloc(size + 1);
+        if (!narrow || !stream || !decoded) {
+            printf("[Bench] Out of memory for %zu indices\n", indexCount);
+            free(narrow);
+            free(stream);
+            free(decoded);
+            return 1;
+        }
+        for (size_t i = 0; i < indexCount; ++i) {
+            if (indexSize == 2) {
+                uint16_t value = (uint16_t)indices[i];
+                memcpy(narrow + i * 2, &value, sizeof(value));
+            } else {
+                memcpy(narrow + i * 4, &indices[i], sizeof(uint32_t));
+            }
+        }
+
+        size_t streamSize = MeshCodec_EncodeIndices(narrow, indexCount, indexSize, stream, bound);
+        double best = 1e30;
+        for (int run = 0; run < BENCH_CODEC_RUNS && streamSize > 0; ++run) {
+            double startTime = GetTimeSeconds();
+            if (MeshCodec_DecodeIndices(stream, streamSize, decoded, indexCount, indexSize)) streamSize = 0;
+            double seconds = GetTimeSeconds() - startTime;
+            if (seconds < best) best = seconds;
+        }
+        if (streamSize == 0) {
+            printf("[Bench] Index round trip failed\n");
+            failed = 1;
+        } else {
+            size_t lz4Only = blockCodecSize(narrow, size);
+            size_t lz4After = blockCodecSize(stream, streamSize);
+            printf("  indices  %2u-bit    %8.2f MB -> %7.2f MB %5.2fx, +LZ4 %5.2fx, LZ4 alone %5.2fx\n",
+                   indexSize * 8, megabytes(size), megabytes(streamSize), (double)size / (double)streamSize,
+                   lz4After ? (double)size / (double)lz4After : 0.0, lz4Only ? (double)size / (double)lz4Only : 0.0);
+            printf("  %-18s %.2f bytes per triangle, decode %5.2f GB/s, %.0f M triangles/s\n", "",
+                   (double)streamSize / (double)(indexCount / 3), (double)size / best / 1e9,
+                   (double)(indexCount / 3) / best / 1e6);
+        }
+        free(narrow);
+        free(stream);
+        free(decoded);
+    }
+    return failed;
+}
+
+// The mesh as the cooker writes it: indexed, optimized for the vertex cache, overdraw and
+// fetch order, then packed
+static int benchFile(const char* path) {
+    ObjMesh mesh;
+    if (LoadOBJ(path, &mesh)) {
+        printf("[Bench] Cannot load %s\n", path);
+        return 1;
+    }
+    ComputeTangents(&mesh);
+    int failed = BuildIndexedMesh(&mesh) ||
+                 MeshOptimizer_OptimizeMesh(&mesh, MESH_OPTIMIZE_VERTEX_CACHE | MESH_OPTIMIZE_OVERDRAW |
+                                                   MESH_OPTIMIZE_VERTEX_FETCH, path);
+    if (failed) {
+        printf("[Bench] Cannot index %s\n", path);
+        freeMesh(&mesh);
+        return 1;
+    }
+    printf("[Bench] %s: %zu vertices, %zu triangles, best of %d decodes\n", path, mesh.unique_vertex_count,
+           mesh.element_count / 3, BENCH_CODEC_RUNS);
+    for (int i = 0; i < LAYOUT_COUNT; ++i) failed |= benchVertices(mesh.unique_vertices, mesh.unique_vertex_count, layouts[i]);
+    failed |= benchIndices(mesh.elements, mesh.element_count, mesh.unique_vertex_count);
+    freeMesh(&mesh);
+    return failed;
+}
+
+int Bench_MeshCodec(int argc, char** argv) {
+    if (argc > 0) {
+        int failed = 0;
+        for (int i = 0; i < argc; ++i) failed |= benchFile(argv[i]);
+        return failed;
+    }
+    // A grid above and below the 16-bit index limit
+    const int sizes[2] = {BENCH_CODEC_GRID_SIZE, 200};
+    int failed = 0;
+    for (int i = 0; i < 2 && !failed; ++i) {
+        char path[256];
+        Test_ScratchPath("bench_codec.obj", path, sizeof(path));
+        if (!Test_WriteGridOBJ(path, sizes[i], sizes[i], 0)) return 1;
+        failed = benchFile(path);
+        remove(path);
+    }
+    return failed;
+}
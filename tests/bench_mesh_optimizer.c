@@ -0,0 +1,128 @@
+#include "test.h"
+#include "OBJ_file_loader.h"
+#include "mesh_optimizer.h"
+#include "time_utils.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BENCH_CACHE_GRID_SIZE 400
+
+static const int fifoSizes[] = {8, 16, 32};
+#define FIFO_SIZE_COUNT ((int)(sizeof(fifoSizes) / sizeof(fifoSizes[0])))
+
+static void printOrder(const char* order, const uint32_t* indices, size_t indexCount, size_t vertexCount,
+                       double seconds) {
+    printf("  %-22s", order);
+    for (int i = 0; i < FIFO_SIZE_COUNT; ++i) {
+        VertexCacheStats stats = MeshOptimizer_AnalyzeVertexCache(indices, indexCount, vertexCount, fifoSizes[i]);
+        printf("  %6.3f", stats.acmr);
+    }
+    VertexCacheStats stats = MeshOptimizer_AnalyzeVertexCache(indices, indexCount, vertexCount,
+                                                              MESH_OPTIMIZER_FIFO_SIZE);
+    printf("  %6.3f", stats.atvr);
+    if (seconds >= 0.0) printf("  %8.1f ms", seconds * 1000.0);
+    printf("\n");
+}
+
+// ACMR at every FIFO size and ATVR of the input order and after each pass the cooker runs.
+// The mesh is optimized as one range; the cooker does the same per submesh.
+static int sweepMesh(const char* name, const uint32_t* indices, size_t indexCount, const float* vertices,
+                     size_t vertexCount) {
+    uint32_t* optimized = malloc(indexCount * sizeof(uint32_t));
+    if (!optimized) return 2;
+
+    printf("[Bench] %s: %zu triangles, %zu vertices\n", name, indexCount / 3, vertexCount);
+    printf("  %-22s", "ACMR at FIFO");
+    for (int i = 0; i < FIFO_SIZE_COUNT; ++i) printf("  %6d", fifoSizes[i]);
+    printf("  %6s\n", "ATVR");
+    printOrder("input order", indices, indexCount, vertexCount, -1.0);
+
+    double startTime = GetTimeSeconds();
+    int result = MeshOptimizer_OptimizeVertexCache(optimized, indices, indexCount, vertexCount);
+    double cacheSeconds = GetTimeSeconds() - startTime;
+    if (result == 0) {
+        printOrder("vertex cache", optimized, indexCount, vertexCount, cacheSeconds);
+        startTime = GetTimeSeconds();
+        result = MeshOptimizer_OptimizeOverdraw(optimized, optimized, indexCount, vertices, vertexCount,
+                                                FLOATS_PER_VERTEX, MESH_OPTIMIZER_OVERDRAW_THRESHOLD);
+        if (result == 0) printOrder("+ overdraw", optimized, indexCount, vertexCount, GetTimeSeconds() - startTime);
+    }
+    if (result) printf("[Bench] Optimizing %s failed (%d)\n", name, result);
+    free(optimized);
+    return result;
+}
+
+static uint32_t nextRandom(uint32_t* state) {
+    *state = *state * 1664525u + 1013904223u;
+    return *state;
+}
+
+// A size x size quad grid as two triangles per cell, row by row like an exporter writes it,
+// and the same triangles in random order.
+static int sweepGrids(int size) {
+    size_t vertexCount = (size_t)(size + 1) * (size + 1);
+    size_t indexCount = (size_t)size * size * 6;
+    float* vertices = calloc(vertexCount * FLOATS_PER_VERTEX, sizeof(float));
+    uint32_t* indices = malloc(indexCount * sizeof(uint32_t));
+    if (!vertices || !indices) {
+        free(vertices);
+        free(indices);
+        return 2;
+    }
+    for (int r = 0; r <= size; ++r) {
+        for (int c = 0; c <= size; ++c) {
+            float* v = &vertices[((size_t)r * (size + 1) + c) * FLOATS_PER_VERTEX];
+            v[0] = (float)c;
+            v[2] = (float)-r;
+            v[4] = 1.0f;
+        }
+    }
+    uint32_t* out = indices;
+    for (int r = 0; r < size; ++r) {
+        for (int c = 0; c < size; ++c) {
+            uint32_t a = (uint32_t)(r * (size + 1) + c), b = a + (uint32_t)(size + 1);
+            *out++ = a; *out++ = b; *out++ = b + 1;
+            *out++ = a; *out++ = b + 1; *out++ = a + 1;
+        }
+    }
+
+    int result = sweepMesh("grid, file order", indices, indexCount, vertices, vertexCount);
+    if (result == 0) {
+        uint32_t seed = 7;
+        for (size_t t = indexCount / 3; t > 1; --t) {
+            size_t other = nextRandom(&seed) % t;
+            for (int k = 0; k < 3; ++k) {
+                uint32_t swap = indices[(t - 1) * 3 + k];
+                indices[(t - 1) * 3 + k] = indices[other * 3 + k];
+                indices[other * 3 + k] = swap;
+            }
+        }
+        result = sweepMesh("grid, shuffled", indices, indexCount, vertices, vertexCount);
+    }
+    free(vertices);
+    free(indices);
+    return result;
+}
+
+static int sweepFile(const char* path) {
+    ObjMesh mesh;
+    if (LoadOBJ(path, &mesh)) {
+        printf("[Bench] Cannot load %s\n", path);
+        return 1;
+    }
+    int result = BuildIndexedMesh(&mesh);
+    if (result == 0) {
+        result = sweepMesh(path, mesh.elements, mesh.element_count, mesh.unique_vertices, mesh.unique_vertex_count);
+    }
+    freeMesh(&mesh);
+    return result;
+}
+
+int Bench_VertexCache(int argc, char** argv) {
+    if (argc == 0) return sweepGrids(BENCH_CACHE_GRID_SIZE);
+    int failed = 0;
+    for (int i = 0; i < argc; ++i) failed |= sweepFile(argv[i]);
+    return failed;
+}
@@ -0,0 +1,256 @@
+#include "test.h"
+#include "OBJ_file_loader.h"
+#include "thread_utils.h"
+#include "time_utils.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#define BENCH_RUNS 3
+#define BENCH_GRID_SIZE 400
+
+// The loader LoadOBJ replaced, kept as the baseline: 512-byte fgets lines, sscanf, a realloc
+// per v/vt/vn record and per corner, three mallocs per face. Only its debug output is gone.
+typedef struct {
+    float* vertices;
+    size_t vertex_count;
+    float* texcoords;
+    size_t texcoord_count;
+    float* normals;
+    size_t normal_count;
+    float* triangle_vertices;
+    size_t triangle_vertex_count;
+} LegacyMesh;
+
+static void legacyFree(LegacyMesh* mesh) {
+    free(mesh->vertices);
+    free(mesh->texcoords);
+    free(mesh->normals);
+    free(mesh->triangle_vertices);
+    memset(mesh, 0, sizeof(*mesh));
+}
+
+static void legacyParseFaceVertex(const char* token, int* vi, int* vti, int* vni) {
+    *vi = -1; *vti = -1; *vni = -1;
+    char buf[64];
+    strncpy(buf, token, sizeof(buf) - 1);
+    buf[sizeof(buf) - 1] = 0;
+
+    char* slash1 = strchr(buf, '/');
+    if (!slash1) {
+        *vi = atoi(buf) - 1;
+        return;
+    }
+    *slash1 = 0;
+    *vi = atoi(buf) - 1;
+    char* slash2 = strchr(slash1 + 1, '/');
+    if (!slash2) {
+        *vti = atoi(slash1 + 1) - 1;
+        return;
+    }
+    *slash2 = 0;
+    if (slash1 + 1 != slash2) *vti = atoi(slash1 + 1) - 1;
+    *vni = atoi(slash2 + 1) - 1;
+}
+
+static int legacyPushFloats(float** array, size_t* count, const float* values, size_t n) {
+    float* grown = realloc(*array, (*count + n) * sizeof(float));
+    if (!grown) return 2;
+    *array = grown;
+    memcpy(*array + *count, values, n * sizeof(float));
+    *count += n;
+    return 0;
+}
+
+static int legacyAddTriangle(LegacyMesh* mesh, const int* vis, const int* vnis, const int* vtis) {
+    for (int i = 0; i < 3; ++i) {
+        int vi = vis[i], vni = vnis[i], vti = vtis[i];
+        if (vi < 0 || (size_t)vi * 3 + 2 >= mesh->vertex_count) continue;
+        float corner[FLOATS_PER_VERTEX] = {0};
+        memcpy(corner, &mesh->vertices[vi * 3], 3 * sizeof(float));
+        if (vni >= 0 && (size_t)vni * 3 + 2 < mesh->normal_count) memcpy(corner + 3, &mesh->normals[vni * 3], 3 * sizeof(float));
+        corner[6] = corner[7] = 1.0f;
+        if (vti >= 0 && (size_t)vti * 2 + 1 < mesh->texcoord_count) memcpy(corner + 6, &mesh->texcoords[vti * 2], 2 * sizeof(float));
+        if (legacyPushFloats(&mesh->triangle_vertices, &mesh->triangle_vertex_count, corner, FLOATS_PER_VERTEX)) return 2;
+    }
+    return 0;
+}
+
+static int legacyLoadOBJ(const char* filename, LegacyMesh* mesh) {
+    memset(mesh, 0, sizeof(*mesh));
+    FILE* file = fopen(filename, "r");
+    if (!file) return 1;
+
+    char line[512];
+    int result = 0;
+    while (result == 0 && fgets(line, sizeof(line), file)) {
+        float xyz[3] = {0.0f, 0.0f, 0.0f};
+        if (line[0] == 'v' && line[1] == ' ') {
+            if (sscanf(line + 2, "%f %f %f", &xyz[0], &xyz[1], &xyz[2]) == 3) {
+                result = legacyPushFloats(&mesh->vertices, &mesh->vertex_count, xyz, 3);
+            }
+        } else if (strncmp(line, "vt ", 3) == 0) {
+            if (sscanf(line + 3, "%f %f", &xyz[0], &xyz[1]) >= 1) {
+                xyz[1] = 1.0f - xyz[1];
+                result = legacyPushFloats(&mesh->texcoords, &mesh->texcoord_count, xyz, 2);
+            }
+        } else if (strncmp(line, "vn ", 3) == 0) {
+            if (sscanf(line + 3, "%f %f %f", &xyz[0], &xyz[1], &xyz[2]) == 3) {
+                result = legacyPushFloats(&mesh->normals, &mesh->normal_count, xyz, 3);
+            }
+        } else if (line[0] == 'f' && line[1] == ' ') {
+            int maxFaceVerts = 64;
+            int* vis = malloc(maxFaceVerts * sizeof(int));
+            int* vnis = malloc(maxFaceVerts * sizeof(int));
+            int* vtis = malloc(maxFaceVerts * sizeof(int));
+            int count = 0;
+            char* token = strtok(line + 2, " \t\r\n");
+            while (token && count < maxFaceVerts) {
+                legacyParseFaceVertex(token, &vis[count], &vtis[count], &vnis[count]);
+                count++;
+                token = strtok(NULL, " \t\r\n");
+            }
+            for (int i = 1; i + 1 < count && result == 0; i++) {
+                int tri[3] = {vis[0], vis[i], vis[i + 1]};
+                int triN[3] = {vnis[0], vnis[i], vnis[i + 1]};
+                int triT[3] = {vtis[0], vtis[i], vtis[i + 1]};
+                result = legacyAddTriangle(mesh, tri, triN, triT);
+            }
+            free(vis);
+            free(vnis);
+            free(vtis);
+        }
+    }
+    fclose(file);
+    if (result) legacyFree(mesh);
+    return result;
+}
+
+static double megabytes(size_t bytes) {
+    return (double)bytes / (1024.0 * 1024.0);
+}
+
+// Best of BENCH_RUNS; the first run also warms the page cache for the others.
+static double timeLegacy(const char* path, LegacyMesh* mesh) {
+    double best = 1e30;
+    for (int run = 0; run < BENCH_RUNS; ++run) {
+        double startTime = GetTimeSeconds();
+        if (legacyLoadOBJ(path, mesh)) return -1.0;
+        double seconds = GetTimeSeconds() - startTime;
+        if (seconds < best) best = seconds;
+        if (run + 1 < BENCH_RUNS) legacyFree(mesh);
+    }
+    return best;
+}
+
+static double timeLoader(const char* path, int threadCount, ObjMesh* mesh) {
+    double best = 1e30;
+    for (int run = 0; run < BENCH_RUNS; ++run) {
+        double startTime = GetTimeSeconds();
+        if (LoadOBJThreaded(path, mesh, threadCount)) return -1.0;
+        double seconds = GetTimeSeconds() - startTime;
+        if (seconds < best) best = seconds;
+        if (run + 1 < BENCH_RUNS) freeMesh(mesh);
+    }
+    return best;
+}
+
+static int benchFile(const char* path) {
+    struct stat st;
+    if (stat(path, &st) != 0) {
+        printf("[Bench] Cannot open %s\n", path);
+        return 1;
+    }
+    size_t size = (size_t)st.st_size;
+
+    LegacyMesh legacy;
+    ObjMesh serial, threaded;
+    int threadCount = GetHardwareThreadCount();
+    double legacySeconds = timeLegacy(path, &legacy);
+    double serialSeconds = timeLoader(path, 1, &serial);
+    double threadedSeconds = timeLoader(path, threadCount, &threaded);
+    if (legacySeconds < 0.0 || serialSeconds < 0.0 || threadedSeconds < 0.0) {
+        printf("[Bench] Failed to load %s\n", path);
+        return 1;
+    }
+
+    // Same soup, up to the last bit of a float parse
+    float worst = 0.0f;
+    int sameCount = legacy.triangle_vertex_count == serial.triangle_vertex_count;
+    for (size_t i = 0; sameCount && i < serial.triangle_vertex_count; ++i) {
+        float difference = fabsf(legacy.triangle_vertices[i] - serial.triangle_vertices[i]);
+        if (difference > worst) worst = difference;
+    }
+
+    printf("[Bench] %s: %.2f MB, %zu triangles\n", path, megabytes(size), serial.triangle_vertex_count / FLOATS_PER_VERTEX / 3);
+    printf("  fgets/sscanf  %8.1f ms %8.1f MB/s\n", legacySeconds * 1000.0, megabytes(size) / legacySeconds);
+    printf("  LoadOBJ       %8.1f ms %8.1f MB/s  %5.1fx\n", serialSeconds * 1000.0, megabytes(size) / serialSeconds,
+           legacySeconds / serialSeconds);
+    printf("  %2d threads    %8.1f ms %8.1f MB/s  %5.1fx\n", threadCount, threadedSeconds * 1000.0,
+           megabytes(size) / threadedSeconds, legacySeconds / threadedSeconds);
+    if (sameCount) printf("  soups match, largest float difference %g\n", worst);
+    else printf("  soups differ: %zu vs %zu floats\n", legacy.triangle_vertex_count, serial.triangle_vertex_count);
+
+    legacyFree(&legacy);
+    freeMesh(&serial);
+    freeMesh(&threaded);
+    return 0;
+}
+
+int Bench_ObjLoader(int argc, char** argv) {
+    if (argc > 0) {
+        int failed = 0;
+        for (int i = 0; i < argc; ++i) failed |= benchFile(argv[i]);
+        return failed;
+    }
+    char path[256];
+    Test_ScratchPath("bench_grid.obj", path, sizeof(path));
+    if (!Test_WriteGridOBJ(path, BENCH_GRID_SIZE, BENCH_GRID_SIZE, 0)) return 1;
+    int failed = benchFile(path);
+    remove(path);
+    return failed;
+}
+
+#define BENCH_STREAM_GRID_SIZE 700
+#define BENCH_STREAM_CHUNK_VERTICES 65536
+
+static int countStreamed(const ObjStreamChunk* chunk, void* user) {
+    *(size_t*)user += chunk->index_count / 3;
+    return 0;
+}
+
+// LoadOBJStreaming prints its own peak scratch against what LoadOBJ would hold
+static int benchStreaming(const char* path) {
+    ObjStreamStats stats;
+    size_t triangles = 0;
+    double startTime = GetTimeSeconds();
+    if (LoadOBJStreaming(path, BENCH_STREAM_CHUNK_VERTICES, countStreamed, &triangles, &stats)) {
+        printf("[Bench] Failed to stream %s\n", path);
+        return 1;
+    }
+    double seconds = GetTimeSeconds() - startTime;
+    printf("  %zu triangles in %zu chunks, %.1f ms, peak scratch %.1f MB of which %.1f MB v/vt/vn pools\n", triangles,
+           stats.chunks, seconds * 1000.0, megabytes(stats.peak_bytes), megabytes(stats.attribute_bytes));
+    return 0;
+}
+
+int Bench_ObjStreaming(int argc, char** argv) {
+    if (argc > 0) {
+        int failed = 0;
+        for (int i = 0; i < argc; ++i) failed |= benchStreaming(argv[i]);
+        return failed;
+    }
+    // The same vertices with one and four times the faces
+    int failed = 0;
+    const int flags[2] = {0, TEST_GRID_REPEAT_FACES};
+    for (int i = 0; i < 2 && !failed; ++i) {
+        char path[256];
+        Test_ScratchPath("bench_stream.obj", path, sizeof(path));
+        if (!Test_WriteGridOBJ(path, BENCH_STREAM_GRID_SIZE, BENCH_STREAM_GRID_SIZE, flags[i])) return 1;
+        failed = benchStreaming(path);
+        remove(path);
+    }
+    return failed;
+}
@@ -0,0 +1,136 @@
+#include "test.h"
+#include "OBJ_file_loader.h"
+#include "thread_utils.h"
+#include "time_utils.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BENCH_SPHERE_SEGMENTS 720
+#define BENCH_PI 3.14159265358979f
+
+static float* allocateCorners(size_t cornerCount) {
+    float* corners = calloc(cornerCount * FLOATS_PER_VERTEX, sizeof(float));
+    if (!corners) printf("[Bench] Out of memory for %zu corners\n", cornerCount);
+    return corners;
+}
+
+static float* writeCorner(float* out, float x, float y, float z) {
+    out[0] = x;
+    out[1] = y;
+    out[2] = z;
+    return out + FLOATS_PER_VERTEX;
+}
+
+static void spherePoint(int segment, int ring, int rings, float* p) {
+    float theta = (float)segment * (2.0f * BENCH_PI / BENCH_SPHERE_SEGMENTS);
+    float phi = (float)ring * (BENCH_PI / (float)rings);
+    p[0] = sinf(phi) * cosf(theta);
+    p[1] = cosf(phi);
+    p[2] = sinf(phi) * sinf(theta);
+}
+
+// UV sphere of BENCH_SPHERE_SEGMENTS segments with enough rings for about cornerCount
+// corners. Each pole is one position shared by BENCH_SPHERE_SEGMENTS corners.
+static float* buildSphere(size_t cornerCount, size_t* outCount) {
+    int rings = (int)(cornerCount / (6 * BENCH_SPHERE_SEGMENTS)) + 1;
+    if (rings < 3) rings = 3;
+    size_t count = (size_t)BENCH_SPHERE_SEGMENTS * ((size_t)(rings - 2) * 6 + 6);
+    float* corners = allocateCorners(count);
+    if (!corners) return NULL;
+    float* out = corners;
+    for (int r = 0; r < rings; ++r) {
+        for (int s = 0; s < BENCH_SPHERE_SEGMENTS; ++s) {
+            float a[3], b[3], c[3], d[3];
+            spherePoint(s, r, rings, a);
+            spherePoint(s + 1, r, rings, b);
+            spherePoint(s, r + 1, rings, c);
+            spherePoint(s + 1, r + 1, rings, d);
+            if (r > 0) {
+                out = writeCorner(out, a[0], a[1], a[2]);
+                out = writeCorner(out, b[0], b[1], b[2]);
+                out = writeCorner(out, d[0], d[1], d[2]);
+            }
+            if (r + 1 < rings) {
+                out = writeCorner(out, a[0], a[1], a[2]);
+                out = writeCorner(out, d[0], d[1], d[2]);
+                out = writeCorner(out, c[0], c[1], c[2]);
+            }
+        }
+    }
+    *outCount = count;
+    return corners;
+}
+
+// Cone whose apex is shared by every one of its segments: one position group of
+// `segments` corners, each with a different face normal.
+static float* buildCone(int segments, size_t* outCount) {
+    size_t count = (size_t)segments * 3;
+    float* corners = allocateCorners(count);
+    if (!corners) return NULL;
+    float* out = corners;
+    for (int s = 0; s < segments; ++s) {
+        float a = (float)s * (2.0f * BENCH_PI / (float)segments);
+        float b = (float)(s + 1) * (2.0f * BENCH_PI / (float)segments);
+        out = writeCorner(out, 0.0f, 1.0f, 0.0f);
+        out = writeCorner(out, cosf(b), 0.0f, sinf(b));
+        out = writeCorner(out, cosf(a), 0.0f, sinf(a));
+    }
+    *outCount = count;
+    return corners;
+}
+
+// 1 thread is the serial pass; more run the threaded steps. Speedup is against serial.
+static int benchMesh(const char* name, float* corners, size_t cornerCount) {
+    if (!corners) return 2;
+    float* copy = malloc(cornerCount * FLOATS_PER_VERTEX * sizeof(float));
+    if (!copy) {
+        free(corners);
+        return 2;
+    }
+    int hardwareThreads = GetHardwareThreadCount();
+    int threadCounts[5] = {1, 2, 4, 8, hardwareThreads};
+    int runs = hardwareThreads > 8 ? 5 : 4;
+    printf("[Bench] %s: %zu corners, %d hardware threads\n", name, cornerCount, hardwareThreads);
+    double serialSeconds = 0.0;
+    for (int i = 0; i < runs; ++i) {
+        ObjMesh mesh;
+        memset(&mesh, 0, sizeof(mesh));
+        memcpy(copy, corners, cornerCount * FLOATS_PER_VERTEX * sizeof(float));
+        mesh.triangle_vertices = copy;
+        mesh.triangle_vertex_count = cornerCount * FLOATS_PER_VERTEX;
+        double startTime = GetTimeSeconds();
+        ComputeSmoothNormalsThreaded(&mesh, threadCounts[i]);
+        double seconds = GetTimeSeconds() - startTime;
+        if (i == 0) serialSeconds = seconds;
+        printf("  %2d threads %9.1f ms %8.1f M corners/s %6.2fx\n", threadCounts[i], seconds * 1000.0,
+               (double)cornerCount / seconds / 1e6, serialSeconds / seconds);
+    }
+    free(copy);
+    free(corners);
+    return 0;
+}
+
+// bench smooth [corners ...]: UV spheres of about that many corners, then cones whose apex
+// groups hold 10K and 100K corners
+int Bench_SmoothNormals(int argc, char** argv) {
+    size_t defaults[] = {1000000, 4000000, 10000000};
+    int sizeCount = argc > 0 ? argc : (int)(sizeof(defaults) / sizeof(defaults[0]));
+    int failed = 0;
+    for (int i = 0; i < sizeCount && !failed; ++i) {
+        size_t target = argc > 0 ? (size_t)strtoull(argv[i], NULL, 10) : defaults[i];
+        size_t count = 0;
+        float* corners = buildSphere(target, &count);
+        char name[64];
+        snprintf(name, sizeof(name), "UV sphere, %d segments", BENCH_SPHERE_SEGMENTS);
+        failed = benchMesh(name, corners, count);
+    }
+    const int apexCorners[] = {10000, 100000};
+    for (int i = 0; i < 2 && !failed && argc == 0; ++i) {
+        size_t count = 0;
+        float* corners = buildCone(apexCorners[i], &count);
+        failed = benchMesh("cone", corners, count);
+    }
+    return failed;
+}
@@ -0,0 +1,58 @@
+#ifndef TEST_H
+#define TEST_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+// Support for the headless tests (make test) and benchmarks (make bench): a check macro that
+// counts failures, scratch file paths and synthetic input files. Both programs link the cook
+// tool's sources, so nothing here needs a GL context. Run them from the repository root.
+
+#define TEST_SCRATCH_DIRECTORY "build"
+
+extern int Test_Failures;
+
+#define TEST_CHECK(condition, ...)                              \
+    do {                                                        \
+        if (!(condition)) {                                     \
+            Test_Failures++;                                    \
+            printf("  FAILED %s:%d: ", __FILE__, __LINE__);     \
+            printf(__VA_ARGS__);                                \
+            printf("\n");                                       \
+        }                                                       \
+    } while (0)
+
+// "<TEST_SCRATCH_DIRECTORY>/test_<name>"
+void Test_ScratchPath(const char* name, char* out, size_t outSize);
+
+// Flags for Test_WriteGridOBJ
+#define TEST_GRID_QUADS 1         // one quad per cell instead of two triangles
+#define TEST_GRID_MATERIALS 2     // usemtl every 8 rows, cycling through three materials
+#define TEST_GRID_RELATIVE 4      // negative (relative) face indices
+#define TEST_GRID_REPEAT_FACES 8  // every face record written four times: more faces, same vertices
+
+// Writes a height field of (columns + 1) x (rows + 1) vertices with v, vt and vn records and
+// v/vt/vn faces, like a terrain export. Returns the file size in bytes, 0 on failure.
+size_t Test_WriteGridOBJ(const char* path, int columns, int rows, int flags);
+
+// Test suites, run by test_main.c
+void Test_ObjParser(void);
+void Test_ObjThreaded(void);
+void Test_ObjStreaming(void);
+void Test_IndexedTangents(void);
+void Test_SmoothGroups(void);
+void Test_SmoothThreads(void);
+void Test_MeshCodec(void);
+void Test_BlockCodec(void);
+
+// Benchmarks, run by bench_main.c; arguments are what follows the benchmark's name.
+// Return 0 on success.
+int Bench_ObjLoader(int argc, char** argv);
+int Bench_ObjStreaming(int argc, char** argv);
+int Bench_VertexCache(int argc, char** argv);
+int Bench_SmoothNormals(int argc, char** argv);
+int Bench_GeometryKernels(int argc, char** argv);
+int Bench_MeshCodec(int argc, char** argv);
+int Bench_BlockCodec(int argc, char** argv);
+
+#endif
@@ -0,0 +1,302 @@
+#include "test.h"
+#include "block_codec.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Bytes after every decode target that the decoder must leave alone
+#define BLOCK_CANARY_BYTES 64
+#define BLOCK_CANARY 0xA5
+// Streams up to this size are cut at every length and get every bit flipped; longer ones
+// at a spread of positions and at each of the last BLOCK_DAMAGE_TAIL bytes
+#define BLOCK_DAMAGE_ALL_BYTES 512
+#define BLOCK_DAMAGE_POSITIONS 97
+#define BLOCK_DAMAGE_TAIL 16
+// Matches closer than this overlap their own output in the 8- and 16-byte copies
+#define BLOCK_MAX_OVERLAP_OFFSET 17
+// The format's minimum match and the distance from the end within which no match starts
+#define BLOCK_MIN_MATCH 4
+#define BLOCK_MF_LIMIT 12
+
+static uint32_t nextRandom(uint32_t* state) {
+    *state = *state * 1664525u + 1013904223u;
+    return *state;
+}
+
+static size_t damagePositionCount(size_t streamSize) {
+    return streamSize <= BLOCK_DAMAGE_ALL_BYTES ? streamSize : BLOCK_DAMAGE_POSITIONS + BLOCK_DAMAGE_TAIL;
+}
+
+static size_t damagePosition(size_t p, size_t streamSize) {
+    if (streamSize <= BLOCK_DAMAGE_ALL_BYTES) return p;
+    if (p < BLOCK_DAMAGE_POSITIONS) return p * streamSize / BLOCK_DAMAGE_POSITIONS;
+    return streamSize - BLOCK_DAMAGE_TAIL + (p - BLOCK_DAMAGE_POSITIONS);
+}
+
+static int decodeBlock(const uint8_t* block, size_t blockSize, uint8_t* target, size_t size) {
+    memset(target, BLOCK_CANARY, size + BLOCK_CANARY_BYTES);
+    return BlockCodec_Decompress(block, blockSize, target, size);
+}
+
+static int canaryIntact(const uint8_t* target, size_t size) {
+    for (size_t i = 0; i < BLOCK_CANARY_BYTES; ++i) {
+        if (target[size + i] != BLOCK_CANARY) return 0;
+    }
+    return 1;
+}
+
+// A block must decode to exactly data; cut short, with a trailing byte, into a target one
+// byte too small or too large it must be rejected; with a flipped bit it may decode to
+// anything but must stay inside the target.
+static void checkBlock(const char* name, const uint8_t* block, size_t blockSize, const uint8_t* data, size_t size) {
+    uint8_t* target = malloc(size + 1 + BLOCK_CANARY_BYTES);
+    uint8_t* damaged = malloc(blockSize + 1);
+    if (!target || !damaged) {
+        TEST_CHECK(0, "out of memory");
+        free(target);
+        free(damaged);
+        return;
+    }
+    int result = decodeBlock(block, blockSize, target, size);
+    TEST_CHECK(result == 0 && memcmp(target, data, size) == 0 && canaryIntact(target, size),
+               "%s: block does not decode to its %zu bytes", name, size);
+    TEST_CHECK(size == 0 || decodeBlock(block, blockSize, target, size - 1) != 0,
+               "%s: decoded into a target one byte short", name);
+    TEST_CHECK(decodeBlock(block, blockSize, target, size + 1) != 0, "%s: decoded into a target one byte long",
+               name);
+
+    memcpy(damaged, block, blockSize);
+    int accepted = 0;
+    for (size_t p = 0; p < damagePositionCount(blockSize); ++p) {
+        accepted |= decodeBlock(damaged, damagePosition(p, blockSize), target, size) == 0;
+    }
+    TEST_CHECK(!accepted, "%s: a truncated block was accepted", name);
+    damaged[blockSize] = 0;
+    TEST_CHECK(decodeBlock(damaged, blockSize + 1, target, size) != 0, "%s: a block with a trailing byte was accepted",
+               name);
+
+    int overrun = 0;
+    for (size_t p = 0; p < damagePositionCount(blockSize); ++p) {
+        size_t position = damagePosition(p, blockSize);
+        for (int bit = 0; bit < 8; ++bit) {
+            damaged[position] ^= (uint8_t)(1u << bit);
+            decodeBlock(damaged, blockSize, target, size);
+            overrun |= !canaryIntact(target, size);
+            damaged[position] ^= (uint8_t)(1u << bit);
+        }
+    }
+    TEST_CHECK(!overrun, "%s: a damaged block was decoded past the target", name);
+    free(target);
+    free(damaged);
+}
+
+// Compresses data and checks the block; returns the compressed size, 0 on failure
+static size_t checkRoundTrip(const char* name, const uint8_t* data, size_t size) {
+    size_t bound = BlockCodec_Bound(size);
+    uint8_t* block = malloc(bound);
+    if (!block) {
+        TEST_CHECK(0, "out of memory");
+        return 0;
+    }
+    size_t blockSize = BlockCodec_Compress(data, size, block, bound);
+    TEST_CHECK(blockSize > 0, "%s: %zu bytes did not compress within the bound", name, size);
+    if (blockSize > 0) checkBlock(name, block, blockSize, data, size);
+    free(block);
+    return blockSize;
+}
+
+static void checkInputs(void) {
+    size_t size = BLOCK_CODEC_BLOCK_SIZE;
+    uint8_t* data = malloc(size);
+    if (!data) {
+        TEST_CHECK(0, "out of memory");
+        return;
+    }
+    uint32_t seed = 21;
+    char name[64];
+
+    for (size_t i = 0; i < size; ++i) data[i] = (uint8_t)(nextRandom(&seed) >> 24);
+    size_t coded = checkRoundTrip("incompressible", data, size);
+    TEST_CHECK(coded <= BlockCodec_Bound(size), "incompressible: %zu bytes past the bound", coded);
+
+    // Runs with every short period, which the encoder codes as matches overlapping their output
+    for (int period = 1; period <= BLOCK_MAX_OVERLAP_OFFSET; ++period) {
+        for (size_t i = 0; i < size; ++i) {
+            data[i] = (uint8_t)(i < (size_t)period ? nextRandom(&seed) >> 24 : data[i - period]);
+        }
+        snprintf(name, sizeof(name), "period %d", period);
+        coded = checkRoundTrip(name, data, size);
+        TEST_CHECK(coded > 0 && coded * 50 < size, "%s: %zu bytes coded to %zu", name, size, coded);
+    }
+
+    // Words from a small dictionary with random gaps: short matches at every distance
+    static const char* words[] = {"mesh", "vertex", "normal", "tangent", "uv", "index", "cache", "block", "a", "of"};
+    for (size_t i = 0; i < size;) {
+        const char* word = words[nextRandom(&seed) % 10];
+        for (size_t k = 0; word[k] && i < size; ++k) data[i++] = (uint8_t)word[k];
+        if (i < size) data[i++] = (uint8_t)((nextRandom(&seed) >> 28) ? ' ' : nextRandom(&seed) >> 24);
+    }
+    checkRoundTrip("words", data, size);
+
+    // Around the sizes where the encoder stops looking for matches
+    for (size_t length = 0; length <= BLOCK_MF_LIMIT + 8; ++length) {
+        memset(data, 'x', length);
+        snprintf(name, sizeof(name), "%zu bytes", length);
+        checkRoundTrip(name, data, length);
+    }
+    free(data);
+}
+
+typedef struct {
+    uint8_t* out;
+    size_t size;
+} BlockWriter;
+
+static void writeLength(BlockWriter* writer, size_t length) {
+    for (length -= 15; length >= 255; length -= 255) writer->out[writer->size++] = 255;
+    writer->out[writer->size++] = (uint8_t)length;
+}
+
+// One sequence; offset 0 writes the literal-only sequence that ends a block
+static void writeSequence(BlockWriter* writer, const uint8_t* literals, size_t literalLength, size_t offset,
+                          size_t matchLength) {
+    size_t code = matchLength - BLOCK_MIN_MATCH;
+    uint8_t* token = &writer->out[writer->size++];
+    *token = (uint8_t)((literalLength >= 15 ? 15 : literalLength) << 4);
+    if (literalLength >= 15) writeLength(writer, literalLength);
+    memcpy(writer->out + writer->size, literals, literalLength);
+    writer->size += literalLength;
+    if (offset == 0) return;
+    writer->out[writer->size++] = (uint8_t)(offset & 0xff);
+    writer->out[writer->size++] = (uint8_t)(offset >> 8);
+    *token |= (uint8_t)(code >= 15 ? 15 : code);
+    if (code >= 15) writeLength(writer, code);
+}
+
+// Byte at a time, as the format defines a match
+static size_t referenceDecode(const uint8_t* prefix, size_t prefixLength, size_t offset, size_t matchLength,
+                              const uint8_t* tail, size_t tailLength, uint8_t* out) {
+    memcpy(out, prefix, prefixLength);
+    for (size_t i = 0; i < matchLength; ++i) out[prefixLength + i] = out[prefixLength + i - offset];
+    memcpy(out + prefixLength + matchLength, tail, tailLength);
+    return prefixLength + matchLength + tailLength;
+}
+
+// Hand-made blocks with one match at every offset 1..BLOCK_MAX_OVERLAP_OFFSET, with match
+// lengths on both sides of the fixed-copy and long-run paths, and tails long enough for the
+// fast path and too short for it.
+static void checkOverlappingMatches(void) {
+    static const size_t matchLengths[] = {4, 5, 7, 8, 9, 15, 16, 17, 18, 19, 20, 31, 64, 65, 100, 300};
+    static const size_t literalLengths[] = {0, 1, 7, 14, 15, 16, 40};
+    static const size_t tailLengths[] = {5, 40};
+    uint8_t random[512], block[1024], expected[1024];
+    uint32_t seed = 33;
+    for (size_t i = 0; i < sizeof(random); ++i) random[i] = (uint8_t)(nextRandom(&seed) >> 24);
+
+    int cases = 0;
+    for (size_t offset = 1; offset <= BLOCK_MAX_OVERLAP_OFFSET; ++offset) {
+        for (size_t m = 0; m < sizeof(matchLengths) / sizeof(matchLengths[0]); ++m) {
+            for (size_t l = 0; l < sizeof(literalLengths) / sizeof(literalLengths[0]); ++l) {
+                for (size_t t = 0; t < sizeof(tailLengths) / sizeof(tailLengths[0]); ++t) {
+                    // The first sequence's literals must reach back as far as the offset
+                    size_t literalLength = literalLengths[l] < offset ? offset : literalLengths[l];
+                    BlockWriter writer = {block, 0};
+                    writeSequence(&writer, random, literalLength, offset, matchLengths[m]);
+                    writeSequence(&writer, random + 100, tailLengths[t], 0, 0);
+                    size_t size = referenceDecode(random, literalLength, offset, matchLengths[m], random + 100,
+                                                  tailLengths[t], expected);
+                    char name[96];
+                    snprintf(name, sizeof(name), "offset %zu, match %zu, literals %zu, tail %zu", offset,
+                             matchLengths[m], literalLength, tailLengths[t]);
+                    checkBlock(name, block, writer.size, expected, size);
+                    cases++;
+                }
+            }
+        }
+    }
+
+    // A match reaching back past the start of the output is invalid
+    BlockWriter writer = {block, 0};
+    writeSequence(&writer, random, 4, 5, 8);
+    writeSequence(&writer, random, 5, 0, 0);
+    TEST_CHECK(decodeBlock(block, writer.size, expected, 4 + 8 + 5) != 0, "offset past the start accepted");
+    writer.size = 0;
+    writeSequence(&writer, random, 4, 0, 8);
+    writer.out[writer.size++] = 0;
+    writer.out[writer.size++] = 0;
+    writeSequence(&writer, random, 5, 0, 0);
+    TEST_CHECK(decodeBlock(block, writer.size, expected, 4 + 4 + 5) != 0, "offset 0 accepted");
+    printf("  %d hand-made blocks with overlapping matches\n", cases);
+}
+
+// Several blocks, one of them stored raw, decoded with one and several threads; damaged
+// headers and size tables are rejected
+static void checkStream(void) {
+    size_t size = 3 * BLOCK_CODEC_BLOCK_SIZE + 1000;
+    uint8_t* data = malloc(size);
+    uint8_t* decoded = malloc(size + BLOCK_CANARY_BYTES);
+    if (!data || !decoded) {
+        TEST_CHECK(0, "out of memory");
+        free(data);
+        free(decoded);
+        return;
+    }
+    uint32_t seed = 45;
+    for (size_t i = 0; i < size; ++i) {
+        int incompressible = i / BLOCK_CODEC_BLOCK_SIZE == 1;
+        data[i] = (uint8_t)(incompressible ? nextRandom(&seed) >> 24 : (i / 64) * 7);
+    }
+
+    void* stream;
+    size_t streamSize;
+    TEST_CHECK(BlockCodec_CompressStream(data, size, 4, &stream, &streamSize) == 0, "stream compression failed");
+    if (!stream) {
+        free(data);
+        free(decoded);
+        return;
+    }
+    BlockStreamHeader header;
+    memcpy(&header, stream, sizeof(header));
+    uint32_t storedSizes[4];
+    memcpy(storedSizes, (uint8_t*)stream + sizeof(header), sizeof(storedSizes));
+    TEST_CHECK(header.blockCount == 4 && (storedSizes[1] & BLOCK_CODEC_STORED_RAW) &&
+               !(storedSizes[0] & BLOCK_CODEC_STORED_RAW), "stream has %u blocks, stored sizes %08x %08x",
+               header.blockCount, storedSizes[0], storedSizes[1]);
+
+    size_t rawSize = 0;
+    TEST_CHECK(BlockCodec_GetRawSize(stream, streamSize, &rawSize) == 0 && rawSize == size, "raw size %zu", rawSize);
+    for (int threads = 1; threads <= 4; threads += 3) {
+        memset(decoded, BLOCK_CANARY, size + BLOCK_CANARY_BYTES);
+        int result = BlockCodec_DecompressStream(stream, streamSize, decoded, size, threads);
+        TEST_CHECK(result == 0 && memcmp(decoded, data, size) == 0 && canaryIntact(decoded, size),
+                   "stream does not decode with %d threads", threads);
+    }
+
+    uint8_t* bytes = (uint8_t*)stream;
+    TEST_CHECK(BlockCodec_DecompressStream(stream, streamSize, decoded, size - 1, 1) != 0, "wrong raw size accepted");
+    TEST_CHECK(BlockCodec_DecompressStream(stream, sizeof(header) + 8, decoded, size, 1) != 0,
+               "truncated size table accepted");
+    TEST_CHECK(BlockCodec_DecompressStream(stream, streamSize - 1, decoded, size, 1) != 0, "truncated stream accepted");
+    bytes[0] ^= 1;
+    TEST_CHECK(BlockCodec_DecompressStream(stream, streamSize, decoded, size, 1) != 0, "bad magic accepted");
+    bytes[0] ^= 1;
+    size_t countOffset = offsetof(BlockStreamHeader, blockCount);
+    bytes[countOffset]++;
+    TEST_CHECK(BlockCodec_DecompressStream(stream, streamSize, decoded, size, 1) != 0, "wrong block count accepted");
+    bytes[countOffset]--;
+    // A raw block whose stored size does not match the block size
+    storedSizes[1]--;
+    memcpy(bytes + sizeof(header) + sizeof(uint32_t), &storedSizes[1], sizeof(uint32_t));
+    TEST_CHECK(BlockCodec_DecompressStream(stream, streamSize, decoded, size, 1) != 0, "short raw block accepted");
+    free(stream);
+    free(data);
+    free(decoded);
+}
+
+void Test_BlockCodec(void) {
+    checkInputs();
+    checkOverlappingMatches();
+    checkStream();
+}
@@ -0,0 +1,54 @@
+// Headless tests for the loading pipeline. Exits with 1 when any check fails.
+//
+//   tests [suite ...]
+//
+// Without arguments every suite runs. Scratch files go to TEST_SCRATCH_DIRECTORY.
+
+#include "test.h"
+#include "time_utils.h"
+#include <stdio.h>
+#include <string.h>
+
+typedef struct {
+    const char* name;
+    void (*run)(void);
+} TestSuite;
+
+static const TestSuite suites[] = {
+    {"obj_parser", Test_ObjParser},
+    {"obj_threaded", Test_ObjThreaded},
+    {"obj_streaming", Test_ObjStreaming},
+    {"indexed_tangents", Test_IndexedTangents},
+    {"smooth_groups", Test_SmoothGroups},
+    {"smooth_threads", Test_SmoothThreads},
+    {"mesh_codec", Test_MeshCodec},
+    {"block_codec", Test_BlockCodec},
+};
+
+#define SUITE_COUNT ((int)(sizeof(suites) / sizeof(suites[0])))
+
+static int isSelected(const char* name, int argc, char** argv) {
+    if (argc < 2) return 1;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], name) == 0) return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    int failedSuites = 0, ranSuites = 0;
+    for (int i = 0; i < SUITE_COUNT; ++i) {
+        if (!isSelected(suites[i].name, argc, argv)) continue;
+        int failuresBefore = Test_Failures;
+        double startTime = GetTimeSeconds();
+        printf("[Test] %s\n", suites[i].name);
+        suites[i].run();
+        int failures = Test_Failures - failuresBefore;
+        printf("[Test] %s: %s (%d failed checks, %.1f ms)\n", suites[i].name, failures ? "FAILED" : "ok", failures,
+               (GetTimeSeconds() - startTime) * 1000.0);
+        failedSuites += failures != 0;
+        ranSuites++;
+    }
+    printf("[Test] %d of %d suites passed\n", ranSuites - failedSuites, ranSuites);
+    return (failedSuites || ranSuites == 0) ? 1 : 0;
+}
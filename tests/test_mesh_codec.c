@@ -0,0 +1,329 @@
+#include "test.h"
+#include "mesh_codec.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Bytes after every decode target that a decoder must leave alone
+#define CODEC_CANARY_BYTES 64
+#define CODEC_CANARY 0xA5
+// Streams up to this size are cut at every length and get every bit flipped; longer ones
+// at a spread of positions and at each of the last CODEC_DAMAGE_TAIL bytes
+#define CODEC_DAMAGE_ALL_BYTES 256
+#define CODEC_DAMAGE_POSITIONS 97
+#define CODEC_DAMAGE_TAIL 16
+
+static const size_t vertexCounts[] = {0, 1, 15, 16, 17, 100};
+#define VERTEX_COUNT_COUNT ((int)(sizeof(vertexCounts) / sizeof(vertexCounts[0])))
+
+static uint32_t nextRandom(uint32_t* state) {
+    *state = *state * 1664525u + 1013904223u;
+    return *state;
+}
+
+static uint8_t* allocateTarget(size_t size) {
+    uint8_t* target = malloc(size + CODEC_CANARY_BYTES);
+    if (target) memset(target, CODEC_CANARY, size + CODEC_CANARY_BYTES);
+    return target;
+}
+
+static int canaryIntact(const uint8_t* target, size_t size) {
+    for (size_t i = 0; i < CODEC_CANARY_BYTES; ++i) {
+        if (target[size + i] != CODEC_CANARY) return 0;
+    }
+    return 1;
+}
+
+static size_t damagePositionCount(size_t streamSize) {
+    return streamSize <= CODEC_DAMAGE_ALL_BYTES ? streamSize : CODEC_DAMAGE_POSITIONS + CODEC_DAMAGE_TAIL;
+}
+
+static size_t damagePosition(size_t p, size_t streamSize) {
+    if (streamSize <= CODEC_DAMAGE_ALL_BYTES) return p;
+    if (p < CODEC_DAMAGE_POSITIONS) return p * streamSize / CODEC_DAMAGE_POSITIONS;
+    return streamSize - CODEC_DAMAGE_TAIL + (p - CODEC_DAMAGE_POSITIONS);
+}
+
+static int decodeVertices(const uint8_t* stream, size_t streamSize, uint8_t* target, size_t vertexCount,
+                          size_t stride, int simd) {
+    memset(target, CODEC_CANARY, vertexCount * stride + CODEC_CANARY_BYTES);
+    MeshCodec_SetSimd(simd);
+    int result = MeshCodec_DecodeVertices(stream, streamSize, target, vertexCount, stride);
+    MeshCodec_SetSimd(1);
+    return result;
+}
+
+// Channel c cycles through what each plane mode is for: a constant (zero planes), steps of
+// +-1 (2-bit), small noise (4-bit) and random values (raw planes).
+static void fillVertices(uint8_t* vertices, size_t vertexCount, size_t stride, uint32_t* seed) {
+    size_t channels = stride / 2;
+    for (size_t c = 0; c < channels; ++c) {
+        uint16_t value = (uint16_t)nextRandom(seed);
+        for (size_t i = 0; i < vertexCount; ++i) {
+            switch (c % 4) {
+            case 0: break;
+            case 1: value = (uint16_t)(value + ((nextRandom(seed) >> 16) & 1 ? 1 : -1)); break;
+            case 2: value = (uint16_t)(value + (int)((nextRandom(seed) >> 16) % 15) - 7); break;
+            default: value = (uint16_t)(nextRandom(seed) >> 16); break;
+            }
+            memcpy(vertices + i * stride + 2 * c, &value, sizeof(value));
+        }
+    }
+}
+
+// A truncated stream and the stream with a byte appended must be rejected. A flipped bit
+// may decode to other values, but both decoders must give the same answer and stay inside
+// the target.
+static void checkDamagedVertices(const char* name, const uint8_t* stream, size_t streamSize, size_t vertexCount,
+                                 size_t stride) {
+    size_t size = vertexCount * stride;
+    uint8_t* damaged = malloc(streamSize + 1);
+    uint8_t* scalar = allocateTarget(size);
+    uint8_t* simd = allocateTarget(size);
+    if (!damaged || !scalar || !simd) {
+        TEST_CHECK(0, "out of memory");
+        free(damaged);
+        free(scalar);
+        free(simd);
+        return;
+    }
+    memcpy(damaged, stream, streamSize);
+
+    int accepted = 0;
+    for (size_t p = 0; p < damagePositionCount(streamSize); ++p) {
+        size_t length = damagePosition(p, streamSize);
+        accepted |= decodeVertices(damaged, length, simd, vertexCount, stride, 1) == 0;
+        accepted |= decodeVertices(damaged, length, scalar, vertexCount, stride, 0) == 0;
+    }
+    TEST_CHECK(!accepted, "%s: a truncated vertex stream was accepted", name);
+    damaged[streamSize] = 0;
+    TEST_CHECK(decodeVertices(damaged, streamSize + 1, simd, vertexCount, stride, 1) != 0,
+               "%s: a vertex stream with a trailing byte was accepted", name);
+
+    int disagree = 0, overrun = 0;
+    for (size_t p = 0; p < damagePositionCount(streamSize); ++p) {
+        size_t position = damagePosition(p, streamSize);
+        for (int bit = 0; bit < 8; ++bit) {
+            damaged[position] ^= (uint8_t)(1u << bit);
+            int simdResult = decodeVertices(damaged, streamSize, simd, vertexCount, stride, 1);
+            int scalarResult = decodeVertices(damaged, streamSize, scalar, vertexCount, stride, 0);
+            overrun |= !canaryIntact(simd, size) || !canaryIntact(scalar, size);
+            disagree |= simdResult != scalarResult || (simdResult == 0 && memcmp(simd, scalar, size) != 0);
+            damaged[position] ^= (uint8_t)(1u << bit);
+        }
+    }
+    TEST_CHECK(!overrun, "%s: a damaged vertex stream was decoded past the target", name);
+    TEST_CHECK(!disagree, "%s: scalar and SSE2 decoders disagree on a damaged stream", name);
+    free(damaged);
+    free(scalar);
+    free(simd);
+}
+
+// Round trip through both decoders; returns the encoded size, 0 on failure
+static size_t checkVertexRoundTrip(const char* name, const uint8_t* vertices, size_t vertexCount, size_t stride,
+                                   int damage) {
+    size_t size = vertexCount * stride;
+    size_t bound = MeshCodec_VertexBound(vertexCount, stride);
+    uint8_t* stream = malloc(bound + 1);
+    uint8_t* decoded = allocateTarget(size);
+    size_t streamSize = 0;
+    if (!stream || !decoded) {
+        TEST_CHECK(0, "out of memory");
+    } else {
+        streamSize = MeshCodec_EncodeVertices(vertices, vertexCount, stride, stream, bound);
+        TEST_CHECK(streamSize > 0 || vertexCount == 0, "%s: encoding failed", name);
+        for (int simd = 1; simd >= 0; --simd) {
+            int result = decodeVertices(stream, streamSize, decoded, vertexCount, stride, simd);
+            TEST_CHECK(result == 0 && memcmp(decoded, vertices, size) == 0 && canaryIntact(decoded, size),
+                       "%s: %s decode does not match", name, simd ? "SSE2" : "scalar");
+        }
+        if (damage && streamSize > 0) checkDamagedVertices(name, stream, streamSize, vertexCount, stride);
+    }
+    free(stream);
+    free(decoded);
+    return streamSize;
+}
+
+static void checkVertices(void) {
+    uint32_t seed = 3;
+    int cases = 0;
+    for (size_t stride = 2; stride <= MESH_CODEC_MAX_STRIDE; stride += 2) {
+        for (int k = 0; k < VERTEX_COUNT_COUNT; ++k) {
+            size_t vertexCount = vertexCounts[k];
+            uint8_t* vertices = malloc(vertexCount * stride + 1);
+            if (!vertices) {
+                TEST_CHECK(0, "out of memory");
+                return;
+            }
+            fillVertices(vertices, vertexCount, stride, &seed);
+            char name[64];
+            snprintf(name, sizeof(name), "stride %zu, %zu vertices", stride, vertexCount);
+            // Damage only a few strides: the decoder loops over channels the same way for all
+            int damage = vertexCount == 17 && (stride == 2 || stride == 16 || stride == 20 || stride == 44 ||
+                                              stride == MESH_CODEC_MAX_STRIDE);
+            checkVertexRoundTrip(name, vertices, vertexCount, stride, damage);
+            free(vertices);
+            cases++;
+        }
+    }
+    printf("  vertices: %d stride and count cases, scalar and SSE2\n", cases);
+
+    // A smooth ramp in every channel must shrink
+    size_t vertexCount = 4096, stride = 16;
+    uint16_t* ramp = malloc(vertexCount * stride);
+    if (!ramp) {
+        TEST_CHECK(0, "out of memory");
+        return;
+    }
+    for (size_t i = 0; i < vertexCount; ++i) {
+        for (size_t c = 0; c < stride / 2; ++c) ramp[i * stride / 2 + c] = (uint16_t)(i * (c + 1));
+    }
+    size_t coded = checkVertexRoundTrip("ramp", (const uint8_t*)ramp, vertexCount, stride, 0);
+    TEST_CHECK(coded > 0 && coded * 3 < vertexCount * stride, "ramp: %zu bytes coded to %zu", vertexCount * stride,
+               coded);
+    free(ramp);
+
+    uint8_t stream[64], vertex[4] = {0};
+    TEST_CHECK(MeshCodec_EncodeVertices(vertex, 1, 3, stream, sizeof(stream)) == 0, "odd stride encoded");
+    TEST_CHECK(MeshCodec_EncodeVertices(vertex, 1, 0, stream, sizeof(stream)) == 0, "zero stride encoded");
+    TEST_CHECK(MeshCodec_DecodeVertices(stream, sizeof(stream), vertex, 1, MESH_CODEC_MAX_STRIDE + 2) != 0,
+               "stride above MESH_CODEC_MAX_STRIDE decoded");
+}
+
+static int sameTriangle(const uint32_t* a, const uint32_t* b) {
+    for (int r = 0; r < 3; ++r) {
+        if (a[0] == b[r] && a[1] == b[(r + 1) % 3] && a[2] == b[(r + 2) % 3]) return 1;
+    }
+    return 0;
+}
+
+static void readIndices(const uint8_t* data, size_t indexCount, uint32_t indexSize, uint32_t* out) {
+    for (size_t i = 0; i < indexCount; ++i) {
+        if (indexSize == 2) {
+            uint16_t value;
+            memcpy(&value, data + i * 2, sizeof(value));
+            out[i] = value;
+        } else {
+            memcpy(&out[i], data + i * 4, sizeof(uint32_t));
+        }
+    }
+}
+
+// Triangles may come back rotated, with the same winding
+static void checkIndexRoundTrip(const char* name, const uint32_t* indices, size_t indexCount, uint32_t indexSize) {
+    size_t size = indexCount * indexSize;
+    size_t bound = MeshCodec_IndexBound(indexCount);
+    uint8_t* narrow = malloc(size + 1);
+    uint8_t* stream = malloc(bound + 1);
+    uint8_t* decoded = allocateTarget(size);
+    uint32_t* wide = malloc(indexCount * sizeof(uint32_t) + 1);
+    if (!narrow || !stream || !decoded || !wide) {
+        TEST_CHECK(0, "out of memory");
+        free(narrow);
+        free(stream);
+        free(decoded);
+        free(wide);
+        return;
+    }
+    for (size_t i = 0; i < indexCount; ++i) {
+        if (indexSize == 2) {
+            uint16_t value = (uint16_t)indices[i];
+            memcpy(narrow + i * 2, &value, sizeof(value));
+        } else {
+            memcpy(narrow + i * 4, &indices[i], sizeof(uint32_t));
+        }
+    }
+
+    size_t streamSize = MeshCodec_EncodeIndices(narrow, indexCount, indexSize, stream, bound);
+    TEST_CHECK(streamSize > 0, "%s: encoding failed", name);
+    int result = MeshCodec_DecodeIndices(stream, streamSize, decoded, indexCount, indexSize);
+    readIndices(decoded, indexCount, indexSize, wide);
+    int same = result == 0;
+    for (size_t t = 0; same && t < indexCount; t += 3) same = sameTriangle(&indices[t], &wide[t]);
+    TEST_CHECK(same && canaryIntact(decoded, size), "%s: decoded triangles do not match", name);
+
+    int accepted = 0;
+    for (size_t p = 0; p < damagePositionCount(streamSize); ++p) {
+        size_t length = damagePosition(p, streamSize);
+        memset(decoded, CODEC_CANARY, size + CODEC_CANARY_BYTES);
+        accepted |= MeshCodec_DecodeIndices(stream, length, decoded, indexCount, indexSize) == 0;
+    }
+    TEST_CHECK(!accepted || indexCount == 0, "%s: a truncated index stream was accepted", name);
+    stream[streamSize] = 0;
+    TEST_CHECK(MeshCodec_DecodeIndices(stream, streamSize + 1, decoded, indexCount, indexSize) != 0,
+               "%s: an index stream with a trailing byte was accepted", name);
+
+    int overrun = 0;
+    for (size_t p = 0; p < damagePositionCount(streamSize); ++p) {
+        size_t position = damagePosition(p, streamSize);
+        for (int bit = 0; bit < 8; ++bit) {
+            stream[position] ^= (uint8_t)(1u << bit);
+            memset(decoded, CODEC_CANARY, size + CODEC_CANARY_BYTES);
+            MeshCodec_DecodeIndices(stream, streamSize, decoded, indexCount, indexSize);
+            overrun |= !canaryIntact(decoded, size);
+            stream[position] ^= (uint8_t)(1u << bit);
+        }
+    }
+    TEST_CHECK(!overrun, "%s: a damaged index stream was decoded past the target", name);
+    printf("  %s: %zu triangles, %u-bit, %.2f bytes per triangle\n", name, indexCount / 3, indexSize * 8,
+           indexCount ? (double)streamSize / (double)(indexCount / 3) : 0.0);
+
+    free(narrow);
+    free(stream);
+    free(decoded);
+    free(wide);
+}
+
+#define CODEC_GRID_SIZE 60
+
+static void checkIndices(void) {
+    size_t indexCount = (size_t)CODEC_GRID_SIZE * CODEC_GRID_SIZE * 6;
+    uint32_t* indices = malloc(indexCount * sizeof(uint32_t));
+    if (!indices) {
+        TEST_CHECK(0, "out of memory");
+        return;
+    }
+    uint32_t* out = indices;
+    for (int r = 0; r < CODEC_GRID_SIZE; ++r) {
+        for (int c = 0; c < CODEC_GRID_SIZE; ++c) {
+            uint32_t a = (uint32_t)(r * (CODEC_GRID_SIZE + 1) + c), b = a + CODEC_GRID_SIZE + 1;
+            *out++ = a; *out++ = b; *out++ = b + 1;
+            *out++ = a; *out++ = b + 1; *out++ = a + 1;
+        }
+    }
+    checkIndexRoundTrip("grid", indices, indexCount, 2);
+    checkIndexRoundTrip("grid", indices, indexCount, 4);
+
+    uint32_t seed = 11;
+    for (size_t t = indexCount / 3; t > 1; --t) {
+        size_t other = nextRandom(&seed) % t;
+        for (int k = 0; k < 3; ++k) {
+            uint32_t swap = indices[(t - 1) * 3 + k];
+            indices[(t - 1) * 3 + k] = indices[other * 3 + k];
+            indices[other * 3 + k] = swap;
+        }
+    }
+    checkIndexRoundTrip("shuffled grid", indices, indexCount, 4);
+
+    // Explicit indices only, with deltas that wrap around in both widths
+    for (size_t i = 0; i < indexCount; ++i) indices[i] = nextRandom(&seed) >> 16;
+    checkIndexRoundTrip("random", indices, indexCount, 2);
+    for (size_t i = 0; i < indexCount; ++i) indices[i] = nextRandom(&seed);
+    checkIndexRoundTrip("random", indices, indexCount, 4);
+    checkIndexRoundTrip("one triangle", indices, 3, 4);
+    free(indices);
+
+    uint8_t stream[64];
+    uint32_t triangle[3] = {0, 1, 2};
+    TEST_CHECK(MeshCodec_EncodeIndices(triangle, 2, 4, stream, sizeof(stream)) == 0, "partial triangle encoded");
+    TEST_CHECK(MeshCodec_EncodeIndices(triangle, 3, 3, stream, sizeof(stream)) == 0, "3-byte indices encoded");
+    TEST_CHECK(MeshCodec_DecodeIndices(stream, sizeof(stream), triangle, 3, 1) != 0, "1-byte indices decoded");
+    TEST_CHECK(MeshCodec_DecodeIndices(stream, 0, triangle, 0, 4) == 0, "empty index stream rejected");
+}
+
+// Round trips, both vertex decoders against each other, and truncated or damaged streams
+void Test_MeshCodec(void) {
+    checkVertices();
+    checkIndices();
+}
@@ -0,0 +1,335 @@
+#include "test.h"
+#include "OBJ_file_loader.h"
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TANGENT_TOLERANCE 1e-4f
+
+typedef struct {
+    size_t checked;
+    float worstLength;           // largest | |t| - 1 |
+    float worstDot;              // largest |n . t|
+} TangentReport;
+
+static void checkTangents(const float* vertices, size_t vertexCount, TangentReport* report) {
+    for (size_t i = 0; i < vertexCount; ++i) {
+        const float* n = &vertices[i * FLOATS_PER_VERTEX + 3];
+        const float* t = &vertices[i * FLOATS_PER_VERTEX + 8];
+        float length = sqrtf(t[0] * t[0] + t[1] * t[1] + t[2] * t[2]);
+        float dot = fabsf(n[0] * t[0] + n[1] * t[1] + n[2] * t[2]);
+        if (fabsf(length - 1.0f) > report->worstLength) report->worstLength = fabsf(length - 1.0f);
+        if (dot > report->worstDot) report->worstDot = dot;
+        report->checked++;
+    }
+}
+
+static int tangentSink(const ObjStreamChunk* chunk, void* user) {
+    checkTangents(chunk->vertices, chunk->vertex_count, user);
+    return 0;
+}
+
+// Welded vertices sum the tangents of every face around them; what comes out of
+// BuildIndexedMesh and the streaming loader must still be a unit tangent in the normal's plane.
+void Test_IndexedTangents(void) {
+    char path[256];
+    Test_ScratchPath("tangents.obj", path, sizeof(path));
+    if (!Test_WriteGridOBJ(path, 64, 64, 0)) {
+        TEST_CHECK(0, "cannot write %s", path);
+        return;
+    }
+
+    ObjMesh mesh;
+    TEST_CHECK(LoadOBJ(path, &mesh) == 0, "LoadOBJ failed");
+    ComputeTangents(&mesh);
+    TEST_CHECK(BuildIndexedMesh(&mesh) == 0, "BuildIndexedMesh failed");
+    size_t cornerCount = mesh.triangle_vertex_count / FLOATS_PER_VERTEX;
+    TEST_CHECK(mesh.unique_vertex_count * 4 < cornerCount, "%zu corners welded into %zu vertices", cornerCount,
+               mesh.unique_vertex_count);
+
+    TangentReport indexed = {0};
+    checkTangents(mesh.unique_vertices, mesh.unique_vertex_count, &indexed);
+    TEST_CHECK(indexed.worstLength < TANGENT_TOLERANCE && indexed.worstDot < TANGENT_TOLERANCE,
+               "indexed tangents: length off by %g, n.t up to %g", indexed.worstLength, indexed.worstDot);
+    freeMesh(&mesh);
+
+    TangentReport streamed = {0};
+    TEST_CHECK(LoadOBJStreaming(path, 1000, tangentSink, &streamed, NULL) == 0, "LoadOBJStreaming failed");
+    TEST_CHECK(streamed.checked > 0, "no streamed vertices");
+    TEST_CHECK(streamed.worstLength < TANGENT_TOLERANCE && streamed.worstDot < TANGENT_TOLERANCE,
+               "streamed tangents: length off by %g, n.t up to %g", streamed.worstLength, streamed.worstDot);
+
+    printf("  %zu indexed and %zu streamed vertices, worst | |t| - 1 | %g, worst n.t %g\n", indexed.checked,
+           streamed.checked, fmaxf(indexed.worstLength, streamed.worstLength), fmaxf(indexed.worstDot, streamed.worstDot));
+    remove(path);
+}
+
+#define SMOOTH_FAN_SEGMENTS 3000
+#define SMOOTH_TOLERANCE 1e-5f
+
+static uint32_t nextRandom(uint32_t* state) {
+    *state = *state * 1664525u + 1013904223u;
+    return *state;
+}
+
+static float randomUnit(uint32_t* state) {
+    return (float)(nextRandom(state) >> 8) / (float)(1u << 24) * 2.0f - 1.0f;
+}
+
+static void setCorner(float* corners, size_t corner, float x, float y, float z) {
+    float* v = &corners[corner * FLOATS_PER_VERTEX];
+    memset(v, 0, FLOATS_PER_VERTEX * sizeof(float));
+    v[0] = x;
+    v[1] = y;
+    v[2] = z;
+}
+
+// Same arithmetic as the face normal kernels
+static void faceNormal(const float* corners, size_t triangle, float* n) {
+    const float* v0 = &corners[triangle * 3 * FLOATS_PER_VERTEX];
+    const float* v1 = v0 + FLOATS_PER_VERTEX;
+    const float* v2 = v1 + FLOATS_PER_VERTEX;
+    float e1[3] = {v1[0] - v0[0], v1[1] - v0[1], v1[2] - v0[2]};
+    float e2[3] = {v2[0] - v0[0], v2[1] - v0[1], v2[2] - v0[2]};
+    n[0] = e1[1] * e2[2] - e1[2] * e2[1];
+    n[1] = e1[2] * e2[0] - e1[0] * e2[2];
+    n[2] = e1[0] * e2[1] - e1[1] * e2[0];
+    float length = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+    if (length > 1e-6f) {
+        n[0] /= length;
+        n[1] /= length;
+        n[2] /= length;
+    }
+}
+
+// Every pair of corners compared, as the smoothing did before it bucketed large groups
+static float compareWithPairwise(const float* corners, const float* smoothed, size_t cornerCount) {
+    const float threshold = cosf(SMOOTH_NORMALS_ANGLE_DEGREES * 3.14159f / 180.0f);
+    float* normals = malloc(cornerCount / 3 * 3 * sizeof(float));
+    if (!normals) return INFINITY;
+    for (size_t t = 0; t < cornerCount / 3; ++t) faceNormal(corners, t, &normals[t * 3]);
+
+    float worst = 0.0f;
+    for (size_t i = 0; i < cornerCount; ++i) {
+        const float* p = &corners[i * FLOATS_PER_VERTEX];
+        const float* n = &normals[i / 3 * 3];
+        double sum[3] = {0, 0, 0};
+        for (size_t j = 0; j < cornerCount; ++j) {
+            const float* q = &corners[j * FLOATS_PER_VERTEX];
+            if (fabsf(p[0] - q[0]) >= SMOOTH_NORMALS_EPSILON || fabsf(p[1] - q[1]) >= SMOOTH_NORMALS_EPSILON ||
+                fabsf(p[2] - q[2]) >= SMOOTH_NORMALS_EPSILON) {
+                continue;
+            }
+            const float* m = &normals[j / 3 * 3];
+            if (n[0] * m[0] + n[1] * m[1] + n[2] * m[2] >= threshold) {
+                for (int k = 0; k < 3; ++k) sum[k] += m[k];
+            }
+        }
+        double length = sqrt(sum[0] * sum[0] + sum[1] * sum[1] + sum[2] * sum[2]);
+        for (int k = 0; k < 3 && length > 1e-6; ++k) {
+            float difference = fabsf((float)(sum[k] / length) - smoothed[i * FLOATS_PER_VERTEX + 3 + k]);
+            if (difference > worst) worst = difference;
+        }
+    }
+    free(normals);
+    return worst;
+}
+
+static void checkSmoothedFan(const char* name, float* corners, size_t cornerCount) {
+    float* smoothed = malloc(cornerCount * FLOATS_PER_VERTEX * sizeof(float));
+    if (!smoothed) {
+        TEST_CHECK(0, "out of memory");
+        return;
+    }
+    memcpy(smoothed, corners, cornerCount * FLOATS_PER_VERTEX * sizeof(float));
+    ObjMesh mesh;
+    memset(&mesh, 0, sizeof(mesh));
+    mesh.triangle_vertices = smoothed;
+    mesh.triangle_vertex_count = cornerCount * FLOATS_PER_VERTEX;
+    ComputeSmoothNormals(&mesh);
+
+    float worst = compareWithPairwise(corners, smoothed, cornerCount);
+    TEST_CHECK(worst < SMOOTH_TOLERANCE, "%s: normals differ from pairwise smoothing by %g", name, worst);
+    printf("  %s: %zu corners, largest difference from pairwise %g\n", name, cornerCount, worst);
+    free(smoothed);
+}
+
+// One position shared by thousands of faces, the case smoothing buckets by normal: a cone
+// apex, whose normals form a ring, and faces of random orientation, many of them close to
+// the smoothing angle apart. Bucketing must give what comparing every pair gives.
+void Test_SmoothGroups(void) {
+    size_t cornerCount = (size_t)SMOOTH_FAN_SEGMENTS * 3;
+    float* corners = malloc(cornerCount * FLOATS_PER_VERTEX * sizeof(float));
+    if (!corners) {
+        TEST_CHECK(0, "out of memory");
+        return;
+    }
+
+    for (int s = 0; s < SMOOTH_FAN_SEGMENTS; ++s) {
+        float a = (float)s * (2.0f * 3.14159265f / SMOOTH_FAN_SEGMENTS);
+        float b = (float)(s + 1) * (2.0f * 3.14159265f / SMOOTH_FAN_SEGMENTS);
+        setCorner(corners, (size_t)s * 3, 0.0f, 1.0f, 0.0f);
+        setCorner(corners, (size_t)s * 3 + 1, cosf(b), 0.0f, sinf(b));
+        setCorner(corners, (size_t)s * 3 + 2, cosf(a), 0.0f, sinf(a));
+    }
+    checkSmoothedFan("cone apex", corners, cornerCount);
+
+    uint32_t seed = 99;
+    for (int s = 0; s < SMOOTH_FAN_SEGMENTS; ++s) {
+        setCorner(corners, (size_t)s * 3, 0.0f, 0.0f, 0.0f);
+        for (int k = 1; k < 3; ++k) {
+            setCorner(corners, (size_t)s * 3 + k, randomUnit(&seed), randomUnit(&seed), randomUnit(&seed));
+        }
+    }
+    checkSmoothedFan("random fan", corners, cornerCount);
+    free(corners);
+}
+
+#define SMOOTH_MAX_THREADS 8
+
+static void smoothCopy(const float* corners, float* out, size_t cornerCount, int threadCount) {
+    memcpy(out, corners, cornerCount * FLOATS_PER_VERTEX * sizeof(float));
+    ObjMesh mesh;
+    memset(&mesh, 0, sizeof(mesh));
+    mesh.triangle_vertices = out;
+    mesh.triangle_vertex_count = cornerCount * FLOATS_PER_VERTEX;
+    ComputeSmoothNormalsThreaded(&mesh, threadCount);
+}
+
+// The threaded steps give the same normals for every thread count above 1, and the serial
+// pass used for 1 thread groups corners the same way, so it agrees with them to float rounding.
+static void checkSmoothThreads(const char* name, const float* corners, size_t cornerCount) {
+    size_t floats = cornerCount * FLOATS_PER_VERTEX;
+    float* serial = malloc(floats * sizeof(float));
+    float* first = malloc(floats * sizeof(float));
+    float* threaded = malloc(floats * sizeof(float));
+    if (!serial || !first || !threaded) {
+        TEST_CHECK(0, "out of memory");
+        free(serial);
+        free(first);
+        free(threaded);
+        return;
+    }
+    smoothCopy(corners, serial, cornerCount, 1);
+    smoothCopy(corners, first, cornerCount, 2);
+    float worst = 0.0f;
+    for (size_t i = 0; i < floats; ++i) {
+        float difference = fabsf(serial[i] - first[i]);
+        if (difference > worst) worst = difference;
+    }
+    TEST_CHECK(worst < SMOOTH_TOLERANCE, "%s: serial and threaded normals differ by %g", name, worst);
+    for (int threadCount = 3; threadCount <= SMOOTH_MAX_THREADS; ++threadCount) {
+        smoothCopy(corners, threaded, cornerCount, threadCount);
+        TEST_CHECK(memcmp(first, threaded, floats * sizeof(float)) == 0, "%s: %d threads differ from 2", name,
+                   threadCount);
+    }
+    printf("  %s: %zu corners, serial vs threaded %g, 2..%d threads identical\n", name, cornerCount, worst,
+           SMOOTH_MAX_THREADS);
+    free(serial);
+    free(first);
+    free(threaded);
+}
+
+#define CHAIN_COUNT 2500
+#define CHAIN_POINTS 8
+#define CHAIN_TRIANGLES_PER_POINT 2
+
+// Triangle whose first corner is at p, facing about +y with a little random tilt, so every
+// corner at p smooths with every other and the normal shows which ones were grouped.
+static void setChainTriangle(float* corners, size_t triangle, const float* p, uint32_t* seed) {
+    size_t corner = triangle * 3;
+    setCorner(corners, corner, p[0], p[1], p[2]);
+    setCorner(corners, corner + 1, p[0] + 0.1f * randomUnit(seed), p[1] + 0.1f * randomUnit(seed), p[2] + 1.0f);
+    setCorner(corners, corner + 2, p[0] + 1.0f, p[1] + 0.1f * randomUnit(seed), p[2] + 0.1f * randomUnit(seed));
+}
+
+// Positions spaced just under and just over SMOOTH_NORMALS_EPSILON along x, where grouping
+// depends on which corner starts a group. The first five are A = 0, B = 0.8, C = 1.6,
+// D = 1.65 and F = 2.5 EPSILONs: {A, B} and {C, D, F}, not {C, D} and {F}. The other chains
+// are jittered and their triangles shuffled, so chains cross task ranges in any order.
+static float* buildChains(size_t* outCount) {
+    size_t triangleCount = 5 + (size_t)CHAIN_COUNT * CHAIN_POINTS * CHAIN_TRIANGLES_PER_POINT;
+    float* corners = malloc(triangleCount * 3 * FLOATS_PER_VERTEX * sizeof(float));
+    size_t* order = malloc(triangleCount * sizeof(size_t));
+    float* points = malloc(triangleCount * 3 * sizeof(float));
+    if (!corners || !order || !points) {
+        free(corners);
+        free(order);
+        free(points);
+        return NULL;
+    }
+
+    const float eps = SMOOTH_NORMALS_EPSILON;
+    const float example[5] = {0.0f, 0.8f, 1.6f, 1.65f, 2.5f};
+    uint32_t seed = 17;
+    size_t count = 0;
+    for (int k = 0; k < 5; ++k, ++count) {
+        points[count * 3] = 0.5f + example[k] * eps;
+        points[count * 3 + 1] = points[count * 3 + 2] = 0.5f;
+    }
+    for (int c = 0; c < CHAIN_COUNT; ++c) {
+        float x = 1.0f + (float)c * 20.0f * eps;
+        for (int k = 0; k < CHAIN_POINTS; ++k) {
+            x += eps * (0.85f + 0.25f * randomUnit(&seed));
+            for (int t = 0; t < CHAIN_TRIANGLES_PER_POINT; ++t, ++count) {
+                points[count * 3] = x;
+                points[count * 3 + 1] = 0.5f + 0.1f * eps * randomUnit(&seed);
+                points[count * 3 + 2] = 0.5f + 0.1f * eps * randomUnit(&seed);
+            }
+        }
+    }
+
+    for (size_t i = 0; i < count; ++i) order[i] = i;
+    for (size_t i = count - 1; i > 5; --i) {
+        size_t j = 5 + nextRandom(&seed) % (i - 4);
+        size_t swap = order[i];
+        order[i] = order[j];
+        order[j] = swap;
+    }
+    for (size_t i = 0; i < count; ++i) setChainTriangle(corners, i, &points[order[i] * 3], &seed);
+    free(order);
+    free(points);
+    *outCount = count * 3;
+    return corners;
+}
+
+void Test_SmoothThreads(void) {
+    char path[256];
+    Test_ScratchPath("smooth_grid.obj", path, sizeof(path));
+    // Large enough for several tasks of SMOOTH_TRIANGLES_PER_TASK triangles
+    if (Test_WriteGridOBJ(path, 300, 300, TEST_GRID_QUADS)) {
+        ObjMesh mesh;
+        TEST_CHECK(LoadOBJ(path, &mesh) == 0, "LoadOBJ failed");
+        checkSmoothThreads("grid", mesh.triangle_vertices, mesh.triangle_vertex_count / FLOATS_PER_VERTEX);
+        freeMesh(&mesh);
+        remove(path);
+    } else {
+        TEST_CHECK(0, "cannot write %s", path);
+    }
+
+    size_t cornerCount = (size_t)SMOOTH_FAN_SEGMENTS * 3;
+    float* corners = malloc(cornerCount * FLOATS_PER_VERTEX * sizeof(float));
+    if (!corners) {
+        TEST_CHECK(0, "out of memory");
+        return;
+    }
+    uint32_t seed = 5;
+    for (int s = 0; s < SMOOTH_FAN_SEGMENTS; ++s) {
+        setCorner(corners, (size_t)s * 3, 0.0f, 0.0f, 0.0f);
+        for (int k = 1; k < 3; ++k) {
+            setCorner(corners, (size_t)s * 3 + k, randomUnit(&seed), randomUnit(&seed), randomUnit(&seed));
+        }
+    }
+    checkSmoothThreads("random fan", corners, cornerCount);
+    free(corners);
+
+    corners = buildChains(&cornerCount);
+    if (!corners) {
+        TEST_CHECK(0, "out of memory");
+        return;
+    }
+    checkSmoothThreads("epsilon chains", corners, cornerCount);
+    free(corners);
+}
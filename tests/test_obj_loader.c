@@ -0,0 +1,314 @@
+#include "test.h"
+#include "OBJ_file_loader.h"
+#include "mtl_loader.h"
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Every record form the tokenizer accepts: blanks and tabs, CRLF, signs, exponents,
+// leading dots, vt with one coordinate, v//vn and relative indices, n-gons and usemtl.
+static const char* const parserSource =
+    "# comment line\n"
+    "mtllib   parser.mtl  \n"
+    "o shape\n"
+    "v 1 2 3\n"
+    "v -1.5e2 +2.25 .5\r\n"
+    "v\t0.125\t-0\t1E+1\n"
+    "v 4 5 6\n"
+    "vt 0.25 0.75\n"
+    "vt 0.5\n"
+    "vn 0 0 1\n"
+    "vn 0 1 0\n"
+    "s 1\n"
+    "usemtl red\n"
+    "f 1/1/1 2/2/1 3/1/2\n"
+    "f -4//-2 -3//-2 -2//-1 -1//-1\r\n"
+    "usemtl blue\n"
+    "f\t1 2 3 4 \n";
+
+static void checkCorner(const ObjMesh* mesh, size_t triangle, int corner, int v, int vt, int vn) {
+    const int* got = &mesh->indices[(triangle * 3 + (size_t)corner) * 3];
+    TEST_CHECK(got[0] == v && got[1] == vt && got[2] == vn, "triangle %zu corner %d is (%d, %d, %d), expected (%d, %d, %d)",
+               triangle, corner, got[0], got[1], got[2], v, vt, vn);
+}
+
+static void checkRecords(void) {
+    char path[256];
+    Test_ScratchPath("parser.obj", path, sizeof(path));
+    FILE* file = fopen(path, "wb");
+    if (!file) {
+        TEST_CHECK(0, "cannot write %s", path);
+        return;
+    }
+    fputs(parserSource, file);
+    fclose(file);
+
+    ObjMesh mesh;
+    TEST_CHECK(LoadOBJ(path, &mesh) == 0, "LoadOBJ failed");
+    const float positions[] = {1, 2, 3, -150, 2.25f, 0.5f, 0.125f, -0.0f, 10, 4, 5, 6};
+    TEST_CHECK(mesh.vertex_count == 12 && memcmp(mesh.vertices, positions, sizeof(positions)) == 0, "positions differ");
+    const float texcoords[] = {0.25f, 0.25f, 0.5f, 1.0f};
+    TEST_CHECK(mesh.texcoord_count == 4 && memcmp(mesh.texcoords, texcoords, sizeof(texcoords)) == 0,
+               "texcoords differ");
+    TEST_CHECK(mesh.normal_count == 6, "%zu normal floats", mesh.normal_count);
+
+    // 1 triangle, a fanned quad and a fanned quad
+    TEST_CHECK(mesh.index_count == 5 * 3 * 3, "%zu index ints", mesh.index_count);
+    checkCorner(&mesh, 0, 0, 0, 0, 0);
+    checkCorner(&mesh, 0, 2, 2, 0, 1);
+    checkCorner(&mesh, 1, 0, 0, -1, 0);
+    checkCorner(&mesh, 1, 1, 1, -1, 0);
+    checkCorner(&mesh, 2, 0, 0, -1, 0);
+    checkCorner(&mesh, 2, 2, 3, -1, 1);
+    checkCorner(&mesh, 4, 1, 2, -1, -1);
+    checkCorner(&mesh, 4, 2, 3, -1, -1);
+
+    // Soup layout: position, normal, uv (1, 1 when absent), zero tangent
+    const float corner[FLOATS_PER_VERTEX] = {-150, 2.25f, 0.5f, 0, 0, 1, 0.5f, 1.0f, 0, 0, 0};
+    TEST_CHECK(mesh.triangle_vertex_count == 15 * FLOATS_PER_VERTEX &&
+               memcmp(&mesh.triangle_vertices[FLOATS_PER_VERTEX], corner, sizeof(corner)) == 0, "soup corner differs");
+    TEST_CHECK(mesh.triangle_vertices[14 * FLOATS_PER_VERTEX + 6] == 1.0f, "missing uv is not 1");
+
+    TEST_CHECK(mesh.material_range_count == 2, "%zu material ranges", mesh.material_range_count);
+    if (mesh.material_range_count == 2) {
+        TEST_CHECK(strcmp(mesh.material_ranges[0].name, "red") == 0 && mesh.material_ranges[0].firstTriangle == 0 &&
+                   mesh.material_ranges[0].triangleCount == 3, "red range");
+        TEST_CHECK(strcmp(mesh.material_ranges[1].name, "blue") == 0 && mesh.material_ranges[1].firstTriangle == 3 &&
+                   mesh.material_ranges[1].triangleCount == 2, "blue range");
+    }
+    TEST_CHECK(strcmp(mesh.material_library, TEST_SCRATCH_DIRECTORY "/parser.mtl") == 0, "mtllib resolved to '%s'",
+               mesh.material_library);
+    freeMesh(&mesh);
+}
+
+static uint32_t nextRandom(uint32_t* state) {
+    *state = *state * 1664525u + 1013904223u;
+    return *state;
+}
+
+static int32_t orderedBits(float value) {
+    int32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits < 0 ? INT32_MIN - bits : bits;
+}
+
+// The tokenizer against strtof on printed random floats of every magnitude; the result may
+// round differently from strtof in the last bit, never more.
+static void checkFloats(void) {
+    enum { VALUE_COUNT = 30000 };
+    char path[256];
+    Test_ScratchPath("floats.obj", path, sizeof(path));
+    FILE* file = fopen(path, "wb");
+    if (!file) {
+        TEST_CHECK(0, "cannot write %s", path);
+        return;
+    }
+    static char printed[VALUE_COUNT][32];
+    uint32_t seed = 12345;
+    for (int i = 0; i < VALUE_COUNT; ++i) {
+        float mantissa = (float)(nextRandom(&seed) >> 8) / (float)(1u << 24) * 2.0f - 1.0f;
+        int exponent = (int)(nextRandom(&seed) % 61) - 30;
+        const char* format = (i % 3 == 0) ? "%.9g" : (i % 3 == 1) ? "%.6f" : "%.4e";
+        snprintf(printed[i], sizeof(printed[i]), format, (double)mantissa * pow(10.0, exponent));
+        fprintf(file, (i % 3 == 0) ? "v %s" : " %s", printed[i]);
+        if (i % 3 == 2) fputc('\n', file);
+    }
+    fclose(file);
+
+    ObjMesh mesh;
+    TEST_CHECK(LoadOBJ(path, &mesh) == 0, "LoadOBJ failed");
+    TEST_CHECK(mesh.vertex_count == VALUE_COUNT, "%zu values", mesh.vertex_count);
+    int worst = 0, inexact = 0;
+    for (size_t i = 0; i < mesh.vertex_count && i < VALUE_COUNT; ++i) {
+        float expected = strtof(printed[i], NULL);
+        int distance = abs(orderedBits(mesh.vertices[i]) - orderedBits(expected));
+        if (distance > worst) worst = distance;
+        inexact += distance != 0;
+        if (distance > 1) TEST_CHECK(0, "'%s' parsed as %.9g", printed[i], mesh.vertices[i]);
+    }
+    printf("  %d floats, %d off by one ulp, worst %d ulp\n", VALUE_COUNT, inexact, worst);
+    freeMesh(&mesh);
+}
+
+static int writeText(const char* path, const char* text) {
+    FILE* file = fopen(path, "wb");
+    if (!file) {
+        TEST_CHECK(0, "cannot write %s", path);
+        return 0;
+    }
+    fputs(text, file);
+    fclose(file);
+    return 1;
+}
+
+// mtllib and map paths that do not fit OBJ_MAX_PATH / MTL_MAX_PATH are dropped instead of
+// being cut to a name that could belong to another file.
+static void checkLongPaths(void) {
+    char name[OBJ_MAX_PATH + 40];
+    memset(name, 'm', sizeof(name) - 1);
+    name[sizeof(name) - 1] = '\0';
+
+    char path[256], text[1024];
+    Test_ScratchPath("long_paths.obj", path, sizeof(path));
+    // Fits on its own, not once the OBJ's folder is put in front
+    snprintf(text, sizeof(text), "mtllib %.*s\nv 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 3\n", OBJ_MAX_PATH - 5, name);
+    if (!writeText(path, text)) return;
+    ObjMesh mesh;
+    TEST_CHECK(LoadOBJ(path, &mesh) == 0, "LoadOBJ failed");
+    TEST_CHECK(mesh.material_library[0] == '\0', "mtllib resolved to %zu bytes", strlen(mesh.material_library));
+    freeMesh(&mesh);
+
+    snprintf(text, sizeof(text), "mtllib %s\nv 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 3\n", name);
+    if (!writeText(path, text)) return;
+    TEST_CHECK(LoadOBJ(path, &mesh) == 0, "LoadOBJ failed");
+    TEST_CHECK(mesh.material_library[0] == '\0', "mtllib resolved to %zu bytes", strlen(mesh.material_library));
+    freeMesh(&mesh);
+    remove(path);
+
+    Test_ScratchPath("long_paths.mtl", path, sizeof(path));
+    snprintf(text, sizeof(text), "newmtl long\nmap_Kd %s.png\n", name);
+    if (!writeText(path, text)) return;
+    MaterialLibrary library;
+    TEST_CHECK(LoadMTL(path, &library) == 0 && library.count == 1, "LoadMTL failed");
+    if (library.count == 1) {
+        TEST_CHECK(library.materials[0].diffuseMap[0] == '\0', "map_Kd resolved to %zu bytes",
+                   strlen(library.materials[0].diffuseMap));
+    }
+    FreeMaterialLibrary(&library);
+    remove(path);
+}
+
+void Test_ObjParser(void) {
+    checkRecords();
+    checkFloats();
+    checkLongPaths();
+}
+
+#define THREADED_MAX_THREADS 16
+
+static int sameFloats(const float* a, const float* b, size_t count) {
+    return count == 0 || memcmp(a, b, count * sizeof(float)) == 0;
+}
+
+static void compareMeshes(const ObjMesh* serial, const ObjMesh* threaded, int threadCount) {
+    TEST_CHECK(serial->vertex_count == threaded->vertex_count &&
+               sameFloats(serial->vertices, threaded->vertices, serial->vertex_count),
+               "%d threads: positions differ", threadCount);
+    TEST_CHECK(serial->texcoord_count == threaded->texcoord_count &&
+               sameFloats(serial->texcoords, threaded->texcoords, serial->texcoord_count),
+               "%d threads: texcoords differ", threadCount);
+    TEST_CHECK(serial->normal_count == threaded->normal_count &&
+               sameFloats(serial->normals, threaded->normals, serial->normal_count),
+               "%d threads: normals differ", threadCount);
+    TEST_CHECK(serial->index_count == threaded->index_count &&
+               memcmp(serial->indices, threaded->indices, serial->index_count * sizeof(int)) == 0,
+               "%d threads: face indices differ", threadCount);
+    TEST_CHECK(serial->triangle_vertex_count == threaded->triangle_vertex_count &&
+               sameFloats(serial->triangle_vertices, threaded->triangle_vertices, serial->triangle_vertex_count),
+               "%d threads: triangle soup differs", threadCount);
+    TEST_CHECK(strcmp(serial->material_library, threaded->material_library) == 0, "%d threads: mtllib differs",
+               threadCount);
+    TEST_CHECK(serial->material_range_count == threaded->material_range_count, "%d threads: %zu material ranges, %zu serial",
+               threadCount, threaded->material_range_count, serial->material_range_count);
+    for (size_t r = 0; r < serial->material_range_count && r < threaded->material_range_count; ++r) {
+        const ObjMaterialRange* a = &serial->material_ranges[r];
+        const ObjMaterialRange* b = &threaded->material_ranges[r];
+        TEST_CHECK(strcmp(a->name, b->name) == 0 && a->firstTriangle == b->firstTriangle &&
+                   a->triangleCount == b->triangleCount, "%d threads: material range %zu differs", threadCount, r);
+    }
+}
+
+// The file is big enough for several chunks per thread, so chunk edges fall inside face
+// runs and between usemtl lines.
+static void checkThreadedFile(const char* name, int size, int flags) {
+    char path[256];
+    Test_ScratchPath(name, path, sizeof(path));
+    size_t bytes = Test_WriteGridOBJ(path, size, size, flags);
+    TEST_CHECK(bytes > 0, "cannot write %s", path);
+    if (!bytes) return;
+
+    ObjMesh serial;
+    TEST_CHECK(LoadOBJ(path, &serial) == 0, "LoadOBJ failed on %s", path);
+    TEST_CHECK(serial.index_count > 0, "no faces in %s", path);
+    for (int threadCount = 2; threadCount <= THREADED_MAX_THREADS; ++threadCount) {
+        ObjMesh threaded;
+        if (LoadOBJThreaded(path, &threaded, threadCount)) {
+            TEST_CHECK(0, "LoadOBJThreaded failed with %d threads", threadCount);
+            continue;
+        }
+        compareMeshes(&serial, &threaded, threadCount);
+        freeMesh(&threaded);
+    }
+    printf("  %s: %.1f MB, %zu triangles, %zu material ranges, 2..%d threads\n", name, bytes / (1024.0 * 1024.0),
+           serial.index_count / 9, serial.material_range_count, THREADED_MAX_THREADS);
+    freeMesh(&serial);
+    remove(path);
+}
+
+// LoadOBJThreaded against LoadOBJ, bit for bit, for every thread count
+void Test_ObjThreaded(void) {
+    checkThreadedFile("threaded_materials.obj", 240, TEST_GRID_MATERIALS);
+    checkThreadedFile("threaded_quads.obj", 200, TEST_GRID_QUADS | TEST_GRID_RELATIVE);
+}
+
+#define STREAM_CHUNK_VERTICES 4096
+
+static int countTriangles(const ObjStreamChunk* chunk, void* user) {
+    *(size_t*)user += chunk->index_count / 3;
+    return 0;
+}
+
+// The bound documented on LoadOBJStreaming
+static size_t streamScratchBound(const ObjStreamStats* stats, size_t chunkVertices) {
+    size_t pools = 0;
+    size_t floats[3] = {stats->positions * 3, stats->texcoords * 2, stats->normals * 3};
+    for (int i = 0; i < 3; ++i) {
+        size_t bytes = 2 * floats[i] * sizeof(float);
+        pools += bytes > 48 * 1024 ? bytes : 48 * 1024;
+    }
+    return OBJ_STREAM_BUFFER_BYTES + 96 * chunkVertices + pools;
+}
+
+static int streamFile(const char* path, ObjStreamStats* stats, size_t* triangles) {
+    *triangles = 0;
+    int result = LoadOBJStreaming(path, STREAM_CHUNK_VERTICES, countTriangles, triangles, stats);
+    TEST_CHECK(result == 0, "LoadOBJStreaming failed on %s", path);
+    TEST_CHECK(*triangles == stats->triangles, "%zu triangles emitted, %zu parsed", *triangles, stats->triangles);
+    return result == 0;
+}
+
+// Peak scratch memory depends on the v/vt/vn records, never on the faces: four times the
+// faces on the same vertices must peak at the same number of bytes.
+void Test_ObjStreaming(void) {
+    char path[256], repeatedPath[256];
+    Test_ScratchPath("stream.obj", path, sizeof(path));
+    Test_ScratchPath("stream_repeated.obj", repeatedPath, sizeof(repeatedPath));
+    size_t bytes = Test_WriteGridOBJ(path, 300, 300, 0);
+    size_t repeatedBytes = Test_WriteGridOBJ(repeatedPath, 300, 300, TEST_GRID_REPEAT_FACES);
+    TEST_CHECK(bytes && repeatedBytes, "cannot write the stream test files");
+    if (!bytes || !repeatedBytes) return;
+
+    ObjStreamStats stats, repeated;
+    size_t triangles, repeatedTriangles;
+    if (streamFile(path, &stats, &triangles) && streamFile(repeatedPath, &repeated, &repeatedTriangles)) {
+        TEST_CHECK(repeatedTriangles == 4 * triangles, "%zu triangles, expected %zu", repeatedTriangles, 4 * triangles);
+        TEST_CHECK(repeated.peak_bytes == stats.peak_bytes, "peak %zu bytes with 4x the faces, %zu without",
+                   repeated.peak_bytes, stats.peak_bytes);
+        size_t bound = streamScratchBound(&repeated, STREAM_CHUNK_VERTICES);
+        TEST_CHECK(repeated.peak_bytes <= bound, "peak %zu bytes above the documented %zu", repeated.peak_bytes, bound);
+
+        // Everything LoadOBJ holds at once for the same file: the mapping, the attributes,
+        // the corner indices and the soup
+        size_t whole = repeatedBytes + (repeated.positions * 3 + repeated.texcoords * 2 + repeated.normals * 3) * 4 +
+                       repeated.triangles * 3 * (3 * sizeof(int) + FLOATS_PER_VERTEX * sizeof(float));
+        TEST_CHECK(repeated.peak_bytes * 8 < whole, "peak %zu bytes, LoadOBJ %zu", repeated.peak_bytes, whole);
+        printf("  %.1f MB / %zu triangles and %.1f MB / %zu triangles: peak %zu KB (%zu KB pools, bound %zu KB), "
+               "LoadOBJ %zu KB\n", bytes / (1024.0 * 1024.0), triangles, repeatedBytes / (1024.0 * 1024.0),
+               repeatedTriangles, repeated.peak_bytes / 1024, repeated.attribute_bytes / 1024, bound / 1024,
+               whole / 1024);
+    }
+    remove(path);
+    remove(repeatedPath);
+}
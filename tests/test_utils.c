@@ -0,0 +1,78 @@
+#include "test.h"
+#include <math.h>
+#include <stdio.h>
+
+int Test_Failures = 0;
+
+void Test_ScratchPath(const char* name, char* out, size_t outSize) {
+    snprintf(out, outSize, "%s/test_%s", TEST_SCRATCH_DIRECTORY, name);
+}
+
+static float gridHeight(int column, int row) {
+    return 2.0f * sinf((float)column * 0.173f) * cosf((float)row * 0.131f);
+}
+
+size_t Test_WriteGridOBJ(const char* path, int columns, int rows, int flags) {
+    FILE* file = fopen(path, "wb");
+    if (!file) {
+        printf("[Test] Cannot write %s\n", path);
+        return 0;
+    }
+
+    fprintf(file, "# synthetic %dx%d grid\nmtllib grid.mtl\no grid\n", columns, rows);
+    for (int r = 0; r <= rows; ++r) {
+        for (int c = 0; c <= columns; ++c) {
+            fprintf(file, "v %.6f %.6f %.6f\n", (float)c * 0.5f, gridHeight(c, r), (float)r * -0.5f);
+        }
+    }
+    for (int r = 0; r <= rows; ++r) {
+        for (int c = 0; c <= columns; ++c) {
+            fprintf(file, "vt %.6f %.6f\n", (float)c / (float)columns, (float)r / (float)rows);
+        }
+    }
+    for (int r = 0; r <= rows; ++r) {
+        for (int c = 0; c <= columns; ++c) {
+            // Normal of the height field from central differences
+            float dx = gridHeight(c + 1, r) - gridHeight(c - 1, r);
+            float dz = gridHeight(c, r + 1) - gridHeight(c, r - 1);
+            float n[3] = {-dx, 2.0f, dz};
+            float length = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+            fprintf(file, "vn %.6f %.6f %.6f\n", n[0] / length, n[1] / length, n[2] / length);
+        }
+    }
+
+    long total = (long)(columns + 1) * (rows + 1);
+    int passes = (flags & TEST_GRID_REPEAT_FACES) ? 4 : 1;
+    for (int pass = 0; pass < passes; ++pass) {
+        for (int r = 0; r < rows; ++r) {
+            if ((flags & TEST_GRID_MATERIALS) && r % 8 == 0) fprintf(file, "usemtl material%d\n", (r / 8) % 3);
+            for (int c = 0; c < columns; ++c) {
+                long corners[4] = {
+                    (long)r * (columns + 1) + c + 1, (long)(r + 1) * (columns + 1) + c + 1,
+                    (long)(r + 1) * (columns + 1) + c + 2, (long)r * (columns + 1) + c + 2
+                };
+                if (flags & TEST_GRID_RELATIVE) {
+                    for (int k = 0; k < 4; ++k) corners[k] -= total + 1;
+                }
+                if (flags & TEST_GRID_QUADS) {
+                    fprintf(file, "f %ld/%ld/%ld %ld/%ld/%ld %ld/%ld/%ld %ld/%ld/%ld\n", corners[0], corners[0],
+                            corners[0], corners[1], corners[1], corners[1], corners[2], corners[2], corners[2],
+                            corners[3], corners[3], corners[3]);
+                } else {
+                    fprintf(file, "f %ld/%ld/%ld %ld/%ld/%ld %ld/%ld/%ld\n", corners[0], corners[0], corners[0],
+                            corners[1], corners[1], corners[1], corners[2], corners[2], corners[2]);
+                    fprintf(file, "f %ld/%ld/%ld %ld/%ld/%ld %ld/%ld/%ld\n", corners[0], corners[0], corners[0],
+                            corners[2], corners[2], corners[2], corners[3], corners[3], corners[3]);
+                }
+            }
+        }
+    }
+
+    long size = ftell(file);
+    int failed = ferror(file);
+    if (fclose(file) != 0 || failed || size <= 0) {
+        printf("[Test] Failed writing %s\n", path);
+        return 0;
+    }
+    return (size_t)size;
+}